@@ -38,7 +38,15 @@
 #include "pic_types.h"
 #include "unicode_font_types.h"
 #include "video_types.h"
+#include "thumb_cache.h"
+#include "slideshow.h"
+#include "pan_viewer.h"
 #include "easy_menu.h"
+// 由font_converter.py --embed-header生成，不存在时所有字符都从SD卡读取
+#if __has_include("embedded_font.h")
+#include "embedded_font.h"
+#define HAS_EMBEDDED_FONT 1
+#endif
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -48,6 +56,12 @@
 
 /* Private define ------------------------------------------------------------*/
 /* USER CODE BEGIN PD */
+#define MENU_GLYPH_CACHE_SIZE 128
+// 一页菜单（20个文件名）用到的字形能同时留在缓存中，预读后滚动不再读卡
+
+#define CANVAS_MEMORY_BYTES (SLIDE_FRAME_PIXELS * sizeof(uint16_t))
+// 画布条带模式的内存（条带、显示列表和掩码一次分配）正好是幻灯片的一帧，显示列表取剩下的约30KB；
+// 播放幻灯片时整块借作第一个帧缓冲区，不再另外分配
 
 /* USER CODE END PD */
 
@@ -60,7 +74,9 @@
 
 /* USER CODE BEGIN PV */
 UnicodeFont global_font;
-Canvas global_canvas(160, 128);
+// 条带模式，不常驻帧缓冲区
+Canvas global_canvas(160, 128, CANVAS_STRIP_ROWS,
+                     CANVAS_MEMORY_BYTES - Canvas::StripMemorySize(160, CANVAS_STRIP_ROWS, 0));
 
 easy_menu::Render render = {
     [](const char* str, uint16_t x, uint16_t y, bool color_inversion, void* data) {
@@ -83,10 +99,22 @@ easy_menu::Render render = {
         static_cast<Canvas*>(data)->DrawCanvasDMA(x, y);
     },
     [](uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t x0, uint16_t y0, void* data) {
-        static_cast<Canvas*>(data)->Copy(x, y, w, h, x0, y0);
+        // 显示列表溢出后部分像素只在屏幕上，不能复制；返回false时菜单整页重绘
+        auto canvas = static_cast<Canvas*>(data);
+        return !canvas->isDisplayListOverflowed() && canvas->Copy(x, y, w, h, x0, y0);
     },
     HAL_GetTick,
     &global_canvas,
+    [](uint16_t x, uint16_t y, uint16_t w, uint16_t h, int16_t dy, void* data) {
+        // 硬件滚动以整行为单位，只有区域横跨整个画布时可用；行列交换的方向下控制器只能左右滚动（见ScrollColumns），
+        // Scroll返回false，菜单退回到区域复制
+        auto canvas = static_cast<Canvas*>(data);
+        return x == 0 && w == canvas->GetSize().first && canvas->Scroll(y, h, dy);
+    },
+    [](const char* const* strings, uint16_t count, void*) {
+        // 按文件偏移顺序一次读入整页的字形，file_manager的每一页也经由这里预读
+        global_font.Preload(strings, count);
+    },
 };
 
 volatile easy_menu::InputEvent input = {false, false, false, false, false};
@@ -253,6 +281,7 @@ void canvas_test(UnicodeFont& font);
 void file_callback(const easy_menu::MenuCell* sender, easy_menu::ClickType type, void* user_data);
 void shift_callback(const easy_menu::MenuCell* sender, void* user_data);
 void open_file(const char* gbk_path);
+void pan_view(const char* gbk_path);
 void file_manager(const char* current_path = "/", uint32_t start_index = 0);
 /* USER CODE BEGIN PFP */
 
@@ -388,7 +417,11 @@ int main() {
 
     // 大字体，超过了1000字符缓存限制，不会分配索引缓存
     auto& font = global_font;
-    if (font.Load("/font/WenQuanDianZhenZhengHei-1_12x12.ufnt")) {
+#ifdef HAS_EMBEDDED_FONT
+    // ASCII和菜单文字在闪存中，显示时不读卡
+    font.SetEmbedded(&embedded_font);
+#endif
+    if (font.Load("/font/WenQuanDianZhenZhengHei-1_12x12.ufnt", MENU_GLYPH_CACHE_SIZE)) {
         printf("字体large加载成功！\r\n");
         ST7735_Select();
         WriteUnicodeStringUTF8DMA(0, offset += font.GetDefaultHeight() + 1, "你好，世界！", &font, ST7735_GREEN,
@@ -743,24 +776,32 @@ void spi_speed_test() {
         MODIFY_REG(hspi2.Instance->CR1, SPI_CR1_BR, prescaler);
         HAL_Delay(10);
 
-        ST7735_FillScreenFast(ST7735_BLACK);
-        HAL_Delay(10);
+        // 12位模式每帧少发送25%的字节，两种格式各测一次
+        for (ST7735_ColorMode mode : {ST7735_COLOR_16BIT, ST7735_COLOR_12BIT}) {
+            ST7735_SetColorMode(mode);
+            ST7735_FillScreenFast(ST7735_BLACK);
+            HAL_Delay(10);
 
-        uint32_t start_tick = HAL_GetTick();
-        for (int i = 0; i < test_frames; i++) {
-            ST7735_FillScreenFast(color_list[i % 4]);
-        }
-        uint32_t elapsed = HAL_GetTick() - start_tick;
+            uint32_t start_tick = HAL_GetTick();
+            for (int i = 0; i < test_frames; i++) {
+                ST7735_FillScreenFast(color_list[i % 4]);
+            }
+            ST7735_QueueFlush();
+            uint32_t elapsed = HAL_GetTick() - start_tick;
 
-        double fps = test_frames * 1000.0 / elapsed;
-        double kbps = test_frames * 40.96 / elapsed * 1000;
+            double frame_kb = ST7735_GetWidth() * ST7735_GetHeight() * (mode == ST7735_COLOR_12BIT ? 1.5 : 2.0) / 1000;
+            double fps = test_frames * 1000.0 / elapsed;
+            double kbps = test_frames * frame_kb / elapsed * 1000;
 
-        printf("刷屏 %d 次, 耗时 %lu ms\r\n", test_frames, elapsed);
-        printf("帧率: %.2f fps, 带宽: %.0f KB/s\r\n", fps, kbps);
+            printf("%s: 刷屏 %d 次, 耗时 %lu ms\r\n", mode == ST7735_COLOR_12BIT ? "RGB444" : "RGB565", test_frames,
+                   elapsed);
+            printf("帧率: %.2f fps, 带宽: %.0f KB/s\r\n", fps, kbps);
 
-        HAL_Delay(500);
+            HAL_Delay(500);
+        }
     }
 
+    ST7735_SetColorMode(ST7735_COLOR_16BIT);
     MODIFY_REG(hspi2.Instance->CR1, SPI_CR1_BR, SPI_BAUDRATEPRESCALER_2);
     printf("\r\n=== 测试完成，已恢复最高速度 ===\r\n\r\n");
 }
@@ -1075,6 +1116,7 @@ void canvas_test(UnicodeFont& font) {
     canvas.WriteUnicodeString(0, offset += font.GetDefaultHeight() + 1, "abcde", &font, ST7735_GREEN, ST7735_BLACK);
     canvas.WriteUnicodeString(0, offset += font.GetDefaultHeight() + 1, "「你好，世界♪」", &font, ST7735_GREEN, ST7735_YELLOW);
     printf("绘制文本耗时 %lu ms\r\n", HAL_GetTick() - start_tick);
+    if (canvas.isDisplayListOverflowed()) printf("显示列表已满，部分内容已提前发送到屏幕\r\n");
     canvas.DrawCanvasDMA();
     measure_free_heap();
     HAL_Delay(2000);
@@ -1137,7 +1179,13 @@ void open_file(const char* gbk_path) {
         VideoPlayer player(gbk_path);
         VideoInfo info;
         player.GetInfo(&info);
-        player.Play((160 - info.width) / 2, (128 - info.height) / 2, VIDEO_PLAY_MODE_POLLING);
+        // 竖屏视频横着放不下时旋转显示方向，旋转由LCD的扫描方向完成，不需要逐像素转置
+        ST7735_Rotation rotation = ST7735_GetRotation();
+        if (info.height > info.width && info.height > ST7735_GetHeight() && info.height <= ST7735_GetWidth()) {
+            ST7735_SetRotation((ST7735_Rotation)((rotation + 1) & 3));
+        }
+        player.Play((ST7735_GetWidth() - info.width) / 2, (ST7735_GetHeight() - info.height) / 2,
+                    VIDEO_PLAY_MODE_POLLING);
         bool paused = false;
         while (player.GetState() == VIDEO_STATE_PLAYING) {
             if (input.enter) {
@@ -1159,11 +1207,65 @@ void open_file(const char* gbk_path) {
                 }
             }
         }
+        ST7735_SetRotation(rotation);
         return;
     }
     else if (fs::suffix_matches(gbk_path, ".bmp") || fs::suffix_matches(gbk_path, ".jpg") || fs::suffix_matches(
-        gbk_path, ".raw")) {
-        PIC_DisplayStreamingDMA(gbk_path, 0, 0, 0, 0, 0, 0);
+        gbk_path, ".raw") || fs::suffix_matches(gbk_path, ".565") || fs::suffix_matches(gbk_path, ".png")) {
+        // 幻灯片：上下键切换同目录的图片，确认键暂停/恢复自动播放，shift键进入JPEG平移浏览；
+        // 画布的内存整块借作第一个帧缓冲区，第二个只在堆中还能留出解码器的内存时分配，
+        // 否则用一个帧缓冲区预加载下一张（见SLIDE_Open）；退出前收回，返回菜单后整体重绘
+        SlideConfig config;
+        SLIDE_GetDefaultConfig(&config);
+        uint32_t lent_size = 0;
+        void* lent = global_canvas.LendMemory(&lent_size);
+        config.frame_buffers[0] = lent_size >= CANVAS_MEMORY_BYTES ? static_cast<uint16_t*>(lent) : nullptr;
+        Slideshow slideshow(gbk_path, &config);
+        if (!slideshow.IsOpen()) {
+            global_canvas.ReturnMemory();
+            PIC_DisplayStreamingDMA(gbk_path, 0, 0, 0, 0, 0, 0);
+        }
+        else {
+            slideshow.Show();
+            bool paused = false;
+            while (!input.break_out and !return_home) {
+                if (input.up) {
+                    input.up = false;
+                    slideshow.Prev();
+                }
+                else if (input.down) {
+                    input.down = false;
+                    slideshow.Next();
+                }
+                else if (input.enter) {
+                    input.enter = false;
+                    paused = !paused;
+                    slideshow.SetPaused(paused);
+                }
+                else if (input.shift) {
+                    // JPEG原尺寸平移浏览，需要先关闭幻灯片释放帧缓冲区
+                    input.shift = false;
+                    const char* name = slideshow.GetName(slideshow.GetIndex());
+                    char path[256];
+                    const char* slash = strrchr(gbk_path, '/');
+                    snprintf(path, sizeof(path), "%.*s/%s", slash ? (int)(slash - gbk_path) : 0, gbk_path, name ? name : "");
+                    if (name && fs::suffix_matches(path, ".jpg")) {
+                        slideshow.Close();
+                        pan_view(path);
+                        slideshow.Open(path, &config);
+                        slideshow.Show();
+                        slideshow.SetPaused(paused);
+                    }
+                }
+                else {
+                    slideshow.Poll();
+                }
+            }
+            slideshow.Close();
+            global_canvas.ReturnMemory();
+            input.break_out = false;
+            return;
+        }
     }
     else {
         WriteUnicodeStringUTF8DMA(0, 0, "暂不支持此格式", &global_font, ST7735_GREEN, ST7735_BLACK);
@@ -1172,11 +1274,96 @@ void open_file(const char* gbk_path) {
     input.break_out = false;
 }
 
+// 平移缩放浏览：上下键沿当前方向平移，shift切换水平/垂直方向，确认键切换缩放级别，返回键退出
+void pan_view(const char* gbk_path) {
+    constexpr int32_t step = 32;
+    PanZoomViewer viewer(gbk_path);
+    if (!viewer.IsOpen()) {
+        printf("平移浏览打开失败: %s\r\n", PanZoomViewer::GetErrorString());
+        return;
+    }
+    ST7735_FillScreenFast(ST7735_BLACK);
+    viewer.Render();
+
+    bool horizontal = false;
+    while (!input.break_out and !return_home) {
+        if (input.up or input.down) {
+            int32_t delta = input.up ? -step : step;
+            input.up = false;
+            input.down = false;
+            if (horizontal) viewer.Move(delta, 0);
+            else viewer.Move(0, delta);
+        }
+        else if (input.shift) {
+            input.shift = false;
+            horizontal = !horizontal;
+        }
+        else if (input.enter) {
+            input.enter = false;
+            viewer.SetZoom((viewer.GetZoom() + 1) % (PAN_MAX_ZOOM + 1));
+            viewer.Render();
+        }
+        else {
+            viewer.ProcessIdle();
+        }
+    }
+    input.break_out = false;
+}
+
+// 文件浏览器右下角的缩略图预览，由display_canvas回调在每帧发送画布前叠加
+struct ThumbPreview {
+    static constexpr uint16_t X = 160 - 6 - THUMB_WIDTH - 2;
+    static constexpr uint16_t Y = 128 - THUMB_HEIGHT - 2;
+
+    ThumbnailCache* cache = nullptr;
+    easy_menu::StaticMenu* menu = nullptr;
+    const easy_menu::MenuCell* last_cell = nullptr;
+    char gbk_name[256] = {};    // 选中项的文件名（GBK），不是图片时为空
+    uint16_t* pixels = nullptr;
+    bool has_thumb = false;
+    bool shown = false;
+
+    // 空闲时生成了name的缩略图：只有属于选中项时才需要重新读取
+    void Generated(const char* name) {
+        if (name[0] != '\0' && strcmp(name, gbk_name) == 0) last_cell = nullptr;
+    }
+
+    void Overlay(Canvas& canvas) {
+        const easy_menu::MenuCell* cell = menu->get_current_item();
+        bool changed = cell != last_cell;
+        if (changed) {
+            last_cell = cell;
+            gbk_name[0] = '\0';
+            has_thumb = false;
+            if (cell && cell->title && ThumbnailCache::IsSupportedFormat(cell->title)) {
+                fs::utf8_to_gbk(cell->title, gbk_name, sizeof(gbk_name));
+                has_thumb = cache->Get(gbk_name, pixels);
+            }
+        }
+        if (has_thumb) {
+            // 画布中的缩略图没有被列表覆盖且没有换图时不再绘制，该区域不会被标记为脏而重复发送
+            if (changed || !shown || canvas.IsDirty(X - 1, Y - 1, THUMB_WIDTH + 2, THUMB_HEIGHT + 2)) {
+                canvas.FillRectangle(X - 1, Y - 1, THUMB_WIDTH + 2, THUMB_HEIGHT + 2, ST7735_WHITE);
+                canvas.DrawBitmap(X, Y, THUMB_WIDTH, THUMB_HEIGHT, pixels);
+            }
+            shown = true;
+        }
+        else if (shown) {
+            // 缩略图下面的列表内容已被覆盖，需要整体重绘
+            shown = false;
+            menu->force_redraw();
+        }
+    }
+};
+
+static ThumbPreview* thumb_preview = nullptr;
+
 void file_manager(const char* current_path, uint32_t start_index) {
     struct PublicData {
         bool is_dir[20] = {false};
         const char* path = nullptr;
         const char* current = nullptr;
+        easy_menu::BaseMenu* menu = nullptr;
     };
     struct Data {
         PublicData& data;
@@ -1187,15 +1374,21 @@ void file_manager(const char* current_path, uint32_t start_index) {
     bool next_page = false;
     data.current = current_path;
     char* path = nullptr;
+    uint32_t consumed = 0;
     {
         char names[20][256];
         int len = -1;
         {
             auto iter = fs::listdir(current_path).begin() + start_index;
-            for (int i = 0; i < 20; i++) {
+            for (int i = 0; i < 20;) {
                 if (iter != fs::DirectoryRange::end()) {
-                    strcpy(names[i], (*iter).name);
-                    data.is_dir[i] = (*iter).type == fs::ObjectType::dir;
+                    auto object = *iter;
+                    if (strcmp(object.name, THUMB_DB_FILENAME) != 0) {
+                        strcpy(names[i], object.name);
+                        data.is_dir[i] = object.type == fs::ObjectType::dir;
+                        i++;
+                    }
+                    consumed++;
                 }
                 else {
                     len = i;
@@ -1217,17 +1410,56 @@ void file_manager(const char* current_path, uint32_t start_index) {
                 }
                 else {
                     file_callback(sender, type, &data->data.current);
+                    // 打开文件时画布可能被借用（如幻灯片帧缓冲区），返回后整体重绘
+                    data->data.menu->force_redraw();
                 }
             }, temp);
         }
+        data.menu = &menu;
         if (!end) {
             menu.add_menu("加载下一页", [](const easy_menu::MenuCell* sender, easy_menu::ClickType type, void* user_data) {
                 *static_cast<bool*>(user_data) = true;
                 input.break_out = true;
             }, &next_page);
         }
+        // 缩略图：先登记本页所有图片，之后在没有按键输入的空闲时间逐个生成
+        char gbk_dir[256];
+        fs::utf8_to_gbk(current_path, gbk_dir, sizeof(gbk_dir));
+        ThumbnailCache thumbs(gbk_dir);
+        bool thumbs_pending = false;
+        if (thumbs.IsOpen()) {
+            for (int i = 0; i < len; i++) {
+                if (data.is_dir[i] || !ThumbnailCache::IsSupportedFormat(names[i])) continue;
+                char gbk_name[256];
+                fs::utf8_to_gbk(names[i], gbk_name, sizeof(gbk_name));
+                thumbs.Request(gbk_name);
+            }
+            thumbs_pending = true;
+        }
+
+        ThumbPreview preview;
+        preview.cache = &thumbs;
+        preview.menu = &menu;
+        preview.pixels = thumbs.IsOpen() ? new uint16_t[THUMB_WIDTH * THUMB_HEIGHT] : nullptr;
+        if (preview.pixels) thumb_preview = &preview;
+
+        easy_menu::Render browser_render = render;
+        browser_render.display_canvas = [](uint16_t x, uint16_t y, void* data) {
+            auto canvas = static_cast<Canvas*>(data);
+            if (thumb_preview) thumb_preview->Overlay(*canvas);
+            canvas->DrawCanvasDMA(x, y);
+        };
+
         easy_menu::MenuState state;
-        while (easy_menu::flush_menu(menu, input, render, state) and not return_home);
+        while (easy_menu::flush_menu(menu, input, browser_render, state) and not return_home) {
+            if (thumbs_pending && !input.up && !input.down && !input.enter && !input.shift && !input.break_out) {
+                char done_name[256];
+                thumbs_pending = thumbs.ProcessIdle(done_name, sizeof(done_name));
+                preview.Generated(done_name);
+            }
+        }
+        thumb_preview = nullptr;
+        delete[] preview.pixels;
         printf("1");
         if (data.path) {
             path = new char[256];
@@ -1240,7 +1472,7 @@ void file_manager(const char* current_path, uint32_t start_index) {
         if (!return_home) goto A;
     }
     if (next_page) {
-        file_manager(current_path, start_index + 20);
+        file_manager(current_path, start_index + consumed);
     }
     redraw = true;
 }
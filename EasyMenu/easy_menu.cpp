@@ -305,6 +305,22 @@ namespace easy_menu {
             return nullptr;
         }
 
+        void preload_page(BaseMenu& menu, const Render& render, uint32_t start_index) {
+            if (!render.preload_text) return;
+
+            // 一页的文字一起交给渲染层，逐项绘制和之后的滚动都不再等待读取
+            const char* strings[MENU_PRELOAD_MAX_ITEMS + 1];
+            uint16_t count = 0;
+            if (menu.title) strings[count++] = menu.title;
+
+            uint32_t total_items = menu.get_item_count();
+            for (uint32_t i = start_index; i < total_items && count < MENU_PRELOAD_MAX_ITEMS + 1; i++) {
+                MenuCell* item = get_item_by_index(menu, i);
+                if (item && item->title) strings[count++] = item->title;
+            }
+            render.preload_text(strings, count, render.user_data);
+        }
+
         bool is_item_selected(BaseMenu& menu, const MenuCell* item) {
             return menu.get_current_item() == item;
         }
@@ -364,7 +380,7 @@ namespace easy_menu {
         void scroll_redraw(BaseMenu& menu, const Render& render, uint16_t list_y, uint16_t item_height,
                            uint16_t list_width, uint32_t old_start_index, uint32_t new_start_index,
                            uint32_t visible_items, RenderCache& cache) {
-            if (render.copy_canvas && !cache.needs_full_redraw) {
+            if ((render.copy_canvas || render.scroll_canvas) && !cache.needs_full_redraw) {
                 auto scroll_offset = (static_cast<int32_t>(old_start_index) - static_cast<int32_t>(new_start_index)) *
                     static_cast<int32_t>(item_height);
 
@@ -378,10 +394,34 @@ namespace easy_menu {
 
                     uint16_t copy_height = actual_visible_items * item_height;
 
+                    if (scroll_offset < 0 && copy_height + scroll_offset > 0) {
+                        // 原来的选中项在最后一行，先取消高亮再随列表上移
+                        MenuCell* item;
+                        if (menu.asDynamicMenu()) {
+                            item = *std::prev(menu.asDynamicMenu()->current_item);
+                        }
+                        else {
+                            item = menu.asStaticMenu()->current_item - 1;
+                        }
+                        render.write_text_func(item->title, 0, list_y + item_height * (visible_items - 1), false,
+                                               render.user_data);
+                    }
+
+                    // 硬件滚动整个列表区域，不可用时退回到区域复制
+                    bool scrolled = render.scroll_canvas &&
+                                    render.scroll_canvas(menu.x, list_y, menu.w, visible_items * item_height,
+                                                         static_cast<int16_t>(scroll_offset), render.user_data);
+                    if (!scrolled && !render.copy_canvas) {
+                        cache.needs_full_redraw = true;
+                        return;
+                    }
+
                     if (scroll_offset > 0) {
-                        if (copy_height - scroll_offset > 0) {
-                            render.copy_canvas(menu.x, list_y, list_width, copy_height - scroll_offset,
-                                               menu.x, list_y + scroll_offset, render.user_data);
+                        if (!scrolled && copy_height - scroll_offset > 0 &&
+                            !render.copy_canvas(menu.x, list_y, list_width, copy_height - scroll_offset,
+                                                menu.x, list_y + scroll_offset, render.user_data)) {
+                            cache.needs_full_redraw = true;
+                            return;
                         }
 
                         for (uint32_t i = new_start_index; i < old_start_index; i++) {
@@ -396,18 +436,11 @@ namespace easy_menu {
                     else {
                         int32_t scroll_offset_abs = -scroll_offset;
                         uint16_t copy_height_abs = copy_height - scroll_offset_abs;
-                        if (copy_height_abs > 0) {
-                            MenuCell* item;
-                            if (menu.asDynamicMenu()) {
-                                item = *std::prev(menu.asDynamicMenu()->current_item);
-                            }
-                            else {
-                                item = menu.asStaticMenu()->current_item - 1;
-                            }
-                            render.write_text_func(item->title, 0, list_y + item_height * (visible_items - 1), false,
-                                                   render.user_data);
-                            render.copy_canvas(menu.x, list_y + scroll_offset_abs, list_width, copy_height_abs,
-                                               menu.x, list_y, render.user_data);
+                        if (!scrolled && copy_height_abs > 0 &&
+                            !render.copy_canvas(menu.x, list_y + scroll_offset_abs, list_width, copy_height_abs,
+                                                menu.x, list_y, render.user_data)) {
+                            cache.needs_full_redraw = true;
+                            return;
                         }
 
                         for (uint32_t i = old_start_index + visible_items; i < new_start_index + visible_items; i++) {
@@ -480,6 +513,7 @@ namespace easy_menu {
         bool menu_changed = (total_items != cache.last_total_items);
 
         if (cache.needs_full_redraw || menu_changed || active_menu->force_redraw_flag) {
+            preload_page(*active_menu, render, start_index);
             render.draw_rect_bg_func(active_menu->x, active_menu->y, active_menu->w, active_menu->h, render.user_data);
             render_title(*active_menu, render, state, current_tick);
 
@@ -620,6 +654,7 @@ namespace easy_menu {
         bool menu_changed = (total_items != cache.last_total_items);
 
         if (cache.needs_full_redraw || menu_changed || active_menu->force_redraw_flag) {
+            preload_page(*active_menu, render, start_index);
             render.draw_rect_bg_func(active_menu->x, active_menu->y, active_menu->w, active_menu->h, render.user_data);
             render_title(*active_menu, render, state, current_tick);
 
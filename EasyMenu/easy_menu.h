@@ -14,6 +14,9 @@
 #define DOUBLE_CLICK_INTERVAL_MS 300
 #define LONG_PRESS_THRESHOLD_MS 500
 
+#define MENU_PRELOAD_MAX_ITEMS 32
+// 整页重绘时最多把多少个菜单项的标题交给preload_text，包含可见项之后的项，滚动时也不用再读字形
+
 namespace easy_menu {
     using std::list;
     using std::pair;
@@ -41,9 +44,12 @@ namespace easy_menu {
     using DrawRectangleBg = void(*)(uint16_t x, uint16_t y, uint16_t w, uint16_t h, void* user_data); // 绘制背景色实心矩形的函数
     using DisplayCanvas = void(*)(uint16_t x, uint16_t y, void* user_data); // 渲染画布的函数
     using CalculateTextSize = pair<uint16_t, uint16_t>(*)(const char* str); // 计算字符串宽x高的函数
-    using CopyCanvas = void(*)(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t x0, uint16_t y0,
-                               void* user_data); // 复制画布区域的函数，将左上角x, y宽高w, h的区域复制到x0, y0
+    using CopyCanvas = bool(*)(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t x0, uint16_t y0,
+                               void* user_data); // 复制画布区域的函数，将左上角x, y宽高w, h的区域复制到x0, y0；无法复制时返回false，菜单整页重绘
+    using ScrollCanvas = bool(*)(uint16_t x, uint16_t y, uint16_t w, uint16_t h, int16_t dy, void* user_data);
+    // 把左上角x, y宽高w, h的区域整体移动dy行（正数向下），移出的行从另一端绕回；不支持时返回false
     using GetTick_ms = uint32_t(*)();
+    using PreloadText = void(*)(const char* const* strings, uint16_t count, void* user_data); // 预读一组字符串用到的资源
 
     struct Render {
         WriteText write_text_func;
@@ -54,6 +60,8 @@ namespace easy_menu {
         CopyCanvas copy_canvas; // 此函数允许为nullptr，此时菜单渲染会退回到基本渲染模式，不使用区域复制加速
         GetTick_ms get_tick_func;
         void* user_data;
+        ScrollCanvas scroll_canvas; // 允许为nullptr；可用时列表滚动优先使用硬件滚动，只发送新露出的项
+        PreloadText preload_text; // 允许为nullptr；整页重绘前收到标题和从首个可见项开始的菜单项标题
     };
 
     class BaseMenu {
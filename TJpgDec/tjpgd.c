@@ -22,6 +22,7 @@
 / Jun 11, 2021 R0.02a Some performance improvement.
 / Jul 01, 2021 R0.03  Added JD_FASTDECODE option.
 /                     Some performance improvement.
+/                     (local) Added jd_checkpoint() and jd_decomp_from().
 /----------------------------------------------------------------------------*/
 
 #include "tjpgd.h"
@@ -1151,3 +1152,90 @@ JRESULT jd_decomp (
 
 	return rc;
 }
+
+
+
+#if JD_FASTDECODE >= 1
+/*-----------------------------------------------------------------------*/
+/* Save the decoder state at an MCU boundary                             */
+/*-----------------------------------------------------------------------*/
+/* Call it in the output function. The state is that before loading the  */
+/* MCU next to the one being output. The application should also record */
+/* the stream offset of the first unread byte (its read offset - dctr).  */
+
+void jd_checkpoint (
+	JDEC* jd,			/* Pointer to the decompressor object */
+	uint32_t mcu,		/* Index of the MCU to be decoded next */
+	JCHECKPOINT* cp		/* Pointer to the checkpoint to be filled */
+)
+{
+	cp->mcu = mcu;
+	cp->wreg = jd->wreg;
+	cp->dbit = jd->dbit;
+	cp->marker = jd->marker;
+	cp->dcv[0] = jd->dcv[0]; cp->dcv[1] = jd->dcv[1]; cp->dcv[2] = jd->dcv[2];
+}
+
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Resume decompression from a checkpoint                                */
+/*-----------------------------------------------------------------------*/
+/* The input stream must have been repositioned by the application so    */
+/* that the next infunc call returns data from the recorded offset. A    */
+/* checkpoint at the start of restart interval n can be made without     */
+/* decoding: mcu = n * nrst, all other members zero, offset of its RSTn  */
+/* marker.                                                                */
+
+JRESULT jd_decomp_from (
+	JDEC* jd,								/* Initialized decompression object */
+	int (*outfunc)(JDEC*, void*, JRECT*),	/* RGB output function */
+	uint8_t scale,							/* Output de-scaling factor (0 to 3) */
+	const JCHECKPOINT* cp					/* Checkpoint to resume from */
+)
+{
+	unsigned int x, y, mx, my, ncol;
+	uint16_t rst, rsc;
+	JRESULT rc;
+
+
+	if (scale > (JD_USE_SCALE ? 3 : 0)) return JDR_PAR;
+	jd->scale = scale;
+
+	mx = jd->msx * 8; my = jd->msy * 8;			/* Size of the MCU (pixel) */
+	ncol = (jd->width + mx - 1) / mx;			/* Number of MCUs in a row */
+	if (cp->mcu >= ncol * ((jd->height + my - 1) / my)) return JDR_PAR;
+
+	jd->dctr = 0;								/* Discard buffered stream */
+	jd->wreg = cp->wreg; jd->dbit = cp->dbit; jd->marker = cp->marker;
+	jd->dcv[0] = cp->dcv[0]; jd->dcv[1] = cp->dcv[1]; jd->dcv[2] = cp->dcv[2];
+
+	rst = rsc = 0;
+	if (jd->nrst) {								/* Position in the restart interval */
+		rst = (uint16_t)(cp->mcu % jd->nrst);
+		rsc = (uint16_t)(cp->mcu / jd->nrst);
+		if (cp->mcu && !rst) {					/* At a boundary, the RSTn marker is read first */
+			rst = jd->nrst; rsc--;
+		}
+	}
+
+	rc = JDR_OK;
+	x = cp->mcu % ncol * mx;
+	for (y = cp->mcu / ncol * my; y < jd->height; y += my, x = 0) {	/* Vertical loop of MCUs */
+		for ( ; x < jd->width; x += mx) {		/* Horizontal loop of MCUs */
+			if (jd->nrst && rst++ == jd->nrst) {	/* Process restart interval if enabled */
+				rc = restart(jd, rsc++);
+				if (rc != JDR_OK) return rc;
+				rst = 1;
+			}
+			rc = mcu_load(jd);					/* Load an MCU (decompress huffman coded stream, dequantize and apply IDCT) */
+			if (rc != JDR_OK) return rc;
+			rc = mcu_output(jd, outfunc, x, y);	/* Output the MCU (YCbCr to RGB, scaling and output) */
+			if (rc != JDR_OK) return rc;
+		}
+	}
+
+	return rc;
+}
+#endif
@@ -90,9 +90,26 @@ struct JDEC {
 
 
 
+#if JD_FASTDECODE >= 1
+/* Decoder state at an MCU boundary, used to resume decompression in the middle of the scan */
+typedef struct {
+	uint32_t mcu;				/* Index of the MCU to be decoded next (raster order) */
+	uint32_t wreg;				/* Working shift register */
+	uint8_t dbit;				/* Number of bits available in wreg */
+	uint8_t marker;				/* Detected marker (0:None) */
+	int16_t dcv[3];				/* Previous DC element of each component */
+} JCHECKPOINT;
+#endif
+
+
+
 /* TJpgDec API functions */
 JRESULT jd_prepare (JDEC* jd, size_t (*infunc)(JDEC*,uint8_t*,size_t), void* pool, size_t sz_pool, void* dev);
 JRESULT jd_decomp (JDEC* jd, int (*outfunc)(JDEC*,void*,JRECT*), uint8_t scale);
+#if JD_FASTDECODE >= 1
+void jd_checkpoint (JDEC* jd, uint32_t mcu, JCHECKPOINT* cp);
+JRESULT jd_decomp_from (JDEC* jd, int (*outfunc)(JDEC*,void*,JRECT*), uint8_t scale, const JCHECKPOINT* cp);
+#endif
 
 
 #ifdef __cplusplus
@@ -3,6 +3,7 @@
 """
 Unicode字体转换脚本
 将TTF字体文件转换为单片机可用的字体文件格式
+依赖Pillow（fontTools可选），见requirements.txt：pip install -r requirements.txt
 """
 
 import os
@@ -20,7 +21,11 @@ except ImportError:
 class UnicodeFontConverter:
     def __init__(self):
         self.file_header = b'UFNT'  # 文件标识
-        self.version = 1
+        self.file_header_v2 = b'UFN2'
+        self.file_header_v3 = b'UFN3'  # v2格式加每像素位数（抗锯齿字形）
+        self.bits_per_pixel = 1  # 2或4时位图每个像素是笔画的覆盖度
+        self.version = 2
+        self.min_fixed_run = 4  # 尺寸相同的连续字符达到此数量才单独作为定长区段
         
     def parse_char_set(self, char_set_file, full_unicode=False):
         """解析字符集文件"""
@@ -260,8 +265,9 @@ class UnicodeFontConverter:
     
     def get_char_bitmap(self, font, char, font_size, offset_map):
         """获取字符的位图数据"""
-        # 创建临时图像
-        img = Image.new('1', (font_size * 2, font_size * 2), 0)
+        # 创建临时图像，多位字形用灰度图像得到抗锯齿的覆盖度
+        bpp = self.bits_per_pixel
+        img = Image.new('1' if bpp == 1 else 'L', (font_size * 2, font_size * 2), 0)
         draw = ImageDraw.Draw(img)
         
         # 应用字符偏移
@@ -269,11 +275,16 @@ class UnicodeFontConverter:
         
         # 绘制字符
         try:
-            draw.text((0, y_offset), char, font=font, fill=1)
+            draw.text((0, y_offset), char, font=font, fill=1 if bpp == 1 else 255)
         except Exception as e:
             print(f"警告: 无法渲染字符 '{char}': {e}")
             return None, 0, 0
         
+        # 覆盖度先量化为0~2^bpp-1，量化为0的淡边不计入边界框
+        levels = (1 << bpp) - 1
+        if bpp > 1:
+            img = img.point(lambda v: (v * levels + 127) // 255)
+        
         # 获取字符边界框
         bbox = img.getbbox()
         if not bbox:
@@ -283,16 +294,15 @@ class UnicodeFontConverter:
         char_img = img.crop(bbox)
         width, height = char_img.size
         
-        # 转换为位图数据
+        # 转换为位图数据，每个像素bpp位，高位在前
         bitmap_data = []
         for y in range(height):
             byte = 0
             bit_count = 0
             for x in range(width):
-                pixel = char_img.getpixel((x, y))
-                if pixel > 0:
-                    byte |= (1 << (7 - bit_count))
-                bit_count += 1
+                pixel = min(char_img.getpixel((x, y)), levels)
+                byte |= pixel << (8 - bpp - bit_count)
+                bit_count += bpp
                 if bit_count == 8:
                     bitmap_data.append(byte)
                     byte = 0
@@ -304,6 +314,226 @@ class UnicodeFontConverter:
         
         return bytes(bitmap_data), width, height
     
+    def encode_rle(self, bitmap_data, width, height):
+        """将位图编码为半字节像素游程（行优先，从空白开始与笔画交替，15表示同色游程继续）"""
+        row_bytes = (width + 7) // 8
+        pixels = [(bitmap_data[y * row_bytes + x // 8] >> (7 - x % 8)) & 1
+                  for y in range(height) for x in range(width)]
+        
+        # 最后一段空白由解码端补齐
+        while pixels and pixels[-1] == 0:
+            pixels.pop()
+        
+        nibbles = []
+        ink = 0
+        i = 0
+        while i < len(pixels):
+            run = 0
+            while i < len(pixels) and pixels[i] == ink:
+                run += 1
+                i += 1
+            while run >= 15:
+                nibbles.append(15)
+                run -= 15
+            nibbles.append(run)
+            ink ^= 1
+        
+        if len(nibbles) % 2:
+            nibbles.append(0)
+        return bytes((nibbles[k] << 4) | nibbles[k + 1] for k in range(0, len(nibbles), 2))
+    
+    def build_ranges(self, char_entries, rle):
+        """将有序的字符划分为码点连续的区段：尺寸相同的未压缩字符组成定长区段，其余字符放入字形表"""
+        glyphs = []
+        for unicode, char_width, char_height, bitmap_data, data_size in char_entries:
+            data, encoding = bitmap_data, 0
+            if rle:
+                packed = self.encode_rle(bitmap_data, char_width, char_height)
+                if len(packed) < len(bitmap_data):
+                    data, encoding = packed, 1
+            glyphs.append((unicode, char_width, char_height, data, encoding))
+        
+        # 码点连续的字符，区段字符数不超过65535
+        runs = []
+        for glyph in glyphs:
+            if runs and glyph[0] == runs[-1][-1][0] + 1 and len(runs[-1]) < 0xFFFF:
+                runs[-1].append(glyph)
+            else:
+                runs.append([glyph])
+        
+        ranges = []
+        for run in runs:
+            i = 0
+            while i < len(run):
+                j = i
+                if run[i][4] == 0:
+                    while j + 1 < len(run) and run[j + 1][4] == 0 and run[j + 1][1:3] == run[i][1:3]:
+                        j += 1
+                
+                if run[i][4] == 0 and j - i + 1 >= self.min_fixed_run:
+                    ranges.append((True, run[i:j + 1]))
+                    i = j + 1
+                    continue
+                
+                # 与前面尺寸不一的字符合并为一个区段
+                if i > 0 and ranges and not ranges[-1][0]:
+                    ranges[-1][1].append(run[i])
+                else:
+                    ranges.append((False, [run[i]]))
+                i += 1
+        
+        # 字形表项比单字符区段更省空间的只有三个字符以上的区段；单字符区段本身可以记录压缩
+        result = []
+        for fixed, glyphs in ranges:
+            if not fixed and len(glyphs) <= 2:
+                result.extend((True, [glyph]) for glyph in glyphs)
+            else:
+                result.append((fixed, glyphs))
+        return result
+    
+    def write_v1(self, f, default_width, default_height, char_entries):
+        """写入v1格式：每个字符16字节的索引项，位图不压缩"""
+        f.write(self.file_header)  # 4字节: UFNT
+        f.write(struct.pack('>HH', default_width, default_height))  # 2+2字节: 默认宽高
+        
+        # 写入实际的字符数量
+        actual_char_count = len(char_entries)
+        f.write(struct.pack('>I', actual_char_count))  # 4字节: 实际字符数量
+        
+        # 计算数据偏移量（文件头 + 字符数量 + 字符索引表）
+        data_offset = 8 + 4 + actual_char_count * (4 + 2 + 2 + 4 + 4)  # 文件头(8) + 字符数量(4) + 每个字符的索引信息(16)
+        
+        # 写入字符索引表
+        for unicode, char_width, char_height, bitmap_data, data_size in char_entries:
+            # 写入字符索引信息（与单片机端UnicodeCharInfo结构完全匹配）
+            f.write(struct.pack('>I', unicode))  # 4字节: Unicode码
+            f.write(struct.pack('>H', char_width))   # 2字节: 字符宽度
+            f.write(struct.pack('>H', char_height))  # 2字节: 字符高度
+            f.write(struct.pack('>I', data_offset))  # 4字节: 数据偏移
+            f.write(struct.pack('>I', data_size))    # 4字节: 数据大小
+            
+            data_offset += data_size
+        
+        # 写入字符位图数据
+        for unicode, char_width, char_height, bitmap_data, data_size in char_entries:
+            f.write(bitmap_data)
+    
+    def write_v2(self, f, default_width, default_height, char_entries, rle):
+        """写入v2格式：区段表 + 字形表 + 位图，返回区段数和字形表项数；多位字形写为v3格式"""
+        ranges = self.build_ranges(char_entries, rle)
+        glyph_count = sum(len(glyphs) for fixed, glyphs in ranges if not fixed)
+        
+        # 文件头(8) + 字符数量、区段数量、字形表偏移(12) + 每个区段16字节 + 每个字形表项8字节；
+        # v3在字形表偏移之后多4字节：每像素位数和3个保留字节
+        counts_size = 12 if self.bits_per_pixel == 1 else 16
+        glyph_table_offset = 8 + counts_size + len(ranges) * 16
+        data_offset = glyph_table_offset + glyph_count * 8
+        
+        range_table = bytearray()
+        glyph_table = bytearray()
+        bitmaps = bytearray()
+        glyph_index = 0
+        for fixed, glyphs in ranges:
+            start, char_width, char_height = glyphs[0][0], glyphs[0][1], glyphs[0][2]
+            if fixed:
+                # 首码点、字符数、宽、高、第一个位图的偏移；单个压缩字符最后4字节为压缩标志和存储大小，否则为0
+                encoding, data = glyphs[0][4], glyphs[0][3]
+                packed = (1 << 31) | len(data) if encoding else 0
+                range_table += struct.pack('>IHBBII', start, len(glyphs), char_width, char_height,
+                                           data_offset + len(bitmaps), packed)
+                for glyph in glyphs:
+                    bitmaps += glyph[3]
+            else:
+                # 宽高为0表示尺寸不一，数据为第一个字形表项的序号
+                range_table += struct.pack('>IHBBII', start, len(glyphs), 0, 0, glyph_index, 0)
+                for unicode, char_width, char_height, data, encoding in glyphs:
+                    # 位图偏移（最高位为压缩标志）、宽、高、存储大小
+                    glyph_table += struct.pack('>IBBH', (data_offset + len(bitmaps)) | (encoding << 31),
+                                               char_width, char_height, len(data))
+                    bitmaps += data
+                    glyph_index += 1
+        
+        f.write(self.file_header_v2 if self.bits_per_pixel == 1 else self.file_header_v3)  # 4字节: UFN2或UFN3
+        f.write(struct.pack('>HH', default_width, default_height))
+        f.write(struct.pack('>III', len(char_entries), len(ranges), glyph_table_offset))
+        if self.bits_per_pixel > 1:
+            f.write(struct.pack('>B3x', self.bits_per_pixel))
+        f.write(range_table)
+        f.write(glyph_table)
+        f.write(bitmaps)
+        return len(ranges), glyph_count
+    
+    def parse_embed_chars(self, embed_chars_file):
+        """解析编译进闪存的字符子集：ASCII可打印字符加上文件中出现的字符（如菜单文字）"""
+        chars = set(chr(i) for i in range(0x21, 0x7F))
+        
+        if embed_chars_file:
+            if not os.path.exists(embed_chars_file):
+                print(f"警告: 内嵌字符文件 {embed_chars_file} 不存在")
+            else:
+                with open(embed_chars_file, 'r', encoding='utf-8') as f:
+                    for char in f.read():
+                        if ord(char) > 0x20 and not char.isspace():
+                            chars.add(char)
+        
+        return sorted(chars)
+    
+    def write_embed_header(self, output_file, name, font, font_size, offset_map, chars,
+                           default_width, default_height, description):
+        """生成C++头文件，把字形子集以constexpr数组编译进闪存"""
+        glyphs = []
+        bitmaps = bytearray()
+        for char in chars:
+            bitmap_data, char_width, char_height = self.get_char_bitmap(font, char, font_size, offset_map)
+            if not bitmap_data:
+                continue
+            if char_width > 255 or char_height > 255:
+                print(f"警告: 内嵌字符 U+{ord(char):04X} 尺寸超过255，已跳过")
+                continue
+            glyphs.append((ord(char), char_width, char_height, len(bitmaps)))
+            bitmaps += bitmap_data
+        
+        if not glyphs:
+            print("警告: 没有可内嵌的字符，未生成头文件")
+            return False
+        
+        guard = ''.join(c if c.isalnum() else '_' for c in os.path.basename(output_file)).upper()
+        lines = [
+            f"// 由font_converter.py生成，请勿手动修改",
+            f"// {description}：{len(glyphs)} 个字符，位图 {len(bitmaps)} 字节",
+            f"#ifndef {guard}",
+            f"#define {guard}",
+            "",
+            '#include "unicode_font_types.h"',
+            "",
+            f"inline constexpr uint8_t {name}_bitmaps[] = {{",
+        ]
+        for i in range(0, len(bitmaps), 16):
+            lines.append("    " + " ".join(f"0x{b:02X}," for b in bitmaps[i:i + 16]))
+        lines += [
+            "};",
+            "",
+            f"inline constexpr EmbeddedGlyph {name}_glyphs[] = {{",
+        ]
+        for unicode, char_width, char_height, offset in glyphs:
+            lines.append(f"    {{0x{unicode:04X}, {char_width}, {char_height}, {offset}}},  // '{chr(unicode)}'")
+        lines += [
+            "};",
+            f'static_assert(IsEmbeddedGlyphsSorted({name}_glyphs), "内嵌字形必须按码点升序排列");',
+            "",
+            f"inline constexpr EmbeddedFont {name} = {{",
+            f"    {default_width}, {default_height}, {len(glyphs)}, {name}_glyphs, {name}_bitmaps, {self.bits_per_pixel},",
+            "};",
+            "",
+            f"#endif // {guard}",
+        ]
+        
+        with open(output_file, 'w', encoding='utf-8') as f:
+            f.write("\n".join(lines) + "\n")
+        
+        print(f"内嵌字形头文件: {output_file}（{len(glyphs)} 个字符，{len(bitmaps)} 字节）")
+        return True
+    
     def parse_size_spec(self, size_spec):
         """解析字体大小规格"""
         sizes = []
@@ -333,12 +563,24 @@ class UnicodeFontConverter:
         
         return sizes
     
-    def convert_font(self, font_path, size_spec, char_set_file, output_dir, offset_file=None, full_unicode=False):
+    def convert_font(self, font_path, size_spec, char_set_file, output_dir, offset_file=None, full_unicode=False,
+                     font_format=2, rle=False, embed_header=None, embed_chars_file=None, embed_name='embedded_font',
+                     bits_per_pixel=1):
         """转换字体文件"""
         if not os.path.exists(font_path):
             print(f"错误: 字体文件 {font_path} 不存在")
             return False
         
+        # 多位字形只能写为v3格式，游程编码只区分笔画和空白，不用于多位字形
+        self.bits_per_pixel = bits_per_pixel
+        if bits_per_pixel > 1:
+            if font_format == 1:
+                print(f"警告: {bits_per_pixel}位字形需要v2布局，改用v3格式")
+                font_format = 2
+            if rle:
+                print(f"警告: {bits_per_pixel}位字形不使用游程编码")
+                rle = False
+        
         os.makedirs(output_dir, exist_ok=True)
         
         chars = self.parse_char_set(char_set_file, full_unicode)
@@ -386,54 +628,55 @@ class UnicodeFontConverter:
                 if bitmap:
                     default_width, default_height = w, h
             
-            # 创建字体文件
-            with open(output_file, 'wb') as f:
-                # 写入文件头
-                f.write(self.file_header)  # 4字节: UFNT
-                f.write(struct.pack('>HH', default_width, default_height))  # 2+2字节: 默认宽高
-                
-                # 先收集所有成功转换的字符
-                char_entries = []
-                for char in chars:
-                    unicode = ord(char)
-                    bitmap_data, char_width, char_height = self.get_char_bitmap(font, char, font_size, offset_map)
-                    
-                    if not bitmap_data:
-                        try:
-                            print(f"警告: 跳过无法渲染的字符 '{char}' (U+{unicode:04X})")
-                        except UnicodeEncodeError:
-                            print(f"警告: 跳过无法渲染的字符 U+{unicode:04X}")
-                        continue
-                    
-                    data_size = len(bitmap_data)
-                    char_entries.append((unicode, char_width, char_height, bitmap_data, data_size))
-                
-                # 字符已经按Unicode码有序排列（由parse_char_set保证）
-                print(f"字符已按Unicode码有序排列，共 {len(char_entries)} 个字符")
-                
-                # 写入实际的字符数量
-                actual_char_count = len(char_entries)
-                f.write(struct.pack('>I', actual_char_count))  # 4字节: 实际字符数量
-                
-                # 计算数据偏移量（文件头 + 字符数量 + 字符索引表）
-                data_offset = 8 + 4 + actual_char_count * (4 + 2 + 2 + 4 + 4)  # 文件头(8) + 字符数量(4) + 每个字符的索引信息(16)
+            # 内嵌字形与字体文件使用相同的尺寸，多个尺寸时文件名和符号名加上尺寸后缀
+            if embed_header:
+                header_path, header_name = embed_header, embed_name
+                if len(sizes) > 1:
+                    root, ext = os.path.splitext(embed_header)
+                    header_path = f"{root}_{width}x{height}{ext}"
+                    header_name = f"{embed_name}_{width}x{height}"
+                self.write_embed_header(header_path, header_name, font, font_size, offset_map,
+                                        self.parse_embed_chars(embed_chars_file), default_width, default_height,
+                                        f"{font_name} {width}x{height}")
+            
+            # 先收集所有成功转换的字符
+            char_entries = []
+            for char in chars:
+                unicode = ord(char)
+                bitmap_data, char_width, char_height = self.get_char_bitmap(font, char, font_size, offset_map)
                 
-                # 写入字符索引表
-                for unicode, char_width, char_height, bitmap_data, data_size in char_entries:
-                    # 写入字符索引信息（与单片机端UnicodeCharInfo结构完全匹配）
-                    f.write(struct.pack('>I', unicode))  # 4字节: Unicode码
-                    f.write(struct.pack('>H', char_width))   # 2字节: 字符宽度
-                    f.write(struct.pack('>H', char_height))  # 2字节: 字符高度
-                    f.write(struct.pack('>I', data_offset))  # 4字节: 数据偏移
-                    f.write(struct.pack('>I', data_size))    # 4字节: 数据大小
-                    
-                    data_offset += data_size
+                if not bitmap_data:
+                    try:
+                        print(f"警告: 跳过无法渲染的字符 '{char}' (U+{unicode:04X})")
+                    except UnicodeEncodeError:
+                        print(f"警告: 跳过无法渲染的字符 U+{unicode:04X}")
+                    continue
                 
-                # 写入字符位图数据
-                for unicode, char_width, char_height, bitmap_data, data_size in char_entries:
-                    f.write(bitmap_data)
+                data_size = len(bitmap_data)
+                char_entries.append((unicode, char_width, char_height, bitmap_data, data_size))
+            
+            # 字符已经按Unicode码有序排列（由parse_char_set保证）
+            print(f"字符已按Unicode码有序排列，共 {len(char_entries)} 个字符")
+            
+            # v2的字形表以单字节保存宽高，超出时退回v1
+            file_format = font_format
+            if file_format == 2 and any(w > 255 or h > 255 for _, w, h, _, _ in char_entries):
+                if bits_per_pixel > 1:
+                    print(f"错误: 存在宽或高超过255的字符，{bits_per_pixel}位字形无法改用v1格式")
+                    continue
+                print("警告: 存在宽或高超过255的字符，改用v1格式")
+                file_format = 1
+            
+            # 创建字体文件
+            with open(output_file, 'wb') as f:
+                if file_format == 2:
+                    range_count, glyph_count = self.write_v2(f, default_width, default_height, char_entries, rle)
+                    print(f"v{2 if bits_per_pixel == 1 else 3}格式: {range_count} 个区段，字形表 {glyph_count} 项，"
+                          f"每像素 {bits_per_pixel} 位")
+                else:
+                    self.write_v1(f, default_width, default_height, char_entries)
                 
-                print(f"成功转换字符数量: {len(char_entries)}")
+                print(f"成功转换字符数量: {len(char_entries)}，文件大小: {f.tell()} 字节")
                 success_count += 1
         
         print(f"\n字体转换完成! 成功转换 {success_count}/{len(sizes)} 个尺寸")
@@ -466,6 +709,13 @@ def main():
     parser.add_argument('--offset', help='字符偏移配置文件路径')
     parser.add_argument('--create-sample', action='store_true', help='创建示例字符集文件')
     parser.add_argument('--full-unicode', action='store_true', help='遍历完整Unicode字符表（覆盖字符集文件）')
+    parser.add_argument('--format', type=int, choices=[1, 2], default=2, help='输出文件格式版本（默认2）')
+    parser.add_argument('--rle', action='store_true', help='v2格式中对压缩后更小的字符使用游程编码')
+    parser.add_argument('--bpp', type=int, choices=[1, 2, 4], default=1,
+                        help='每像素位数，2或4生成抗锯齿字形（v3格式，默认1）')
+    parser.add_argument('--embed-header', help='同时生成内嵌字形子集的C++头文件（如st7735/embedded_font.h）')
+    parser.add_argument('--embed-chars', help='内嵌字符文件，ASCII之外需要内嵌的字符（如菜单文字）')
+    parser.add_argument('--embed-name', default='embedded_font', help='内嵌字体的符号名（默认embedded_font）')
     
     args = parser.parse_args()
     
@@ -482,7 +732,13 @@ def main():
         args.char_set,
         args.output_dir,
         args.offset,
-        args.full_unicode
+        args.full_unicode,
+        args.format,
+        args.rle,
+        args.embed_header,
+        args.embed_chars,
+        args.embed_name,
+        args.bpp
     )
     
     if not success:
@@ -0,0 +1,117 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+图片转换脚本
+将PNG/JPEG等图片转换为单片机可直接流式显示的RGB565格式（.565）
+文件格式与st7735/pic_types.h中的PicRawHeader一致
+"""
+
+import os
+import sys
+import struct
+import argparse
+from pathlib import Path
+from PIL import Image
+
+class RawImageConverter:
+    def __init__(self):
+        self.magic = b'R565'        # 文件标识
+        self.version = 1
+        self.sector_size = 512
+        self.header_size = 16
+
+    def fit_image(self, image, max_width, max_height):
+        """保持宽高比缩小到指定范围内（不放大）"""
+        if not max_width and not max_height:
+            return image
+        max_width = max_width or image.width
+        max_height = max_height or image.height
+        scale = min(max_width / image.width, max_height / image.height, 1.0)
+        if scale >= 1.0:
+            return image
+        size = (max(1, round(image.width * scale)), max(1, round(image.height * scale)))
+        return image.resize(size, Image.LANCZOS)
+
+    def encode_pixels(self, image, little_endian):
+        """转换为RGB565像素数据"""
+        fmt = '<H' if little_endian else '>H'
+        data = bytearray()
+        for r, g, b in image.getdata():
+            data += struct.pack(fmt, ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3))
+        return data
+
+    def build_header(self, width, height, little_endian, data_offset):
+        """构建16字节文件头"""
+        return struct.pack('<4sBBHHHI', self.magic, self.version, 1 if little_endian else 0,
+                           width, height, 0, data_offset)
+
+    def convert(self, input_path, output_path, max_width=0, max_height=0, little_endian=True, pad=True,
+                background=(0, 0, 0)):
+        """转换单个图片文件"""
+        try:
+            image = Image.open(input_path)
+        except Exception as e:
+            print(f"错误: 无法打开图片 {input_path}: {e}")
+            return False
+
+        # 带透明通道的图片与背景色混合
+        if image.mode in ('RGBA', 'LA', 'P'):
+            image = image.convert('RGBA')
+            canvas = Image.new('RGBA', image.size, background + (255,))
+            canvas.alpha_composite(image)
+            image = canvas
+        image = self.fit_image(image.convert('RGB'), max_width, max_height)
+
+        if image.width > 0xFFFF or image.height > 0xFFFF:
+            print(f"错误: 图片尺寸过大 {image.width}x{image.height}")
+            return False
+
+        # 像素数据按扇区对齐，使设备上的FatFs可以直接多扇区读取到DMA缓冲区
+        data_offset = self.sector_size if pad else self.header_size
+        header = self.build_header(image.width, image.height, little_endian, data_offset)
+        pixels = self.encode_pixels(image, little_endian)
+
+        with open(output_path, 'wb') as f:
+            f.write(header)
+            f.write(b'\0' * (data_offset - len(header)))
+            f.write(pixels)
+
+        print(f"已转换: {input_path} -> {output_path} ({image.width}x{image.height}, "
+              f"{'小端' if little_endian else '大端'}, 数据偏移 {data_offset})")
+        return True
+
+def main():
+    parser = argparse.ArgumentParser(description='RGB565图片转换工具')
+    parser.add_argument('inputs', nargs='+', help='输入图片路径（PNG/JPEG等PIL支持的格式）')
+    parser.add_argument('-o', '--output', help='输出文件路径（单个输入）或输出目录（多个输入），默认与输入同目录')
+    parser.add_argument('--width', type=int, default=0, help='最大宽度，超过时按比例缩小（如160）')
+    parser.add_argument('--height', type=int, default=0, help='最大高度，超过时按比例缩小（如128）')
+    parser.add_argument('--big-endian', action='store_true', help='以高字节在前存储像素（设备显示时需要交换字节，较慢）')
+    parser.add_argument('--no-pad', action='store_true', help='不把像素数据填充到扇区边界')
+    parser.add_argument('--bg-color', help='透明区域的背景颜色，格式: R,G,B (默认: 0,0,0)')
+
+    args = parser.parse_args()
+
+    background = (0, 0, 0)
+    if args.bg_color:
+        background = tuple(int(c) for c in args.bg_color.split(','))
+
+    converter = RawImageConverter()
+    success = True
+    for input_path in args.inputs:
+        if args.output and len(args.inputs) == 1 and not os.path.isdir(args.output):
+            output_path = args.output
+        else:
+            output_dir = args.output or os.path.dirname(input_path)
+            if output_dir:
+                os.makedirs(output_dir, exist_ok=True)
+            output_path = os.path.join(output_dir, Path(input_path).stem + '.565')
+
+        success &= converter.convert(input_path, output_path, args.width, args.height,
+                                     not args.big_endian, not args.no_pad, background)
+
+    if not success:
+        sys.exit(1)
+
+if __name__ == '__main__':
+    main()
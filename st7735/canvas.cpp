@@ -1,376 +1,1077 @@
 //
 // Canvas 画布类实现
 // 提供离屏缓冲区和图形绘制功能
+// 每个绘制方法都生成一条绘制命令：帧缓冲区模式下立即光栅化，条带模式下记录到显示列表，显示时逐条带重放
 //
 
 #include "canvas.h"
 #include <algorithm>
 #include <optional>
 #include <cmath>
+#include <cstring>
 
 extern "C" {
 #include "st7735.h"
 }
 
-void Canvas::FillRectangle(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color) {
-    if (!buffer) return;
-    if (x >= width || y >= height) return;
-
-    if (x + w > width) w = width - x;
-    if (y + h > height) h = height - y;
-    if (w == 0 || h == 0) return;
+Canvas::Canvas(uint16_t width, uint16_t height, uint16_t strip_rows, uint32_t list_size)
+    : width(width), height(height), auto_release(false) {
+    AllocateStrips(strip_rows, list_size);
+}
 
-    uint16_t swapped_color = swap_bytes(color);
-    uint16_t* row_start = buffer + y * width + x;
+bool Canvas::AllocateStrips(uint16_t rows, uint32_t list_size) {
+    ReleaseStrips();
+    if (rows == 0 || rows > height) rows = height;
 
-    for (uint16_t row = 0; row < h; row++) {
-        std::fill_n(row_start + row * width, w, swapped_color);
-    }
+    // 一次分配：只占一个堆块，整块可以借出（LendMemory）
+    strip_block = new uint8_t[StripMemorySize(width, rows, list_size)];
+    if (!strip_block) return false;
+    AssignStrips(strip_block, rows, list_size);
+    dirty_all = true;
+    return true;
 }
 
-void Canvas::FillCanvas(uint16_t color) {
-    if (!buffer) return;
+void Canvas::AssignStrips(uint8_t* block, uint16_t rows, uint32_t list_size) {
+    uint32_t list_bytes = StripMemorySize(width, 0, list_size);
+    display_list = block;
+    strips[0] = reinterpret_cast<uint16_t*>(block + list_bytes);
+    strips[1] = strips[0] + width * rows;
+    known_mask = reinterpret_cast<uint8_t*>(strips[1] + width * rows);
+    strip_rows = rows;
+    list_capacity = list_size;
+    list_used = 0;
+    list_overflow = false;
+}
 
-    uint16_t swapped_color = swap_bytes(color);
-    std::fill_n(buffer, static_cast<size_t>(width) * height, swapped_color);
+void Canvas::ReleaseStrips() {
+    ReturnMemory();
+    // 条带可能仍在DMA发送
+    while (strip_busy[0] || strip_busy[1]);
+
+    delete[] strip_block;
+    strip_block = nullptr;
+    strips[0] = strips[1] = nullptr;
+    display_list = nullptr;
+    known_mask = nullptr;
+    strip_rows = 0;
+    list_capacity = 0;
+    list_used = 0;
+    list_overflow = false;
 }
 
-#if ENABLE_ADVANCED_METHOD != 0
+void* Canvas::LendMemory(uint32_t* size) {
+    if (lent_block || (!strip_block && !buffer)) return nullptr;
+
+    // 已提交的DMA可能仍在读取条带或帧缓冲区
+    while (!isDMAIdle());
+    while (strip_busy[0] || strip_busy[1]);
+
+    if (strip_block) {
+        lent_block = strip_block;
+        lent_rows = strip_rows;
+        lent_list_size = list_capacity;
+        *size = StripMemorySize(width, strip_rows, list_capacity);
+        strip_block = nullptr;
+        strips[0] = strips[1] = nullptr;
+        display_list = nullptr;
+        known_mask = nullptr;
+        strip_rows = 0;
+        list_capacity = 0;
+        list_used = 0;
+        list_overflow = false;
+    }
+    else {
+        lent_block = reinterpret_cast<uint8_t*>(buffer);
+        lent_rows = 0;
+        *size = static_cast<uint32_t>(width) * height * sizeof(uint16_t);
+        buffer = nullptr;
+    }
+    return lent_block;
+}
 
-void Canvas::HollowRectangle(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color) {
-    if (!buffer) return;
-    if (x >= width || y >= height) return;
-    if (w == 0 || h == 0) return;
+void Canvas::ReturnMemory() {
+    if (!lent_block) return;
 
-    if (x + w > width) w = width - x;
-    if (y + h > height) h = height - y;
+    if (lent_rows) {
+        strip_block = lent_block;
+        AssignStrips(strip_block, lent_rows, lent_list_size);
+    }
+    else {
+        buffer = reinterpret_cast<uint16_t*>(lent_block);
+    }
+    lent_block = nullptr;
+    dirty_all = true;
+}
 
-    uint16_t swapped_color = swap_bytes(color);
+Canvas::DrawCommand Canvas::MakeCommand(DrawOp op, uint16_t color) const {
+    DrawCommand cmd = {};
+    cmd.op = op;
+    cmd.clip_x0 = 0;
+    cmd.clip_y0 = 0;
+    cmd.clip_x1 = static_cast<int16_t>(width - 1);
+    cmd.clip_y1 = static_cast<int16_t>(height - 1);
+    cmd.color = color;
+    return cmd;
+}
 
-    for (uint16_t col = x; col < x + w; col++) {
-        buffer[y * width + col] = swapped_color;
-        if (h > 1) {
-            buffer[(y + h - 1) * width + col] = swapped_color;
-        }
+bool Canvas::GetCommandBounds(const DrawCommand& cmd, DirtyRect* rect) const {
+    int32_t x0, y0, x1, y1;
+    switch (cmd.op) {
+        case DrawOp::LINE:
+            x0 = std::min(cmd.x[0], cmd.x[1]);
+            y0 = std::min(cmd.y[0], cmd.y[1]);
+            x1 = std::max(cmd.x[0], cmd.x[1]);
+            y1 = std::max(cmd.y[0], cmd.y[1]);
+            break;
+        case DrawOp::FILL_TRIANGLE:
+            x0 = std::min({cmd.x[0], cmd.x[1], cmd.x[2]});
+            y0 = std::min({cmd.y[0], cmd.y[1], cmd.y[2]});
+            x1 = std::max({cmd.x[0], cmd.x[1], cmd.x[2]});
+            y1 = std::max({cmd.y[0], cmd.y[1], cmd.y[2]});
+            break;
+        case DrawOp::FILL_CIRCLE:
+        case DrawOp::HOLLOW_CIRCLE:
+            x0 = cmd.x[0] - cmd.w;
+            y0 = cmd.y[0] - cmd.w;
+            x1 = cmd.x[0] + cmd.w;
+            y1 = cmd.y[0] + cmd.w;
+            break;
+        case DrawOp::FILL_ELLIPSE:
+        case DrawOp::HOLLOW_ELLIPSE:
+            x0 = cmd.x[0] - cmd.w;
+            y0 = cmd.y[0] - cmd.h;
+            x1 = cmd.x[0] + cmd.w;
+            y1 = cmd.y[0] + cmd.h;
+            break;
+        default:
+            x0 = cmd.x[0];
+            y0 = cmd.y[0];
+            x1 = x0 + cmd.w - 1;
+            y1 = y0 + cmd.h - 1;
+            break;
     }
 
-    for (uint16_t row = y; row < y + h; row++) {
-        buffer[row * width + x] = swapped_color;
-        if (w > 1) {
-            buffer[row * width + (x + w - 1)] = swapped_color;
-        }
-    }
-}
+    x0 = std::max<int32_t>(x0, cmd.clip_x0);
+    y0 = std::max<int32_t>(y0, cmd.clip_y0);
+    x1 = std::min<int32_t>(x1, cmd.clip_x1);
+    y1 = std::min<int32_t>(y1, cmd.clip_y1);
+    if (x0 > x1 || y0 > y1) return false;
 
-void Canvas::FillTriangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t x3, uint16_t y3,
-                          uint16_t color) {
-    if (!buffer) return;
+    *rect = {static_cast<uint16_t>(x0), static_cast<uint16_t>(y0), static_cast<uint16_t>(x1),
+             static_cast<uint16_t>(y1)};
+    return true;
+}
 
-    uint16_t swapped_color = swap_bytes(color);
+void Canvas::Submit(const DrawCommand& cmd) {
+    if (!isBufferValid()) return;
 
-#if TRIANGLE_USE_SCANLINE != 0
-    if (y2 < y1) { std::swap(x1, x2); std::swap(y1, y2); }
-    if (y3 < y1) { std::swap(x1, x3); std::swap(y1, y3); }
-    if (y3 < y2) { std::swap(x2, x3); std::swap(y2, y3); }
+    DirtyRect bounds;
+    if (!GetCommandBounds(cmd, &bounds)) return;
 
-    int32_t total_height = y3 - y1;
-    if (total_height == 0) return;
+    if (display_list) {
+        // 直接光栅化发送的命令已经在屏幕上
+        if (!Record(cmd, bounds)) return;
+    }
+    else {
+        Raster(cmd, cmd.data, {buffer, 0, 0, 0, width - 1, height - 1, nullptr});
+    }
+    MarkDirtyClipped(bounds.x0, bounds.y0, bounds.x1, bounds.y1);
+}
 
-    auto draw_horizontal_line = [this, swapped_color](int32_t x_start, int32_t x_end, int32_t y) {
-        if (y < 0 || y >= static_cast<int32_t>(height)) return;
+void Canvas::Raster(const DrawCommand& cmd, const void* data, const RasterTarget& target) const {
+    const int32_t clip_x0 = std::max<int32_t>(target.x0, cmd.clip_x0);
+    const int32_t clip_y0 = std::max<int32_t>(target.y0, cmd.clip_y0);
+    const int32_t clip_x1 = std::min<int32_t>(target.x1, cmd.clip_x1);
+    const int32_t clip_y1 = std::min<int32_t>(target.y1, cmd.clip_y1);
+    if (clip_x0 > clip_x1 || clip_y0 > clip_y1) return;
+
+    const uint16_t color = cmd.color;
+    const uint16_t known_stride = KnownStride();
+    auto row_ptr = [&](int32_t py) {
+        return target.pixels + (py - target.row0) * width;
+    };
+    auto known_row = [&](int32_t py) {
+        return target.known + (py - target.row0) * known_stride;
+    };
+    auto mark_known = [&](int32_t x_start, int32_t x_end, int32_t py) {
+        if (!target.known) return;
+        uint8_t* row = known_row(py);
+        for (int32_t px = x_start; px <= x_end; px++) row[px >> 3] |= 0x80 >> (px & 7);
+    };
+    auto set_pixel = [&](int32_t px, int32_t py) {
+        if (px >= clip_x0 && px <= clip_x1 && py >= clip_y0 && py <= clip_y1) {
+            row_ptr(py)[px] = color;
+            mark_known(px, px, py);
+        }
+    };
+    auto draw_horizontal_line = [&](int32_t x_start, int32_t x_end, int32_t py) {
+        if (py < clip_y0 || py > clip_y1) return;
         if (x_start > x_end) std::swap(x_start, x_end);
-        x_start = std::max(0l, x_start);
-        x_end = std::min(static_cast<int32_t>(width) - 1, x_end);
+        x_start = std::max(clip_x0, x_start);
+        x_end = std::min(clip_x1, x_end);
         if (x_start <= x_end) {
-            std::fill(buffer + y * width + x_start, buffer + y * width + x_end + 1, swapped_color);
+            std::fill(row_ptr(py) + x_start, row_ptr(py) + x_end + 1, color);
+            mark_known(x_start, x_end, py);
         }
     };
 
-    for (int32_t i = 0; i < total_height; i++) {
-        bool second_half = i > y2 - y1 || y2 == y1;
-        int32_t segment_height = second_half ? y3 - y2 : y2 - y1;
-        if (segment_height == 0) continue;
+    switch (cmd.op) {
+        case DrawOp::FILL_RECT: {
+            int32_t y_end = std::min<int32_t>(clip_y1, cmd.y[0] + cmd.h - 1);
+            for (int32_t py = std::max<int32_t>(clip_y0, cmd.y[0]); py <= y_end; py++) {
+                draw_horizontal_line(cmd.x[0], cmd.x[0] + cmd.w - 1, py);
+            }
+            break;
+        }
 
-        double alpha = static_cast<double>(i) / total_height;
-        double beta = second_half
-            ? static_cast<double>(i - (y2 - y1)) / segment_height
-            : static_cast<double>(i) / segment_height;
+        case DrawOp::GLYPH: {
+            auto bitmap = static_cast<const uint8_t*>(data);
+            uint16_t bytes_per_row = GlyphRowBytes(cmd.w, cmd.bpp);
+            int32_t x_start = std::max<int32_t>(clip_x0, cmd.x[0]);
+            int32_t x_end = std::min<int32_t>(clip_x1, cmd.x[0] + cmd.w - 1);
+            int32_t y_end = std::min<int32_t>(clip_y1, cmd.y[0] + cmd.h - 1);
+
+            if (cmd.bpp > 1) {
+                // 覆盖度字形：带背景时查颜色梯度，透明时与已有的像素混合，完全覆盖的像素直接写前景色
+                const uint8_t max_level = (1 << cmd.bpp) - 1;
+                uint16_t ramp[UNICODE_GLYPH_MAX_LEVELS];
+                uint8_t alpha[UNICODE_GLYPH_MAX_LEVELS];
+                if (cmd.has_bg) BuildGlyphRamp(ramp, cmd.bpp, color, cmd.bgcolor);
+                for (uint8_t level = 0; level <= max_level; level++) alpha[level] = GlyphLevelAlpha(level, max_level);
+
+                for (int32_t py = std::max<int32_t>(clip_y0, cmd.y[0]); py <= y_end; py++) {
+                    const uint8_t* bitmap_row = bitmap + (py - cmd.y[0]) * bytes_per_row;
+                    uint16_t* buffer_row = row_ptr(py);
+                    uint8_t* mask_row = target.known ? known_row(py) : nullptr;
+
+                    for (int32_t px = x_start; px <= x_end; px++) {
+                        uint8_t level = GetGlyphLevel(bitmap_row, px - cmd.x[0], cmd.bpp);
+
+                        if (cmd.has_bg) buffer_row[px] = ramp[level];
+                        else if (level == max_level) buffer_row[px] = color;
+                        else {
+                            // 底下的像素只在屏幕上时无法混合，保持不变
+                            if (!level || (mask_row && !(mask_row[px >> 3] & (0x80 >> (px & 7))))) continue;
+                            buffer_row[px] = BlendRGB565(color, buffer_row[px], alpha[level]);
+                        }
+                        if (mask_row) mask_row[px >> 3] |= 0x80 >> (px & 7);
+                    }
+                }
+                break;
+            }
 
-        int32_t ax = x1 + static_cast<int32_t>((x3 - x1) * alpha);
-        int32_t bx = second_half 
-            ? x2 + static_cast<int32_t>((x3 - x2) * beta)
-            : x1 + static_cast<int32_t>((x2 - x1) * beta);
+            for (int32_t py = std::max<int32_t>(clip_y0, cmd.y[0]); py <= y_end; py++) {
+                const uint8_t* bitmap_row = bitmap + (py - cmd.y[0]) * bytes_per_row;
+                uint16_t* buffer_row = row_ptr(py);
+
+                for (int32_t px = x_start; px <= x_end; px++) {
+                    int32_t col = px - cmd.x[0];
+                    uint8_t bitmap_byte = bitmap_row[col >> 3];
+                    uint8_t bit_mask = 0x80 >> (col & 7);
+
+                    if (bitmap_byte & bit_mask) {
+                        buffer_row[px] = color;
+                    }
+                    else if (cmd.has_bg) {
+                        buffer_row[px] = cmd.bgcolor;
+                    }
+                    else continue;
+                    mark_known(px, px, py);
+                }
+            }
+            break;
+        }
 
-        draw_horizontal_line(ax, bx, y1 + i);
-    }
+        case DrawOp::BITMAP: {
+            auto pixels = static_cast<const uint16_t*>(data);
+            int32_t x_start = std::max<int32_t>(clip_x0, cmd.x[0]);
+            int32_t x_end = std::min<int32_t>(clip_x1, cmd.x[0] + cmd.w - 1);
+            int32_t y_end = std::min<int32_t>(clip_y1, cmd.y[0] + cmd.h - 1);
+            if (x_start > x_end) break;
+
+            for (int32_t py = std::max<int32_t>(clip_y0, cmd.y[0]); py <= y_end; py++) {
+                const uint16_t* src_row = pixels + (py - cmd.y[0]) * cmd.stride + (x_start - cmd.x[0]);
+                memcpy(row_ptr(py) + x_start, src_row, (x_end - x_start + 1) * sizeof(uint16_t));
+                mark_known(x_start, x_end, py);
+            }
+            break;
+        }
+
+        case DrawOp::LINE: {
+            int32_t x0 = cmd.x[0], y0 = cmd.y[0], x1 = cmd.x[1], y1 = cmd.y[1];
+            int32_t dx = abs(x1 - x0);
+            int32_t dy = -abs(y1 - y0);
+            int32_t sx = x0 < x1 ? 1 : -1;
+            int32_t sy = y0 < y1 ? 1 : -1;
+            int32_t err = dx + dy;
+            int32_t cx = x0, cy = y0;
+
+            while (true) {
+                set_pixel(cx, cy);
+
+                if (cx == x1 && cy == y1) break;
+
+                int32_t e2 = 2 * err;
+                if (e2 >= dy) {
+                    err += dy;
+                    cx += sx;
+                }
+                if (e2 <= dx) {
+                    err += dx;
+                    cy += sy;
+                }
+            }
+            break;
+        }
+
+#if ENABLE_ADVANCED_METHOD != 0
+        case DrawOp::FILL_TRIANGLE: {
+            int32_t x1 = cmd.x[0], y1 = cmd.y[0];
+            int32_t x2 = cmd.x[1], y2 = cmd.y[1];
+            int32_t x3 = cmd.x[2], y3 = cmd.y[2];
+
+#if TRIANGLE_USE_SCANLINE != 0
+            if (y2 < y1) { std::swap(x1, x2); std::swap(y1, y2); }
+            if (y3 < y1) { std::swap(x1, x3); std::swap(y1, y3); }
+            if (y3 < y2) { std::swap(x2, x3); std::swap(y2, y3); }
+
+            int32_t total_height = y3 - y1;
+            if (total_height == 0) break;
+
+            // 只计算目标区域内的扫描线，每条扫描线的端点与整幅光栅化时相同
+            int32_t i_start = std::max<int32_t>(0, clip_y0 - y1);
+            int32_t i_end = std::min<int32_t>(total_height, clip_y1 - y1 + 1);
+            for (int32_t i = i_start; i < i_end; i++) {
+                bool second_half = i > y2 - y1 || y2 == y1;
+                int32_t segment_height = second_half ? y3 - y2 : y2 - y1;
+                if (segment_height == 0) continue;
+
+                double alpha = static_cast<double>(i) / total_height;
+                double beta = second_half
+                    ? static_cast<double>(i - (y2 - y1)) / segment_height
+                    : static_cast<double>(i) / segment_height;
+
+                int32_t ax = x1 + static_cast<int32_t>((x3 - x1) * alpha);
+                int32_t bx = second_half
+                    ? x2 + static_cast<int32_t>((x3 - x2) * beta)
+                    : x1 + static_cast<int32_t>((x2 - x1) * beta);
+
+                draw_horizontal_line(ax, bx, y1 + i);
+            }
 #else
-    int32_t min_y = std::min({y1, y2, y3});
-    int32_t max_y = std::max({y1, y2, y3});
+            auto edge_function = [](int32_t x, int32_t y, int32_t ax, int32_t ay, int32_t bx, int32_t by) -> int32_t {
+                return (bx - ax) * (y - ay) - (by - ay) * (x - ax);
+            };
+
+            int32_t area = edge_function(x1, y1, x2, y2, x3, y3);
+            if (area == 0) break;
+
+            int32_t min_y = std::max(clip_y0, std::min({y1, y2, y3}));
+            int32_t max_y = std::min(clip_y1, std::max({y1, y2, y3}));
+            int32_t min_x = std::max(clip_x0, std::min({x1, x2, x3}));
+            int32_t max_x = std::min(clip_x1, std::max({x1, x2, x3}));
+
+            for (int32_t y = min_y; y <= max_y; y++) {
+                int32_t x_start = max_x;
+                int32_t x_end = min_x;
+
+                for (int32_t x = min_x; x <= max_x; x++) {
+                    int32_t w0 = edge_function(x, y, x2, y2, x3, y3);
+                    int32_t w1 = edge_function(x, y, x3, y3, x1, y1);
+                    int32_t w2 = edge_function(x, y, x1, y1, x2, y2);
+
+                    if ((w0 >= 0 && w1 >= 0 && w2 >= 0) || (w0 <= 0 && w1 <= 0 && w2 <= 0)) {
+                        if (x < x_start) x_start = x;
+                        if (x > x_end) x_end = x;
+                    }
+                }
 
-    if (min_y >= height || max_y < 0) return;
+                if (x_start <= x_end) {
+                    draw_horizontal_line(x_start, x_end, y);
+                }
+            }
+#endif
+            break;
+        }
 
-    auto edge_function = [](int32_t x, int32_t y, int32_t ax, int32_t ay, int32_t bx, int32_t by) -> int32_t {
-        return (bx - ax) * (y - ay) - (by - ay) * (x - ax);
-    };
+        case DrawOp::FILL_CIRCLE: {
+            int32_t cx = cmd.x[0], cy = cmd.y[0];
+            int32_t x = 0;
+            int32_t y = cmd.w;
+            int32_t d = 3 - 2 * y;
 
-    int32_t area = edge_function(x1, y1, x2, y2, x3, y3);
-    if (area == 0) return;
+            while (x <= y) {
+                draw_horizontal_line(cx - x, cx + x, cy - y);
+                draw_horizontal_line(cx - x, cx + x, cy + y);
+                draw_horizontal_line(cx - y, cx + y, cy - x);
+                draw_horizontal_line(cx - y, cx + y, cy + x);
 
-    int32_t min_x = std::min({x1, x2, x3});
-    int32_t max_x = std::max({x1, x2, x3});
+                if (d < 0) {
+                    d = d + 4 * x + 6;
+                }
+                else {
+                    d = d + 4 * (x - y) + 10;
+                    y--;
+                }
+                x++;
+            }
+            break;
+        }
 
-    min_y = std::max(0l, min_y);
-    max_y = std::min(static_cast<int32_t>(height) - 1, max_y);
-    min_x = std::max(0l, min_x);
-    max_x = std::min(static_cast<int32_t>(width) - 1, max_x);
+        case DrawOp::HOLLOW_CIRCLE: {
+            int32_t cx = cmd.x[0], cy = cmd.y[0];
+            int32_t x = 0;
+            int32_t y = cmd.w;
+            int32_t d = 3 - 2 * y;
+
+            while (x <= y) {
+                set_pixel(cx + x, cy + y);
+                set_pixel(cx - x, cy + y);
+                set_pixel(cx + x, cy - y);
+                set_pixel(cx - x, cy - y);
+                set_pixel(cx + y, cy + x);
+                set_pixel(cx - y, cy + x);
+                set_pixel(cx + y, cy - x);
+                set_pixel(cx - y, cy - x);
+
+                if (d < 0) {
+                    d = d + 4 * x + 6;
+                }
+                else {
+                    d = d + 4 * (x - y) + 10;
+                    y--;
+                }
+                x++;
+            }
+            break;
+        }
 
-    for (int32_t y = min_y; y <= max_y; y++) {
-        int32_t x_start = max_x;
-        int32_t x_end = min_x;
+        case DrawOp::FILL_ELLIPSE: {
+            int32_t cx = cmd.x[0], cy = cmd.y[0];
+            int32_t rx = cmd.w, ry = cmd.h;
 
-        for (int32_t x = min_x; x <= max_x; x++) {
-            int32_t w0 = edge_function(x, y, x2, y2, x3, y3);
-            int32_t w1 = edge_function(x, y, x3, y3, x1, y1);
-            int32_t w2 = edge_function(x, y, x1, y1, x2, y2);
+#if ELLIPSE_USE_MIDPOINT != 0
+            int32_t x = 0;
+            int32_t y = ry;
+            int32_t rx2 = rx * rx;
+            int32_t ry2 = ry * ry;
+            int32_t two_rx2 = 2 * rx2;
+            int32_t two_ry2 = 2 * ry2;
+            int32_t px = 0;
+            int32_t py = two_rx2 * y;
+
+            auto p = static_cast<int32_t>(ry2 - rx2 * ry + 0.25 * rx2);
+            while (px < py) {
+                draw_horizontal_line(cx - x, cx + x, cy + y);
+                draw_horizontal_line(cx - x, cx + x, cy - y);
+                x++;
+                px += two_ry2;
+                if (p < 0) {
+                    p += ry2 + px;
+                } else {
+                    y--;
+                    py -= two_rx2;
+                    p += ry2 + px - py;
+                }
+            }
+
+            p = static_cast<int32_t>(ry2 * (x + 0.5) * (x + 0.5) + rx2 * (y - 1) * (y - 1) - rx2 * ry2);
+            while (y >= 0) {
+                draw_horizontal_line(cx - x, cx + x, cy + y);
+                draw_horizontal_line(cx - x, cx + x, cy - y);
+                y--;
+                py -= two_rx2;
+                if (p > 0) {
+                    p += rx2 - py;
+                } else {
+                    x++;
+                    px += two_ry2;
+                    p += rx2 - py + px;
+                }
+            }
+#else
+            int32_t rx2 = rx * rx;
+            int32_t ry2 = ry * ry;
 
-            if ((w0 >= 0 && w1 >= 0 && w2 >= 0) || (w0 <= 0 && w1 <= 0 && w2 <= 0)) {
-                if (x < x_start) x_start = x;
-                if (x > x_end) x_end = x;
+            for (int32_t y = -ry; y <= ry; y++) {
+                auto x_limit = static_cast<int32_t>(sqrt(rx2 * (1 - static_cast<double>(y * y) / ry2)));
+                draw_horizontal_line(cx - x_limit, cx + x_limit, cy + y);
             }
+#endif
+            break;
         }
 
-        if (x_start <= x_end) {
-            std::fill(buffer + y * width + x_start, buffer + y * width + x_end + 1, swapped_color);
+        case DrawOp::HOLLOW_ELLIPSE: {
+            int32_t cx = cmd.x[0], cy = cmd.y[0];
+            int32_t rx2 = cmd.w * cmd.w;
+            int32_t ry2 = cmd.h * cmd.h;
+
+            for (int32_t y = -static_cast<int32_t>(cmd.h); y <= static_cast<int32_t>(cmd.h); y++) {
+                auto x = static_cast<int32_t>(sqrt(rx2 * (1 - static_cast<double>(y * y) / ry2)));
+
+                set_pixel(cx + x, cy + y);
+                set_pixel(cx - x, cy + y);
+            }
+            break;
         }
-    }
 #endif
+
+        default:
+            break;
+    }
 }
 
-void Canvas::HollowTriangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t x3, uint16_t y3,
-                            uint16_t color) {
-    if (!buffer) return;
+void Canvas::FillRectangle(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color) {
+    if (w == 0 || h == 0) return;
 
-    Line(x1, y1, x2, y2, color);
-    Line(x2, y2, x3, y3, color);
-    Line(x3, y3, x1, y1, color);
+    DrawCommand cmd = MakeCommand(DrawOp::FILL_RECT, color);
+    cmd.x[0] = x;
+    cmd.y[0] = y;
+    cmd.w = w;
+    cmd.h = h;
+    Submit(cmd);
 }
 
-void Canvas::Line(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint16_t color) {
-    if (!buffer) return;
+void Canvas::FillCanvas(uint16_t color) {
+    if (display_list) {
+        // 整个画布被覆盖，之前记录的命令全部作废
+        list_used = 0;
+        list_overflow = false;
+        FillRectangle(0, 0, width, height, color);
+    }
+    else {
+        if (!buffer) return;
+        std::fill_n(buffer, static_cast<size_t>(width) * height, color);
+    }
+    dirty_all = true;
+}
 
-    uint16_t swapped_color = swap_bytes(color);
+void Canvas::MarkDirty(uint16_t x, uint16_t y, uint16_t w, uint16_t h) {
+    if (w == 0 || h == 0) return;
+    MarkDirtyClipped(x, y, static_cast<int32_t>(x) + w - 1, static_cast<int32_t>(y) + h - 1);
+}
 
-    int32_t dx = abs(static_cast<int32_t>(x1) - static_cast<int32_t>(x0));
-    int32_t dy = -abs(static_cast<int32_t>(y1) - static_cast<int32_t>(y0));
-    int32_t sx = x0 < x1 ? 1 : -1;
-    int32_t sy = y0 < y1 ? 1 : -1;
-    int32_t err = dx + dy;
-    int32_t cx = x0, cy = y0;
+void Canvas::MarkDirtyClipped(int32_t x0, int32_t y0, int32_t x1, int32_t y1) {
+    if (dirty_all) return;
 
+    x0 = std::max<int32_t>(x0, 0);
+    y0 = std::max<int32_t>(y0, 0);
+    x1 = std::min<int32_t>(x1, width - 1);
+    y1 = std::min<int32_t>(y1, height - 1);
+    if (x0 > x1 || y0 > y1) return;
+
+    auto area = [](const DirtyRect& r) {
+        return static_cast<uint32_t>(r.x1 - r.x0 + 1) * (r.y1 - r.y0 + 1);
+    };
+    auto merge = [](const DirtyRect& a, const DirtyRect& b) {
+        return DirtyRect{std::min(a.x0, b.x0), std::min(a.y0, b.y0), std::max(a.x1, b.x1), std::max(a.y1, b.y1)};
+    };
+
+    DirtyRect rect = {static_cast<uint16_t>(x0), static_cast<uint16_t>(y0),
+                      static_cast<uint16_t>(x1), static_cast<uint16_t>(y1)};
     while (true) {
-        if (cx >= 0 && cx < static_cast<int32_t>(width) && cy >= 0 && cy < static_cast<int32_t>(height)) {
-            buffer[cy * width + cx] = swapped_color;
+        // 与已有矩形重叠或相邻时合并；合并后的矩形可能又接触到其他矩形，取出后重新检查
+        uint8_t index = 0;
+        for (; index < dirty_count; index++) {
+            const DirtyRect& r = dirty_rects[index];
+            if (rect.x0 <= r.x1 + 1 && r.x0 <= rect.x1 + 1 && rect.y0 <= r.y1 + 1 && r.y0 <= rect.y1 + 1) break;
         }
 
-        if (cx == static_cast<int32_t>(x1) && cy == static_cast<int32_t>(y1)) break;
+        if (index == dirty_count) {
+            if (dirty_count < CANVAS_MAX_DIRTY_RECTS) {
+                dirty_rects[dirty_count++] = rect;
+                return;
+            }
+            // 列表已满，并入合并后面积增加最少的矩形
+            uint32_t best_growth = UINT32_MAX;
+            for (uint8_t i = 0; i < dirty_count; i++) {
+                uint32_t growth = area(merge(rect, dirty_rects[i])) - area(dirty_rects[i]);
+                if (growth < best_growth) {
+                    best_growth = growth;
+                    index = i;
+                }
+            }
+        }
 
-        int32_t e2 = 2 * err;
-        if (e2 >= dy) {
-            err += dy;
-            cx += sx;
+        rect = merge(rect, dirty_rects[index]);
+        dirty_rects[index] = dirty_rects[--dirty_count];
+    }
+}
+
+bool Canvas::IsDirty(uint16_t x, uint16_t y, uint16_t w, uint16_t h) const {
+    if (w == 0 || h == 0) return false;
+    if (dirty_all) return true;
+
+    int32_t x1 = static_cast<int32_t>(x) + w - 1, y1 = static_cast<int32_t>(y) + h - 1;
+    for (uint8_t i = 0; i < dirty_count; i++) {
+        const DirtyRect& r = dirty_rects[i];
+        if (x <= r.x1 && r.x0 <= x1 && y <= r.y1 && r.y0 <= y1) return true;
+    }
+    return false;
+}
+
+void Canvas::ClearDirty(uint16_t x, uint16_t y) {
+    dirty_count = 0;
+    dirty_all = false;
+    shown_x = x;
+    shown_y = y;
+    shown_serial = ST7735_GetWriteSerial();
+}
+
+Canvas::DrawCommand* Canvas::Append(const DrawCommand& cmd, uint32_t data_size) {
+    uint32_t size = (sizeof(DrawCommand) + data_size + alignof(DrawCommand) - 1) & ~(alignof(DrawCommand) - 1);
+    if (size > UINT16_MAX || list_used + size > list_capacity) return nullptr;
+
+    auto stored = reinterpret_cast<DrawCommand*>(display_list + list_used);
+    *stored = cmd;
+    stored->size = size;
+    stored->data = nullptr;
+    list_used += size;
+    return stored;
+}
+
+bool Canvas::Record(const DrawCommand& cmd, const DirtyRect& bounds) {
+    // 不透明的命令完全覆盖的旧命令不会再有可见像素，先删除腾出空间
+    if (cmd.op == DrawOp::FILL_RECT || cmd.op == DrawOp::BITMAP || (cmd.op == DrawOp::GLYPH && cmd.has_bg)) {
+        CullCovered(bounds, list_used);
+        // 覆盖整个画布后所有像素又都由显示列表决定
+        if (bounds.x0 == 0 && bounds.y0 == 0 && bounds.x1 == width - 1 && bounds.y1 == height - 1) {
+            list_overflow = false;
         }
-        if (e2 <= dx) {
-            err += dx;
-            cy += sy;
+    }
+
+    uint32_t data_size = 0;
+    if (cmd.op == DrawOp::GLYPH) data_size = GlyphRowBytes(cmd.w, cmd.bpp) * cmd.h;
+    else if (cmd.op == DrawOp::BITMAP) data_size = static_cast<uint32_t>(cmd.w) * cmd.h * sizeof(uint16_t);
+
+    DrawCommand* stored = Append(cmd, data_size);
+    if (!stored) {
+        FlushRecorded();
+        stored = Append(cmd, data_size);
+    }
+    if (!stored) {
+        RasterImmediate(cmd, bounds);
+        return false;
+    }
+    if (!data_size) return true;
+
+    if (cmd.op == DrawOp::BITMAP) {
+        // 按紧凑的行跨度复制，调用者的像素数据在返回后即可释放
+        auto dst = reinterpret_cast<uint16_t*>(stored + 1);
+        auto src = static_cast<const uint16_t*>(cmd.data);
+        for (uint16_t row = 0; row < cmd.h; row++) {
+            memcpy(dst + row * cmd.w, src + row * cmd.stride, cmd.w * sizeof(uint16_t));
         }
+        stored->stride = cmd.w;
+    }
+    else {
+        memcpy(stored + 1, cmd.data, data_size);
     }
+    return true;
 }
 
-void Canvas::FillCircle(uint16_t cx, uint16_t cy, uint16_t radius, uint16_t color) {
-    if (!buffer) return;
-    if (radius == 0) return;
+void Canvas::FlushRecorded() {
+    // 已记录的内容发送到上次显示的位置后由屏幕保存，显示列表从头开始记录；
+    // 画布放不下屏幕时（从未能显示过）无处保存，已记录的内容丢失
+    if (shown_x + width <= ST7735_GetWidth() && shown_y + height <= ST7735_GetHeight()) {
+        DrawCanvasDMA(shown_x, shown_y, false);
+    }
+    list_used = 0;
+    list_overflow = true;
+}
 
-    uint16_t swapped_color = swap_bytes(color);
+void Canvas::RasterImmediate(const DrawCommand& cmd, const DirtyRect& bounds) {
+    if (shown_x + width > ST7735_GetWidth() || shown_y + height > ST7735_GetHeight()) return;
+
+    // 显示列表刚刚清空，只需光栅化这一条命令，发送它写入的像素
+    const bool current = ST7735_GetWriteSerial() == shown_serial;
+    uint8_t index = 0;
+    for (uint16_t band_y = bounds.y0 - bounds.y0 % strip_rows; band_y <= bounds.y1; band_y += strip_rows) {
+        uint16_t rows = std::min<uint16_t>(strip_rows, height - band_y);
+        while (strip_busy[index]);
+        memset(known_mask, 0, KnownStride() * rows);
+        Raster(cmd, cmd.data, {strips[index], band_y, 0, band_y, width - 1, band_y + rows - 1, known_mask});
+        QueueKnown(index, shown_x, shown_y, band_y, rows);
+        index ^= 1;
+    }
+    if (current) shown_serial = ST7735_GetWriteSerial();
+}
 
-    int32_t x = 0;
-    int32_t y = radius;
-    int32_t d = 3 - 2 * radius;
+void Canvas::CullCovered(const DirtyRect& cover, uint32_t end) {
+    uint32_t read = 0, write = 0;
+    while (read < end) {
+        auto cmd = reinterpret_cast<const DrawCommand*>(display_list + read);
+        uint16_t size = cmd->size;
+
+        DirtyRect bounds;
+        bool covered = !GetCommandBounds(*cmd, &bounds) ||
+                       (bounds.x0 >= cover.x0 && bounds.x1 <= cover.x1 && bounds.y0 >= cover.y0 && bounds.y1 <= cover.y1);
+        if (!covered) {
+            if (write != read) memmove(display_list + write, display_list + read, size);
+            write += size;
+        }
+        read += size;
+    }
 
-    while (x <= y) {
-        for (int32_t i = cx - x; i <= cx + x; i++) {
-            if (i >= 0 && i < static_cast<int32_t>(width)) {
-                int32_t py1 = cy - y;
-                int32_t py2 = cy + y;
-                if (py1 >= 0 && py1 < static_cast<int32_t>(height)) {
-                    buffer[py1 * width + i] = swapped_color;
-                }
-                if (py2 >= 0 && py2 < static_cast<int32_t>(height)) {
-                    buffer[py2 * width + i] = swapped_color;
-                }
-            }
+    // 范围之后的命令整体前移
+    if (write != end) {
+        memmove(display_list + write, display_list + end, list_used - end);
+        list_used -= end - write;
+    }
+}
+
+bool Canvas::CopyRecorded(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t x0, uint16_t y0) {
+    const DirtyRect src = {x, y, static_cast<uint16_t>(x + w - 1), static_cast<uint16_t>(y + h - 1)};
+    const DirtyRect dst = {x0, y0, static_cast<uint16_t>(x0 + w - 1), static_cast<uint16_t>(y0 + h - 1)};
+    const int32_t dx = static_cast<int32_t>(x0) - x;
+    const int32_t dy = static_cast<int32_t>(y0) - y;
+
+    // 原命令落在目标区域内的部分被裁掉（跨越边界的拆成最多4个裁剪矩形），与源区域相交的命令再加一份平移到目标区域的副本
+    auto split = [&](const DrawCommand& original, DrawCommand* outputs) -> uint8_t {
+        DirtyRect bounds;
+        if (!GetCommandBounds(original, &bounds)) return 0;
+
+        uint8_t count = 0;
+        auto add_piece = [&](int32_t clip_x0, int32_t clip_y0, int32_t clip_x1, int32_t clip_y1) {
+            DrawCommand& piece = outputs[count++];
+            piece = original;
+            piece.clip_x0 = static_cast<int16_t>(clip_x0);
+            piece.clip_y0 = static_cast<int16_t>(clip_y0);
+            piece.clip_x1 = static_cast<int16_t>(clip_x1);
+            piece.clip_y1 = static_cast<int16_t>(clip_y1);
+        };
+
+        if (bounds.x1 < dst.x0 || bounds.x0 > dst.x1 || bounds.y1 < dst.y0 || bounds.y0 > dst.y1) {
+            outputs[count++] = original;
+        }
+        else {
+            uint16_t middle_y0 = std::max(bounds.y0, dst.y0);
+            uint16_t middle_y1 = std::min(bounds.y1, dst.y1);
+            if (bounds.y0 < dst.y0) add_piece(bounds.x0, bounds.y0, bounds.x1, dst.y0 - 1);
+            if (bounds.y1 > dst.y1) add_piece(bounds.x0, dst.y1 + 1, bounds.x1, bounds.y1);
+            if (bounds.x0 < dst.x0) add_piece(bounds.x0, middle_y0, dst.x0 - 1, middle_y1);
+            if (bounds.x1 > dst.x1) add_piece(dst.x1 + 1, middle_y0, bounds.x1, middle_y1);
         }
 
-        for (int32_t i = cx - y; i <= cx + y; i++) {
-            if (i >= 0 && i < static_cast<int32_t>(width)) {
-                int32_t py1 = cy - x;
-                int32_t py2 = cy + x;
-                if (py1 >= 0 && py1 < static_cast<int32_t>(height)) {
-                    buffer[py1 * width + i] = swapped_color;
-                }
-                if (py2 >= 0 && py2 < static_cast<int32_t>(height)) {
-                    buffer[py2 * width + i] = swapped_color;
-                }
+        if (bounds.x1 >= src.x0 && bounds.x0 <= src.x1 && bounds.y1 >= src.y0 && bounds.y0 <= src.y1) {
+            add_piece(std::max(bounds.x0, src.x0) + dx, std::max(bounds.y0, src.y0) + dy,
+                      std::min(bounds.x1, src.x1) + dx, std::min(bounds.y1, src.y1) + dy);
+            DrawCommand& moved = outputs[count - 1];
+            for (uint8_t i = 0; i < 3; i++) {
+                moved.x[i] += dx;
+                moved.y[i] += dy;
             }
         }
+        return count;
+    };
 
-        if (d < 0) {
-            d = d + 4 * x + 6;
-        }
-        else {
-            d = d + 4 * (x - y) + 10;
-            y--;
+    // 现有命令整体移到列表末尾，再从头依次写回，写回不能越过尚未读取的命令。
+    // 先按同样的顺序演算一遍，放不下时不做任何修改
+    DrawCommand outputs[5];
+    const uint32_t base_size = (sizeof(DrawCommand) + alignof(DrawCommand) - 1) & ~(alignof(DrawCommand) - 1);
+    uint32_t written = base_size;
+    for (uint32_t read = 0; read < list_used;) {
+        auto original = reinterpret_cast<const DrawCommand*>(display_list + read);
+        read += original->size;
+        written += split(*original, outputs) * original->size;
+        if (written > list_capacity - list_used + read) return false;
+    }
+    if (base_size > list_capacity - list_used) return false;
+
+    // 写回的原命令都不再触及目标区域，所以目标区域的底色（条带的初始值，源区域中没有被画过的像素也是这个值）放在最前面，
+    // 与源区域相交的命令紧跟着写入平移后的副本，重放时就得到复制的像素
+    uint32_t read = list_capacity - list_used;
+    memmove(display_list + read, display_list, list_used);
+    list_used = 0;
+
+    DrawCommand base = MakeCommand(DrawOp::FILL_RECT, 0);
+    base.x[0] = x0;
+    base.y[0] = y0;
+    base.w = w;
+    base.h = h;
+    Append(base, 0);
+
+    while (read < list_capacity) {
+        const DrawCommand original = *reinterpret_cast<const DrawCommand*>(display_list + read);
+        const uint8_t count = split(original, outputs);
+
+        // 第一份之后的副本从已经写回的第一份复制字形或位图数据
+        uint32_t first = list_used;
+        for (uint8_t i = 0; i < count; i++) {
+            if (i == 0) memmove(display_list + list_used, display_list + read, original.size);
+            else memcpy(display_list + list_used, display_list + first, original.size);
+            *reinterpret_cast<DrawCommand*>(display_list + list_used) = outputs[i];
+            list_used += original.size;
         }
-        x++;
+        read += original.size;
     }
+    return true;
 }
 
-void Canvas::HollowCircle(uint16_t cx, uint16_t cy, uint16_t radius, uint16_t color) {
-    if (!buffer) return;
-    if (radius == 0) return;
+void Canvas::RenderBand(uint16_t* strip, uint16_t band_y, uint16_t rows) const {
+    std::fill_n(strip, static_cast<size_t>(width) * rows, 0);
+    if (list_overflow) memset(known_mask, 0, KnownStride() * rows);
 
-    uint16_t swapped_color = swap_bytes(color);
+    const RasterTarget target = {strip, band_y, 0, band_y, width - 1, band_y + rows - 1,
+                                 list_overflow ? known_mask : nullptr};
+    for (uint32_t offset = 0; offset < list_used;) {
+        auto cmd = reinterpret_cast<const DrawCommand*>(display_list + offset);
+        offset += cmd->size;
 
-    int32_t x = 0;
-    int32_t y = radius;
-    int32_t d = 3 - 2 * radius;
+        DirtyRect bounds;
+        if (!GetCommandBounds(*cmd, &bounds)) continue;
+        if (bounds.y1 < target.y0 || bounds.y0 > target.y1) continue;
+        Raster(*cmd, cmd + 1, target);
+    }
+}
 
-    auto set_pixel = [this, swapped_color](int32_t px, int32_t py) {
-        if (px >= 0 && px < static_cast<int32_t>(width) && py >= 0 && py < static_cast<int32_t>(height)) {
-            buffer[py * width + px] = swapped_color;
-        }
-    };
+bool Canvas::GetBandDirtyColumns(uint16_t band_y, uint16_t rows, uint16_t* col0, uint16_t* col1) const {
+    bool dirty = false;
+    for (uint8_t i = 0; i < dirty_count; i++) {
+        const DirtyRect& r = dirty_rects[i];
+        if (r.y0 >= band_y + rows || r.y1 < band_y) continue;
+        *col0 = dirty ? std::min(*col0, r.x0) : r.x0;
+        *col1 = dirty ? std::max(*col1, r.x1) : r.x1;
+        dirty = true;
+    }
+    return dirty;
+}
 
-    while (x <= y) {
-        set_pixel(cx + x, cy + y);
-        set_pixel(cx - x, cy + y);
-        set_pixel(cx + x, cy - y);
-        set_pixel(cx - x, cy - y);
-        set_pixel(cx + y, cy + x);
-        set_pixel(cx - y, cy + x);
-        set_pixel(cx + y, cy - x);
-        set_pixel(cx - y, cy - x);
+void Canvas::StripDone(void* user) {
+    *static_cast<volatile bool*>(user) = false;
+}
 
-        if (d < 0) {
-            d = d + 4 * x + 6;
+void Canvas::DrawStripsDMA(uint16_t x, uint16_t y) {
+    uint8_t index = 0;
+    for (uint16_t band_y = 0; band_y < height; band_y += strip_rows) {
+        uint16_t rows = std::min<uint16_t>(strip_rows, height - band_y);
+        // 只发送脏矩形覆盖的列，按列滚动后每个条带只有新露出的几列需要发送
+        uint16_t col0 = 0, col1 = width - 1;
+        if (!dirty_all && !GetBandDirtyColumns(band_y, rows, &col0, &col1)) continue;
+
+        // 等待这个条带上一次的DMA完成，此时另一个条带可能仍在发送
+        while (strip_busy[index]);
+        RenderBand(strips[index], band_y, rows);
+        if (list_overflow) {
+            QueueKnown(index, x, y, band_y, rows);
         }
         else {
-            d = d + 4 * (x - y) + 10;
-            y--;
+            strip_busy[index] = true;
+            QueueRows(x, y, band_y, rows, col0, col1 - col0 + 1, strips[index] + col0, StripDone,
+                      const_cast<bool*>(&strip_busy[index]));
         }
-        x++;
+        index ^= 1;
     }
 }
 
-void Canvas::FillEllipse(uint16_t cx, uint16_t cy, uint16_t rx, uint16_t ry, uint16_t color) {
-    if (!buffer) return;
-    if (rx == 0 || ry == 0) return;
+void Canvas::QueueKnown(uint8_t index, uint16_t x, uint16_t y, uint16_t band_y, uint16_t rows) {
+    // 每行已知像素的连续段向下延伸到各行该段都已知为止，一块一个地址窗口；发送过的位随即清除。
+    // 最后一块提交时才知道是最后一块，所以每块推迟到找到下一块时提交
+    const uint16_t stride = KnownStride();
+    const uint16_t* strip = strips[index];
+    auto known = [&](uint16_t row, uint16_t col) {
+        return known_mask[row * stride + (col >> 3)] & (0x80 >> (col & 7));
+    };
 
-    uint16_t swapped_color = swap_bytes(color);
+    bool pending = false;
+    uint16_t block_row = 0, block_rows = 0, block_col = 0, block_cols = 0;
+    for (uint16_t row = 0; row < rows; row++) {
+        for (uint16_t col = 0; col < width;) {
+            if (!known_mask[row * stride + (col >> 3)]) {
+                col = (col & ~7) + 8;
+                continue;
+            }
+            if (!known(row, col)) {
+                col++;
+                continue;
+            }
 
-#if ELLIPSE_USE_MIDPOINT != 0
-    int32_t x = 0;
-    int32_t y = ry;
-    int32_t rx2 = static_cast<int32_t>(rx) * rx;
-    int32_t ry2 = static_cast<int32_t>(ry) * ry;
-    int32_t two_rx2 = 2 * rx2;
-    int32_t two_ry2 = 2 * ry2;
-    int32_t px = 0;
-    int32_t py = two_rx2 * y;
-
-    auto draw_horizontal_line = [this, swapped_color, cx](int32_t x1, int32_t y_pos) {
-        if (y_pos < 0 || y_pos >= static_cast<int32_t>(height)) return;
-        int32_t start = cx - x1;
-        int32_t end = cx + x1;
-        start = std::max(0l, start);
-        end = std::min(static_cast<int32_t>(width) - 1, end);
-        if (start <= end) {
-            std::fill(buffer + y_pos * width + start, buffer + y_pos * width + end + 1, swapped_color);
-        }
-    };
+            uint16_t end = col + 1;
+            while (end < width && known(row, end)) end++;
+            uint16_t count = 1;
+            while (row + count < rows) {
+                uint16_t c = col;
+                while (c < end && known(row + count, c)) c++;
+                if (c < end) break;
+                for (c = col; c < end; c++) known_mask[(row + count) * stride + (c >> 3)] &= ~(0x80 >> (c & 7));
+                count++;
+            }
 
-    auto p = static_cast<int32_t>(ry2 - rx2 * ry + 0.25 * rx2);
-    while (px < py) {
-        draw_horizontal_line(x, cy + y);
-        draw_horizontal_line(x, cy - y);
-        x++;
-        px += two_ry2;
-        if (p < 0) {
-            p += ry2 + px;
-        } else {
-            y--;
-            py -= two_rx2;
-            p += ry2 + px - py;
-        }
-    }
-
-    p = static_cast<int32_t>(ry2 * (x + 0.5) * (x + 0.5) + rx2 * (y - 1) * (y - 1) - rx2 * ry2);
-    while (y >= 0) {
-        draw_horizontal_line(x, cy + y);
-        draw_horizontal_line(x, cy - y);
-        y--;
-        py -= two_rx2;
-        if (p > 0) {
-            p += rx2 - py;
-        } else {
-            x++;
-            px += two_ry2;
-            p += rx2 - py + px;
+            if (pending) {
+                QueueRows(x, y, band_y + block_row, block_rows, block_col, block_cols,
+                          strip + block_row * width + block_col, nullptr, nullptr);
+            }
+            pending = true;
+            block_row = row;
+            block_rows = count;
+            block_col = col;
+            block_cols = end - col;
+            col = end;
         }
     }
-#else
-    int32_t rx2 = rx * rx;
-    int32_t ry2 = ry * ry;
-
-    for (int32_t y = -static_cast<int32_t>(ry); y <= static_cast<int32_t>(ry); y++) {
-        auto x_limit = static_cast<int32_t>(sqrt(rx2 * (1 - static_cast<double>(y * y) / ry2)));
-
-        int32_t py = cy + y;
-        if (py >= 0 && py < static_cast<int32_t>(height)) {
-            int32_t start = std::max(0l, cx - x_limit);
-            int32_t end = std::min(static_cast<int32_t>(width) - 1, cx + x_limit);
-            if (start <= end) {
-                std::fill(buffer + py * width + start, buffer + py * width + end + 1, swapped_color);
-            }
+
+    if (pending) {
+        strip_busy[index] = true;
+        QueueRows(x, y, band_y + block_row, block_rows, block_col, block_cols, strip + block_row * width + block_col,
+                  StripDone, const_cast<bool*>(&strip_busy[index]));
+    }
+}
+
+void Canvas::PrepareScroll(uint16_t x, uint16_t y) {
+    // 位置、方向或屏幕内容变化后无法再按滚动换算，放弃滚动区域
+    bool spans = scroll_columns ? y == 0 && height == ST7735_GetHeight() : x == 0 && width == ST7735_GetWidth();
+    ST7735_ScrollAxis axis = scroll_columns ? ST7735_SCROLL_HORIZONTAL : ST7735_SCROLL_VERTICAL;
+    if (!spans || ST7735_GetScrollAxis() != axis ||
+        !ST7735_SetScrollArea((scroll_columns ? x : y) + scroll_start, scroll_length)) {
+        ST7735_ResetScroll();
+        scroll_length = 0;
+        scroll_offset = 0;
+        dirty_all = true;
+        return;
+    }
+
+    // 整帧发送时按未滚动的地址写入，比逐段换算简单
+    if (dirty_all) scroll_offset = 0;
+    ST7735_SetScrollOffset(scroll_offset);
+}
+
+void Canvas::QueueRows(uint16_t x, uint16_t y, uint16_t row0, uint16_t rows, uint16_t col0, uint16_t cols,
+                       const uint16_t* data, void (*callback)(void* user), void* user) {
+    const uint16_t scroll_end = scroll_start + scroll_length;
+    uint16_t pos = scroll_columns ? col0 : row0;
+    uint16_t left = scroll_columns ? cols : rows;
+    while (left) {
+        // 滚动区域内的行（列）写到换算后的地址，在区域边界和绕回处分段
+        uint16_t count = left;
+        uint16_t target = pos;
+        if (scroll_offset && pos < scroll_start) {
+            count = std::min<uint16_t>(count, scroll_start - pos);
+        }
+        else if (scroll_offset && pos < scroll_end) {
+            uint16_t wrapped = (pos - scroll_start + scroll_offset) % scroll_length;
+            target = scroll_start + wrapped;
+            count = std::min<uint16_t>(count, std::min<uint16_t>(scroll_end - pos, scroll_length - wrapped));
         }
+        uint16_t seg_row = scroll_columns ? row0 : target, seg_rows = scroll_columns ? rows : count;
+        uint16_t seg_col = scroll_columns ? target : col0, seg_cols = scroll_columns ? count : cols;
+
+        ST7735_Transaction transaction = {};
+        transaction.set_window = true;
+        transaction.keep_scroll = true;
+        transaction.x0 = x + seg_col;
+        transaction.y0 = y + seg_row;
+        transaction.x1 = x + seg_col + seg_cols - 1;
+        transaction.y1 = y + seg_row + seg_rows - 1;
+        transaction.data = reinterpret_cast<const uint8_t*>(data);
+        transaction.pixels = true;
+        if (seg_cols == width) {
+            // 整行宽的区域在缓冲区中是连续的
+            transaction.length = static_cast<uint32_t>(seg_cols) * seg_rows * sizeof(uint16_t);
+        }
+        else {
+            // 每行一次DMA，按画布行跨度前进
+            transaction.length = seg_cols * sizeof(uint16_t);
+            transaction.repeat = seg_rows;
+            transaction.stride = width * sizeof(uint16_t);
+        }
+        left -= count;
+        if (!left) {
+            // 完成回调只挂在最后一段上
+            transaction.callback = callback;
+            transaction.user = user;
+        }
+        ST7735_QueueSubmit(&transaction);
+
+        pos += count;
+        data += scroll_columns ? count : static_cast<uint32_t>(count) * width;
     }
-#endif
 }
 
-void Canvas::HollowEllipse(uint16_t cx, uint16_t cy, uint16_t rx, uint16_t ry, uint16_t color) {
-    if (!buffer) return;
-    if (rx == 0 || ry == 0) return;
+#if ENABLE_ADVANCED_METHOD != 0
 
-    uint16_t swapped_color = swap_bytes(color);
+void Canvas::HollowRectangle(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color) {
+    if (w == 0 || h == 0) return;
 
-    int32_t rx2 = rx * rx;
-    int32_t ry2 = ry * ry;
+    // 四条边分别作为矩形填充
+    FillRectangle(x, y, w, 1, color);
+    if (h > 1) FillRectangle(x, y + h - 1, w, 1, color);
+    FillRectangle(x, y, 1, h, color);
+    if (w > 1) FillRectangle(x + w - 1, y, 1, h, color);
+}
 
-    auto set_pixel = [this, swapped_color](int32_t px, int32_t py) {
-        if (px >= 0 && px < static_cast<int32_t>(width) && py >= 0 && py < static_cast<int32_t>(height)) {
-            buffer[py * width + px] = swapped_color;
-        }
-    };
+void Canvas::FillTriangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t x3, uint16_t y3,
+                          uint16_t color) {
+    DrawCommand cmd = MakeCommand(DrawOp::FILL_TRIANGLE, color);
+    cmd.x[0] = x1;
+    cmd.y[0] = y1;
+    cmd.x[1] = x2;
+    cmd.y[1] = y2;
+    cmd.x[2] = x3;
+    cmd.y[2] = y3;
+    Submit(cmd);
+}
 
-    for (int32_t y = -static_cast<int32_t>(ry); y <= static_cast<int32_t>(ry); y++) {
-        auto x = static_cast<int32_t>(sqrt(rx2 * (1 - static_cast<double>(y * y) / ry2)));
+void Canvas::HollowTriangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t x3, uint16_t y3,
+                            uint16_t color) {
+    Line(x1, y1, x2, y2, color);
+    Line(x2, y2, x3, y3, color);
+    Line(x3, y3, x1, y1, color);
+}
 
-        set_pixel(cx + x, cy + y);
-        set_pixel(cx - x, cy + y);
-    }
+void Canvas::FillCircle(uint16_t cx, uint16_t cy, uint16_t radius, uint16_t color) {
+    if (radius == 0) return;
+
+    DrawCommand cmd = MakeCommand(DrawOp::FILL_CIRCLE, color);
+    cmd.x[0] = cx;
+    cmd.y[0] = cy;
+    cmd.w = radius;
+    Submit(cmd);
+}
+
+void Canvas::HollowCircle(uint16_t cx, uint16_t cy, uint16_t radius, uint16_t color) {
+    if (radius == 0) return;
+
+    DrawCommand cmd = MakeCommand(DrawOp::HOLLOW_CIRCLE, color);
+    cmd.x[0] = cx;
+    cmd.y[0] = cy;
+    cmd.w = radius;
+    Submit(cmd);
+}
+
+void Canvas::FillEllipse(uint16_t cx, uint16_t cy, uint16_t rx, uint16_t ry, uint16_t color) {
+    if (rx == 0 || ry == 0) return;
+
+    DrawCommand cmd = MakeCommand(DrawOp::FILL_ELLIPSE, color);
+    cmd.x[0] = cx;
+    cmd.y[0] = cy;
+    cmd.w = rx;
+    cmd.h = ry;
+    Submit(cmd);
+}
+
+void Canvas::HollowEllipse(uint16_t cx, uint16_t cy, uint16_t rx, uint16_t ry, uint16_t color) {
+    if (rx == 0 || ry == 0) return;
+
+    DrawCommand cmd = MakeCommand(DrawOp::HOLLOW_ELLIPSE, color);
+    cmd.x[0] = cx;
+    cmd.y[0] = cy;
+    cmd.w = rx;
+    cmd.h = ry;
+    Submit(cmd);
+}
+
+void Canvas::Line(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint16_t color) {
+    DrawCommand cmd = MakeCommand(DrawOp::LINE, color);
+    cmd.x[0] = x0;
+    cmd.y[0] = y0;
+    cmd.x[1] = x1;
+    cmd.y[1] = y1;
+    Submit(cmd);
 }
 
 #endif
 
+
 void Canvas::WriteUnicodeString(uint16_t x, uint16_t y, const char* utf8_str, UnicodeFont* font, uint16_t color) {
     WriteUnicodeStringImpl(x, y, utf8_str, font, color, std::nullopt);
 }
@@ -406,7 +1107,7 @@ uint16_t Canvas::GetCharSpacing(uint16_t char_width, uint32_t unicode) {
 
 void Canvas::WriteUnicodeStringImpl(uint16_t x, uint16_t y, const char* utf8_str, UnicodeFont* font, uint16_t color,
                                     std::optional<uint16_t> bgcolor) {
-    if (!buffer || !utf8_str || !font) return;
+    if (!isBufferValid() || !utf8_str || !font) return;
 
     const char* ptr = utf8_str;
     uint16_t current_x = x;
@@ -422,13 +1123,7 @@ void Canvas::WriteUnicodeStringImpl(uint16_t x, uint16_t y, const char* utf8_str
         uint32_t unicode = UTF8ToUnicode(&temp_ptr);
         if (unicode == 0) break;
 
-        uint16_t char_width;
-        
-        if (!font->GetCharWidth(unicode, &char_width)) {
-            char_width = font->GetDefaultWidth();
-        }
-
-        uint16_t char_spacing = GetCharSpacing(char_width, unicode);
+        uint16_t char_spacing = GetCharSpacing(font->MeasureChar(unicode), unicode);
 
         if (line_width + char_spacing > width) {
             if (line_width > total_width) {
@@ -455,7 +1150,7 @@ void Canvas::WriteUnicodeStringImpl(uint16_t x, uint16_t y, const char* utf8_str
         uint32_t unicode = UTF8ToUnicode(&ptr);
         if (unicode == 0) break;
 
-        std::shared_ptr<uint8_t[]> bitmap;
+        const uint8_t* bitmap;
         uint16_t char_width, char_height;
 
         if (unicode == 0x0020 || unicode == 0x00A0) {
@@ -482,7 +1177,8 @@ void Canvas::WriteUnicodeStringImpl(uint16_t x, uint16_t y, const char* utf8_str
         uint16_t char_baseline = char_height - 1;
         uint16_t render_y = current_y + baseline_offset - char_baseline;
 
-        DrawChar(current_x, render_y, bitmap, char_width, char_height, color, std::nullopt);
+        // 字形也带背景色绘制，不依赖底下的背景矩形（显示列表溢出后矩形可能只在屏幕上，无法混合）
+        DrawChar(current_x, render_y, bitmap, char_width, char_height, color, bgcolor, font->GetBitsPerPixel());
 
         current_x += GetCharSpacing(char_width, unicode);
     }
@@ -490,7 +1186,7 @@ void Canvas::WriteUnicodeStringImpl(uint16_t x, uint16_t y, const char* utf8_str
 
 void Canvas::WriteUnicodeStringImpl(uint16_t x, uint16_t y, const uint32_t* unicode_str, UnicodeFont* font,
                                     uint16_t color, std::optional<uint16_t> bgcolor) {
-    if (!buffer || !unicode_str || !font) return;
+    if (!isBufferValid() || !unicode_str || !font) return;
 
     uint16_t current_x = x;
     uint16_t current_y = y;
@@ -503,13 +1199,7 @@ void Canvas::WriteUnicodeStringImpl(uint16_t x, uint16_t y, const uint32_t* unic
     while (*temp_ptr != 0) {
         uint32_t unicode = *temp_ptr;
 
-        uint16_t char_width;
-        
-        if (!font->GetCharWidth(unicode, &char_width)) {
-            char_width = font->GetDefaultWidth();
-        }
-
-        uint16_t char_spacing = GetCharSpacing(char_width, unicode);
+        uint16_t char_spacing = GetCharSpacing(font->MeasureChar(unicode), unicode);
 
         if (line_width + char_spacing > width) {
             if (line_width > total_width) {
@@ -537,7 +1227,7 @@ void Canvas::WriteUnicodeStringImpl(uint16_t x, uint16_t y, const uint32_t* unic
     while (*unicode_str != 0) {
         uint32_t unicode = *unicode_str;
 
-        std::shared_ptr<uint8_t[]> bitmap;
+        const uint8_t* bitmap;
         uint16_t char_width, char_height;
 
         if (unicode == 0x0020 || unicode == 0x00A0) {
@@ -566,61 +1256,36 @@ void Canvas::WriteUnicodeStringImpl(uint16_t x, uint16_t y, const uint32_t* unic
         uint16_t char_baseline = char_height - 1;
         uint16_t render_y = current_y + baseline_offset - char_baseline;
 
-        DrawChar(current_x, render_y, bitmap, char_width, char_height, color, std::nullopt);
+        DrawChar(current_x, render_y, bitmap, char_width, char_height, color, bgcolor, font->GetBitsPerPixel());
 
         current_x += GetCharSpacing(char_width, unicode);
         unicode_str++;
     }
 }
 
-void Canvas::DrawChar(uint16_t x, uint16_t y, const std::shared_ptr<uint8_t[]>& bitmap, uint16_t char_width,
-                      uint16_t char_height, uint16_t color, std::optional<uint16_t> bgcolor) {
-    if (x >= width || y >= height) return;
-
-    uint16_t swapped_color = swap_bytes(color);
-    uint16_t swapped_bgcolor = bgcolor.has_value() ? swap_bytes(bgcolor.value()) : 0;
-
-    uint16_t row_end = (y + char_height > height) ? height - y : char_height;
-    uint16_t col_end = (x + char_width > width) ? width - x : char_width;
-
-    uint16_t bytes_per_row = (char_width + 7) / 8;
-    uint16_t* buffer_ptr = buffer + y * width + x;
-
-    for (uint16_t row = 0; row < row_end; row++) {
-        const uint8_t* bitmap_row = bitmap.get() + row * bytes_per_row;
-        uint16_t* buffer_row = buffer_ptr + row * width;
-
-        for (uint16_t col = 0; col < col_end; col++) {
-            uint8_t bitmap_byte = bitmap_row[col >> 3];
-            uint8_t bit_mask = 0x80 >> (col & 7);
-
-            if (bitmap_byte & bit_mask) {
-                buffer_row[col] = swapped_color;
-            }
-            else if (bgcolor.has_value()) {
-                buffer_row[col] = swapped_bgcolor;
-            }
-        }
-    }
+void Canvas::DrawChar(uint16_t x, uint16_t y, const uint8_t* bitmap, uint16_t char_width,
+                      uint16_t char_height, uint16_t color, std::optional<uint16_t> bgcolor, uint8_t bits_per_pixel) {
+    if (!bitmap || char_width == 0 || char_height == 0) return;
+
+    DrawCommand cmd = MakeCommand(DrawOp::GLYPH, color);
+    cmd.x[0] = x;
+    cmd.y[0] = y;
+    cmd.w = char_width;
+    cmd.h = char_height;
+    cmd.has_bg = bgcolor.has_value();
+    cmd.bgcolor = bgcolor.value_or(0);
+    cmd.bpp = bits_per_pixel;
+    cmd.data = bitmap;
+    Submit(cmd);
 }
 
 void Canvas::DrawSpace(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t bgcolor) {
-    uint16_t swapped_bgcolor = swap_bytes(bgcolor);
-
-    for (uint16_t row = 0; row < h; row++) {
-        for (uint16_t col = 0; col < w; col++) {
-            uint16_t buf_x = x + col;
-            uint16_t buf_y = y + row;
-            if (buf_x < width && buf_y < height) {
-                buffer[buf_y * width + buf_x] = swapped_bgcolor;
-            }
-        }
-    }
+    FillRectangle(x, y, w, h, bgcolor);
 }
 
 PicError Canvas::DrawImage(const DynamicImage& image, uint16_t x, uint16_t y, uint16_t x0, uint16_t y0, uint16_t w,
                            uint16_t h) {
-    if (!buffer) return PIC_ERROR_INVALID_PARAM;
+    if (!isBufferValid()) return PIC_ERROR_INVALID_PARAM;
     if (!image.IsLoaded()) return PIC_ERROR_INVALID_PARAM;
 
     PicInfo info;
@@ -642,52 +1307,116 @@ PicError Canvas::DrawImage(const DynamicImage& image, uint16_t x, uint16_t y, ui
     uint16_t copy_w = (x + w > width) ? width - x : w;
     uint16_t copy_h = (y + h > height) ? height - y : h;
 
-    for (uint16_t row = 0; row < copy_h; row++) {
-        const uint16_t* src_row = img_data + (y0 + row) * info.width + x0;
-        uint16_t* dst_row = buffer + (y + row) * width + x;
-        memcpy(dst_row, src_row, copy_w * sizeof(uint16_t));
-    }
+    // 条带模式下只复制画布内的部分到显示列表
+    DrawCommand cmd = MakeCommand(DrawOp::BITMAP, 0);
+    cmd.x[0] = x;
+    cmd.y[0] = y;
+    cmd.w = copy_w;
+    cmd.h = copy_h;
+    cmd.stride = info.width;
+    cmd.data = img_data + y0 * info.width + x0;
+    Submit(cmd);
 
     return PIC_SUCCESS;
 }
 
-void Canvas::DrawCanvas(uint16_t x, uint16_t y) const {
-    if (!buffer) return;
+void Canvas::DrawBitmap(uint16_t x, uint16_t y, uint16_t w, uint16_t h, const uint16_t* data) {
+    if (!data) return;
+    if (x >= width || y >= height) return;
 
-    ST7735_DrawImage(x, y, width, height, buffer);
+    uint16_t copy_w = (x + w > width) ? width - x : w;
+    uint16_t copy_h = (y + h > height) ? height - y : h;
+
+    DrawCommand cmd = MakeCommand(DrawOp::BITMAP, 0);
+    cmd.x[0] = x;
+    cmd.y[0] = y;
+    cmd.w = copy_w;
+    cmd.h = copy_h;
+    cmd.stride = w;
+    cmd.data = data;
+    Submit(cmd);
+}
+
+void Canvas::DrawCanvas(uint16_t x, uint16_t y) {
+    if (!isBufferValid()) return;
+
+    if (display_list && list_overflow) {
+        // 列表之外的像素只在屏幕上，与DMA显示一样只发送显示列表决定的像素
+        DrawCanvasDMA(x, y, true);
+        return;
+    }
+    if (display_list) {
+        for (uint16_t band_y = 0; band_y < height; band_y += strip_rows) {
+            uint16_t rows = std::min<uint16_t>(strip_rows, height - band_y);
+            while (strip_busy[0]);
+            RenderBand(strips[0], band_y, rows);
+            ST7735_DrawImage(x, y + band_y, width, rows, strips[0]);
+        }
+    }
+    else {
+        ST7735_DrawImage(x, y, width, height, buffer);
+    }
+    // 阻塞写入不按滚动换算地址，驱动已复位滚动
+    scroll_offset = 0;
+    ClearDirty(x, y);
 }
 
 bool Canvas::isDMAIdle() {
-    return HAL_SPI_GetState(&ST7735_SPI_PORT) == HAL_SPI_STATE_READY 
+    return ST7735_QueueIsIdle() && HAL_SPI_GetState(&ST7735_SPI_PORT) == HAL_SPI_STATE_READY
            && !__HAL_SPI_GET_FLAG(&ST7735_SPI_PORT, SPI_FLAG_BSY);
 }
 
-void Canvas::DrawCanvasDMA(uint16_t x, uint16_t y, bool wait_dma) const {
-    if (!buffer) return;
-    if (!isDMAIdle()) return;
+void Canvas::DrawCanvasDMA(uint16_t x, uint16_t y, bool wait_dma) {
+    if (!isBufferValid()) return;
+    if (x + width > ST7735_GetWidth() || y + height > ST7735_GetHeight()) return;
 
-    ST7735_Select();
-    ST7735_SetAddressWindow(x, y, x + width - 1, y + height - 1);
-    ST7735_DC_HIGH();
+    // 屏幕上已经不是上次显示的画布时，只发送脏矩形会留下别的内容
+    if (x != shown_x || y != shown_y || ST7735_GetWriteSerial() != shown_serial) dirty_all = true;
 
-    HAL_SPI_Transmit_DMA(&ST7735_SPI_PORT, reinterpret_cast<uint8_t*>(buffer), width * height * sizeof(uint16_t));
+    if (!display_list) {
+        uint32_t dirty_area = 0;
+        for (uint8_t i = 0; i < dirty_count; i++) {
+            const DirtyRect& r = dirty_rects[i];
+            dirty_area += static_cast<uint32_t>(r.x1 - r.x0 + 1) * (r.y1 - r.y0 + 1);
+        }
+        if (dirty_area * 100 > static_cast<uint32_t>(width) * height * CANVAS_DIRTY_FULL_PERCENT) dirty_all = true;
+    }
+    if (scroll_length) PrepareScroll(x, y);
+
+    // 排在已提交的事务之后，窗口命令和像素数据都由发送完成中断依次发出
+    if (display_list) {
+        DrawStripsDMA(x, y);
+    }
+    else if (dirty_all) {
+        QueueRows(x, y, 0, height, 0, width, buffer, nullptr, nullptr);
+    }
+    else {
+        for (uint8_t i = 0; i < dirty_count; i++) {
+            const DirtyRect& r = dirty_rects[i];
+            QueueRows(x, y, r.y0, r.y1 - r.y0 + 1, r.x0, r.x1 - r.x0 + 1, buffer + r.y0 * width + r.x0, nullptr,
+                      nullptr);
+        }
+    }
+    ClearDirty(x, y);
 
     if (wait_dma) {
-        while (isDMAIdle())
-        ST7735_Unselect();
+        ST7735_QueueFlush();
     }
 }
 
 bool Canvas::RenewBuffer() {
+    ReleaseStrips();
     if (auto_release) {
         delete[] this->buffer;
     }
     buffer = new uint16_t[width * height];
     auto_release = true;
+    dirty_all = true;
     return buffer != nullptr;
 }
 
 bool Canvas::RenewBuffer(uint16_t width, uint16_t height) {
+    ReleaseStrips();
     if (auto_release) {
         delete[] this->buffer;
     }
@@ -695,18 +1424,22 @@ bool Canvas::RenewBuffer(uint16_t width, uint16_t height) {
     this->height = height;
     buffer = new uint16_t[width * height];
     auto_release = true;
+    dirty_all = true;
     return buffer != nullptr;
 }
 
 void Canvas::RenewBuffer(uint16_t* buffer) {
+    ReleaseStrips();
     if (auto_release) {
         delete[] this->buffer;
     }
     this->buffer = buffer;
     auto_release = false;
+    dirty_all = true;
 }
 
 void Canvas::RenewBuffer(uint16_t* buffer, uint16_t width, uint16_t height) {
+    ReleaseStrips();
     if (auto_release) {
         delete[] this->buffer;
     }
@@ -714,22 +1447,58 @@ void Canvas::RenewBuffer(uint16_t* buffer, uint16_t width, uint16_t height) {
     this->width = width;
     this->height = height;
     auto_release = false;
+    dirty_all = true;
 }
 
-void Canvas::Copy(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t x0, uint16_t y0) {
-    if (!buffer) return;
-    if (w == 0 || h == 0) return;
-    
-    if (x >= width || y >= height) return;
+bool Canvas::FitScreen() {
+    uint16_t screen_width = ST7735_GetWidth();
+    uint16_t screen_height = ST7735_GetHeight();
+    if (width == screen_width && height == screen_height) return isBufferValid();
+
+    if (display_list) {
+        uint16_t rows = strip_rows;
+        uint32_t list_size = list_capacity;
+        width = screen_width;
+        height = screen_height;
+        return AllocateStrips(rows, list_size);
+    }
+
+    if (buffer && static_cast<uint32_t>(width) * height == static_cast<uint32_t>(screen_width) * screen_height) {
+        width = screen_width;
+        height = screen_height;
+        dirty_all = true;
+        return true;
+    }
+    if (!auto_release) return false;
+    return RenewBuffer(screen_width, screen_height);
+}
+
+bool Canvas::Copy(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t x0, uint16_t y0) {
+    if (!isBufferValid()) return false;
+    if (w == 0 || h == 0) return true;
+
+    if (x >= width || y >= height) return false;
     if (x + w > width) w = width - x;
     if (y + h > height) h = height - y;
-    
-    if (x0 >= width || y0 >= height) return;
+
+    if (x0 >= width || y0 >= height) return false;
     if (x0 + w > width) w = width - x0;
     if (y0 + h > height) h = height - y0;
-    
-    if (w == 0 || h == 0) return;
-    
+
+    if (w == 0 || h == 0) return true;
+    if (x == x0 && y == y0) return true;
+
+    if (!CopyPixels(x, y, w, h, x0, y0)) return false;
+    MarkDirty(x0, y0, w, h);
+    return true;
+}
+
+bool Canvas::CopyPixels(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t x0, uint16_t y0) {
+    if (display_list) {
+        // 溢出后源区域中有的像素只在屏幕上，无法复制
+        return !list_overflow && CopyRecorded(x, y, w, h, x0, y0);
+    }
+
     int16_t row_start, row_end, row_step;
     int16_t col_start, col_end, col_step;
     
@@ -761,4 +1530,68 @@ void Canvas::Copy(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t x0, u
             dst_row[col] = src_row[col];
         }
     }
+    return true;
+}
+
+bool Canvas::Scroll(uint16_t y, uint16_t h, int16_t dy) {
+    return ScrollArea(false, y, h, dy);
+}
+
+bool Canvas::ScrollColumns(uint16_t x, uint16_t w, int16_t dx) {
+    return ScrollArea(true, x, w, dx);
+}
+
+bool Canvas::ScrollArea(bool columns, uint16_t start, uint16_t length, int16_t delta) {
+    if (!isBufferValid()) return false;
+    if (length == 0 || start + length > (columns ? width : height)) return false;
+    if (delta == 0) return true;
+    uint16_t distance = std::abs(delta);
+    if (distance >= length) return false;
+
+    // 硬件只能沿滚动轴整行（行列交换时为整列）循环滚动，另一个方向上画布必须覆盖整个屏幕
+    ST7735_ScrollAxis axis = columns ? ST7735_SCROLL_HORIZONTAL : ST7735_SCROLL_VERTICAL;
+    bool spans = columns ? height == ST7735_GetHeight() && shown_y == 0 : width == ST7735_GetWidth() && shown_x == 0;
+    if (!spans || ST7735_GetScrollAxis() != axis) return false;
+
+    // 画布内容随屏幕一起移动
+    uint16_t from = delta > 0 ? start : start + distance;
+    uint16_t to = delta > 0 ? start + distance : start;
+    bool copied = columns ? CopyPixels(from, 0, length - distance, height, to, 0)
+                          : CopyPixels(0, from, width, length - distance, 0, to);
+    if (!copied) return false;
+
+    if (scroll_length && (scroll_columns != columns || scroll_start != start || scroll_length != length)) {
+        // 换了滚动区域，旧区域回到未滚动的状态后需要按原地址重新发送
+        if (scroll_offset) {
+            if (scroll_columns) MarkDirty(scroll_start, 0, scroll_length, height);
+            else MarkDirty(0, scroll_start, width, scroll_length);
+        }
+        scroll_offset = 0;
+    }
+    scroll_columns = columns;
+    scroll_start = start;
+    scroll_length = length;
+
+    // 尚未发送的脏矩形随内容移动；移入的行（列）在GRAM中是从另一端绕回的旧内容，必须重新发送
+    const int32_t last = start + length - 1;
+    DirtyRect moved[CANVAS_MAX_DIRTY_RECTS];
+    uint8_t moved_count = 0;
+    for (uint8_t i = 0; i < dirty_count; i++) {
+        const DirtyRect& r = dirty_rects[i];
+        int32_t lo = columns ? r.x0 : r.y0, hi = columns ? r.x1 : r.y1;
+        lo = std::max<int32_t>(std::max<int32_t>(lo, start) + delta, start);
+        hi = std::min<int32_t>(std::min<int32_t>(hi, last) + delta, last);
+        if (lo > hi) continue;
+        if (columns) moved[moved_count++] = {static_cast<uint16_t>(lo), r.y0, static_cast<uint16_t>(hi), r.y1};
+        else moved[moved_count++] = {r.x0, static_cast<uint16_t>(lo), r.x1, static_cast<uint16_t>(hi)};
+    }
+    for (uint8_t i = 0; i < moved_count; i++) {
+        MarkDirtyClipped(moved[i].x0, moved[i].y0, moved[i].x1, moved[i].y1);
+    }
+    uint16_t exposed = delta > 0 ? start : start + length - distance;
+    if (columns) MarkDirty(exposed, 0, distance, height);
+    else MarkDirty(0, exposed, width, distance);
+
+    scroll_offset = (scroll_offset + length - delta) % length;
+    return true;
 }
@@ -23,6 +23,20 @@
 // 0: 浮点运算算法
 // 1: 中点椭圆算法
 
+#define CANVAS_MAX_DIRTY_RECTS 8
+// 脏矩形列表的容量，列表满时把新区域合并到扩张面积最小的矩形中
+
+#define CANVAS_DIRTY_FULL_PERCENT 60
+// 脏区域总面积超过画布面积的这个百分比时直接整帧发送（每行一次DMA的开销已不划算）
+
+#define CANVAS_STRIP_ROWS 16
+// 条带模式下每个条带的行数，两个条带轮流光栅化和DMA发送
+
+#define CANVAS_DISPLAY_LIST_SIZE 20480
+// 条带模式下显示列表的默认字节数，字形和位图的像素数据也保存在其中。12x12的4位字形每个约占128字节，
+// 一屏约130个字（一页菜单）需要约16.5KB，1位字形约80字节；仍远小于40KB的帧缓冲区。
+// 更大的字体或更多的文字写满列表时先发送已记录的内容，见isDisplayListOverflowed
+
 #ifdef __cplusplus
 #include <optional>
 /**
@@ -35,21 +49,106 @@
  * - 基本图形：矩形、三角形、圆形、椭圆
  * - 文本渲染：支持 UTF-8 和 Unicode 字符串
  * - 图像绘制：支持从 DynamicImage 绘制图片
- * - 显示优化：支持 DMA 传输
+ * - 显示优化：支持 DMA 传输，只发送上次显示之后被修改过的区域
  * 
  * 内存管理：
  * - 可以自动管理缓冲区内存（构造函数分配，析构函数释放）
  * - 也可以使用用户提供的外部缓冲区
+ * - 条带模式不分配整帧缓冲区：绘制调用记录为显示列表，显示时逐条带光栅化到两个小条带缓冲区并依次DMA发送，
+ *   被不透明的矩形、位图或带背景的文字完全覆盖的旧命令会被删除，列表大小随屏幕内容而不是绘制次数增长
+ *
+ * 两种模式使用同一套光栅化代码，条带模式的输出与帧缓冲区模式逐像素相同（未绘制过的像素在条带模式下为0）；
+ * 显示列表写满时已记录的内容先发送到屏幕，再重新开始记录，见isDisplayListOverflowed
  */
 class Canvas {
 private:
+    // 脏矩形（闭区间）
+    struct DirtyRect {
+        uint16_t x0, y0, x1, y1;
+    };
+
+    // 绘制命令：帧缓冲区模式下立即光栅化，条带模式下记录到显示列表中，显示时逐条带重放
+    enum class DrawOp : uint8_t {
+        FILL_RECT, LINE, FILL_TRIANGLE, FILL_CIRCLE, HOLLOW_CIRCLE, FILL_ELLIPSE, HOLLOW_ELLIPSE, GLYPH, BITMAP
+    };
+
+    struct DrawCommand {
+        DrawOp op;
+        bool has_bg;                // GLYPH：背景像素写入bgcolor
+        uint16_t size;              // 在显示列表中占用的字节数（含紧随其后的字形或位图数据）
+        int16_t clip_x0, clip_y0, clip_x1, clip_y1; // 裁剪矩形（闭区间，在画布内），复制区域时用于截取平移后的命令
+        int32_t x[3], y[3];         // 矩形左上角、直线端点、三角形顶点或圆心（复制区域后可能在画布之外）
+        uint16_t w, h;              // 矩形、字形、位图的尺寸，圆的半径（w）或椭圆的半径
+        uint16_t stride;            // BITMAP：每行的像素数
+        uint8_t bpp;                // GLYPH：每像素位数，多位时按覆盖度与背景混合
+        uint16_t color, bgcolor;
+        const void* data;           // 帧缓冲区模式下字形或位图数据的地址；显示列表中数据紧随命令之后
+    };
+
+    // 光栅化目标：pixels指向画布第row0行，只写入闭区间[x0, x1] x [y0, y1]
+    // known非空时在其中置位被写入的像素（每行KnownStride()字节，高位在前），透明的覆盖度字形只与已置位的像素混合
+    struct RasterTarget {
+        uint16_t* pixels;
+        int32_t row0;
+        int32_t x0, y0, x1, y1;
+        uint8_t* known;
+    };
+
     uint16_t* buffer = nullptr;
     uint16_t width = 0, height = 0;
     bool auto_release = true;
 
-    static uint16_t swap_bytes(uint16_t value) {
-        return ((value & 0xFF00) >> 8) | ((value & 0xFF) << 8);
-    }
+    uint16_t strip_rows = 0;        // 非0时为条带模式
+    uint16_t* strips[2] = {};
+    volatile bool strip_busy[2] = {};
+    uint8_t* strip_block = nullptr; // 条带、显示列表和掩码共用的一块内存，可以整块借出
+    uint8_t* display_list = nullptr;
+    uint32_t list_capacity = 0;
+    uint32_t list_used = 0;
+    bool list_overflow = false;     // 列表写满后重新开始记录过，列表之外的像素只在屏幕上
+    uint8_t* known_mask = nullptr;  // 溢出后每个条带中由显示列表决定的像素，只发送这些像素
+    uint8_t* lent_block = nullptr;  // 借出的条带内存或帧缓冲区，借出期间画布不绘制也不显示
+    uint16_t lent_rows = 0;         // 借出的是条带内存时为条带行数，帧缓冲区为0
+    uint32_t lent_list_size = 0;
+
+    DirtyRect dirty_rects[CANVAS_MAX_DIRTY_RECTS] = {};
+    uint8_t dirty_count = 0;
+    bool dirty_all = true;          // 下次显示时整帧发送
+    uint16_t shown_x = 0, shown_y = 0;
+    uint32_t shown_serial = 0;      // 上次显示后LCD驱动的写入序号
+
+    bool scroll_columns = false;    // 滚动轴为x方向（行列交换的方向），滚动区域由画布列组成
+    uint16_t scroll_start = 0, scroll_length = 0;   // 硬件滚动区域（沿滚动轴的画布行或列），scroll_length为0表示没有使用
+    uint16_t scroll_offset = 0;     // 区域内第n行（列）显示的是写入地址为(n + scroll_offset) % scroll_length的行（列）
+
+    void MarkDirtyClipped(int32_t x0, int32_t y0, int32_t x1, int32_t y1);
+    void ClearDirty(uint16_t x, uint16_t y);
+
+    [[nodiscard]] DrawCommand MakeCommand(DrawOp op, uint16_t color) const;
+    bool GetCommandBounds(const DrawCommand& cmd, DirtyRect* rect) const;
+    void Submit(const DrawCommand& cmd);
+    void Raster(const DrawCommand& cmd, const void* data, const RasterTarget& target) const;
+
+    bool AllocateStrips(uint16_t rows, uint32_t list_size);
+    void AssignStrips(uint8_t* block, uint16_t rows, uint32_t list_size);
+    void ReleaseStrips();
+    DrawCommand* Append(const DrawCommand& cmd, uint32_t data_size);
+    bool Record(const DrawCommand& cmd, const DirtyRect& bounds);
+    void FlushRecorded();
+    void RasterImmediate(const DrawCommand& cmd, const DirtyRect& bounds);
+    void CullCovered(const DirtyRect& cover, uint32_t end);
+    bool CopyRecorded(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t x0, uint16_t y0);
+    bool CopyPixels(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t x0, uint16_t y0);
+    void PrepareScroll(uint16_t x, uint16_t y);
+    bool ScrollArea(bool columns, uint16_t start, uint16_t length, int16_t delta);
+    void QueueRows(uint16_t x, uint16_t y, uint16_t row0, uint16_t rows, uint16_t col0, uint16_t cols,
+                   const uint16_t* data, void (*callback)(void* user), void* user);
+    void RenderBand(uint16_t* strip, uint16_t band_y, uint16_t rows) const;
+    void QueueKnown(uint8_t index, uint16_t x, uint16_t y, uint16_t band_y, uint16_t rows);
+    [[nodiscard]] uint16_t KnownStride() const { return (width + 7) / 8; }
+    bool GetBandDirtyColumns(uint16_t band_y, uint16_t rows, uint16_t* col0, uint16_t* col1) const;
+    void DrawStripsDMA(uint16_t x, uint16_t y);
+    static void StripDone(void* user);
 
     static uint16_t GetCharSpacing(uint16_t char_width, uint32_t unicode);
 
@@ -57,8 +156,8 @@ private:
                                 std::optional<uint16_t> bgcolor);
     void WriteUnicodeStringImpl(uint16_t x, uint16_t y, const uint32_t* unicode_str, UnicodeFont* font, uint16_t color,
                                 std::optional<uint16_t> bgcolor);
-    void DrawChar(uint16_t x, uint16_t y, const std::shared_ptr<uint8_t[]>& bitmap, uint16_t char_width, uint16_t char_height,
-                  uint16_t color, std::optional<uint16_t> bgcolor);
+    void DrawChar(uint16_t x, uint16_t y, const uint8_t* bitmap, uint16_t char_width, uint16_t char_height,
+                  uint16_t color, std::optional<uint16_t> bgcolor, uint8_t bits_per_pixel);
     void DrawSpace(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t bgcolor);
 
 public:
@@ -83,11 +182,25 @@ public:
                                                                 auto_release(false) {
     }
 
+    /**
+     * @brief 构造函数，条带模式（不分配整帧缓冲区）
+     * @param width 画布宽度
+     * @param height 画布高度
+     * @param strip_rows 每个条带的行数，常用CANVAS_STRIP_ROWS
+     * @param list_size 显示列表的字节数
+     * @note 占用StripMemorySize(width, strip_rows, list_size)字节（2 * width * strip_rows个像素、list_size字节和
+     *       每行一位的掩码，一次分配）；显示列表写满时已记录的内容先发送到上次显示的位置，
+     *       然后从当前的绘制调用开始重新记录（单个调用比整个列表还大时直接光栅化发送），见isDisplayListOverflowed
+     */
+    Canvas(uint16_t width, uint16_t height, uint16_t strip_rows, uint32_t list_size = CANVAS_DISPLAY_LIST_SIZE);
+
     /**
      * @brief 析构函数
      * @note 如果缓冲区由类自动管理，则释放缓冲区
      */
     ~Canvas() {
+        // 先收回借出的内存，再按所属的模式释放
+        ReleaseStrips();
         if (auto_release) delete [] buffer;
     }
 
@@ -256,13 +369,24 @@ public:
                        uint16_t w = 0,
                        uint16_t h = 0);
 
+    /**
+     * @brief 在画布上绘制原始像素数据
+     * @param x 绘制位置的X坐标
+     * @param y 绘制位置的Y坐标
+     * @param w 像素数据的宽度
+     * @param h 像素数据的高度
+     * @param data 像素数据（本机字节序的RGB565，与画布缓冲区格式相同）
+     * @note 超出画布的部分会被裁剪
+     */
+    void DrawBitmap(uint16_t x, uint16_t y, uint16_t w, uint16_t h, const uint16_t* data);
+
     /**
      * @brief 将画布内容显示到 LCD
      * @param x 显示位置的X坐标
      * @param y 显示位置的Y坐标
-     * @note 使用普通 SPI 传输
+     * @note 使用普通 SPI 传输；条带模式下逐条带光栅化后发送
      */
-    void DrawCanvas(uint16_t x = 0, uint16_t y = 0) const;
+    void DrawCanvas(uint16_t x = 0, uint16_t y = 0);
 
     /**
      * @brief 将画布内容显示到 LCD（使用 DMA 传输）
@@ -270,9 +394,39 @@ public:
      * @param y 显示位置的Y坐标
      * @param wait_dma 是否阻塞等待DMA传输
      * @note 使用 DMA 传输
-     * @note 注意：如果你需要在传输后修改画布，请调用isDMAIdle手动阻塞等待并调用ST7735_Unselect或者设置wait_dma为true，否则DMA传输会受影响
+     * @note wait_dma为false时提交到ST7735事务队列后立即返回，传输期间可以做其他不涉及画布的工作；修改画布前需要等待isDMAIdle()为true
+     * @note 只发送上次显示之后被绘制过的脏矩形，每个矩形一个地址窗口，按画布行跨度逐行DMA；
+     *       显示位置改变、屏幕被其他模块写过（ST7735_GetWriteSerial变化）或脏区域过大时整帧发送
+     * @note 条带模式下只光栅化与脏矩形相交的条带，只发送其中脏矩形覆盖的列，一个条带DMA发送时光栅化另一个；
+     *       条带缓冲区归画布所有，返回后即可继续绘制
      */
-    void DrawCanvasDMA(uint16_t x = 0, uint16_t y = 0, bool wait_dma = true) const;
+    void DrawCanvasDMA(uint16_t x = 0, uint16_t y = 0, bool wait_dma = true);
+
+    /**
+     * @brief 标记一块区域已修改，下次DrawCanvasDMA时发送
+     * @param x 区域左上角X坐标
+     * @param y 区域左上角Y坐标
+     * @param w 区域宽度
+     * @param h 区域高度
+     * @note 所有绘制方法都会自动标记；只有通过GetBuffer直接修改缓冲区时才需要调用
+     */
+    void MarkDirty(uint16_t x, uint16_t y, uint16_t w, uint16_t h);
+
+    /**
+     * @brief 标记整个画布已修改，下次显示时整帧发送
+     */
+    void Invalidate() { dirty_all = true; }
+
+    /**
+     * @brief 检查区域自上次显示后是否可能被修改过
+     * @param x 区域左上角X坐标
+     * @param y 区域左上角Y坐标
+     * @param w 区域宽度
+     * @param h 区域高度
+     * @return 与待发送的脏矩形相交或需要整帧发送时返回true（脏矩形合并过，可能多报，不会漏报）
+     * @note 叠加在画布上的内容（如缩略图）可以据此只在被覆盖后重绘，不必每帧都重新绘制和发送
+     */
+    [[nodiscard]] bool IsDirty(uint16_t x, uint16_t y, uint16_t w, uint16_t h) const;
 
     /**
      * @brief 获取画布尺寸
@@ -286,7 +440,58 @@ public:
      * @brief 检查缓冲区是否有效
      * @return 缓冲区有效返回true，否则返回false
      */
-    [[nodiscard]] bool isBufferValid() const { return buffer; }
+    [[nodiscard]] bool isBufferValid() const { return buffer || display_list; }
+
+    /**
+     * @brief 检查是否为条带模式
+     * @return 条带模式返回true，帧缓冲区模式返回false
+     */
+    [[nodiscard]] bool isStripMode() const { return display_list; }
+
+    /**
+     * @brief 检查显示列表是否写满过（条带模式）
+     * @return 显示列表写满后重新开始记录过，且之后没有被FillCanvas或覆盖整个画布的不透明绘制重置时返回true
+     * @note 此时部分像素只保存在屏幕上：显示时只发送显示列表决定的像素，透明的抗锯齿文字边缘不与这些像素混合；
+     *       换位置显示或屏幕被其他模块写过之后这些像素不再正确，Copy和Scroll也无法复制它们而返回false，需要整屏重绘
+     */
+    [[nodiscard]] bool isDisplayListOverflowed() const { return list_overflow; }
+
+    /**
+     * @brief 获取缓冲区指针（本机字节序的RGB565，行优先）
+     * @return 缓冲区指针，条带模式下为nullptr
+     * @note 供需要临时借用整帧内存的模块使用，借用后画布内容作废，需要重绘；
+     *       直接修改缓冲区后需要调用MarkDirty或Invalidate
+     */
+    [[nodiscard]] uint16_t* GetBuffer() const { return buffer; }
+
+    /**
+     * @brief 条带模式的画布占用的字节数
+     * @param width 画布宽度
+     * @param strip_rows 每个条带的行数
+     * @param list_size 显示列表的字节数
+     * @return 条带、显示列表和掩码合计的字节数，按这个大小一次分配
+     * @note 用于选择list_size，使整块内存正好能借作其他模块的缓冲区（如幻灯片的一帧），见LendMemory
+     */
+    [[nodiscard]] static constexpr uint32_t StripMemorySize(uint16_t width, uint16_t strip_rows, uint32_t list_size) {
+        // 显示列表在前，按命令的对齐要求补齐后放两个条带，掩码在最后
+        uint32_t list_bytes = (list_size + alignof(DrawCommand) - 1) & ~static_cast<uint32_t>(alignof(DrawCommand) - 1);
+        return list_bytes + 2u * width * strip_rows * sizeof(uint16_t) + static_cast<uint32_t>((width + 7) / 8) * strip_rows;
+    }
+
+    /**
+     * @brief 把画布的内存（条带模式下条带和显示列表所在的整块内存，帧缓冲区模式下为缓冲区）借给其他模块
+     * @param size 返回借出的字节数
+     * @return 内存地址，已经借出或没有缓冲区时返回nullptr
+     * @note 先等待画布的DMA发送完成；借出期间绘制和显示调用被忽略，不分配也不释放堆内存，
+     *       借用者在ReturnMemory之前可以任意覆盖其内容
+     */
+    void* LendMemory(uint32_t* size);
+
+    /**
+     * @brief 收回LendMemory借出的内存
+     * @note 画布内容作废：显示列表清空，帧缓冲区内容不确定，下次显示时整帧发送，调用者需要重绘
+     */
+    void ReturnMemory();
 
     /**
      * @brief 检查DMA是否完成
@@ -297,7 +502,7 @@ public:
     /**
      * @brief 重新分配缓冲区（保持当前尺寸）
      * @return 成功返回true，失败返回false
-     * @note 如果缓冲区由类自动管理，则先释放旧缓冲区
+     * @note 如果缓冲区由类自动管理，则先释放旧缓冲区；条带模式的画布切换为帧缓冲区模式（所有RenewBuffer都是如此）
      */
     bool RenewBuffer();
 
@@ -326,6 +531,15 @@ public:
      */
     void RenewBuffer(uint16_t* buffer, uint16_t width, uint16_t height);
 
+    /**
+     * @brief 把画布尺寸调整为LCD当前方向下的逻辑尺寸（ST7735_GetWidth/ST7735_GetHeight）
+     * @return 成功返回true，失败返回false
+     * @note 旋转90/270度时像素数不变，只交换宽高并复用原缓冲区；像素数不同时重新分配，
+     *       外部缓冲区不会被重新分配，此时返回false；条带模式下按新的宽度重新分配条带并清空显示列表；
+     *       调整后画布内容作废，需要重绘
+     */
+    bool FitScreen();
+
     /**
      * @brief 复制画布区域
      * @param x 源区域左上角X坐标
@@ -334,9 +548,33 @@ public:
      * @param h 复制区域的高度
      * @param x0 目标位置X坐标
      * @param y0 目标位置Y坐标
+     * @return 成功返回true；条带模式下显示列表放不下复制后的命令或isDisplayListOverflowed()为true时返回false，
+     *         画布内容不变，调用者应重绘目标区域
      * @note 将画布上从(x, y)开始的区域复制到(x0, y0)位置，自动处理重叠情况
      */
-    void Copy(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t x0, uint16_t y0);
+    bool Copy(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t x0, uint16_t y0);
+
+    /**
+     * @brief 用LCD的硬件滚动把若干整行上下移动
+     * @param y 滚动区域起始行
+     * @param h 滚动区域行数
+     * @param dy 移动的行数，正数向下移动
+     * @return 成功返回true；不满足硬件滚动的条件或无法复制画布内容（见Copy）时返回false，画布内容不变，调用者应改用Copy
+     * @note 画布内容同样移动，之后只有新露出的|dy|行需要重绘和发送。
+     *       要求画布与屏幕等宽、上次显示在屏幕左边缘，且当前方向的滚动轴为y方向（见ST7735_GetScrollAxis）；
+     *       整帧发送时滚动会复位
+     */
+    bool Scroll(uint16_t y, uint16_t h, int16_t dy);
+
+    /**
+     * @brief 用LCD的硬件滚动把若干整列左右移动，用于行列交换（MV）的方向，此时控制器的滚动轴为x方向
+     * @param x 滚动区域起始列
+     * @param w 滚动区域列数
+     * @param dx 移动的列数，正数向右移动
+     * @return 与Scroll相同
+     * @note 要求画布与屏幕等高、上次显示在屏幕上边缘，且当前方向的滚动轴为x方向；其余与Scroll相同
+     */
+    bool ScrollColumns(uint16_t x, uint16_t w, int16_t dx);
 };
 #endif
 
@@ -0,0 +1,579 @@
+//
+// 大图平移缩放浏览器实现
+// 瓦片缓存布局：按MCU行（条带）顺序，每个条带tiles_x个瓦片，每个瓦片PAN_TILE_WIDTH × strip_h个RGB565像素
+// 解码检查点：每个MCU行记录一个不晚于行首的解码器状态和数据流偏移，平移到未缓存区域时从最近的检查点恢复解码
+//
+
+#include "pan_viewer.h"
+#include "pic_types.h"
+#include "st7735.h"
+#include "fatfs.h"
+#include "tjpgd.h"
+#include <cstring>
+#include <cstdlib>
+#include <strings.h>
+
+extern SPI_HandleTypeDef ST7735_SPI_PORT;
+
+#define PAN_MAX_STRIP_HEIGHT 16     // 最大MCU高度（4:2:0采样）
+#define PAN_TILE_PIXELS (PAN_TILE_WIDTH * PAN_MAX_STRIP_HEIGHT)
+#define PAN_BAND_PIXELS (ST7735_MAX_SIDE * PAN_MAX_STRIP_HEIGHT)
+
+// 解码检查点：MCU边界处的解码器状态和下一个未读字节的文件偏移
+typedef struct {
+    JCHECKPOINT state;
+    uint32_t offset;                // 0表示还没有检查点
+} PanCheckpoint;
+
+typedef struct PanViewer {
+    FIL file;
+    FIL scratch;
+    bool scratch_open;
+    JDEC jdec;
+    uint8_t* workbuf;
+    uint16_t mcu_cols;
+    uint16_t mcu_rows;
+    PanCheckpoint* checkpoints;     // 每个MCU行一个
+
+    // 重启标记扫描进度（从熵编码数据开头顺序扫描）
+    uint32_t scan_offset;
+    uint32_t scan_markers;
+    bool scan_prev_ff;
+    bool scan_done;
+
+    // 当前缩放级别的瓦片缓存
+    uint8_t zoom;
+    uint16_t img_w;
+    uint16_t img_h;
+    uint16_t strip_h;
+    uint16_t strips;
+    uint16_t tiles_x;
+    uint32_t tile_bytes;
+    uint8_t* strip_cached;
+    uint16_t* ram_cache;            // 非空时瓦片保存在内存中，否则保存在临时文件中
+
+    // 解码过程状态
+    uint16_t* tile;                 // 解码时拼装瓦片，绘制时读取溢出的瓦片
+    int32_t active_strip;           // 从行首开始输出的MCU行，只缓存完整的行
+    uint16_t stop_strip;            // 超过此MCU行后中止解码
+    bool write_failed;
+
+    // 视口
+    uint16_t view_x;
+    uint16_t view_y;
+    bool clear_pending;
+    uint16_t* bands[2];             // 视口行带，轮流进行DMA发送
+} PanViewer;
+
+static PanError g_last_error = PAN_SUCCESS;
+
+static const char* error_strings[] = {
+    "成功",
+    "无效的参数",
+    "文件打开失败",
+    "文件读取失败",
+    "文件写入失败",
+    "内存分配失败",
+    "不支持的格式",
+    "解码失败"
+};
+
+static bool is_jpeg_name(const char* filename);
+static size_t pan_input(JDEC* jd, uint8_t* buf, size_t nbyte);
+static int pan_output(JDEC* jd, void* bitmap, JRECT* rect);
+static PanError apply_zoom(PanViewer* viewer, uint8_t zoom);
+static void view_size(const PanViewer* viewer, uint16_t* w, uint16_t* h);
+static void clamp_view(PanViewer* viewer, int32_t x, int32_t y);
+static bool store_tile(PanViewer* viewer, uint16_t tx, uint16_t strip);
+static const uint16_t* load_tile(PanViewer* viewer, uint16_t tx, uint16_t strip);
+static void add_restart(PanViewer* viewer, uint32_t interval, uint32_t offset);
+static PanError scan_restarts(PanViewer* viewer, uint16_t target_row);
+static int32_t find_checkpoint(const PanViewer* viewer, uint16_t row);
+static PanError run_decoder(PanViewer* viewer, const PanCheckpoint* checkpoint, uint16_t stop_strip);
+static PanError decode_strips(PanViewer* viewer, uint16_t first, uint16_t last);
+
+PanError PAN_Open(const char* filename, PanViewer_t* handle) {
+    if (!filename || !handle) {
+        g_last_error = PAN_ERROR_INVALID_PARAM;
+        return g_last_error;
+    }
+    if (!is_jpeg_name(filename)) {
+        g_last_error = PAN_ERROR_UNSUPPORTED_FORMAT;
+        return g_last_error;
+    }
+
+    PanViewer* viewer = (PanViewer*)malloc(sizeof(PanViewer));
+    if (!viewer) {
+        g_last_error = PAN_ERROR_MEMORY_ALLOC;
+        return g_last_error;
+    }
+    memset(viewer, 0, sizeof(PanViewer));
+
+    if (f_open(&viewer->file, filename, FA_READ) != FR_OK) {
+        free(viewer);
+        g_last_error = PAN_ERROR_FILE_OPEN;
+        return g_last_error;
+    }
+
+    PanError error = PAN_SUCCESS;
+    viewer->workbuf = (uint8_t*)malloc(PIC_TJPGDEC_WORKSPACE);
+    viewer->tile = (uint16_t*)malloc(PAN_TILE_PIXELS * sizeof(uint16_t));
+    viewer->bands[0] = (uint16_t*)malloc(PAN_BAND_PIXELS * sizeof(uint16_t));
+    viewer->bands[1] = (uint16_t*)malloc(PAN_BAND_PIXELS * sizeof(uint16_t));
+    if (!viewer->workbuf || !viewer->tile || !viewer->bands[0] || !viewer->bands[1]) {
+        error = PAN_ERROR_MEMORY_ALLOC;
+    }
+
+    if (error == PAN_SUCCESS) {
+        JRESULT jres = jd_prepare(&viewer->jdec, pan_input, viewer->workbuf, PIC_TJPGDEC_WORKSPACE, viewer);
+        if (jres == JDR_FMT3) {
+            error = PAN_ERROR_UNSUPPORTED_FORMAT;
+        }
+        else if (jres != JDR_OK || viewer->jdec.msy * 8 > PAN_MAX_STRIP_HEIGHT) {
+            error = PAN_ERROR_DECODE_FAILED;
+        }
+    }
+
+    if (error == PAN_SUCCESS) {
+        uint16_t mx = viewer->jdec.msx * 8;
+        uint16_t my = viewer->jdec.msy * 8;
+        viewer->mcu_cols = (viewer->jdec.width + mx - 1) / mx;
+        viewer->mcu_rows = (viewer->jdec.height + my - 1) / my;
+        viewer->checkpoints = (PanCheckpoint*)calloc(viewer->mcu_rows, sizeof(PanCheckpoint));
+        if (!viewer->checkpoints) error = PAN_ERROR_MEMORY_ALLOC;
+    }
+
+    if (error == PAN_SUCCESS) {
+        // 熵编码数据的起点就是第一个检查点，jd_prepare预读但未消耗的字节不计入
+        viewer->checkpoints[0].offset = f_tell(&viewer->file) - viewer->jdec.dctr;
+        viewer->scan_offset = viewer->checkpoints[0].offset;
+        viewer->zoom = 0;
+        error = apply_zoom(viewer, 0);
+    }
+
+    if (error != PAN_SUCCESS) {
+        PAN_Close(viewer);
+        g_last_error = error;
+        return error;
+    }
+
+    viewer->clear_pending = true;
+    *handle = viewer;
+    g_last_error = PAN_SUCCESS;
+    return PAN_SUCCESS;
+}
+
+void PAN_Close(PanViewer_t handle) {
+    if (!handle) return;
+
+    f_close(&handle->file);
+    if (handle->scratch_open) {
+        f_close(&handle->scratch);
+        f_unlink(PAN_SCRATCH_FILENAME);
+    }
+    free(handle->workbuf);
+    free(handle->checkpoints);
+    free(handle->strip_cached);
+    free(handle->ram_cache);
+    free(handle->tile);
+    free(handle->bands[0]);
+    free(handle->bands[1]);
+    free(handle);
+}
+
+PanError PAN_SetZoom(PanViewer_t handle, uint8_t zoom) {
+    if (!handle || zoom > PAN_MAX_ZOOM) {
+        g_last_error = PAN_ERROR_INVALID_PARAM;
+        return g_last_error;
+    }
+    if (zoom == handle->zoom) {
+        g_last_error = PAN_SUCCESS;
+        return PAN_SUCCESS;
+    }
+
+    uint16_t view_w, view_h;
+    view_size(handle, &view_w, &view_h);
+    int32_t cx = ((int32_t)(handle->view_x + view_w / 2) << handle->zoom) >> zoom;
+    int32_t cy = ((int32_t)(handle->view_y + view_h / 2) << handle->zoom) >> zoom;
+
+    PanError error = apply_zoom(handle, zoom);
+    if (error != PAN_SUCCESS) {
+        // 回到原缩放级别，保证句柄仍然可用
+        apply_zoom(handle, handle->zoom);
+        g_last_error = error;
+        return error;
+    }
+    handle->zoom = zoom;
+
+    view_size(handle, &view_w, &view_h);
+    clamp_view(handle, cx - view_w / 2, cy - view_h / 2);
+    handle->clear_pending = true;
+
+    g_last_error = PAN_SUCCESS;
+    return PAN_SUCCESS;
+}
+
+PanError PAN_Move(PanViewer_t handle, int32_t dx, int32_t dy) {
+    if (!handle) {
+        g_last_error = PAN_ERROR_INVALID_PARAM;
+        return g_last_error;
+    }
+
+    uint16_t old_x = handle->view_x;
+    uint16_t old_y = handle->view_y;
+    clamp_view(handle, (int32_t)handle->view_x + dx, (int32_t)handle->view_y + dy);
+    if (handle->view_x == old_x && handle->view_y == old_y) {
+        g_last_error = PAN_SUCCESS;
+        return PAN_SUCCESS;
+    }
+    return PAN_Render(handle);
+}
+
+PanError PAN_Render(PanViewer_t handle) {
+    if (!handle) {
+        g_last_error = PAN_ERROR_INVALID_PARAM;
+        return g_last_error;
+    }
+
+    uint16_t view_w, view_h;
+    view_size(handle, &view_w, &view_h);
+    uint16_t first = handle->view_y / handle->strip_h;
+    uint16_t last = (handle->view_y + view_h - 1) / handle->strip_h;
+
+    PanError error = decode_strips(handle, first, last);
+    if (error != PAN_SUCCESS) {
+        g_last_error = error;
+        return error;
+    }
+
+    // 图片比屏幕小时居中显示，切换缩放级别后先清屏
+    uint16_t ox = (ST7735_GetWidth() - view_w) / 2;
+    uint16_t oy = (ST7735_GetHeight() - view_h) / 2;
+    if (handle->clear_pending) {
+        if (view_w < ST7735_GetWidth() || view_h < ST7735_GetHeight()) ST7735_FillScreenFast(ST7735_BLACK);
+        handle->clear_pending = false;
+    }
+
+    ST7735_Select();
+    ST7735_SetAddressWindow(ox, oy, ox + view_w - 1, oy + view_h - 1);
+
+    uint8_t index = 0;
+    bool dma_busy = false;
+    for (uint16_t strip = first; strip <= last && error == PAN_SUCCESS; strip++) {
+        uint16_t y0 = strip * handle->strip_h;
+        uint16_t r0 = (handle->view_y > y0 ? handle->view_y : y0) - y0;
+        uint16_t r1 = (handle->view_y + view_h < y0 + handle->strip_h ? handle->view_y + view_h : y0 + handle->strip_h) - y0;
+        uint16_t* band = handle->bands[index];
+
+        // 把视口覆盖的瓦片片段拼成一个行带
+        for (uint16_t tx = handle->view_x / PAN_TILE_WIDTH; tx * PAN_TILE_WIDTH < handle->view_x + view_w; tx++) {
+            const uint16_t* tile = load_tile(handle, tx, strip);
+            if (!tile) {
+                error = PAN_ERROR_FILE_READ;
+                break;
+            }
+            uint16_t tile_x = tx * PAN_TILE_WIDTH;
+            uint16_t c0 = handle->view_x > tile_x ? handle->view_x : tile_x;
+            uint16_t c1 = handle->view_x + view_w < tile_x + PAN_TILE_WIDTH ? handle->view_x + view_w : tile_x + PAN_TILE_WIDTH;
+            for (uint16_t r = r0; r < r1; r++) {
+                memcpy(band + (uint32_t)(r - r0) * view_w + (c0 - handle->view_x),
+                       tile + (uint32_t)r * PAN_TILE_WIDTH + (c0 - tile_x), (c1 - c0) * sizeof(uint16_t));
+            }
+        }
+        if (error != PAN_SUCCESS) break;
+
+        if (dma_busy) {
+            while (HAL_SPI_GetState(&ST7735_SPI_PORT) != HAL_SPI_STATE_READY);
+        }
+        ST7735_WritePixelsDMA(band, (uint32_t)(r1 - r0) * view_w);
+        dma_busy = true;
+        index ^= 1;
+    }
+
+    if (dma_busy) {
+        while (HAL_SPI_GetState(&ST7735_SPI_PORT) != HAL_SPI_STATE_READY);
+        while (__HAL_SPI_GET_FLAG(&ST7735_SPI_PORT, SPI_FLAG_BSY));
+    }
+    ST7735_Unselect();
+
+    g_last_error = error;
+    return error;
+}
+
+bool PAN_ProcessIdle(PanViewer_t handle) {
+    if (!handle) return false;
+
+    uint16_t view_w, view_h;
+    view_size(handle, &view_w, &view_h);
+    uint16_t first = handle->view_y / handle->strip_h;
+    uint16_t last = (handle->view_y + view_h - 1) / handle->strip_h;
+
+    // 先向下（解码方向）再向上寻找最近的未缓存MCU行
+    int32_t target = -1;
+    for (uint16_t strip = last + 1; strip < handle->strips; strip++) {
+        if (!handle->strip_cached[strip]) {
+            target = strip;
+            break;
+        }
+    }
+    for (int32_t strip = (int32_t)first - 1; target < 0 && strip >= 0; strip--) {
+        if (!handle->strip_cached[strip]) target = strip;
+    }
+    if (target < 0) return false;
+
+    uint16_t stop = target + PAN_IDLE_STRIPS - 1 < handle->strips ? target + PAN_IDLE_STRIPS - 1 : handle->strips - 1;
+    return decode_strips(handle, (uint16_t)target, stop) == PAN_SUCCESS;
+}
+
+void PAN_GetImageSize(PanViewer_t handle, uint16_t* width, uint16_t* height) {
+    if (!handle) return;
+    if (width) *width = handle->img_w;
+    if (height) *height = handle->img_h;
+}
+
+uint8_t PAN_GetZoom(PanViewer_t handle) {
+    return handle ? handle->zoom : 0;
+}
+
+const char* PAN_GetErrorString(PanError error) {
+    if (error < 0 || error >= sizeof(error_strings) / sizeof(error_strings[0])) {
+        return "未知错误";
+    }
+    return error_strings[error];
+}
+
+PanError PAN_GetLastError(void) {
+    return g_last_error;
+}
+
+static bool is_jpeg_name(const char* filename) {
+    const char* ext = strrchr(filename, '.');
+    return ext && (strcasecmp(ext, ".jpg") == 0 || strcasecmp(ext, ".jpeg") == 0);
+}
+
+static size_t pan_input(JDEC* jd, uint8_t* buf, size_t nbyte) {
+    PanViewer* viewer = (PanViewer*)jd->device;
+    if (!buf) {
+        FSIZE_t target = f_tell(&viewer->file) + nbyte;
+        if (target > f_size(&viewer->file) || f_lseek(&viewer->file, target) != FR_OK) {
+            return 0;
+        }
+        return nbyte;
+    }
+    UINT bytes_read;
+    if (f_read(&viewer->file, buf, nbyte, &bytes_read) != FR_OK) {
+        return 0;
+    }
+    return bytes_read;
+}
+
+static int pan_output(JDEC* jd, void* bitmap, JRECT* rect) {
+    PanViewer* viewer = (PanViewer*)jd->device;
+    uint16_t row = rect->top / viewer->strip_h;
+    if (row > viewer->stop_strip) return 0;
+
+    bool row_end = rect->right + 1 >= viewer->img_w;
+
+    if (!viewer->strip_cached[row]) {
+        // 从检查点恢复时可能从行中间开始，这样的行不完整，不缓存
+        if (rect->left == 0) viewer->active_strip = row;
+        if (viewer->active_strip == row) {
+            uint16_t w = rect->right - rect->left + 1;
+            uint16_t tile_x = rect->left % PAN_TILE_WIDTH;
+            const uint16_t* src = (const uint16_t*)bitmap;
+            for (uint16_t y = rect->top; y <= rect->bottom; y++) {
+                uint16_t* dst = viewer->tile + (uint32_t)(y - rect->top) * PAN_TILE_WIDTH + tile_x;
+                memcpy(dst, src, w * sizeof(uint16_t));
+                src += w;
+            }
+
+            // MCU宽度整除瓦片宽度，瓦片右边界处的MCU输出后瓦片即完整
+            if (tile_x + w == PAN_TILE_WIDTH || row_end) {
+                if (!store_tile(viewer, rect->left / PAN_TILE_WIDTH, row)) {
+                    viewer->write_failed = true;
+                    return 0;
+                }
+                memset(viewer->tile, 0, viewer->tile_bytes);
+                if (row_end) viewer->strip_cached[row] = 1;
+            }
+        }
+    }
+
+    // 一行的最后一个MCU输出后，解码器状态就是下一行开头的状态
+    if (row_end && row + 1 < viewer->mcu_rows) {
+        uint32_t mcu = (uint32_t)row * viewer->mcu_cols + rect->left / ((jd->msx * 8) >> viewer->zoom) + 1;
+        PanCheckpoint* checkpoint = &viewer->checkpoints[row + 1];
+        if (checkpoint->offset == 0 || checkpoint->state.mcu < mcu) {
+            jd_checkpoint(jd, mcu, &checkpoint->state);
+            checkpoint->offset = f_tell(&viewer->file) - jd->dctr;
+        }
+    }
+
+    return 1;
+}
+
+// 建立指定缩放级别的瓦片缓存，总大小不超过PAN_RAM_CACHE_SIZE时放在内存中，否则使用临时文件
+static PanError apply_zoom(PanViewer* viewer, uint8_t zoom) {
+    free(viewer->strip_cached);
+    free(viewer->ram_cache);
+    viewer->strip_cached = nullptr;
+    viewer->ram_cache = nullptr;
+
+    viewer->img_w = viewer->jdec.width >> zoom;
+    viewer->img_h = viewer->jdec.height >> zoom;
+    viewer->strip_h = (viewer->jdec.msy * 8) >> zoom;
+    if (viewer->img_w == 0 || viewer->img_h == 0) return PAN_ERROR_INVALID_PARAM;
+
+    viewer->strips = (viewer->img_h + viewer->strip_h - 1) / viewer->strip_h;
+    viewer->tiles_x = (viewer->img_w + PAN_TILE_WIDTH - 1) / PAN_TILE_WIDTH;
+    viewer->tile_bytes = (uint32_t)PAN_TILE_WIDTH * viewer->strip_h * sizeof(uint16_t);
+
+    viewer->strip_cached = (uint8_t*)calloc(viewer->strips, 1);
+    if (!viewer->strip_cached) return PAN_ERROR_MEMORY_ALLOC;
+
+    uint32_t total = (uint32_t)viewer->tiles_x * viewer->strips * viewer->tile_bytes;
+    if (total <= PAN_RAM_CACHE_SIZE) {
+        viewer->ram_cache = (uint16_t*)malloc(total);
+    }
+    if (!viewer->ram_cache && !viewer->scratch_open) {
+        if (f_open(&viewer->scratch, PAN_SCRATCH_FILENAME, FA_CREATE_ALWAYS | FA_READ | FA_WRITE) != FR_OK) {
+            return PAN_ERROR_FILE_OPEN;
+        }
+        viewer->scratch_open = true;
+    }
+
+    memset(viewer->tile, 0, viewer->tile_bytes);
+    return PAN_SUCCESS;
+}
+
+static void view_size(const PanViewer* viewer, uint16_t* w, uint16_t* h) {
+    *w = viewer->img_w < ST7735_GetWidth() ? viewer->img_w : ST7735_GetWidth();
+    *h = viewer->img_h < ST7735_GetHeight() ? viewer->img_h : ST7735_GetHeight();
+}
+
+static void clamp_view(PanViewer* viewer, int32_t x, int32_t y) {
+    uint16_t view_w, view_h;
+    view_size(viewer, &view_w, &view_h);
+    int32_t max_x = viewer->img_w - view_w;
+    int32_t max_y = viewer->img_h - view_h;
+    viewer->view_x = (uint16_t)(x < 0 ? 0 : (x > max_x ? max_x : x));
+    viewer->view_y = (uint16_t)(y < 0 ? 0 : (y > max_y ? max_y : y));
+}
+
+static bool store_tile(PanViewer* viewer, uint16_t tx, uint16_t strip) {
+    uint32_t index = (uint32_t)strip * viewer->tiles_x + tx;
+    if (viewer->ram_cache) {
+        memcpy((uint8_t*)viewer->ram_cache + index * viewer->tile_bytes, viewer->tile, viewer->tile_bytes);
+        return true;
+    }
+
+    UINT bytes_written;
+    if (f_lseek(&viewer->scratch, index * viewer->tile_bytes) != FR_OK) return false;
+    return f_write(&viewer->scratch, viewer->tile, viewer->tile_bytes, &bytes_written) == FR_OK &&
+           bytes_written == viewer->tile_bytes;
+}
+
+static const uint16_t* load_tile(PanViewer* viewer, uint16_t tx, uint16_t strip) {
+    uint32_t index = (uint32_t)strip * viewer->tiles_x + tx;
+    if (viewer->ram_cache) {
+        return (const uint16_t*)((const uint8_t*)viewer->ram_cache + index * viewer->tile_bytes);
+    }
+
+    UINT bytes_read;
+    if (f_lseek(&viewer->scratch, index * viewer->tile_bytes) != FR_OK ||
+        f_read(&viewer->scratch, viewer->tile, viewer->tile_bytes, &bytes_read) != FR_OK ||
+        bytes_read != viewer->tile_bytes) {
+        return nullptr;
+    }
+    return viewer->tile;
+}
+
+// 第interval个重启间隔从offset处的RSTn标记开始，为行首落在这个间隔内的MCU行建立检查点
+static void add_restart(PanViewer* viewer, uint32_t interval, uint32_t offset) {
+    uint32_t mcu = interval * viewer->jdec.nrst;
+    uint32_t row = (mcu + viewer->mcu_cols - 1) / viewer->mcu_cols;
+    for (; row < viewer->mcu_rows && row * viewer->mcu_cols < mcu + viewer->jdec.nrst; row++) {
+        PanCheckpoint* checkpoint = &viewer->checkpoints[row];
+        if (checkpoint->offset == 0 || checkpoint->state.mcu < mcu) {
+            memset(&checkpoint->state, 0, sizeof(JCHECKPOINT));
+            checkpoint->state.mcu = mcu;
+            checkpoint->offset = offset;
+        }
+    }
+}
+
+// 顺序扫描熵编码数据中的RSTn标记（不做霍夫曼解码），直到target_row有检查点
+static PanError scan_restarts(PanViewer* viewer, uint16_t target_row) {
+    uint8_t* buf = (uint8_t*)viewer->tile;
+    const UINT chunk = PAN_TILE_PIXELS * sizeof(uint16_t);
+
+    while (!viewer->scan_done && viewer->checkpoints[target_row].offset == 0) {
+        UINT bytes_read;
+        if (f_lseek(&viewer->file, viewer->scan_offset) != FR_OK ||
+            f_read(&viewer->file, buf, chunk, &bytes_read) != FR_OK) {
+            return PAN_ERROR_FILE_READ;
+        }
+        if (bytes_read == 0) viewer->scan_done = true;
+
+        for (UINT i = 0; i < bytes_read && !viewer->scan_done; i++) {
+            uint8_t b = buf[i];
+            if (viewer->scan_prev_ff) {
+                if (b >= 0xD0 && b <= 0xD7) {
+                    // 第k个标记（从0计）之后是第k + 1个重启间隔
+                    add_restart(viewer, ++viewer->scan_markers, viewer->scan_offset + i - 1);
+                }
+                else if (b == 0xD9) {
+                    viewer->scan_done = true;
+                }
+            }
+            viewer->scan_prev_ff = b == 0xFF;
+        }
+        viewer->scan_offset += bytes_read;
+    }
+
+    // 瓦片缓冲区被用作扫描缓冲区
+    memset(viewer->tile, 0, viewer->tile_bytes);
+    return PAN_SUCCESS;
+}
+
+static int32_t find_checkpoint(const PanViewer* viewer, uint16_t row) {
+    for (int32_t i = row; i >= 0; i--) {
+        if (viewer->checkpoints[i].offset) return i;
+    }
+    return 0;
+}
+
+static PanError run_decoder(PanViewer* viewer, const PanCheckpoint* checkpoint, uint16_t stop_strip) {
+    if (f_lseek(&viewer->file, checkpoint->offset) != FR_OK) return PAN_ERROR_FILE_READ;
+
+    JCHECKPOINT state = checkpoint->state;
+    viewer->active_strip = -1;
+    viewer->stop_strip = stop_strip;
+    viewer->write_failed = false;
+    memset(viewer->tile, 0, viewer->tile_bytes);
+
+    JRESULT jres = jd_decomp_from(&viewer->jdec, pan_output, viewer->zoom, &state);
+    if (viewer->write_failed) return PAN_ERROR_FILE_WRITE;
+    if (jres != JDR_OK && jres != JDR_INTR) return PAN_ERROR_DECODE_FAILED;
+    return PAN_SUCCESS;
+}
+
+// 解码[first, last]中尚未缓存的MCU行，途经的其他未缓存行也一并缓存
+static PanError decode_strips(PanViewer* viewer, uint16_t first, uint16_t last) {
+    for (uint16_t strip = first; strip <= last; strip++) {
+        if (viewer->strip_cached[strip]) continue;
+
+        int32_t start = find_checkpoint(viewer, strip);
+        if (viewer->jdec.nrst && strip - start > 2) {
+            // 有重启标记时扫描标记比逐行解码快得多
+            PanError error = scan_restarts(viewer, strip);
+            if (error != PAN_SUCCESS) return error;
+            start = find_checkpoint(viewer, strip);
+        }
+
+        PanError error = run_decoder(viewer, &viewer->checkpoints[start], last);
+        if (error != PAN_SUCCESS) return error;
+        if (!viewer->strip_cached[strip]) return PAN_ERROR_DECODE_FAILED;
+    }
+    return PAN_SUCCESS;
+}
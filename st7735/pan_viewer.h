@@ -0,0 +1,217 @@
+//
+// 大图平移缩放浏览器类型定义和接口
+// JPEG按MCU行解码为固定宽度的瓦片缓存（内存不足时溢出到SD卡上的临时文件），平移时只重新发送缓存的瓦片
+//
+
+#ifndef SD_AND_LCD2_PAN_VIEWER_H
+#define SD_AND_LCD2_PAN_VIEWER_H
+
+#include "ff.h"
+
+#ifdef __cplusplus
+extern "C" {
+#else
+#include <stdint.h>
+#include <stdbool.h>
+#endif
+
+#define PAN_TILE_WIDTH 64
+// 瓦片宽度（像素），是所有缩放级别下MCU宽度的整数倍；瓦片高度为一个MCU行
+
+#define PAN_RAM_CACHE_SIZE 24576
+// 瓦片缓存放在内存中的上限（字节），超过时溢出到SD卡
+
+#define PAN_SCRATCH_FILENAME "/.pan_cache.tmp"
+// 溢出瓦片缓存的临时文件，关闭时删除
+
+#define PAN_IDLE_STRIPS 4
+// 空闲时每次最多预解码的MCU行数
+
+#define PAN_MAX_ZOOM 3
+// 最大缩小级别（1:8），对应TJpgDec的缩放参数
+
+// 错误码定义
+typedef enum {
+    PAN_SUCCESS = 0,
+    PAN_ERROR_INVALID_PARAM,
+    PAN_ERROR_FILE_OPEN,
+    PAN_ERROR_FILE_READ,
+    PAN_ERROR_FILE_WRITE,
+    PAN_ERROR_MEMORY_ALLOC,
+    PAN_ERROR_UNSUPPORTED_FORMAT,
+    PAN_ERROR_DECODE_FAILED
+} PanError;
+
+// 浏览器句柄
+typedef struct PanViewer* PanViewer_t;
+
+/**
+ * @brief 打开JPEG图片，以原始分辨率显示左上角
+ * @param filename 图片文件路径（GBK编码）
+ * @param handle 返回的浏览器句柄
+ * @return 成功返回PAN_SUCCESS，失败返回错误码
+ * @note 只支持基线JPEG；打开时只解析文件头，需要调用PAN_Render显示
+ */
+PanError PAN_Open(const char* filename, PanViewer_t* handle);
+
+/**
+ * @brief 关闭浏览器，释放缓存并删除临时文件
+ * @param handle 浏览器句柄
+ */
+void PAN_Close(PanViewer_t handle);
+
+/**
+ * @brief 设置缩小级别，保持视口中心不变
+ * @param handle 浏览器句柄
+ * @param zoom 0为原始分辨率，1~3依次为1/2、1/4、1/8
+ * @return 成功返回PAN_SUCCESS，失败返回错误码
+ * @note 瓦片缓存与缩放级别相关，切换后重新建立；已记录的解码检查点仍然有效
+ */
+PanError PAN_SetZoom(PanViewer_t handle, uint8_t zoom);
+
+/**
+ * @brief 平移视口并重绘
+ * @param handle 浏览器句柄
+ * @param dx 水平移动的像素数（当前缩放级别下），超出图片边界时自动限制
+ * @param dy 垂直移动的像素数
+ * @return 成功返回PAN_SUCCESS，失败返回错误码
+ */
+PanError PAN_Move(PanViewer_t handle, int32_t dx, int32_t dy);
+
+/**
+ * @brief 解码视口内尚未缓存的MCU行并把视口发送到LCD
+ * @param handle 浏览器句柄
+ * @return 成功返回PAN_SUCCESS，失败返回错误码
+ * @note 解码从视口之前最近的检查点恢复：已经解码经过的MCU行都有检查点，
+ *       图片带有重启标记时只扫描标记即可跳到尚未解码的区域
+ */
+PanError PAN_Render(PanViewer_t handle);
+
+/**
+ * @brief 在空闲时调用，预解码视口附近的MCU行
+ * @param handle 浏览器句柄
+ * @return 仍有未缓存的MCU行返回true，否则返回false
+ */
+bool PAN_ProcessIdle(PanViewer_t handle);
+
+/**
+ * @brief 获取当前缩放级别下的图片尺寸
+ * @param handle 浏览器句柄
+ * @param width 返回的宽度
+ * @param height 返回的高度
+ */
+void PAN_GetImageSize(PanViewer_t handle, uint16_t* width, uint16_t* height);
+
+/**
+ * @brief 获取当前缩放级别
+ * @param handle 浏览器句柄
+ * @return 缩放级别
+ */
+uint8_t PAN_GetZoom(PanViewer_t handle);
+
+/**
+ * @brief 获取错误信息字符串
+ * @param error 错误码
+ * @return 错误信息字符串
+ */
+const char* PAN_GetErrorString(PanError error);
+
+/**
+ * @brief 获取最后发生的错误
+ * @return 最后发生的错误码
+ */
+PanError PAN_GetLastError(void);
+
+#ifdef __cplusplus
+
+class PanZoomViewer {
+private:
+    PanViewer_t handle;
+
+public:
+    PanZoomViewer() : handle(nullptr) {}
+
+    explicit PanZoomViewer(const char* filename) : handle(nullptr) {
+        Open(filename);
+    }
+
+    ~PanZoomViewer() {
+        Close();
+    }
+
+    bool Open(const char* filename) {
+        Close();
+        return PAN_Open(filename, &handle) == PAN_SUCCESS;
+    }
+
+    void Close() {
+        if (handle) {
+            PAN_Close(handle);
+            handle = nullptr;
+        }
+    }
+
+    [[nodiscard]] bool IsOpen() const {
+        return handle != nullptr;
+    }
+
+    bool SetZoom(uint8_t zoom) const {
+        if (!handle) return false;
+        return PAN_SetZoom(handle, zoom) == PAN_SUCCESS;
+    }
+
+    [[nodiscard]] uint8_t GetZoom() const {
+        return handle ? PAN_GetZoom(handle) : 0;
+    }
+
+    bool Move(int32_t dx, int32_t dy) const {
+        if (!handle) return false;
+        return PAN_Move(handle, dx, dy) == PAN_SUCCESS;
+    }
+
+    bool Render() const {
+        if (!handle) return false;
+        return PAN_Render(handle) == PAN_SUCCESS;
+    }
+
+    bool ProcessIdle() const {
+        if (!handle) return false;
+        return PAN_ProcessIdle(handle);
+    }
+
+    void GetImageSize(uint16_t* width, uint16_t* height) const {
+        if (handle) PAN_GetImageSize(handle, width, height);
+    }
+
+    static PanError GetLastError() {
+        return PAN_GetLastError();
+    }
+
+    static const char* GetErrorString() {
+        return PAN_GetErrorString(GetLastError());
+    }
+
+    PanZoomViewer(const PanZoomViewer&) = delete;
+    PanZoomViewer& operator=(const PanZoomViewer&) = delete;
+
+    PanZoomViewer(PanZoomViewer&& other) noexcept : handle(other.handle) {
+        other.handle = nullptr;
+    }
+
+    PanZoomViewer& operator=(PanZoomViewer&& other) noexcept {
+        if (this != &other) {
+            Close();
+            handle = other.handle;
+            other.handle = nullptr;
+        }
+        return *this;
+    }
+};
+
+#endif // __cplusplus
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SD_AND_LCD2_PAN_VIEWER_H
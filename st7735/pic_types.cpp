@@ -6,6 +6,7 @@
 #include "pic_types.h"
 #include "st7735.h"
 #include "fatfs.h"
+#include "png_decoder.h"
 #include <cstring>
 #include <cmath>
 
@@ -22,6 +23,9 @@ typedef struct {
     uint16_t display_height;
     uint8_t scale;
     uint16_t* pixel_data;      // 用于load_jpeg的目标缓冲区
+    uint16_t* stage[2];        // DMA输出的两个MCU暂存缓冲区，一个在队列中发送时填充另一个
+    volatile bool stage_busy[2];
+    uint8_t stage_index;
 } JpegContext;
 
 // 全局变量
@@ -49,9 +53,14 @@ typedef struct __attribute__((packed)) {
 
 // 内部函数声明
 static PicError detect_image_format(const char* filename, PicFormat* format);
+static uint8_t jpeg_exif_rotation(FIL* file);
+static ST7735_Rotation exif_rotate_begin(uint8_t turns);
+static void exif_rotate_end(ST7735_Rotation previous);
+static PicError read_raw_header(FIL* file, PicRawHeader* header);
 static PicError load_raw_565(PicHandle_t handle, FIL* file);
 static PicError load_bmp(PicHandle_t handle, FIL* file);
 static PicError load_jpeg(PicHandle_t handle, FIL* file);
+static PicError load_png(PicHandle_t handle, FIL* file);
 static PicError decode_bmp_data(PicHandle_t handle, FIL* file, uint32_t data_offset, uint32_t row_size, uint16_t bits_per_pixel);
 static PicError display_bmp_streaming(FIL* file, uint32_t data_offset, uint16_t bits_per_pixel,
                                      uint16_t img_width, uint16_t img_height,
@@ -62,9 +71,30 @@ static PicError display_bmp_streaming(FIL* file, uint32_t data_offset, uint16_t
 static size_t jpeg_input_func(JDEC* jd, uint8_t* buf, size_t nbyte);
 static int jpeg_output_func(JDEC* jd, void* bitmap, JRECT* rect);
 static int jpeg_output_func_mem(JDEC* jd, void* bitmap, JRECT* rect);
+static int jpeg_output_func_scaled(JDEC* jd, void* bitmap, JRECT* rect);
 static bool is_bmp_file(const uint8_t* header);
 static uint16_t rgb888_to_565(uint8_t r, uint8_t g, uint8_t b);
 
+// 缩放输出目标
+typedef struct {
+    float scale;                // 大于0时按比例缩放；为0时等比适配到fit_w × fit_h以内（不放大）
+    uint16_t fit_w, fit_h;
+    uint16_t x, y;              // 输出到LCD时的左上角
+    uint16_t* buffer;           // 非空时输出到fit_w × fit_h的缓冲区（居中，其余填黑），否则发送到LCD
+    PicScaleMode mode;
+} PicScaleTarget;
+
+// RAW流式显示
+static PicError display_raw_streaming(FIL* file, uint16_t display_x, uint16_t display_y,
+                                      uint16_t src_x, uint16_t src_y, uint16_t src_w, uint16_t src_h, bool use_dma);
+static PicError decode_raw_scaled(FIL* file, const PicScaleTarget* target);
+
+// PNG解码内部函数
+static PicError png_error_to_pic(PngError error);
+static PicError display_png_streaming(FIL* file, uint16_t display_x, uint16_t display_y,
+                                      uint16_t src_x, uint16_t src_y, uint16_t src_w, uint16_t src_h, bool use_dma);
+static PicError decode_png_scaled(FIL* file, const PicScaleTarget* target);
+
 // 错误信息字符串
 static const char* error_strings[] = {
     "成功",
@@ -137,7 +167,7 @@ PicError PIC_LoadFromSD(const char* filename, PicHandle_t* handle) {
             error = load_jpeg(pic_handle, &file);
             break;
         case PIC_FORMAT_PNG:
-            error = PIC_ERROR_UNSUPPORTED_FORMAT;
+            error = load_png(pic_handle, &file);
             break;
         default:
             error = PIC_ERROR_INVALID_FORMAT;
@@ -257,11 +287,28 @@ PicError PIC_ParseInfo(const char* filename, PicInfo* info) {
             break;
         }
         case PIC_FORMAT_RAW_565: {
-            uint32_t file_size = f_size(&file);
-            uint32_t pixels = file_size / 2;
-            uint16_t sqrt_pixels = (uint16_t)sqrt((double)pixels);
-            info->width = sqrt_pixels;
-            info->height = sqrt_pixels;
+            PicRawHeader header;
+            error = read_raw_header(&file, &header);
+            if (error != PIC_SUCCESS) {
+                f_close(&file);
+                g_last_error = error;
+                return g_last_error;
+            }
+            info->width = header.width;
+            info->height = header.height;
+            info->data_offset = header.data_offset;
+            break;
+        }
+        case PIC_FORMAT_PNG: {
+            PngInfo png_info;
+            PngError png_error = PNG_ReadInfo(&file, &png_info);
+            if (png_error != PNG_SUCCESS) {
+                f_close(&file);
+                g_last_error = png_error_to_pic(png_error);
+                return g_last_error;
+            }
+            info->width = png_info.width;
+            info->height = png_info.height;
             break;
         }
         default:
@@ -293,15 +340,15 @@ PicError PIC_DisplayDMA(PicHandle_t handle, uint16_t x, uint16_t y) {
         return g_last_error;
     }
     
-    if((x >= ST7735_WIDTH) || (y >= ST7735_HEIGHT)) {
+    if((x >= ST7735_GetWidth()) || (y >= ST7735_GetHeight())) {
         g_last_error = PIC_ERROR_INVALID_PARAM;
         return g_last_error;
     }
-    if((x + handle->info.width - 1) >= ST7735_WIDTH) {
+    if((x + handle->info.width - 1) >= ST7735_GetWidth()) {
         g_last_error = PIC_ERROR_INVALID_PARAM;
         return g_last_error;
     }
-    if((y + handle->info.height - 1) >= ST7735_HEIGHT) {
+    if((y + handle->info.height - 1) >= ST7735_GetHeight()) {
         g_last_error = PIC_ERROR_INVALID_PARAM;
         return g_last_error;
     }
@@ -309,8 +356,7 @@ PicError PIC_DisplayDMA(PicHandle_t handle, uint16_t x, uint16_t y) {
     ST7735_Select();
     ST7735_SetAddressWindow(x, y, x + handle->info.width - 1, y + handle->info.height - 1);
     
-    ST7735_DC_HIGH();
-    HAL_SPI_Transmit_DMA(&ST7735_SPI_PORT, (uint8_t*)handle->pixel_data, handle->data_size);
+    ST7735_WritePixelsDMA(handle->pixel_data, handle->data_size / sizeof(uint16_t));
     while (HAL_SPI_GetState(&ST7735_SPI_PORT) != HAL_SPI_STATE_READY);
     while (__HAL_SPI_GET_FLAG(&ST7735_SPI_PORT, SPI_FLAG_BSY));
     
@@ -320,44 +366,299 @@ PicError PIC_DisplayDMA(PicHandle_t handle, uint16_t x, uint16_t y) {
     return PIC_SUCCESS;
 }
 
-PicError PIC_DisplayScaled(PicHandle_t handle, uint16_t x, uint16_t y, float scale) {
-    if (!handle || !handle->is_loaded || !handle->pixel_data || scale <= 0) {
+// 流式缩放器：逐行接收源图像（RGB565），按16.16定点步进输出缩放后的行，
+// 通过DMA发送到LCD或直接写入内存缓冲区
+// 列映射在初始化时计算一次，所有行复用；连续的目标行映射到同一源位置时直接重发上一行
+typedef struct {
+    uint16_t src_w, src_h;
+    uint16_t dst_w, dst_h;
+    PicScaleMode mode;
+    uint32_t step_y;            // 16.16，每个目标行对应的源行步长
+    uint16_t next_row;          // 下一个待输出的目标行
+    uint16_t* x_index;          // 每个目标列对应的源列
+    uint8_t* x_weight;          // 双线性插值的水平权重（0~32）
+    uint16_t* out[2];           // DMA双缓冲
+    uint8_t out_index;
+    bool dma_busy;
+    uint32_t last_key;          // 上一个输出行的源位置，用于行复用
+    bool has_last;
+    uint16_t* prev_src;         // 双线性插值需要的上一源行
+    uint16_t* dest;             // 非空时输出到内存（第一行的位置），不使用DMA
+    uint16_t dest_stride;       // 内存输出的行跨度（像素）
+} PicScaler;
+
+static inline uint32_t scaler_expand(uint16_t p) {
+    return ((uint32_t)p | ((uint32_t)p << 16)) & 0x07E0F81Fu;
+}
+
+static inline uint16_t scaler_pack(uint32_t v) {
+    v &= 0x07E0F81Fu;
+    return (uint16_t)(v | (v >> 16));
+}
+
+// 16.16定点的采样位置：最近邻取像素中心，双线性向左上偏移半个像素
+static inline uint32_t scaler_position(uint32_t index, uint32_t step, PicScaleMode mode) {
+    uint32_t pos = index * step + step / 2;
+    if (mode == PIC_SCALE_BILINEAR) pos = pos > 0x8000 ? pos - 0x8000 : 0;
+    return pos;
+}
+
+static void scaler_free(PicScaler* s) {
+    free(s->x_index);
+    free(s->x_weight);
+    free(s->out[0]);
+    free(s->out[1]);
+    free(s->prev_src);
+    memset(s, 0, sizeof(PicScaler));
+}
+
+static PicError scaler_init(PicScaler* s, uint16_t src_w, uint16_t src_h, uint16_t dst_w, uint16_t dst_h,
+                            PicScaleMode mode, bool to_lcd) {
+    memset(s, 0, sizeof(PicScaler));
+    if (src_w == 0 || src_h == 0 || dst_w == 0 || dst_h == 0) return PIC_ERROR_INVALID_PARAM;
+
+    s->src_w = src_w;
+    s->src_h = src_h;
+    s->dst_w = dst_w;
+    s->dst_h = dst_h;
+    s->mode = mode;
+    s->step_y = ((uint32_t)src_h << 16) / dst_h;
+
+    s->x_index = (uint16_t*)malloc(dst_w * sizeof(uint16_t));
+    if (to_lcd) {
+        s->out[0] = (uint16_t*)malloc(dst_w * sizeof(uint16_t));
+        s->out[1] = (uint16_t*)malloc(dst_w * sizeof(uint16_t));
+    }
+    if (mode == PIC_SCALE_BILINEAR) {
+        s->x_weight = (uint8_t*)malloc(dst_w);
+        s->prev_src = (uint16_t*)malloc(src_w * sizeof(uint16_t));
+    }
+    if (!s->x_index || (to_lcd && (!s->out[0] || !s->out[1])) ||
+        (mode == PIC_SCALE_BILINEAR && (!s->x_weight || !s->prev_src))) {
+        scaler_free(s);
+        return PIC_ERROR_MEMORY_ALLOC;
+    }
+
+    uint32_t step_x = ((uint32_t)src_w << 16) / dst_w;
+    for (uint16_t dx = 0; dx < dst_w; dx++) {
+        uint32_t pos = scaler_position(dx, step_x, mode);
+        uint16_t sx = pos >> 16;
+        uint8_t weight = (uint8_t)(((pos & 0xFFFF) + 0x400) >> 11);
+        if (weight == 32) {
+            sx++;
+            weight = 0;
+        }
+        if (sx >= src_w - 1) {
+            sx = src_w - 1;
+            weight = 0;
+        }
+        s->x_index[dx] = sx;
+        if (s->x_weight) s->x_weight[dx] = weight;
+    }
+
+    return PIC_SUCCESS;
+}
+
+static void scaler_wait_dma(PicScaler* s) {
+    if (s->dma_busy) {
+        while (HAL_SPI_GetState(&ST7735_SPI_PORT) != HAL_SPI_STATE_READY);
+        while (__HAL_SPI_GET_FLAG(&ST7735_SPI_PORT, SPI_FLAG_BSY));
+        s->dma_busy = false;
+    }
+}
+
+static void scaler_send(PicScaler* s, uint16_t* row) {
+    scaler_wait_dma(s);
+    ST7735_WritePixelsDMA(row, s->dst_w);
+    s->dma_busy = true;
+}
+
+static void scaler_horizontal(const PicScaler* s, const uint16_t* src, uint16_t* dst) {
+    for (uint16_t dx = 0; dx < s->dst_w; dx++) {
+        dst[dx] = src[s->x_index[dx]];
+    }
+}
+
+static void scaler_bilinear(const PicScaler* s, const uint16_t* top, const uint16_t* bottom, uint32_t wy,
+                            uint16_t* dst) {
+    if (wy == 0) {
+        for (uint16_t dx = 0; dx < s->dst_w; dx++) {
+            uint16_t sx = s->x_index[dx];
+            uint32_t wx = s->x_weight[dx];
+            dst[dx] = wx ? scaler_pack((scaler_expand(top[sx]) * (32 - wx) + scaler_expand(top[sx + 1]) * wx) >> 5)
+                         : top[sx];
+        }
+        return;
+    }
+
+    for (uint16_t dx = 0; dx < s->dst_w; dx++) {
+        uint16_t sx = s->x_index[dx];
+        uint32_t wx = s->x_weight[dx];
+        uint16_t sx1 = wx ? sx + 1 : sx;
+        uint32_t t = (scaler_expand(top[sx]) * (32 - wx) + scaler_expand(top[sx1]) * wx) >> 5;
+        uint32_t b = (scaler_expand(bottom[sx]) * (32 - wx) + scaler_expand(bottom[sx1]) * wx) >> 5;
+        t &= 0x07E0F81Fu;
+        b &= 0x07E0F81Fu;
+        dst[dx] = scaler_pack((t * (32 - wy) + b * wy) >> 5);
+    }
+}
+
+// 最近邻缩小时大部分源行不会被采样，调用者可以跳过这些行的转换
+static bool scaler_needs_row(const PicScaler* s, uint16_t sy) {
+    if (s->mode == PIC_SCALE_BILINEAR) return true;
+    if (s->next_row >= s->dst_h) return false;
+    uint32_t sy0 = scaler_position(s->next_row, s->step_y, s->mode) >> 16;
+    return sy0 == sy || (sy0 >= s->src_h && sy == s->src_h - 1);
+}
+
+// 输入第sy行源数据（必须从0开始按顺序输入每一行），输出所有只依赖已输入行的目标行
+static void scaler_push_row(PicScaler* s, const uint16_t* row, uint16_t sy) {
+    while (s->next_row < s->dst_h) {
+        uint32_t pos = scaler_position(s->next_row, s->step_y, s->mode);
+        uint32_t sy0 = pos >> 16;
+        if (sy0 >= s->src_h) sy0 = s->src_h - 1;
+        uint32_t wy = 0;
+
+        if (s->mode == PIC_SCALE_BILINEAR) {
+            wy = ((pos & 0xFFFF) + 0x400) >> 11;
+            if (wy == 32) {
+                sy0++;
+                wy = 0;
+            }
+            if (sy0 + 1 >= s->src_h) {
+                sy0 = s->src_h - 1;
+                wy = 0;
+            }
+        }
+        if (sy0 + (wy ? 1 : 0) > sy) break;
+        uint32_t key = ((uint32_t)sy0 << 6) | wy;
+
+        if (s->has_last && key == s->last_key) {
+            // 与上一行采样位置相同，直接重发
+            if (s->dest) {
+                uint16_t* dst = s->dest + (uint32_t)s->next_row * s->dest_stride;
+                memcpy(dst, dst - s->dest_stride, s->dst_w * sizeof(uint16_t));
+            }
+            else {
+                scaler_send(s, s->out[s->out_index ^ 1]);
+            }
+        }
+        else {
+            uint16_t* dst = s->dest ? s->dest + (uint32_t)s->next_row * s->dest_stride : s->out[s->out_index];
+            if (s->mode == PIC_SCALE_BILINEAR) {
+                // wy不为0时sy0 == sy - 1，上一源行保存在prev_src中
+                scaler_bilinear(s, wy ? s->prev_src : row, row, wy, dst);
+            }
+            else {
+                scaler_horizontal(s, row, dst);
+            }
+            if (!s->dest) {
+                scaler_send(s, dst);
+                s->out_index ^= 1;
+            }
+            s->last_key = key;
+            s->has_last = true;
+        }
+        s->next_row++;
+    }
+
+    if (s->prev_src) {
+        memcpy(s->prev_src, row, s->src_w * sizeof(uint16_t));
+    }
+}
+
+static PicError scaler_compute_size(const PicScaleTarget* target, uint16_t src_w, uint16_t src_h,
+                                    uint16_t* dst_w, uint16_t* dst_h) {
+    if (target->scale > 0) {
+        *dst_w = (uint16_t)(src_w * target->scale);
+        *dst_h = (uint16_t)(src_h * target->scale);
+    }
+    else {
+        if (target->fit_w == 0 || target->fit_h == 0) return PIC_ERROR_INVALID_PARAM;
+        if ((uint32_t)src_w * target->fit_h > (uint32_t)src_h * target->fit_w) {
+            *dst_w = src_w < target->fit_w ? src_w : target->fit_w;
+            *dst_h = (uint16_t)((uint32_t)src_h * *dst_w / src_w);
+        }
+        else {
+            *dst_h = src_h < target->fit_h ? src_h : target->fit_h;
+            *dst_w = (uint16_t)((uint32_t)src_w * *dst_h / src_h);
+        }
+    }
+
+    if (*dst_w == 0 || *dst_h == 0) return PIC_ERROR_INVALID_PARAM;
+    if (target->buffer) {
+        if (*dst_w > target->fit_w || *dst_h > target->fit_h) return PIC_ERROR_INVALID_PARAM;
+    }
+    else if (target->x + *dst_w > ST7735_GetWidth() || target->y + *dst_h > ST7735_GetHeight()) {
+        return PIC_ERROR_INVALID_PARAM;
+    }
+
+    return PIC_SUCCESS;
+}
+
+// 初始化缩放器并准备输出：LCD目标设置显示窗口，内存目标清空缓冲区并计算居中位置
+static PicError scaler_begin(PicScaler* s, const PicScaleTarget* target, uint16_t src_w, uint16_t src_h,
+                             uint16_t dst_w, uint16_t dst_h) {
+    PicError error = scaler_init(s, src_w, src_h, dst_w, dst_h, target->mode, target->buffer == nullptr);
+    if (error != PIC_SUCCESS) return error;
+
+    if (target->buffer) {
+        memset(target->buffer, 0, (uint32_t)target->fit_w * target->fit_h * sizeof(uint16_t));
+        s->dest = target->buffer + (uint32_t)((target->fit_h - dst_h) / 2) * target->fit_w + (target->fit_w - dst_w) / 2;
+        s->dest_stride = target->fit_w;
+    }
+    else {
+        ST7735_Select();
+        ST7735_SetAddressWindow(target->x, target->y, target->x + dst_w - 1, target->y + dst_h - 1);
+    }
+    return PIC_SUCCESS;
+}
+
+static void scaler_end(PicScaler* s) {
+    if (!s->dest) {
+        scaler_wait_dma(s);
+        ST7735_Unselect();
+    }
+    scaler_free(s);
+}
+
+PicError PIC_DisplayScaled(PicHandle_t handle, uint16_t x, uint16_t y, float scale, PicScaleMode mode) {
+    if (!handle || !handle->is_loaded || !handle->pixel_data) {
         g_last_error = PIC_ERROR_INVALID_PARAM;
         return g_last_error;
     }
-    
-    // 简化实现：只支持整数缩放
-    uint16_t scaled_width = (uint16_t)(handle->info.width * scale);
-    uint16_t scaled_height = (uint16_t)(handle->info.height * scale);
-    
-    if (scaled_width == 0 || scaled_height == 0) {
+
+    if (scale <= 0) {
         g_last_error = PIC_ERROR_INVALID_PARAM;
         return g_last_error;
     }
-    
-    // 简单的最近邻缩放算法
-    uint16_t* scaled_data = (uint16_t*)malloc(scaled_width * scaled_height * sizeof(uint16_t));
-    if (!scaled_data) {
-        g_last_error = PIC_ERROR_MEMORY_ALLOC;
-        return g_last_error;
+
+    PicScaleTarget target;
+    memset(&target, 0, sizeof(target));
+    target.scale = scale;
+    target.x = x;
+    target.y = y;
+    target.mode = mode;
+
+    uint16_t src_w = handle->info.width;
+    uint16_t src_h = handle->info.height;
+    uint16_t dst_w, dst_h;
+    PicScaler scaler;
+    PicError error = scaler_compute_size(&target, src_w, src_h, &dst_w, &dst_h);
+    if (error == PIC_SUCCESS) error = scaler_begin(&scaler, &target, src_w, src_h, dst_w, dst_h);
+    if (error != PIC_SUCCESS) {
+        g_last_error = error;
+        return error;
     }
-    
-    for (uint16_t sy = 0; sy < scaled_height; sy++) {
-        for (uint16_t sx = 0; sx < scaled_width; sx++) {
-            uint16_t src_x = (uint16_t)(sx / scale);
-            uint16_t src_y = (uint16_t)(sy / scale);
-            
-            if (src_x < handle->info.width && src_y < handle->info.height) {
-                scaled_data[sy * scaled_width + sx] = 
-                    handle->pixel_data[src_y * handle->info.width + src_x];
-            }
+
+    for (uint16_t sy = 0; sy < src_h; sy++) {
+        if (scaler_needs_row(&scaler, sy)) {
+            scaler_push_row(&scaler, handle->pixel_data + (uint32_t)sy * src_w, sy);
         }
     }
-    
-    // 显示缩放后的图片
-    ST7735_DrawImage(x, y, scaled_width, scaled_height, scaled_data);
-    
-    free(scaled_data);
+
+    scaler_end(&scaler);
+
     g_last_error = PIC_SUCCESS;
     return PIC_SUCCESS;
 }
@@ -413,6 +714,19 @@ PicError PIC_DisplayRawData(const uint16_t* data, uint16_t width, uint16_t heigh
     return PIC_SUCCESS;
 }
 
+uint8_t PIC_GetExifRotation(const char* filename) {
+    PicFormat format;
+    if (!filename || detect_image_format(filename, &format) != PIC_SUCCESS || format != PIC_FORMAT_JPEG) {
+        return 0;
+    }
+
+    FIL file;
+    if (f_open(&file, filename, FA_READ) != FR_OK) return 0;
+    uint8_t turns = jpeg_exif_rotation(&file);
+    f_close(&file);
+    return turns;
+}
+
 bool PIC_IsSupportedFormat(const char* filename) {
     if (!filename) return false;
     
@@ -433,6 +747,76 @@ PicError PIC_GetLastError(void) {
 
 // 内部函数实现
 
+static inline uint16_t exif_u16(const uint8_t* p, bool little_endian) {
+    return little_endian ? (uint16_t)(p[0] | (p[1] << 8)) : (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static inline uint32_t exif_u32(const uint8_t* p, bool little_endian) {
+    return little_endian ? ((uint32_t)exif_u16(p + 2, true) << 16) | exif_u16(p, true)
+                         : ((uint32_t)exif_u16(p, false) << 16) | exif_u16(p + 2, false);
+}
+
+// 从文件开头查找APP1中的EXIF方向标签（IFD0的0x0112），只读取必要的几十个字节
+// 遇到APPn以外的段就停止，调用者需要自行把文件指针移回开头
+static uint8_t jpeg_exif_rotation(FIL* file) {
+    // EXIF方向值1~8对应的顺时针旋转次数，镜像方向只取旋转部分
+    static const uint8_t orientation_turns[9] = { 0, 0, 0, 2, 2, 3, 1, 1, 3 };
+
+    uint8_t buf[16];
+    UINT bytes_read;
+    if (f_lseek(file, 0) != FR_OK || f_read(file, buf, 2, &bytes_read) != FR_OK || bytes_read != 2 ||
+        buf[0] != 0xFF || buf[1] != 0xD8) {
+        return 0;
+    }
+
+    for (;;) {
+        FSIZE_t segment = f_tell(file);
+        if (f_read(file, buf, 4, &bytes_read) != FR_OK || bytes_read != 4 || buf[0] != 0xFF) return 0;
+        if (buf[1] < 0xE0 || buf[1] > 0xEF) return 0;
+        uint16_t length = (uint16_t)((buf[2] << 8) | buf[3]);
+        FSIZE_t next = segment + 2 + length;
+
+        if (buf[1] == 0xE1 && length >= 2 + 6 + 8) {
+            // "Exif\0\0"后面是TIFF头：字节序、0x002A、IFD0偏移（相对TIFF头）
+            if (f_read(file, buf, 6 + 8, &bytes_read) != FR_OK || bytes_read != 6 + 8) return 0;
+            if (memcmp(buf, "Exif\0\0", 6) == 0) {
+                FSIZE_t tiff = segment + 4 + 6;
+                bool le = buf[6] == 'I';
+                if (exif_u16(buf + 8, le) != 0x002A) return 0;
+                FSIZE_t ifd = tiff + exif_u32(buf + 10, le);
+                if (ifd + 2 > next || f_lseek(file, ifd) != FR_OK ||
+                    f_read(file, buf, 2, &bytes_read) != FR_OK || bytes_read != 2) {
+                    return 0;
+                }
+                uint16_t entries = exif_u16(buf, le);
+                for (uint16_t i = 0; i < entries && f_tell(file) + 12 <= next; i++) {
+                    if (f_read(file, buf, 12, &bytes_read) != FR_OK || bytes_read != 12) return 0;
+                    if (exif_u16(buf, le) == 0x0112) {
+                        // SHORT类型的值直接存放在值字段的前两个字节
+                        uint16_t orientation = exif_u16(buf + 8, le);
+                        return orientation <= 8 ? orientation_turns[orientation] : 0;
+                    }
+                }
+                return 0;
+            }
+        }
+
+        if (f_lseek(file, next) != FR_OK) return 0;
+    }
+}
+
+// 在当前方向的基础上再旋转turns个90度，返回原方向
+static ST7735_Rotation exif_rotate_begin(uint8_t turns) {
+    ST7735_Rotation previous = ST7735_GetRotation();
+    if (turns) ST7735_SetRotation((ST7735_Rotation)((previous + turns) & 3));
+    return previous;
+}
+
+// 恢复原方向；已写入GRAM的内容保持旋转后的样子
+static void exif_rotate_end(ST7735_Rotation previous) {
+    if (ST7735_GetRotation() != previous) ST7735_SetRotation(previous);
+}
+
 static PicError detect_image_format(const char* filename, PicFormat* format) {
     if (!filename || !format) {
         return PIC_ERROR_INVALID_PARAM;
@@ -459,46 +843,74 @@ static PicError detect_image_format(const char* filename, PicFormat* format) {
     return PIC_SUCCESS;
 }
 
-static PicError load_raw_565(PicHandle_t handle, FIL* file) {
-    // 对于RAW格式，假设文件大小就是图片数据大小
+// 读取RAW文件头；没有文件头的旧格式文件按文件大小推断尺寸，视为高字节在前、从偏移0开始
+static PicError read_raw_header(FIL* file, PicRawHeader* header) {
     uint32_t file_size = f_size(file);
-    
-    // 计算图片尺寸（假设是正方形或根据文件大小推断）
+    UINT bytes_read;
+    FRESULT res = f_lseek(file, 0);
+    if (res == FR_OK) res = f_read(file, header, sizeof(PicRawHeader), &bytes_read);
+    if (res != FR_OK) return PIC_ERROR_FILE_READ;
+
+    if (bytes_read == sizeof(PicRawHeader) && header->magic == PIC_RAW_MAGIC) {
+        if (header->version != PIC_RAW_VERSION || header->width == 0 || header->height == 0 ||
+            header->byte_order > PIC_RAW_LITTLE_ENDIAN || header->data_offset < sizeof(PicRawHeader) ||
+            header->data_offset + (uint32_t)header->width * header->height * sizeof(uint16_t) > file_size) {
+            return PIC_ERROR_INVALID_FORMAT;
+        }
+        return PIC_SUCCESS;
+    }
+
     uint32_t pixel_count = file_size / sizeof(uint16_t);
-    uint16_t width = 1;
-    uint16_t height = 1;
-    
-    // 尝试推断合理的尺寸
+    memset(header, 0, sizeof(PicRawHeader));
+    header->magic = PIC_RAW_MAGIC;
+    header->version = PIC_RAW_VERSION;
+    header->byte_order = PIC_RAW_BIG_ENDIAN;
+    header->width = 1;
+    header->height = 1;
     for (uint16_t w = 1; w <= 320; w++) {
-        if (pixel_count % w == 0) {
-            uint16_t h = pixel_count / w;
-            if (h <= 240) {  // 假设最大高度为240
-                width = w;
-                height = h;
-                break;
-            }
+        if (pixel_count % w == 0 && pixel_count / w <= 240) {
+            header->width = w;
+            header->height = pixel_count / w;
+            break;
         }
     }
-    
-    handle->info.width = width;
-    handle->info.height = height;
-    handle->data_size = file_size;
-    
-    // 分配内存
-    handle->pixel_data = (uint16_t*)malloc(file_size);
+    return pixel_count ? PIC_SUCCESS : PIC_ERROR_INVALID_FORMAT;
+}
+
+static inline void swap_pixel_bytes(uint16_t* pixels, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        pixels[i] = (pixels[i] >> 8) | (pixels[i] << 8);
+    }
+}
+
+static PicError load_raw_565(PicHandle_t handle, FIL* file) {
+    PicRawHeader header;
+    PicError error = read_raw_header(file, &header);
+    if (error != PIC_SUCCESS) return error;
+
+    handle->info.width = header.width;
+    handle->info.height = header.height;
+    handle->info.data_offset = header.data_offset;
+    handle->data_size = (uint32_t)header.width * header.height * sizeof(uint16_t);
+
+    handle->pixel_data = (uint16_t*)malloc(handle->data_size);
     if (!handle->pixel_data) {
         return PIC_ERROR_MEMORY_ALLOC;
     }
-    
-    // 读取数据
+
     UINT bytes_read;
-    FRESULT res = f_read(file, handle->pixel_data, file_size, &bytes_read);
-    if (res != FR_OK || bytes_read != file_size) {
+    FRESULT res = f_lseek(file, header.data_offset);
+    if (res == FR_OK) res = f_read(file, handle->pixel_data, handle->data_size, &bytes_read);
+    if (res != FR_OK || bytes_read != handle->data_size) {
         free(handle->pixel_data);
         handle->pixel_data = nullptr;
         return PIC_ERROR_FILE_READ;
     }
-    
+
+    if (header.byte_order == PIC_RAW_BIG_ENDIAN) {
+        swap_pixel_bytes(handle->pixel_data, (uint32_t)header.width * header.height);
+    }
+
     return PIC_SUCCESS;
 }
 
@@ -534,6 +946,99 @@ static PicError load_bmp(PicHandle_t handle, FIL* file) {
     return error;
 }
 
+// BMP块读取器：一次读取多行、按扇区对齐的数据，在内存中倒序遍历自下而上存储的行
+typedef struct {
+    FIL* file;
+    uint32_t data_offset;
+    uint32_t row_size;
+    uint16_t rows_per_block;
+    uint8_t* buffer;            // 容量为 rows_per_block * row_size + 2 * PIC_SECTOR_SIZE
+    uint32_t buffer_offset;     // buffer[0]对应的文件偏移
+} BmpBlockReader;
+
+static PicError bmp_block_reader_init(BmpBlockReader* reader, FIL* file, uint32_t data_offset, uint32_t row_size,
+                                      uint16_t max_rows) {
+    uint32_t rows = PIC_BMP_BLOCK_SIZE / row_size;
+    if (rows == 0) rows = 1;
+    if (rows > max_rows) rows = max_rows;
+
+    reader->file = file;
+    reader->data_offset = data_offset;
+    reader->row_size = row_size;
+    reader->rows_per_block = (uint16_t)rows;
+    reader->buffer_offset = 0;
+    reader->buffer = (uint8_t*)malloc(rows * row_size + 2 * PIC_SECTOR_SIZE);
+    return reader->buffer ? PIC_SUCCESS : PIC_ERROR_MEMORY_ALLOC;
+}
+
+static void bmp_block_reader_free(BmpBlockReader* reader) {
+    free(reader->buffer);
+    reader->buffer = nullptr;
+}
+
+// 读取文件中[first_row, first_row + row_count)行，读取范围向外扩展到扇区边界，
+// 使FatFs可以绕过FIL内部缓冲直接多扇区读取
+static PicError bmp_block_read(BmpBlockReader* reader, uint16_t first_row, uint16_t row_count) {
+    uint32_t start = reader->data_offset + (uint32_t)first_row * reader->row_size;
+    uint32_t end = start + (uint32_t)row_count * reader->row_size;
+    uint32_t aligned_start = start & ~(uint32_t)(PIC_SECTOR_SIZE - 1);
+    uint32_t aligned_end = (end + PIC_SECTOR_SIZE - 1) & ~(uint32_t)(PIC_SECTOR_SIZE - 1);
+    if (aligned_end > f_size(reader->file)) aligned_end = f_size(reader->file);
+    if (aligned_end < end) return PIC_ERROR_FILE_READ;
+
+    UINT bytes_read;
+    FRESULT res = f_lseek(reader->file, aligned_start);
+    if (res == FR_OK) res = f_read(reader->file, reader->buffer, aligned_end - aligned_start, &bytes_read);
+    if (res != FR_OK || bytes_read < end - aligned_start) return PIC_ERROR_FILE_READ;
+
+    reader->buffer_offset = aligned_start;
+    return PIC_SUCCESS;
+}
+
+static inline const uint8_t* bmp_block_row(const BmpBlockReader* reader, uint16_t row) {
+    return reader->buffer + (reader->data_offset + (uint32_t)row * reader->row_size - reader->buffer_offset);
+}
+
+static inline uint32_t load_u32(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// 两个RGB565像素打包成一个字写入
+static inline void store_pixel_pair(uint16_t* dst, uint32_t p0, uint32_t p1) {
+    uint32_t pair = p0 | (p1 << 16);
+    memcpy(dst, &pair, sizeof(pair));
+}
+
+// 将一行BGR（24位）或BGRA（32位）像素转换为RGB565，按字读取
+static void bmp_convert_row(const uint8_t* src, uint16_t* dst, uint16_t count, uint8_t bytes_per_pixel) {
+    uint16_t i = 0;
+    if (bytes_per_pixel == 3) {
+        // 每次处理4个像素（3个字）
+        for (; i + 4 <= count; i += 4, src += 12, dst += 4) {
+            uint32_t w0 = load_u32(src), w1 = load_u32(src + 4), w2 = load_u32(src + 8);
+            uint32_t p0 = ((w0 >> 8) & 0xF800) | ((w0 >> 5) & 0x07E0) | ((w0 >> 3) & 0x001F);
+            uint32_t p1 = (w1 & 0xF800) | ((w1 << 3) & 0x07E0) | (w0 >> 27);
+            uint32_t p2 = ((w2 << 8) & 0xF800) | ((w1 >> 21) & 0x07E0) | ((w1 >> 19) & 0x001F);
+            uint32_t p3 = ((w2 >> 16) & 0xF800) | ((w2 >> 13) & 0x07E0) | ((w2 >> 11) & 0x001F);
+            store_pixel_pair(dst, p0, p1);
+            store_pixel_pair(dst + 2, p2, p3);
+        }
+    }
+    else {
+        for (; i + 2 <= count; i += 2, src += 8, dst += 2) {
+            uint32_t w0 = load_u32(src), w1 = load_u32(src + 4);
+            uint32_t p0 = ((w0 >> 8) & 0xF800) | ((w0 >> 5) & 0x07E0) | ((w0 >> 3) & 0x001F);
+            uint32_t p1 = ((w1 >> 8) & 0xF800) | ((w1 >> 5) & 0x07E0) | ((w1 >> 3) & 0x001F);
+            store_pixel_pair(dst, p0, p1);
+        }
+    }
+    for (; i < count; i++, src += bytes_per_pixel) {
+        *dst++ = rgb888_to_565(src[2], src[1], src[0]);
+    }
+}
+
 static PicError decode_bmp_data(PicHandle_t handle, FIL* file, uint32_t data_offset, uint32_t row_size, uint16_t bits_per_pixel) {
     if (!file || row_size == 0) {
         return PIC_ERROR_INVALID_PARAM;
@@ -549,56 +1054,34 @@ static PicError decode_bmp_data(PicHandle_t handle, FIL* file, uint32_t data_off
     // 每个像素的字节数
     uint8_t bytes_per_pixel = bits_per_pixel / 8;
     
-    // 分配行缓冲区（只存储一行BMP数据）
-    uint8_t* row_buffer = (uint8_t*)malloc(row_size);
-    if (!row_buffer) {
+    BmpBlockReader reader;
+    if (bmp_block_reader_init(&reader, file, data_offset, row_size, handle->info.height) != PIC_SUCCESS) {
         free(handle->pixel_data);
         handle->pixel_data = nullptr;
         return PIC_ERROR_MEMORY_ALLOC;
     }
     
-    FRESULT res;
-    UINT bytes_read;
-    
-    // 逐行读取并转换
-    for (uint16_t y = 0; y < handle->info.height; y++) {
-        // BMP数据从下到上存储
-        uint16_t src_y = handle->info.height - 1 - y;
-        
-        // 定位到源行
-        res = f_lseek(file, data_offset + src_y * row_size);
-        if (res != FR_OK) {
-            free(row_buffer);
-            free(handle->pixel_data);
-            handle->pixel_data = nullptr;
-            return PIC_ERROR_FILE_READ;
-        }
+    // 按块读取，BMP数据从下到上存储，块内倒序转换
+    for (uint16_t y = 0; y < handle->info.height; y += reader.rows_per_block) {
+        uint16_t rows = handle->info.height - y;
+        if (rows > reader.rows_per_block) rows = reader.rows_per_block;
+        uint16_t first_row = handle->info.height - y - rows;
         
-        // 读取一行BMP数据
-        res = f_read(file, row_buffer, row_size, &bytes_read);
-        if (res != FR_OK || bytes_read != row_size) {
-            free(row_buffer);
+        if (bmp_block_read(&reader, first_row, rows) != PIC_SUCCESS) {
+            bmp_block_reader_free(&reader);
             free(handle->pixel_data);
             handle->pixel_data = nullptr;
             return PIC_ERROR_FILE_READ;
         }
         
-        // 转换该行的每个像素
-        for (uint16_t x = 0; x < handle->info.width; x++) {
-            const uint8_t* pixel = row_buffer + x * bytes_per_pixel;
-            
-            // BMP存储顺序是BGR（24位）或BGRA（32位）
-            uint8_t b = pixel[0];
-            uint8_t g = pixel[1];
-            uint8_t r = pixel[2];
-            
-            // 转换为RGB565
-            handle->pixel_data[y * handle->info.width + x] = rgb888_to_565(r, g, b);
+        for (uint16_t i = 0; i < rows; i++) {
+            bmp_convert_row(bmp_block_row(&reader, first_row + rows - 1 - i),
+                            handle->pixel_data + (uint32_t)(y + i) * handle->info.width,
+                            handle->info.width, bytes_per_pixel);
         }
     }
     
-    // 释放行缓冲区
-    free(row_buffer);
+    bmp_block_reader_free(&reader);
     
     return PIC_SUCCESS;
 }
@@ -668,21 +1151,14 @@ static int jpeg_output_func_mem(JDEC* jd, void* bitmap, JRECT* rect) {
     
     for (uint16_t y = 0; y < h; y++) {
         uint16_t dst_y = rect->top + y;
-        for (uint16_t x = 0; x < w; x++) {
-            uint16_t dst_x = rect->left + x;
-            uint16_t dst_idx = dst_y * ctx->display_width + dst_x;
-            uint16_t pixel = src[y * w + x];
-            ctx->pixel_data[dst_idx] = ((pixel & 0xFF00) >> 8) | ((pixel & 0xFF) << 8);
-        }
+        memcpy(ctx->pixel_data + dst_y * ctx->display_width + rect->left, src + y * w, w * sizeof(uint16_t));
     }
     
     return 1;
 }
 
 static uint16_t rgb888_to_565(uint8_t r, uint8_t g, uint8_t b) {
-    uint16_t color565 = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
-    color565 = ((color565 & 0xFF00) >> 8) | ((color565 & 0xFF) << 8);
-    return color565;
+    return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
 }
 
 PicError PIC_DisplayStreaming(const char* filename, uint16_t x, uint16_t y,
@@ -788,6 +1264,9 @@ PicError PIC_DisplayStreaming(const char* filename, uint16_t x, uint16_t y,
             ctx.display_y = y;
             ctx.scale = scale;
             
+            uint8_t turns = jpeg_exif_rotation(&file);
+            f_lseek(&file, 0);
+            
             // 准备JPEG解码
             JRESULT jres = jd_prepare(&jdec, jpeg_input_func, workbuf, PIC_TJPGDEC_WORKSPACE, &ctx);
             if (jres != JDR_OK) {
@@ -803,8 +1282,12 @@ PicError PIC_DisplayStreaming(const char* filename, uint16_t x, uint16_t y,
             ctx.display_width = (jdec.width + scale_factor - 1) / scale_factor;
             ctx.display_height = (jdec.height + scale_factor - 1) / scale_factor;
             
+            // EXIF方向通过改写LCD扫描方向实现，解码输出仍按原始行序写入
+            ST7735_Rotation previous = exif_rotate_begin(turns);
+            
             // 检查是否超出LCD范围
-            if (x + ctx.display_width > ST7735_WIDTH || y + ctx.display_height > ST7735_HEIGHT) {
+            if (x + ctx.display_width > ST7735_GetWidth() || y + ctx.display_height > ST7735_GetHeight()) {
+                exif_rotate_end(previous);
                 free(workbuf);
                 f_close(&file);
                 g_last_error = PIC_ERROR_INVALID_PARAM;
@@ -813,6 +1296,7 @@ PicError PIC_DisplayStreaming(const char* filename, uint16_t x, uint16_t y,
             
             // 解码JPEG并显示
             jres = jd_decomp(&jdec, jpeg_output_func, scale);
+            exif_rotate_end(previous);
             
             free(workbuf);
             
@@ -825,7 +1309,12 @@ PicError PIC_DisplayStreaming(const char* filename, uint16_t x, uint16_t y,
             break;
         }
         case PIC_FORMAT_RAW_565:
+            error = display_raw_streaming(&file, x, y, src_x, src_y, src_w, src_h, false);
+            break;
         case PIC_FORMAT_PNG:
+            // PNG不支持TJpgDec式的缩放参数，src_*按BMP的区域语义处理
+            error = display_png_streaming(&file, x, y, src_x, src_y, src_w, src_h, false);
+            break;
         default:
             f_close(&file);
             g_last_error = PIC_ERROR_UNSUPPORTED_FORMAT;
@@ -851,80 +1340,70 @@ static PicError display_bmp_streaming(FIL* file, uint32_t data_offset, uint16_t
     // 每个像素的字节数
     uint8_t bytes_per_pixel = bits_per_pixel / 8;
     
-    // 分配BMP行缓冲区
-    uint8_t* bmp_row_buffer = (uint8_t*)malloc(row_size);
-    if (!bmp_row_buffer) {
+    // 每块的行数同时受单次SPI传输长度（65535字节）限制
+    uint16_t max_rows = 65535 / (src_w * sizeof(uint16_t));
+    if (max_rows > src_h) max_rows = src_h;
+    
+    BmpBlockReader reader;
+    if (bmp_block_reader_init(&reader, file, data_offset, row_size, max_rows) != PIC_SUCCESS) {
         return PIC_ERROR_MEMORY_ALLOC;
     }
     
-    // 分配RGB565显示缓冲区（只分配要显示的宽度）
-    uint16_t* display_buffer = (uint16_t*)malloc(src_w * sizeof(uint16_t));
+    // 分配RGB565显示缓冲区（一块的行数 × 要显示的宽度）
+    uint16_t* display_buffer = (uint16_t*)malloc(reader.rows_per_block * src_w * sizeof(uint16_t));
     if (!display_buffer) {
-        free(bmp_row_buffer);
+        bmp_block_reader_free(&reader);
         return PIC_ERROR_MEMORY_ALLOC;
     }
     
-    FRESULT res;
-    UINT bytes_read;
-    
     // 设置LCD显示窗口
     ST7735_Select();
     ST7735_SetAddressWindow(display_x, display_y, display_x + src_w - 1, display_y + src_h - 1);
-    ST7735_DC_HIGH();
     
-    // 逐行读取并显示
-    for (uint16_t dy = 0; dy < src_h; dy++) {
-        // BMP数据从下到上存储
-        uint16_t src_y_abs = src_y + (src_h - 1 - dy);
-        
-        // 定位到源行
-        res = f_lseek(file, data_offset + src_y_abs * row_size);
-        if (res != FR_OK) {
-            free(bmp_row_buffer);
-            free(display_buffer);
-            return PIC_ERROR_FILE_READ;
-        }
+    // 逐块读取并显示
+    for (uint16_t dy = 0; dy < src_h; dy += reader.rows_per_block) {
+        uint16_t rows = src_h - dy;
+        if (rows > reader.rows_per_block) rows = reader.rows_per_block;
+        // BMP数据从下到上存储，显示的第dy行对应文件中的第src_y + src_h - 1 - dy行
+        uint16_t first_row = src_y + src_h - dy - rows;
         
-        // 读取一行BMP数据
-        res = f_read(file, bmp_row_buffer, row_size, &bytes_read);
-        if (res != FR_OK || bytes_read != row_size) {
-            free(bmp_row_buffer);
+        if (bmp_block_read(&reader, first_row, rows) != PIC_SUCCESS) {
+            bmp_block_reader_free(&reader);
             free(display_buffer);
+            ST7735_Unselect();
             return PIC_ERROR_FILE_READ;
         }
         
-        // 转换要显示的区域
-        for (uint16_t dx = 0; dx < src_w; dx++) {
-            uint16_t src_x_abs = src_x + dx;
-            const uint8_t* pixel = bmp_row_buffer + src_x_abs * bytes_per_pixel;
-            
-            // BMP存储顺序是BGR（24位）或BGRA（32位）
-            uint8_t b = pixel[0];
-            uint8_t g = pixel[1];
-            uint8_t r = pixel[2];
-            
-            // 转换为RGB565
-            display_buffer[dx] = rgb888_to_565(r, g, b);
+        // 块内倒序转换要显示的区域
+        for (uint16_t i = 0; i < rows; i++) {
+            bmp_convert_row(bmp_block_row(&reader, first_row + rows - 1 - i) + src_x * bytes_per_pixel,
+                            display_buffer + i * src_w, src_w, bytes_per_pixel);
         }
         
-        // 发送一行到LCD
-        HAL_SPI_Transmit(&ST7735_SPI_PORT, (uint8_t*)display_buffer, src_w * sizeof(uint16_t), HAL_MAX_DELAY);
+        // 一次发送整块
+        ST7735_WritePixels(display_buffer, (size_t)rows * src_w);
     }
     
     ST7735_Unselect();
     
     // 释放缓冲区
-    free(bmp_row_buffer);
+    bmp_block_reader_free(&reader);
     free(display_buffer);
     
-    ST7735_Unselect();
-    
     return PIC_SUCCESS;
 }
 
 // JPEG输入函数：从文件读取数据
 static size_t jpeg_input_func(JDEC* jd, uint8_t* buf, size_t nbyte) {
     JpegContext* ctx = (JpegContext*)jd->device;
+    if (!buf) {
+        // TJpgDec用空缓冲区请求跳过不需要的段
+        FSIZE_t target = f_tell(ctx->file) + nbyte;
+        if (target > f_size(ctx->file) || f_lseek(ctx->file, target) != FR_OK) {
+            return 0;
+        }
+        return nbyte;
+    }
     UINT bytes_read;
     FRESULT res = f_read(ctx->file, buf, nbyte, &bytes_read);
     if (res != FR_OK) {
@@ -946,30 +1425,10 @@ static int jpeg_output_func(JDEC* jd, void* bitmap, JRECT* rect) {
     // 设置LCD显示窗口
     ST7735_Select();
     ST7735_SetAddressWindow(x, y, x + w - 1, y + h - 1);
-    ST7735_DC_HIGH();
-    
-    // TJpgDec输出格式为RGB565（由tjpgdcnf.h中的JD_FORMAT=1配置）
-    // 需要字节交换以适配ST7735的SPI传输格式
-    uint16_t* src = (uint16_t*)bitmap;
-    uint32_t pixel_count = w * h;
-    
-    // 分配临时缓冲区用于字节交换
-    uint16_t* temp_buffer = (uint16_t*)malloc(pixel_count * sizeof(uint16_t));
-    if (!temp_buffer) {
-        ST7735_Unselect();
-        return 0;
-    }
-    
-    // 字节交换
-    for (uint32_t i = 0; i < pixel_count; i++) {
-        uint16_t pixel = src[i];
-        temp_buffer[i] = ((pixel & 0xFF00) >> 8) | ((pixel & 0xFF) << 8);
-    }
     
-    // 批量发送
-    HAL_SPI_Transmit(&ST7735_SPI_PORT, (uint8_t*)temp_buffer, pixel_count * sizeof(uint16_t), HAL_MAX_DELAY);
+    // TJpgDec输出格式为RGB565（由tjpgdcnf.h中的JD_FORMAT=1配置），以16位帧直接发送
+    ST7735_WritePixels((const uint16_t*)bitmap, (size_t)w * h);
     
-    free(temp_buffer);
     ST7735_Unselect();
     
     return 1;
@@ -986,91 +1445,81 @@ static PicError display_bmp_streaming_dma(FIL* file, uint32_t data_offset, uint1
     uint32_t row_size = ((img_width * bits_per_pixel + 31) / 32) * 4;
     uint8_t bytes_per_pixel = bits_per_pixel / 8;
     
-    uint8_t* bmp_row_buffer = (uint8_t*)malloc(row_size);
-    if (!bmp_row_buffer) {
+    uint16_t max_rows = 65535 / (src_w * sizeof(uint16_t));
+    if (max_rows > src_h) max_rows = src_h;
+    
+    BmpBlockReader reader;
+    if (bmp_block_reader_init(&reader, file, data_offset, row_size, max_rows) != PIC_SUCCESS) {
         return PIC_ERROR_MEMORY_ALLOC;
     }
     
-    uint16_t row_buffer_size = src_w * sizeof(uint16_t);
-    uint16_t* display_buffer_a = (uint16_t*)malloc(row_buffer_size);
-    uint16_t* display_buffer_b = (uint16_t*)malloc(row_buffer_size);
+    // 双缓冲：DMA发送一块的同时读取并转换下一块
+    uint32_t block_buffer_size = reader.rows_per_block * src_w * sizeof(uint16_t);
+    uint16_t* display_buffer_a = (uint16_t*)malloc(block_buffer_size);
+    uint16_t* display_buffer_b = (uint16_t*)malloc(block_buffer_size);
     
     if (!display_buffer_a || !display_buffer_b) {
-        free(bmp_row_buffer);
+        bmp_block_reader_free(&reader);
         if (display_buffer_a) free(display_buffer_a);
         if (display_buffer_b) free(display_buffer_b);
         return PIC_ERROR_MEMORY_ALLOC;
     }
     
-    FRESULT res;
-    UINT bytes_read;
-    
     ST7735_Select();
     ST7735_SetAddressWindow(display_x, display_y, display_x + src_w - 1, display_y + src_h - 1);
-    ST7735_DC_HIGH();
-    
-    uint16_t src_y_abs = src_y + (src_h - 1);
-    res = f_lseek(file, data_offset + src_y_abs * row_size);
-    if (res != FR_OK) {
-        free(bmp_row_buffer);
-        free(display_buffer_a);
-        free(display_buffer_b);
-        ST7735_Unselect();
-        return PIC_ERROR_FILE_READ;
-    }
-    
-    res = f_read(file, bmp_row_buffer, row_size, &bytes_read);
-    if (res != FR_OK || bytes_read != row_size) {
-        free(bmp_row_buffer);
-        free(display_buffer_a);
-        free(display_buffer_b);
-        ST7735_Unselect();
-        return PIC_ERROR_FILE_READ;
-    }
-    
-    for (uint16_t dx = 0; dx < src_w; dx++) {
-        uint16_t src_x_abs = src_x + dx;
-        const uint8_t* pixel = bmp_row_buffer + src_x_abs * bytes_per_pixel;
-        uint8_t b = pixel[0];
-        uint8_t g = pixel[1];
-        uint8_t r = pixel[2];
-        display_buffer_a[dx] = rgb888_to_565(r, g, b);
-    }
     
-    for (uint16_t dy = 0; dy < src_h; dy++) {
-        uint16_t* current_buf = (dy % 2 == 0) ? display_buffer_a : display_buffer_b;
-        uint16_t* next_buf = (dy % 2 == 0) ? display_buffer_b : display_buffer_a;
-        
-        HAL_SPI_Transmit_DMA(&ST7735_SPI_PORT, (uint8_t*)current_buf, row_buffer_size);
-        
-        if (dy < src_h - 1) {
-            uint16_t src_y_next = src_y + (src_h - 1 - dy - 1);
-            res = f_lseek(file, data_offset + src_y_next * row_size);
-            if (res == FR_OK) {
-                res = f_read(file, bmp_row_buffer, row_size, &bytes_read);
-                if (res == FR_OK && bytes_read == row_size) {
-                    for (uint16_t dx = 0; dx < src_w; dx++) {
-                        uint16_t src_x_abs = src_x + dx;
-                        const uint8_t* pixel = bmp_row_buffer + src_x_abs * bytes_per_pixel;
-                        uint8_t b = pixel[0];
-                        uint8_t g = pixel[1];
-                        uint8_t r = pixel[2];
-                        next_buf[dx] = rgb888_to_565(r, g, b);
-                    }
+    PicError error = PIC_SUCCESS;
+    uint16_t* current_buf = display_buffer_a;
+    uint16_t* next_buf = display_buffer_b;
+    uint16_t current_rows = 0;
+    
+    for (uint16_t dy = 0; dy < src_h || current_rows; dy += reader.rows_per_block) {
+        uint16_t rows = 0;
+        if (dy < src_h && error == PIC_SUCCESS) {
+            rows = src_h - dy;
+            if (rows > reader.rows_per_block) rows = reader.rows_per_block;
+            uint16_t first_row = src_y + src_h - dy - rows;
+            
+            // 上一块仍在DMA发送中，这里的SD卡读取与之重叠
+            error = bmp_block_read(&reader, first_row, rows);
+            if (error == PIC_SUCCESS) {
+                for (uint16_t i = 0; i < rows; i++) {
+                    bmp_convert_row(bmp_block_row(&reader, first_row + rows - 1 - i) + src_x * bytes_per_pixel,
+                                    next_buf + i * src_w, src_w, bytes_per_pixel);
                 }
             }
+            else {
+                rows = 0;
+            }
         }
         
-        while (HAL_SPI_GetState(&ST7735_SPI_PORT) != HAL_SPI_STATE_READY);
-        while (__HAL_SPI_GET_FLAG(&ST7735_SPI_PORT, SPI_FLAG_BSY));
+        if (current_rows) {
+            while (HAL_SPI_GetState(&ST7735_SPI_PORT) != HAL_SPI_STATE_READY);
+            while (__HAL_SPI_GET_FLAG(&ST7735_SPI_PORT, SPI_FLAG_BSY));
+        }
+        
+        current_rows = rows;
+        if (current_rows) {
+            uint16_t* temp = current_buf;
+            current_buf = next_buf;
+            next_buf = temp;
+            ST7735_WritePixelsDMA(current_buf, current_rows * src_w);
+        }
+        else if (error != PIC_SUCCESS) {
+            break;
+        }
     }
     
-    free(bmp_row_buffer);
+    bmp_block_reader_free(&reader);
     free(display_buffer_a);
     free(display_buffer_b);
     ST7735_Unselect();
     
-    return PIC_SUCCESS;
+    return error;
+}
+
+static void jpeg_stage_done(void* user) {
+    *(volatile bool*)user = false;
 }
 
 static int jpeg_output_func_dma(JDEC* jd, void* bitmap, JRECT* rect) {
@@ -1081,30 +1530,22 @@ static int jpeg_output_func_dma(JDEC* jd, void* bitmap, JRECT* rect) {
     uint16_t w = rect->right - rect->left + 1;
     uint16_t h = rect->bottom - rect->top + 1;
     
-    ST7735_Select();
-    ST7735_SetAddressWindow(x, y, x + w - 1, y + h - 1);
-    ST7735_DC_HIGH();
-    
     uint16_t* src = (uint16_t*)bitmap;
     uint32_t pixel_count = w * h;
     
-    uint16_t* temp_buffer = (uint16_t*)malloc(pixel_count * sizeof(uint16_t));
-    if (!temp_buffer) {
-        ST7735_Unselect();
-        return 0;
-    }
-    
-    for (uint32_t i = 0; i < pixel_count; i++) {
-        uint16_t pixel = src[i];
-        temp_buffer[i] = ((pixel & 0xFF00) >> 8) | ((pixel & 0xFF) << 8);
-    }
+    // 等待这个暂存缓冲区上一次的传输完成，此时另一个缓冲区可能仍在发送
+    uint8_t index = ctx->stage_index;
+    while (ctx->stage_busy[index]);
     
-    HAL_SPI_Transmit_DMA(&ST7735_SPI_PORT, (uint8_t*)temp_buffer, pixel_count * sizeof(uint16_t));
-    while (HAL_SPI_GetState(&ST7735_SPI_PORT) != HAL_SPI_STATE_READY);
-    while (__HAL_SPI_GET_FLAG(&ST7735_SPI_PORT, SPI_FLAG_BSY));
+    // TJpgDec解码下一个MCU时会覆盖输出缓冲区，先复制出来
+    uint16_t* dst = ctx->stage[index];
+    memcpy(dst, src, pixel_count * sizeof(uint16_t));
     
-    free(temp_buffer);
-    ST7735_Unselect();
+    // 提交后立即返回，TJpgDec解码下一个MCU时这一个MCU在后台发送
+    ctx->stage_busy[index] = true;
+    ST7735_QueueWindow(x, y, x + w - 1, y + h - 1, dst, pixel_count * sizeof(uint16_t),
+                       jpeg_stage_done, (void*)&ctx->stage_busy[index]);
+    ctx->stage_index = index ^ 1;
     
     return 1;
 }
@@ -1193,6 +1634,9 @@ PicError PIC_DisplayStreamingDMA(const char* filename, uint16_t x, uint16_t y,
             ctx.display_y = y;
             ctx.scale = scale;
             
+            uint8_t turns = jpeg_exif_rotation(&file);
+            f_lseek(&file, 0);
+            
             JRESULT jres = jd_prepare(&jdec, jpeg_input_func, workbuf, PIC_TJPGDEC_WORKSPACE, &ctx);
             if (jres != JDR_OK) {
                 free(workbuf);
@@ -1205,7 +1649,29 @@ PicError PIC_DisplayStreamingDMA(const char* filename, uint16_t x, uint16_t y,
             ctx.display_width = (jdec.width + scale_factor - 1) / scale_factor;
             ctx.display_height = (jdec.height + scale_factor - 1) / scale_factor;
             
-            if (x + ctx.display_width > ST7735_WIDTH || y + ctx.display_height > ST7735_HEIGHT) {
+            // 两个MCU大小的暂存缓冲区轮流提交到ST7735事务队列
+            uint32_t mcu_pixels = (uint32_t)jdec.msx * 8 * jdec.msy * 8;
+            ctx.stage[0] = (uint16_t*)malloc(mcu_pixels * sizeof(uint16_t));
+            ctx.stage[1] = (uint16_t*)malloc(mcu_pixels * sizeof(uint16_t));
+            ctx.stage_busy[0] = false;
+            ctx.stage_busy[1] = false;
+            ctx.stage_index = 0;
+            if (!ctx.stage[0] || !ctx.stage[1]) {
+                free(ctx.stage[0]);
+                free(ctx.stage[1]);
+                free(workbuf);
+                f_close(&file);
+                g_last_error = PIC_ERROR_MEMORY_ALLOC;
+                return g_last_error;
+            }
+            
+            // EXIF方向通过改写LCD扫描方向实现，解码输出仍按原始行序写入
+            ST7735_Rotation previous = exif_rotate_begin(turns);
+            
+            if (x + ctx.display_width > ST7735_GetWidth() || y + ctx.display_height > ST7735_GetHeight()) {
+                exif_rotate_end(previous);
+                free(ctx.stage[0]);
+                free(ctx.stage[1]);
                 free(workbuf);
                 f_close(&file);
                 g_last_error = PIC_ERROR_INVALID_PARAM;
@@ -1213,7 +1679,11 @@ PicError PIC_DisplayStreamingDMA(const char* filename, uint16_t x, uint16_t y,
             }
             
             jres = jd_decomp(&jdec, jpeg_output_func_dma, scale);
+            ST7735_QueueFlush();
+            exif_rotate_end(previous);
             
+            free(ctx.stage[0]);
+            free(ctx.stage[1]);
             free(workbuf);
             
             if (jres != JDR_OK) {
@@ -1225,7 +1695,11 @@ PicError PIC_DisplayStreamingDMA(const char* filename, uint16_t x, uint16_t y,
             break;
         }
         case PIC_FORMAT_RAW_565:
+            error = display_raw_streaming(&file, x, y, src_x, src_y, src_w, src_h, true);
+            break;
         case PIC_FORMAT_PNG:
+            error = display_png_streaming(&file, x, y, src_x, src_y, src_w, src_h, true);
+            break;
         default:
             f_close(&file);
             g_last_error = PIC_ERROR_UNSUPPORTED_FORMAT;
@@ -1235,4 +1709,554 @@ PicError PIC_DisplayStreamingDMA(const char* filename, uint16_t x, uint16_t y,
     f_close(&file);
     g_last_error = error;
     return error;
-}
\ No newline at end of file
+}
+// 流式缩放JPEG的上下文：TJpgDec按MCU输出，先拼成一个MCU行高的条带，整行完成后逐行送入缩放器
+typedef struct {
+    JpegContext base;           // 必须是第一个成员，jpeg_input_func通过它读取文件
+    PicScaler* scaler;
+    uint16_t* strip;            // strip_width × strip_height
+    uint16_t strip_width;
+    uint16_t strip_height;
+} JpegScaleContext;
+
+static int jpeg_output_func_scaled(JDEC* jd, void* bitmap, JRECT* rect) {
+    JpegScaleContext* ctx = (JpegScaleContext*)jd->device;
+    uint16_t w = rect->right - rect->left + 1;
+    const uint16_t* src = (const uint16_t*)bitmap;
+
+    for (uint16_t row = rect->top; row <= rect->bottom; row++) {
+        uint16_t* dst = ctx->strip + (uint32_t)(row - rect->top) * ctx->strip_width + rect->left;
+        memcpy(dst, src, w * sizeof(uint16_t));
+        src += w;
+    }
+
+    // 最右侧的MCU完成后，这一MCU行的所有源行都已就绪
+    if (rect->right + 1 >= ctx->strip_width) {
+        for (uint16_t row = rect->top; row <= rect->bottom; row++) {
+            if (scaler_needs_row(ctx->scaler, row)) {
+                scaler_push_row(ctx->scaler, ctx->strip + (uint32_t)(row - rect->top) * ctx->strip_width, row);
+            }
+        }
+    }
+
+    return 1;
+}
+
+static PicError decode_jpeg_scaled(FIL* file, const PicScaleTarget* target) {
+    uint8_t* workbuf = (uint8_t*)malloc(PIC_TJPGDEC_WORKSPACE);
+    if (!workbuf) return PIC_ERROR_MEMORY_ALLOC;
+
+    JDEC jdec;
+    JpegScaleContext ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.base.file = file;
+    ctx.base.workbuf = workbuf;
+
+    if (jd_prepare(&jdec, jpeg_input_func, workbuf, PIC_TJPGDEC_WORKSPACE, &ctx) != JDR_OK) {
+        free(workbuf);
+        return PIC_ERROR_DECODE_FAILED;
+    }
+
+    uint16_t dst_w, dst_h;
+    PicError error = scaler_compute_size(target, jdec.width, jdec.height, &dst_w, &dst_h);
+    if (error != PIC_SUCCESS) {
+        free(workbuf);
+        return error;
+    }
+
+    // 选择不小于目标尺寸的最大TJpgDec缩放（1/8时只解码DC分量），剩余比例由定点缩放器完成
+    uint8_t jd_scale = 0;
+    while (jd_scale < 3 && (jdec.width >> (jd_scale + 1)) >= dst_w && (jdec.height >> (jd_scale + 1)) >= dst_h) {
+        jd_scale++;
+    }
+    uint16_t src_w = jdec.width >> jd_scale;
+    uint16_t src_h = jdec.height >> jd_scale;
+
+    ctx.strip_width = src_w;
+    ctx.strip_height = (jdec.msy * 8) >> jd_scale;
+    ctx.strip = (uint16_t*)malloc((uint32_t)ctx.strip_width * ctx.strip_height * sizeof(uint16_t));
+    if (!ctx.strip) {
+        free(workbuf);
+        return PIC_ERROR_MEMORY_ALLOC;
+    }
+
+    PicScaler scaler;
+    error = scaler_begin(&scaler, target, src_w, src_h, dst_w, dst_h);
+    if (error != PIC_SUCCESS) {
+        free(ctx.strip);
+        free(workbuf);
+        return error;
+    }
+    ctx.scaler = &scaler;
+
+    JRESULT jres = jd_decomp(&jdec, jpeg_output_func_scaled, jd_scale);
+
+    scaler_end(&scaler);
+    free(ctx.strip);
+    free(workbuf);
+
+    return (jres == JDR_OK) ? PIC_SUCCESS : PIC_ERROR_DECODE_FAILED;
+}
+
+static PicError decode_bmp_scaled(FIL* file, const BMPHeader* header, const PicScaleTarget* target) {
+    uint16_t img_width = (uint16_t)abs(header->width);
+    uint16_t img_height = (uint16_t)abs(header->height);
+    uint32_t row_size = ((img_width * header->bits_per_pixel + 31) / 32) * 4;
+    uint8_t bytes_per_pixel = header->bits_per_pixel / 8;
+
+    uint16_t dst_w, dst_h;
+    PicError error = scaler_compute_size(target, img_width, img_height, &dst_w, &dst_h);
+    if (error != PIC_SUCCESS) return error;
+
+    BmpBlockReader reader;
+    uint16_t* src_row = (uint16_t*)malloc(img_width * sizeof(uint16_t));
+    if (!src_row || bmp_block_reader_init(&reader, file, header->data_offset, row_size, img_height) != PIC_SUCCESS) {
+        free(src_row);
+        return PIC_ERROR_MEMORY_ALLOC;
+    }
+
+    PicScaler scaler;
+    error = scaler_begin(&scaler, target, img_width, img_height, dst_w, dst_h);
+    if (error != PIC_SUCCESS) {
+        bmp_block_reader_free(&reader);
+        free(src_row);
+        return error;
+    }
+
+    // BMP自下而上存储：每块从文件中读取连续的若干行，再按显示顺序（自上而下）送入缩放器
+    for (uint16_t top = 0; top < img_height && error == PIC_SUCCESS; top += reader.rows_per_block) {
+        uint16_t rows = reader.rows_per_block;
+        if (rows > img_height - top) rows = img_height - top;
+
+        error = bmp_block_read(&reader, img_height - top - rows, rows);
+        for (uint16_t i = 0; i < rows && error == PIC_SUCCESS; i++) {
+            uint16_t sy = top + i;
+            if (!scaler_needs_row(&scaler, sy)) continue;
+            bmp_convert_row(bmp_block_row(&reader, img_height - 1 - sy), src_row, img_width, bytes_per_pixel);
+            scaler_push_row(&scaler, src_row, sy);
+        }
+    }
+
+    scaler_end(&scaler);
+    bmp_block_reader_free(&reader);
+    free(src_row);
+    return error;
+}
+
+// 按格式解码文件并缩放输出到指定目标
+static PicError decode_file_scaled(const char* filename, const PicScaleTarget* target) {
+    FIL file;
+    PicFormat format;
+
+    PicError error = detect_image_format(filename, &format);
+    if (error != PIC_SUCCESS) return error;
+
+    FRESULT res = f_open(&file, filename, FA_READ);
+    if (res != FR_OK) {
+        return (res == FR_NO_FILE) ? PIC_ERROR_FILE_NOT_FOUND : PIC_ERROR_FILE_OPEN;
+    }
+
+    switch (format) {
+        case PIC_FORMAT_BMP: {
+            BMPHeader header;
+            UINT bytes_read;
+
+            res = f_read(&file, &header, sizeof(BMPHeader), &bytes_read);
+            if (res != FR_OK || bytes_read != sizeof(BMPHeader)) {
+                error = PIC_ERROR_FILE_READ;
+            }
+            else if (!is_bmp_file((uint8_t*)&header)) {
+                error = PIC_ERROR_INVALID_FORMAT;
+            }
+            else if (header.bits_per_pixel != 24 && header.bits_per_pixel != 32) {
+                error = PIC_ERROR_UNSUPPORTED_FORMAT;
+            }
+            else {
+                error = decode_bmp_scaled(&file, &header, target);
+            }
+            break;
+        }
+        case PIC_FORMAT_JPEG:
+            error = decode_jpeg_scaled(&file, target);
+            break;
+        case PIC_FORMAT_RAW_565:
+            error = decode_raw_scaled(&file, target);
+            break;
+        case PIC_FORMAT_PNG:
+            error = decode_png_scaled(&file, target);
+            break;
+        default:
+            error = PIC_ERROR_UNSUPPORTED_FORMAT;
+            break;
+    }
+
+    f_close(&file);
+    return error;
+}
+
+PicError PIC_DisplayStreamingScaled(const char* filename, uint16_t x, uint16_t y, float scale, PicScaleMode mode) {
+    if (!filename || scale <= 0) {
+        g_last_error = PIC_ERROR_INVALID_PARAM;
+        return g_last_error;
+    }
+
+    PicScaleTarget target;
+    memset(&target, 0, sizeof(target));
+    target.scale = scale;
+    target.x = x;
+    target.y = y;
+    target.mode = mode;
+
+    ST7735_Rotation previous = exif_rotate_begin(PIC_GetExifRotation(filename));
+    g_last_error = decode_file_scaled(filename, &target);
+    exif_rotate_end(previous);
+    return g_last_error;
+}
+
+PicError PIC_DecodeToBuffer(const char* filename, uint16_t* buffer, uint16_t width, uint16_t height,
+                            PicScaleMode mode) {
+    if (!filename || !buffer || width == 0 || height == 0) {
+        g_last_error = PIC_ERROR_INVALID_PARAM;
+        return g_last_error;
+    }
+
+    PicScaleTarget target;
+    memset(&target, 0, sizeof(target));
+    target.fit_w = width;
+    target.fit_h = height;
+    target.buffer = buffer;
+    target.mode = mode;
+
+    g_last_error = decode_file_scaled(filename, &target);
+    return g_last_error;
+}
+
+// PNG逐行显示上下文
+typedef struct {
+    uint16_t src_x;
+    uint16_t src_y;
+    uint16_t src_w;
+    uint16_t src_h;
+    bool use_dma;
+    bool dma_busy;
+    uint16_t* buffers[2];       // DMA模式下轮流发送的行缓冲区
+    uint8_t buffer_index;
+} PngDisplayContext;
+
+static PicError png_error_to_pic(PngError error) {
+    switch (error) {
+        case PNG_SUCCESS: return PIC_SUCCESS;
+        case PNG_ERROR_FILE_READ: return PIC_ERROR_FILE_READ;
+        case PNG_ERROR_INVALID_FORMAT: return PIC_ERROR_INVALID_FORMAT;
+        case PNG_ERROR_UNSUPPORTED_FORMAT: return PIC_ERROR_UNSUPPORTED_FORMAT;
+        case PNG_ERROR_MEMORY_ALLOC: return PIC_ERROR_MEMORY_ALLOC;
+        default: return PIC_ERROR_DECODE_FAILED;
+    }
+}
+
+static bool png_row_to_handle(void* user, uint16_t y, const uint16_t* pixels, uint16_t width) {
+    PicHandle_t handle = (PicHandle_t)user;
+    memcpy(handle->pixel_data + (uint32_t)y * width, pixels, width * sizeof(uint16_t));
+    return true;
+}
+
+static PicError load_png(PicHandle_t handle, FIL* file) {
+    PngInfo info;
+    PngError png_error = PNG_ReadInfo(file, &info);
+    if (png_error != PNG_SUCCESS) return png_error_to_pic(png_error);
+
+    handle->info.width = info.width;
+    handle->info.height = info.height;
+    handle->data_size = (uint32_t)info.width * info.height * sizeof(uint16_t);
+
+    handle->pixel_data = (uint16_t*)malloc(handle->data_size);
+    if (!handle->pixel_data) {
+        return PIC_ERROR_MEMORY_ALLOC;
+    }
+
+    png_error = PNG_Decode(file, png_row_to_handle, handle);
+    if (png_error != PNG_SUCCESS) {
+        free(handle->pixel_data);
+        handle->pixel_data = nullptr;
+        return png_error_to_pic(png_error);
+    }
+
+    return PIC_SUCCESS;
+}
+
+static bool png_row_to_lcd(void* user, uint16_t y, const uint16_t* pixels, uint16_t width) {
+    PngDisplayContext* ctx = (PngDisplayContext*)user;
+    if (y < ctx->src_y) return true;
+    if (y >= ctx->src_y + ctx->src_h) return false;     // 区域已显示完，提前结束解码
+
+    const uint16_t* row = pixels + ctx->src_x;
+    if (!ctx->use_dma) {
+        ST7735_WritePixels(row, ctx->src_w);
+        return true;
+    }
+
+    // 解码器的行缓冲区在回调返回后会被覆盖，复制到空闲的DMA缓冲区后再发送
+    uint16_t* buffer = ctx->buffers[ctx->buffer_index];
+    memcpy(buffer, row, ctx->src_w * sizeof(uint16_t));
+    if (ctx->dma_busy) {
+        while (HAL_SPI_GetState(&ST7735_SPI_PORT) != HAL_SPI_STATE_READY);
+        while (__HAL_SPI_GET_FLAG(&ST7735_SPI_PORT, SPI_FLAG_BSY));
+    }
+    ST7735_WritePixelsDMA(buffer, ctx->src_w);
+    ctx->dma_busy = true;
+    ctx->buffer_index ^= 1;
+    return true;
+}
+
+static PicError display_png_streaming(FIL* file, uint16_t display_x, uint16_t display_y,
+                                      uint16_t src_x, uint16_t src_y, uint16_t src_w, uint16_t src_h, bool use_dma) {
+    PngInfo info;
+    PngError png_error = PNG_ReadInfo(file, &info);
+    if (png_error != PNG_SUCCESS) return png_error_to_pic(png_error);
+
+    if (src_w == 0) src_w = info.width - src_x;
+    if (src_h == 0) src_h = info.height - src_y;
+    if (src_x >= info.width || src_y >= info.height || src_w == 0 || src_h == 0 ||
+        src_x + src_w > info.width || src_y + src_h > info.height ||
+        display_x + src_w > ST7735_GetWidth() || display_y + src_h > ST7735_GetHeight()) {
+        return PIC_ERROR_INVALID_PARAM;
+    }
+
+    PngDisplayContext ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.src_x = src_x;
+    ctx.src_y = src_y;
+    ctx.src_w = src_w;
+    ctx.src_h = src_h;
+    ctx.use_dma = use_dma;
+    if (use_dma) {
+        ctx.buffers[0] = (uint16_t*)malloc(src_w * sizeof(uint16_t));
+        ctx.buffers[1] = (uint16_t*)malloc(src_w * sizeof(uint16_t));
+        if (!ctx.buffers[0] || !ctx.buffers[1]) {
+            free(ctx.buffers[0]);
+            free(ctx.buffers[1]);
+            return PIC_ERROR_MEMORY_ALLOC;
+        }
+    }
+
+    ST7735_Select();
+    ST7735_SetAddressWindow(display_x, display_y, display_x + src_w - 1, display_y + src_h - 1);
+
+    png_error = PNG_Decode(file, png_row_to_lcd, &ctx);
+
+    if (ctx.dma_busy) {
+        while (HAL_SPI_GetState(&ST7735_SPI_PORT) != HAL_SPI_STATE_READY);
+        while (__HAL_SPI_GET_FLAG(&ST7735_SPI_PORT, SPI_FLAG_BSY));
+    }
+    ST7735_Unselect();
+
+    free(ctx.buffers[0]);
+    free(ctx.buffers[1]);
+
+    return png_error == PNG_ERROR_ABORTED ? PIC_SUCCESS : png_error_to_pic(png_error);
+}
+
+static bool png_row_to_scaler(void* user, uint16_t y, const uint16_t* pixels, uint16_t width) {
+    PicScaler* scaler = (PicScaler*)user;
+    if (scaler_needs_row(scaler, y)) {
+        scaler_push_row(scaler, pixels, y);
+    }
+    return scaler->next_row < scaler->dst_h;
+}
+
+static PicError decode_png_scaled(FIL* file, const PicScaleTarget* target) {
+    PngInfo info;
+    PngError png_error = PNG_ReadInfo(file, &info);
+    if (png_error != PNG_SUCCESS) return png_error_to_pic(png_error);
+
+    uint16_t dst_w, dst_h;
+    PicScaler scaler;
+    PicError error = scaler_compute_size(target, info.width, info.height, &dst_w, &dst_h);
+    if (error == PIC_SUCCESS) error = scaler_begin(&scaler, target, info.width, info.height, dst_w, dst_h);
+    if (error != PIC_SUCCESS) return error;
+
+    png_error = PNG_Decode(file, png_row_to_scaler, &scaler);
+
+    scaler_end(&scaler);
+
+    return png_error == PNG_ERROR_ABORTED ? PIC_SUCCESS : png_error_to_pic(png_error);
+}
+
+static void raw_wait_dma(bool* dma_busy) {
+    if (*dma_busy) {
+        while (HAL_SPI_GetState(&ST7735_SPI_PORT) != HAL_SPI_STATE_READY);
+        while (__HAL_SPI_GET_FLAG(&ST7735_SPI_PORT, SPI_FLAG_BSY));
+        *dma_busy = false;
+    }
+}
+
+// 发送一块像素：DMA模式下先等待上一块发送完成，再启动本块的传输后立即返回
+static void raw_send_block(const uint8_t* data, uint32_t size, bool use_dma, bool* dma_busy) {
+    raw_wait_dma(dma_busy);
+    if (use_dma) {
+        ST7735_WritePixelsDMA((const uint16_t*)data, size / sizeof(uint16_t));
+        *dma_busy = true;
+    }
+    else {
+        ST7735_WritePixels((const uint16_t*)data, size / sizeof(uint16_t));
+    }
+}
+
+static PicError display_raw_streaming(FIL* file, uint16_t display_x, uint16_t display_y,
+                                      uint16_t src_x, uint16_t src_y, uint16_t src_w, uint16_t src_h, bool use_dma) {
+    PicRawHeader header;
+    PicError error = read_raw_header(file, &header);
+    if (error != PIC_SUCCESS) return error;
+
+    if (src_w == 0) src_w = header.width - src_x;
+    if (src_h == 0) src_h = header.height - src_y;
+    if (src_x >= header.width || src_y >= header.height || src_w == 0 || src_h == 0 ||
+        src_x + src_w > header.width || src_y + src_h > header.height ||
+        display_x + src_w > ST7735_GetWidth() || display_y + src_h > ST7735_GetHeight()) {
+        return PIC_ERROR_INVALID_PARAM;
+    }
+    // 奇数偏移会让像素跨越缓冲区边界，既无法原地交换字节也不满足16位DMA的对齐要求
+    if (header.data_offset & 1) return PIC_ERROR_INVALID_FORMAT;
+
+    uint32_t row_bytes = (uint32_t)header.width * sizeof(uint16_t);
+    bool swap = header.byte_order == PIC_RAW_BIG_ENDIAN;
+    bool dma_busy = false;
+
+    ST7735_Select();
+    ST7735_SetAddressWindow(display_x, display_y, display_x + src_w - 1, display_y + src_h - 1);
+
+    if (src_x == 0 && src_w == header.width) {
+        // 整行区域在文件中连续：按扇区对齐读取固定大小的块，读到的数据原样发送
+        uint8_t* buffers[2];
+        buffers[0] = (uint8_t*)malloc(PIC_RAW_BLOCK_SIZE);
+        buffers[1] = use_dma ? (uint8_t*)malloc(PIC_RAW_BLOCK_SIZE) : buffers[0];
+        if (!buffers[0] || !buffers[1]) {
+            ST7735_Unselect();
+            free(buffers[0]);
+            if (use_dma) free(buffers[1]);
+            return PIC_ERROR_MEMORY_ALLOC;
+        }
+
+        uint32_t file_size = f_size(file);
+        uint32_t pos = header.data_offset + src_y * row_bytes;
+        uint32_t remaining = src_h * row_bytes;
+        uint8_t index = 0;
+
+        while (remaining && error == PIC_SUCCESS) {
+            uint32_t aligned = pos & ~(uint32_t)(PIC_SECTOR_SIZE - 1);
+            uint32_t lead = pos - aligned;
+            uint32_t chunk = PIC_RAW_BLOCK_SIZE - lead;
+            if (chunk > remaining) chunk = remaining;
+            uint32_t read_size = (lead + chunk + PIC_SECTOR_SIZE - 1) & ~(uint32_t)(PIC_SECTOR_SIZE - 1);
+            if (aligned + read_size > file_size) read_size = file_size - aligned;
+
+            // DMA发送上一块的同时读取这一块
+            UINT bytes_read;
+            FRESULT res = f_lseek(file, aligned);
+            if (res == FR_OK) res = f_read(file, buffers[index], read_size, &bytes_read);
+            if (res != FR_OK || bytes_read < lead + chunk) {
+                error = PIC_ERROR_FILE_READ;
+                break;
+            }
+
+            uint8_t* data = buffers[index] + lead;
+            if (swap) swap_pixel_bytes((uint16_t*)data, chunk / sizeof(uint16_t));
+            raw_send_block(data, chunk, use_dma, &dma_busy);
+
+            pos += chunk;
+            remaining -= chunk;
+            index ^= 1;
+        }
+
+        raw_wait_dma(&dma_busy);
+        free(buffers[0]);
+        if (use_dma) free(buffers[1]);
+    }
+    else {
+        // 部分列：每块读取若干整行，把需要的列紧凑排列到缓冲区开头后一次发送
+        uint32_t max_rows = 65535 / (src_w * sizeof(uint16_t));
+        if (max_rows > src_h) max_rows = src_h;
+
+        BmpBlockReader readers[2];
+        memset(readers, 0, sizeof(readers));
+        uint8_t reader_count = use_dma ? 2 : 1;
+        for (uint8_t i = 0; i < reader_count && error == PIC_SUCCESS; i++) {
+            error = bmp_block_reader_init(&readers[i], file, header.data_offset, row_bytes, (uint16_t)max_rows);
+        }
+        if (error != PIC_SUCCESS) {
+            ST7735_Unselect();
+            bmp_block_reader_free(&readers[0]);
+            bmp_block_reader_free(&readers[1]);
+            return error;
+        }
+
+        uint16_t rows_per_block = readers[0].rows_per_block;
+        uint8_t index = 0;
+        for (uint16_t done = 0; done < src_h && error == PIC_SUCCESS; done += rows_per_block) {
+            uint16_t rows = rows_per_block;
+            if (rows > src_h - done) rows = src_h - done;
+
+            BmpBlockReader* reader = &readers[index];
+            error = bmp_block_read(reader, src_y + done, rows);
+            if (error != PIC_SUCCESS) break;
+
+            uint32_t segment = src_w * sizeof(uint16_t);
+            for (uint16_t r = 0; r < rows; r++) {
+                memmove(reader->buffer + r * segment, bmp_block_row(reader, src_y + done + r) + src_x * sizeof(uint16_t),
+                        segment);
+            }
+            if (swap) swap_pixel_bytes((uint16_t*)reader->buffer, (uint32_t)rows * src_w);
+            raw_send_block(reader->buffer, rows * segment, use_dma, &dma_busy);
+
+            if (use_dma) index ^= 1;
+        }
+
+        raw_wait_dma(&dma_busy);
+        bmp_block_reader_free(&readers[0]);
+        bmp_block_reader_free(&readers[1]);
+    }
+
+    ST7735_Unselect();
+    return error;
+}
+
+static PicError decode_raw_scaled(FIL* file, const PicScaleTarget* target) {
+    PicRawHeader header;
+    PicError error = read_raw_header(file, &header);
+    if (error != PIC_SUCCESS) return error;
+    if (header.data_offset & 1) return PIC_ERROR_INVALID_FORMAT;
+
+    uint16_t dst_w, dst_h;
+    error = scaler_compute_size(target, header.width, header.height, &dst_w, &dst_h);
+    if (error != PIC_SUCCESS) return error;
+
+    uint32_t row_bytes = (uint32_t)header.width * sizeof(uint16_t);
+    BmpBlockReader reader;
+    if (bmp_block_reader_init(&reader, file, header.data_offset, row_bytes, header.height) != PIC_SUCCESS) {
+        return PIC_ERROR_MEMORY_ALLOC;
+    }
+
+    PicScaler scaler;
+    error = scaler_begin(&scaler, target, header.width, header.height, dst_w, dst_h);
+    if (error != PIC_SUCCESS) {
+        bmp_block_reader_free(&reader);
+        return error;
+    }
+
+    for (uint16_t top = 0; top < header.height && error == PIC_SUCCESS; top += reader.rows_per_block) {
+        uint16_t rows = reader.rows_per_block;
+        if (rows > header.height - top) rows = header.height - top;
+
+        error = bmp_block_read(&reader, top, rows);
+        for (uint16_t sy = top; sy < top + rows && error == PIC_SUCCESS; sy++) {
+            if (!scaler_needs_row(&scaler, sy)) continue;
+            uint16_t* row = (uint16_t*)bmp_block_row(&reader, sy);
+            if (header.byte_order == PIC_RAW_BIG_ENDIAN) swap_pixel_bytes(row, header.width);
+            scaler_push_row(&scaler, row, sy);
+        }
+    }
+
+    scaler_end(&scaler);
+    bmp_block_reader_free(&reader);
+    return error;
+}
@@ -17,15 +17,53 @@ extern "C" {
 
 #define PIC_TJPGDEC_WORKSPACE 10000
 
+#define PIC_SECTOR_SIZE 512
+// SD卡扇区大小，流式读取按此对齐以便FatFs直接多扇区读取
+
+#define PIC_BMP_BLOCK_SIZE 4096
+// BMP流式显示每次从SD卡读取的数据块大小（字节），按整行向下取整，至少一行
+
+#define PIC_RAW_BLOCK_SIZE 8192
+// RAW流式显示每个DMA缓冲区的大小（字节），必须是PIC_SECTOR_SIZE的整数倍
+
+#define PIC_RAW_MAGIC 0x35363552
+// RAW文件头标识，文件中的字节为"R565"
+
+#define PIC_RAW_VERSION 1
+
+// RAW像素字节序
+typedef enum {
+    PIC_RAW_BIG_ENDIAN = 0,      // 高字节在前（显示时需要逐像素交换）
+    PIC_RAW_LITTLE_ENDIAN = 1    // 低字节在前（与内存中的RGB565一致，可直接以16位帧发送）
+} PicRawByteOrder;
+
+// RAW文件头（16字节），像素数据从data_offset开始逐行连续存放，每行width个像素
+// 转换工具默认把data_offset填充到PIC_SECTOR_SIZE，使像素数据按扇区对齐
+typedef struct __attribute__((packed)) {
+    uint32_t magic;             // PIC_RAW_MAGIC
+    uint8_t version;            // PIC_RAW_VERSION
+    uint8_t byte_order;         // PicRawByteOrder
+    uint16_t width;
+    uint16_t height;
+    uint16_t reserved;
+    uint32_t data_offset;       // 像素数据在文件中的偏移（不小于文件头大小）
+} PicRawHeader;
+
 // 图片格式定义
 typedef enum {
     PIC_FORMAT_UNKNOWN = 0,
-    PIC_FORMAT_RAW_565,      // 原始RGB565数据
+    PIC_FORMAT_RAW_565,      // RGB565数据（带PicRawHeader文件头，或无文件头的旧格式）
     PIC_FORMAT_BMP,          // BMP格式
     PIC_FORMAT_JPEG,         // JPEG格式（需要解码）
     PIC_FORMAT_PNG           // PNG格式（需要解码）
 } PicFormat;
 
+// 缩放插值方式
+typedef enum {
+    PIC_SCALE_NEAREST = 0,   // 最近邻
+    PIC_SCALE_BILINEAR       // 双线性插值
+} PicScaleMode;
+
 // 图片信息结构体
 typedef struct {
     char filename[64];       // 文件名
@@ -103,6 +141,16 @@ PicError PIC_GetInfo(PicHandle_t handle, PicInfo* info);
  */
 PicError PIC_ParseInfo(const char* filename, PicInfo* info);
 
+/**
+ * @brief 读取JPEG的EXIF方向标签，换算为显示时需要的顺时针旋转
+ * @param filename 图片文件路径
+ * @return 顺时针旋转的90度次数（0~3），非JPEG、没有EXIF或读取失败时返回0
+ * @note 带镜像的方向（2、4、5、7）只取其中的旋转部分
+ *       流式显示JPEG时会据此临时改写LCD的扫描方向（ST7735_SetRotation），旋转不需要逐像素转置，
+ *       显示位置x、y和边界检查都按旋转后的逻辑坐标计算
+ */
+uint8_t PIC_GetExifRotation(const char* filename);
+
 /**
  * @brief 在LCD上显示图片
  * @param handle 图片句柄
@@ -127,9 +175,11 @@ PicError PIC_DisplayDMA(PicHandle_t handle, uint16_t x, uint16_t y);
  * @param x 显示位置的X坐标
  * @param y 显示位置的Y坐标
  * @param scale 缩放比例（1.0为原始大小）
+ * @param mode 插值方式
  * @return 成功返回PIC_SUCCESS，失败返回错误码
+ * @note 使用16.16定点步进逐行缩放，每行通过DMA发送，只需要两行目标像素的缓冲区
  */
-PicError PIC_DisplayScaled(PicHandle_t handle, uint16_t x, uint16_t y, float scale);
+PicError PIC_DisplayScaled(PicHandle_t handle, uint16_t x, uint16_t y, float scale, PicScaleMode mode);
 
 /**
  * @brief 在LCD上显示图片（指定区域）
@@ -168,9 +218,12 @@ PicError PIC_DisplayRawData(const uint16_t* data, uint16_t width, uint16_t heigh
  * @param src_h 要显示的区域高度（BMP使用，0表示显示到图片底部；JPEG使用时忽略）
  * @return 成功返回PIC_SUCCESS，失败返回错误码
  * 
- * @note 此函数支持BMP和JPEG格式，使用流式解码，逐行读取并显示图片，不会将整张图片加载到内存
- *       BMP内存占用：行缓冲区（约1KB）+ 显示缓冲区（约0.5KB）
+ * @note 此函数支持BMP和JPEG格式，使用流式解码，逐块读取并显示图片，不会将整张图片加载到内存
+ *       BMP内存占用：块缓冲区（PIC_BMP_BLOCK_SIZE + 1KB）+ 显示缓冲区（块内行数 × 显示宽度 × 2）
  *       JPEG内存占用：工作缓冲区（约10KB（可在efine中调节）） + BMP内存占用量
+ *       RAW按BMP的区域语义处理src_*参数，整行区域直接发送扇区对齐读取的数据块（PIC_RAW_BLOCK_SIZE）
+ *       PNG按BMP的区域语义处理src_*参数，内存占用：滑动窗口（zlib头声明，最大32KB）+ 两行扫描线
+ *       + 一行RGB565 + 约7KB解码器状态（见PNG_GetMemoryUsage），显示完区域后立即停止解码
  *       适合显示大图片或内存受限的场景
  */
 PicError PIC_DisplayStreaming(const char* filename, uint16_t x, uint16_t y,
@@ -187,12 +240,47 @@ PicError PIC_DisplayStreaming(const char* filename, uint16_t x, uint16_t y,
  * @param src_h 要显示的区域高度（BMP使用，0表示显示到图片底部；JPEG使用时忽略）
  * @return 成功返回PIC_SUCCESS，失败返回错误码
  * 
- * @note 使用DMA双缓冲技术，在发送当前行时并行准备下一行数据
- *       相比PIC_DisplayStreaming有更高的显示效率
+ * @note 使用DMA双缓冲技术，在发送当前块时并行读取并转换下一块数据
+ *       相比PIC_DisplayStreaming有更高的显示效率，BMP需要两个显示缓冲区
+ *       PNG逐行解码，解码下一行时通过DMA发送上一行（额外两行显示缓冲区）
+ *       RAW是最快的静态图片路径：整行区域从SD卡按扇区对齐读取到两个PIC_RAW_BLOCK_SIZE的缓冲区，
+ *       一个通过DMA发送时读取另一个，像素数据不经过任何转换（低字节在前的文件）
  */
 PicError PIC_DisplayStreamingDMA(const char* filename, uint16_t x, uint16_t y,
                                uint16_t src_x, uint16_t src_y, uint16_t src_w, uint16_t src_h);
 
+/**
+ * @brief 流式缩放显示图片（任意缩放比例，不需要将整张图片加载到内存）
+ * @param filename 图片文件路径
+ * @param x 显示位置的X坐标
+ * @param y 显示位置的Y坐标
+ * @param scale 缩放比例（1.0为原始大小），缩放后的图片必须完整位于屏幕内
+ * @param mode 插值方式
+ * @return 成功返回PIC_SUCCESS，失败返回错误码
+ *
+ * @note BMP逐块读取源行，JPEG先用TJpgDec内置的1/2~1/8缩放降到不小于目标尺寸，再逐MCU行缩放
+ *       BMP内存占用：块缓冲区（PIC_BMP_BLOCK_SIZE + 1KB）+ 一行源像素 + 两行目标像素
+ *       JPEG内存占用：工作缓冲区 + 一个MCU行高度的条带（解码宽度 × 8或16行 × 2）+ 两行目标像素
+ *       PNG内存占用：PNG解码器（见PNG_GetMemoryUsage）+ 两行目标像素
+ *       双线性插值额外需要一行源像素
+ */
+PicError PIC_DisplayStreamingScaled(const char* filename, uint16_t x, uint16_t y, float scale, PicScaleMode mode);
+
+/**
+ * @brief 解码图片并等比缩放到内存缓冲区（不放大），居中放置，其余区域填黑
+ * @param filename 图片文件路径
+ * @param buffer 输出缓冲区（width × height个本机字节序的RGB565像素，可直接DMA发送到LCD）
+ * @param width 缓冲区宽度
+ * @param height 缓冲区高度
+ * @param mode 插值方式
+ * @return 成功返回PIC_SUCCESS，失败返回错误码
+ *
+ * @note 与PIC_DisplayStreamingScaled使用相同的流式解码路径，只是目标行直接写入缓冲区，不占用SPI
+ *       可在显示当前图片时预先解码下一张
+ */
+PicError PIC_DecodeToBuffer(const char* filename, uint16_t* buffer, uint16_t width, uint16_t height,
+                            PicScaleMode mode);
+
 /**
  * @brief 检查文件是否为支持的图片格式
  * @param filename 文件名
@@ -298,11 +386,12 @@ public:
      * @param x 显示位置的X坐标
      * @param y 显示位置的Y坐标
      * @param scale 缩放比例
+     * @param mode 插值方式
      * @return 成功返回true，失败返回false
      */
-    bool DisplayScaled(uint16_t x, uint16_t y, float scale) const {
+    bool DisplayScaled(uint16_t x, uint16_t y, float scale, PicScaleMode mode = PIC_SCALE_NEAREST) const {
         if (!handle) return false;
-        return PIC_DisplayScaled(handle, x, y, scale) == PIC_SUCCESS;
+        return PIC_DisplayScaled(handle, x, y, scale, mode) == PIC_SUCCESS;
     }
 
     bool DisplayRegion(uint16_t x, uint16_t y,
@@ -331,6 +420,16 @@ public:
                                   uint16_t src_x, uint16_t src_y, uint16_t src_w, uint16_t src_h) {
         return PIC_DisplayStreamingDMA(filename, x, y, src_x, src_y, src_w, src_h) == PIC_SUCCESS;
     }
+
+    static bool DisplayStreamingScaled(const char* filename, uint16_t x, uint16_t y, float scale,
+                                       PicScaleMode mode = PIC_SCALE_NEAREST) {
+        return PIC_DisplayStreamingScaled(filename, x, y, scale, mode) == PIC_SUCCESS;
+    }
+
+    static bool DecodeToBuffer(const char* filename, uint16_t* buffer, uint16_t width, uint16_t height,
+                               PicScaleMode mode = PIC_SCALE_NEAREST) {
+        return PIC_DecodeToBuffer(filename, buffer, width, height, mode) == PIC_SUCCESS;
+    }
     
     static bool ParseInfo(const char* filename, PicInfo* info) {
         return PIC_ParseInfo(filename, info) == PIC_SUCCESS;
@@ -0,0 +1,688 @@
+//
+// 流式PNG解码器实现
+// 数据流：文件 → 输入缓冲区（512字节）→ IDAT字节流 → inflate（滑动窗口）→ 扫描线（两行）→ RGB565行 → 回调
+//
+
+#include "png_decoder.h"
+#include <cstring>
+#include <cstdlib>
+
+#define PNG_FAST_BITS 9
+#define PNG_FAST_MASK ((1u << PNG_FAST_BITS) - 1)
+#define PNG_MAX_WINDOW 32768
+#define PNG_MAX_OVERRUN 4           // 压缩流末尾允许预读的字节数
+
+#define PNG_CHUNK_IHDR 0x49484452
+#define PNG_CHUNK_PLTE 0x504C5445
+#define PNG_CHUNK_tRNS 0x74524E53
+#define PNG_CHUNK_IDAT 0x49444154
+#define PNG_CHUNK_IEND 0x49454E44
+
+// 规范霍夫曼表：计数/符号数组用于逐位解码，fast表一次查出码长不超过PNG_FAST_BITS的符号
+typedef struct {
+    uint16_t counts[16];
+    uint16_t symbols[288];
+    uint16_t fast[1 << PNG_FAST_BITS];   // 低9位为符号，高位为码长；0表示需要逐位解码
+} PngHuffman;
+
+typedef struct {
+    FIL* file;
+    uint8_t input[PNG_INPUT_BUFFER_SIZE];
+    uint16_t input_pos;
+    uint16_t input_len;
+    uint32_t chunk_remaining;       // 当前IDAT块中剩余的字节数
+    bool idat_done;
+
+    uint32_t bit_buf;
+    uint8_t bit_count;
+    uint8_t overrun;                // 压缩流结束后补零的字节数
+
+    uint8_t* window;
+    uint32_t window_size;
+    uint32_t window_pos;            // 已输出的总字节数
+    PngHuffman lit;
+    PngHuffman dist;
+    bool fixed_tables;              // lit/dist当前是否为固定霍夫曼表
+
+    PngInfo info;
+    uint8_t palette_rgb[256 * 3];
+    uint8_t palette_alpha[256];
+    uint16_t palette[256];          // 已与黑色背景混合的RGB565
+    uint8_t channels;
+    uint8_t filter_bpp;             // 反滤波时的像素字节数（至少为1）
+    uint32_t row_bytes;
+
+    uint8_t* rows;                  // 两行扫描线的存储
+    uint8_t* prev_row;
+    uint8_t* cur_row;
+    uint32_t row_pos;               // 0表示下一个字节是滤波类型
+    uint8_t filter;
+    uint16_t y;
+    uint16_t* out_row;
+
+    PngRowFunc row_func;
+    void* user;
+    PngError error;
+} PngDecoder;
+
+static const uint16_t len_base[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t len_extra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint16_t dist_base[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+static const uint8_t dist_extra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+static const uint8_t code_length_order[19] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+static const uint8_t png_signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+
+static const char* error_strings[] = {
+    "成功",
+    "文件读取失败",
+    "无效的格式",
+    "不支持的格式",
+    "内存分配失败",
+    "解码失败",
+    "解码被中止"
+};
+
+static inline uint32_t load_be32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static inline uint16_t png_rgb565(uint8_t r, uint8_t g, uint8_t b) {
+    return (uint16_t)(((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3));
+}
+
+// 与黑色背景混合：v * a / 255（精确舍入）
+static inline uint8_t png_blend(uint8_t v, uint8_t a) {
+    uint32_t t = (uint32_t)v * a + 128;
+    return (uint8_t)((t + (t >> 8)) >> 8);
+}
+
+// ---------------- 文件与块读取 ----------------
+
+static bool png_fill(PngDecoder* d) {
+    UINT bytes_read;
+    if (f_read(d->file, d->input, PNG_INPUT_BUFFER_SIZE, &bytes_read) != FR_OK || bytes_read == 0) {
+        return false;
+    }
+    d->input_pos = 0;
+    d->input_len = (uint16_t)bytes_read;
+    return true;
+}
+
+static bool png_read(PngDecoder* d, uint8_t* dst, uint32_t len) {
+    while (len) {
+        if (d->input_pos == d->input_len && !png_fill(d)) return false;
+        uint32_t n = d->input_len - d->input_pos;
+        if (n > len) n = len;
+        memcpy(dst, d->input + d->input_pos, n);
+        d->input_pos += n;
+        dst += n;
+        len -= n;
+    }
+    return true;
+}
+
+static bool png_skip(PngDecoder* d, uint32_t len) {
+    uint32_t avail = d->input_len - d->input_pos;
+    if (len <= avail) {
+        d->input_pos += len;
+        return true;
+    }
+    len -= avail;
+    d->input_pos = d->input_len = 0;
+    return f_lseek(d->file, f_tell(d->file) + len) == FR_OK;
+}
+
+// 跨越多个IDAT块读取压缩数据的下一个字节，数据结束返回-1
+static int png_idat_byte(PngDecoder* d) {
+    while (d->chunk_remaining == 0) {
+        uint8_t header[8];
+        if (d->idat_done || !png_skip(d, 4) || !png_read(d, header, sizeof(header)) ||
+            load_be32(header + 4) != PNG_CHUNK_IDAT) {
+            d->idat_done = true;
+            return -1;
+        }
+        d->chunk_remaining = load_be32(header);
+    }
+    if (d->input_pos == d->input_len && !png_fill(d)) {
+        d->idat_done = true;
+        return -1;
+    }
+    d->chunk_remaining--;
+    return d->input[d->input_pos++];
+}
+
+// ---------------- 位读取与霍夫曼解码 ----------------
+
+static inline void png_refill(PngDecoder* d) {
+    while (d->bit_count <= 24) {
+        int b = png_idat_byte(d);
+        if (b < 0) {
+            b = 0;
+            if (d->overrun < 255) d->overrun++;
+        }
+        d->bit_buf |= (uint32_t)b << d->bit_count;
+        d->bit_count += 8;
+    }
+}
+
+static inline uint32_t png_bits(PngDecoder* d, uint8_t n) {
+    if (d->bit_count < n) png_refill(d);
+    uint32_t v = d->bit_buf & ((1u << n) - 1);
+    d->bit_buf >>= n;
+    d->bit_count -= n;
+    return v;
+}
+
+static bool png_build_huffman(PngHuffman* h, const uint8_t* lengths, uint16_t count) {
+    uint16_t offsets[16];
+    uint16_t next_code[16];
+
+    memset(h->counts, 0, sizeof(h->counts));
+    memset(h->fast, 0, sizeof(h->fast));
+    for (uint16_t i = 0; i < count; i++) h->counts[lengths[i]]++;
+    h->counts[0] = 0;
+
+    int32_t left = 1;
+    for (uint8_t len = 1; len < 16; len++) {
+        left = (left << 1) - h->counts[len];
+        if (left < 0) return false;     // 码字超额分配
+    }
+
+    offsets[1] = 0;
+    next_code[1] = 0;
+    for (uint8_t len = 1; len < 15; len++) {
+        offsets[len + 1] = offsets[len] + h->counts[len];
+        next_code[len + 1] = (next_code[len] + h->counts[len]) << 1;
+    }
+
+    for (uint16_t sym = 0; sym < count; sym++) {
+        uint8_t len = lengths[sym];
+        if (len == 0) continue;
+        h->symbols[offsets[len]++] = sym;
+
+        uint16_t code = next_code[len]++;
+        if (len > PNG_FAST_BITS) continue;
+        // deflate从最高位开始发送霍夫曼码，而位缓冲区从最低位开始消费，需要反转
+        uint16_t reversed = 0;
+        for (uint8_t i = 0; i < len; i++) {
+            reversed = (reversed << 1) | ((code >> i) & 1);
+        }
+        for (uint16_t k = reversed; k < (1u << PNG_FAST_BITS); k += (1u << len)) {
+            h->fast[k] = sym | (len << 9);
+        }
+    }
+    return true;
+}
+
+static int png_decode_symbol(PngDecoder* d, const PngHuffman* h) {
+    if (d->bit_count < 16) png_refill(d);
+
+    uint16_t entry = h->fast[d->bit_buf & PNG_FAST_MASK];
+    if (entry) {
+        uint8_t len = entry >> 9;
+        d->bit_buf >>= len;
+        d->bit_count -= len;
+        return entry & 0x1FF;
+    }
+
+    int32_t code = 0, first = 0, index = 0;
+    for (uint8_t len = 1; len < 16; len++) {
+        code |= d->bit_buf & 1;
+        d->bit_buf >>= 1;
+        d->bit_count--;
+        int32_t count = h->counts[len];
+        if (code - count < first) return h->symbols[index + (code - first)];
+        index += count;
+        first = (first + count) << 1;
+        code <<= 1;
+    }
+    return -1;
+}
+
+// ---------------- 扫描线 ----------------
+
+static inline uint8_t png_paeth(uint8_t a, uint8_t b, uint8_t c) {
+    int16_t p = (int16_t)a + b - c;
+    int16_t pa = p > a ? p - a : a - p;
+    int16_t pb = p > b ? p - b : b - p;
+    int16_t pc = p > c ? p - c : c - p;
+    if (pa <= pb && pa <= pc) return a;
+    return pb <= pc ? b : c;
+}
+
+static bool png_unfilter(PngDecoder* d) {
+    uint8_t* cur = d->cur_row;
+    const uint8_t* prev = d->prev_row;
+    uint32_t n = d->row_bytes;
+    uint8_t bpp = d->filter_bpp;
+
+    switch (d->filter) {
+        case 0:
+            break;
+        case 1:
+            for (uint32_t i = bpp; i < n; i++) cur[i] += cur[i - bpp];
+            break;
+        case 2:
+            for (uint32_t i = 0; i < n; i++) cur[i] += prev[i];
+            break;
+        case 3:
+            for (uint32_t i = 0; i < bpp; i++) cur[i] += prev[i] >> 1;
+            for (uint32_t i = bpp; i < n; i++) cur[i] += (cur[i - bpp] + prev[i]) >> 1;
+            break;
+        case 4:
+            for (uint32_t i = 0; i < bpp; i++) cur[i] += prev[i];
+            for (uint32_t i = bpp; i < n; i++) cur[i] += png_paeth(cur[i - bpp], prev[i], prev[i - bpp]);
+            break;
+        default:
+            return false;
+    }
+    return true;
+}
+
+// 取出第x个小于8位的样本（调色板索引或灰度）
+static inline uint8_t png_sub_byte_sample(const uint8_t* row, uint32_t x, uint8_t depth) {
+    uint32_t bit = x * depth;
+    return (row[bit >> 3] >> (8 - depth - (bit & 7))) & ((1u << depth) - 1);
+}
+
+static void png_convert_row(PngDecoder* d) {
+    const uint8_t* src = d->cur_row;
+    uint16_t* dst = d->out_row;
+    uint16_t width = d->info.width;
+    uint8_t depth = d->info.bit_depth;
+    // 16位样本只取高字节
+    uint8_t step = depth == 16 ? 2 : 1;
+
+    switch (d->info.color_type) {
+        case 3:
+            if (depth == 8) {
+                for (uint16_t x = 0; x < width; x++) dst[x] = d->palette[src[x]];
+            }
+            else {
+                for (uint16_t x = 0; x < width; x++) dst[x] = d->palette[png_sub_byte_sample(src, x, depth)];
+            }
+            break;
+        case 0:
+            if (depth < 8) {
+                uint8_t gain = depth == 1 ? 255 : (depth == 2 ? 85 : 17);
+                for (uint16_t x = 0; x < width; x++) {
+                    uint8_t v = png_sub_byte_sample(src, x, depth) * gain;
+                    dst[x] = png_rgb565(v, v, v);
+                }
+            }
+            else {
+                for (uint16_t x = 0; x < width; x++, src += step) dst[x] = png_rgb565(*src, *src, *src);
+            }
+            break;
+        case 2:
+            for (uint16_t x = 0; x < width; x++, src += 3 * step) {
+                dst[x] = png_rgb565(src[0], src[step], src[2 * step]);
+            }
+            break;
+        case 4:
+            for (uint16_t x = 0; x < width; x++, src += 2 * step) {
+                uint8_t v = png_blend(src[0], src[step]);
+                dst[x] = png_rgb565(v, v, v);
+            }
+            break;
+        case 6:
+            for (uint16_t x = 0; x < width; x++, src += 4 * step) {
+                uint8_t a = src[3 * step];
+                dst[x] = png_rgb565(png_blend(src[0], a), png_blend(src[step], a), png_blend(src[2 * step], a));
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static void png_finish_row(PngDecoder* d) {
+    if (!png_unfilter(d)) {
+        d->error = PNG_ERROR_DECODE_FAILED;
+        return;
+    }
+    png_convert_row(d);
+    if (!d->row_func(d->user, d->y, d->out_row, d->info.width)) {
+        d->error = PNG_ERROR_ABORTED;
+    }
+
+    uint8_t* t = d->prev_row;
+    d->prev_row = d->cur_row;
+    d->cur_row = t;
+    d->y++;
+}
+
+// 解压输出的每个字节同时写入滑动窗口和当前扫描线
+static inline void png_emit(PngDecoder* d, uint8_t b) {
+    d->window[d->window_pos++ & (d->window_size - 1)] = b;
+    if (d->y >= d->info.height) return;
+
+    if (d->row_pos == 0) {
+        d->filter = b;
+        d->row_pos = 1;
+        return;
+    }
+    d->cur_row[d->row_pos - 1] = b;
+    if (d->row_pos++ == d->row_bytes) {
+        d->row_pos = 0;
+        png_finish_row(d);
+    }
+}
+
+// ---------------- inflate ----------------
+
+static PngError png_load_fixed_tables(PngDecoder* d) {
+    uint8_t lengths[288];
+    memset(lengths, 8, 144);
+    memset(lengths + 144, 9, 112);
+    memset(lengths + 256, 7, 24);
+    memset(lengths + 280, 8, 8);
+    png_build_huffman(&d->lit, lengths, 288);
+    memset(lengths, 5, 30);
+    png_build_huffman(&d->dist, lengths, 30);
+    d->fixed_tables = true;
+    return PNG_SUCCESS;
+}
+
+static PngError png_load_dynamic_tables(PngDecoder* d) {
+    uint8_t lengths[286 + 30];
+    uint16_t hlit = png_bits(d, 5) + 257;
+    uint16_t hdist = png_bits(d, 5) + 1;
+    uint16_t hclen = png_bits(d, 4) + 4;
+    if (hlit > 286 || hdist > 30) return PNG_ERROR_DECODE_FAILED;
+
+    memset(lengths, 0, 19);
+    for (uint16_t i = 0; i < hclen; i++) {
+        lengths[code_length_order[i]] = png_bits(d, 3);
+    }
+    // 码长表借用dist表的空间
+    d->fixed_tables = false;
+    if (!png_build_huffman(&d->dist, lengths, 19)) return PNG_ERROR_DECODE_FAILED;
+
+    uint16_t i = 0;
+    while (i < hlit + hdist) {
+        int sym = png_decode_symbol(d, &d->dist);
+        if (sym < 0) return PNG_ERROR_DECODE_FAILED;
+        if (sym < 16) {
+            lengths[i++] = (uint8_t)sym;
+            continue;
+        }
+
+        uint8_t value = 0;
+        uint16_t repeat;
+        if (sym == 16) {
+            if (i == 0) return PNG_ERROR_DECODE_FAILED;
+            value = lengths[i - 1];
+            repeat = 3 + png_bits(d, 2);
+        }
+        else if (sym == 17) {
+            repeat = 3 + png_bits(d, 3);
+        }
+        else {
+            repeat = 11 + png_bits(d, 7);
+        }
+        if (i + repeat > hlit + hdist) return PNG_ERROR_DECODE_FAILED;
+        memset(lengths + i, value, repeat);
+        i += repeat;
+    }
+
+    if (lengths[256] == 0) return PNG_ERROR_DECODE_FAILED;
+    if (!png_build_huffman(&d->lit, lengths, hlit) || !png_build_huffman(&d->dist, lengths + hlit, hdist)) {
+        return PNG_ERROR_DECODE_FAILED;
+    }
+    return PNG_SUCCESS;
+}
+
+static PngError png_inflate_stored(PngDecoder* d) {
+    png_bits(d, d->bit_count & 7);
+    uint16_t len = png_bits(d, 16);
+    uint16_t nlen = png_bits(d, 16);
+    if ((uint16_t)~nlen != len) return PNG_ERROR_DECODE_FAILED;
+
+    while (len-- && d->error == PNG_SUCCESS) {
+        png_emit(d, (uint8_t)png_bits(d, 8));
+    }
+    return d->overrun > PNG_MAX_OVERRUN ? PNG_ERROR_DECODE_FAILED : d->error;
+}
+
+static PngError png_inflate_codes(PngDecoder* d) {
+    while (d->error == PNG_SUCCESS && d->y < d->info.height) {
+        int sym = png_decode_symbol(d, &d->lit);
+        if (sym < 0 || d->overrun > PNG_MAX_OVERRUN) return PNG_ERROR_DECODE_FAILED;
+
+        if (sym < 256) {
+            png_emit(d, (uint8_t)sym);
+            continue;
+        }
+        if (sym == 256) break;
+
+        sym -= 257;
+        if (sym >= 29) return PNG_ERROR_DECODE_FAILED;
+        uint16_t len = len_base[sym] + png_bits(d, len_extra[sym]);
+
+        int dsym = png_decode_symbol(d, &d->dist);
+        if (dsym < 0 || dsym >= 30) return PNG_ERROR_DECODE_FAILED;
+        uint32_t dist = dist_base[dsym] + png_bits(d, dist_extra[dsym]);
+        if (dist > d->window_size || dist > d->window_pos) return PNG_ERROR_DECODE_FAILED;
+
+        uint32_t mask = d->window_size - 1;
+        while (len--) {
+            png_emit(d, d->window[(d->window_pos - dist) & mask]);
+        }
+    }
+    return d->error;
+}
+
+static PngError png_inflate(PngDecoder* d) {
+    int cmf = png_idat_byte(d);
+    int flg = png_idat_byte(d);
+    if (cmf < 0 || flg < 0 || (cmf & 0x0F) != 8 || ((cmf << 8) | flg) % 31 != 0 || (flg & 0x20)) {
+        return PNG_ERROR_INVALID_FORMAT;
+    }
+
+    // zlib头声明的窗口大小保证流中不会出现更远的距离，小窗口可以节省内存
+    uint32_t window_size = 1u << ((cmf >> 4) + 8);
+    if (window_size > PNG_MAX_WINDOW) return PNG_ERROR_INVALID_FORMAT;
+    d->window_size = window_size;
+    d->window = (uint8_t*)malloc(window_size);
+    if (!d->window) return PNG_ERROR_MEMORY_ALLOC;
+
+    PngError error = PNG_SUCCESS;
+    bool final = false;
+    while (!final && error == PNG_SUCCESS && d->y < d->info.height) {
+        final = png_bits(d, 1);
+        switch (png_bits(d, 2)) {
+            case 0:
+                error = png_inflate_stored(d);
+                break;
+            case 1:
+                if (!d->fixed_tables) png_load_fixed_tables(d);
+                error = png_inflate_codes(d);
+                break;
+            case 2:
+                error = png_load_dynamic_tables(d);
+                if (error == PNG_SUCCESS) error = png_inflate_codes(d);
+                break;
+            default:
+                error = PNG_ERROR_DECODE_FAILED;
+                break;
+        }
+    }
+
+    if (error == PNG_SUCCESS && d->y < d->info.height) error = PNG_ERROR_DECODE_FAILED;
+    return error;
+}
+
+// ---------------- 文件头 ----------------
+
+static uint8_t png_channels(uint8_t color_type) {
+    switch (color_type) {
+        case 0: return 1;
+        case 2: return 3;
+        case 3: return 1;
+        case 4: return 2;
+        case 6: return 4;
+        default: return 0;
+    }
+}
+
+static PngError png_parse_ihdr(const uint8_t* data, PngInfo* info) {
+    uint32_t width = load_be32(data);
+    uint32_t height = load_be32(data + 4);
+    uint8_t depth = data[8];
+    uint8_t color_type = data[9];
+
+    if (width == 0 || height == 0) return PNG_ERROR_INVALID_FORMAT;
+    uint8_t channels = png_channels(color_type);
+    if (channels == 0) return PNG_ERROR_INVALID_FORMAT;
+
+    bool depth_ok;
+    switch (color_type) {
+        case 0: depth_ok = depth == 1 || depth == 2 || depth == 4 || depth == 8 || depth == 16; break;
+        case 3: depth_ok = depth == 1 || depth == 2 || depth == 4 || depth == 8; break;
+        default: depth_ok = depth == 8 || depth == 16; break;
+    }
+    if (!depth_ok || data[10] != 0 || data[11] != 0) return PNG_ERROR_INVALID_FORMAT;
+
+    info->width = (uint16_t)(width > 0xFFFF ? 0xFFFF : width);
+    info->height = (uint16_t)(height > 0xFFFF ? 0xFFFF : height);
+    info->bit_depth = depth;
+    info->color_type = color_type;
+    info->interlace = data[12];
+
+    if (width > PNG_MAX_WIDTH || height > 0xFFFF || data[12] != 0) return PNG_ERROR_UNSUPPORTED_FORMAT;
+    return PNG_SUCCESS;
+}
+
+PngError PNG_ReadInfo(FIL* file, PngInfo* info) {
+    if (!file || !info) return PNG_ERROR_INVALID_FORMAT;
+
+    // 签名(8) + IHDR长度与类型(8) + IHDR数据(13)
+    uint8_t header[29];
+    UINT bytes_read;
+    if (f_lseek(file, 0) != FR_OK || f_read(file, header, sizeof(header), &bytes_read) != FR_OK ||
+        bytes_read != sizeof(header)) {
+        return PNG_ERROR_FILE_READ;
+    }
+    if (memcmp(header, png_signature, 8) != 0 || load_be32(header + 12) != PNG_CHUNK_IHDR) {
+        return PNG_ERROR_INVALID_FORMAT;
+    }
+    PngError error = png_parse_ihdr(header + 16, info);
+    // 隔行图片仍可以返回尺寸信息
+    return error == PNG_ERROR_UNSUPPORTED_FORMAT ? PNG_SUCCESS : error;
+}
+
+size_t PNG_GetMemoryUsage(const PngInfo* info, uint32_t window_size) {
+    if (!info) return 0;
+    if (window_size == 0 || window_size > PNG_MAX_WINDOW) window_size = PNG_MAX_WINDOW;
+    uint32_t row_bytes = ((uint32_t)info->width * png_channels(info->color_type) * info->bit_depth + 7) / 8;
+    return sizeof(PngDecoder) + window_size + 2 * row_bytes + info->width * sizeof(uint16_t);
+}
+
+static PngError png_read_chunks(PngDecoder* d) {
+    uint8_t header[8];
+    if (!png_read(d, header, sizeof(header))) return PNG_ERROR_FILE_READ;
+    if (memcmp(header, png_signature, 8) != 0) return PNG_ERROR_INVALID_FORMAT;
+
+    bool has_header = false;
+    memset(d->palette_alpha, 0xFF, sizeof(d->palette_alpha));
+
+    for (;;) {
+        if (!png_read(d, header, sizeof(header))) return PNG_ERROR_FILE_READ;
+        uint32_t length = load_be32(header);
+        uint32_t type = load_be32(header + 4);
+
+        if (type == PNG_CHUNK_IDAT) {
+            if (!has_header) return PNG_ERROR_INVALID_FORMAT;
+            d->chunk_remaining = length;
+            return PNG_SUCCESS;
+        }
+
+        if (type == PNG_CHUNK_IHDR) {
+            uint8_t data[13];
+            if (length != 13 || !png_read(d, data, sizeof(data))) return PNG_ERROR_INVALID_FORMAT;
+            PngError error = png_parse_ihdr(data, &d->info);
+            if (error != PNG_SUCCESS) return error;
+            has_header = true;
+        }
+        else if (type == PNG_CHUNK_PLTE && length <= sizeof(d->palette_rgb) && length % 3 == 0) {
+            if (!png_read(d, d->palette_rgb, length)) return PNG_ERROR_FILE_READ;
+        }
+        else if (type == PNG_CHUNK_tRNS && d->info.color_type == 3 && length <= sizeof(d->palette_alpha)) {
+            if (!png_read(d, d->palette_alpha, length)) return PNG_ERROR_FILE_READ;
+        }
+        else if (type == PNG_CHUNK_IEND) {
+            return PNG_ERROR_INVALID_FORMAT;
+        }
+        else if (!png_skip(d, length)) {
+            return PNG_ERROR_FILE_READ;
+        }
+
+        // 跳过CRC
+        if (!png_skip(d, 4)) return PNG_ERROR_FILE_READ;
+    }
+}
+
+PngError PNG_Decode(FIL* file, PngRowFunc row_func, void* user) {
+    if (!file || !row_func) return PNG_ERROR_INVALID_FORMAT;
+    if (f_lseek(file, 0) != FR_OK) return PNG_ERROR_FILE_READ;
+
+    PngDecoder* d = (PngDecoder*)malloc(sizeof(PngDecoder));
+    if (!d) return PNG_ERROR_MEMORY_ALLOC;
+    memset(d, 0, sizeof(PngDecoder));
+    d->file = file;
+    d->row_func = row_func;
+    d->user = user;
+
+    PngError error = png_read_chunks(d);
+    if (error == PNG_SUCCESS) {
+        d->channels = png_channels(d->info.color_type);
+        d->row_bytes = ((uint32_t)d->info.width * d->channels * d->info.bit_depth + 7) / 8;
+        d->filter_bpp = (d->channels * d->info.bit_depth) / 8;
+        if (d->filter_bpp == 0) d->filter_bpp = 1;
+
+        for (uint16_t i = 0; i < 256; i++) {
+            uint8_t a = d->palette_alpha[i];
+            const uint8_t* rgb = d->palette_rgb + i * 3;
+            d->palette[i] = png_rgb565(png_blend(rgb[0], a), png_blend(rgb[1], a), png_blend(rgb[2], a));
+        }
+
+        d->rows = (uint8_t*)calloc(2, d->row_bytes);
+        d->out_row = (uint16_t*)malloc(d->info.width * sizeof(uint16_t));
+        if (!d->rows || !d->out_row) {
+            error = PNG_ERROR_MEMORY_ALLOC;
+        }
+        else {
+            d->prev_row = d->rows;
+            d->cur_row = d->rows + d->row_bytes;
+            error = png_inflate(d);
+        }
+    }
+
+    free(d->window);
+    free(d->rows);
+    free(d->out_row);
+    free(d);
+    return error;
+}
+
+const char* PNG_GetErrorString(PngError error) {
+    if (error < 0 || error >= sizeof(error_strings) / sizeof(error_strings[0])) {
+        return "未知错误";
+    }
+    return error_strings[error];
+}
@@ -0,0 +1,93 @@
+//
+// 流式PNG解码器
+// 从文件逐块读取IDAT数据，增量解压并逐行反滤波，每解出一行即转换为RGB565交给回调函数
+//
+
+#ifndef SD_AND_LCD2_PNG_DECODER_H
+#define SD_AND_LCD2_PNG_DECODER_H
+
+#include "ff.h"
+
+#ifdef __cplusplus
+extern "C" {
+#else
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#endif
+
+#define PNG_INPUT_BUFFER_SIZE 512
+// 文件读取缓冲区大小（字节），与SD卡扇区大小一致
+
+#define PNG_MAX_WIDTH 2048
+// 支持的最大图片宽度，限制两行扫描线缓冲区的大小
+
+// 错误码定义
+typedef enum {
+    PNG_SUCCESS = 0,
+    PNG_ERROR_FILE_READ,
+    PNG_ERROR_INVALID_FORMAT,
+    PNG_ERROR_UNSUPPORTED_FORMAT,
+    PNG_ERROR_MEMORY_ALLOC,
+    PNG_ERROR_DECODE_FAILED,
+    PNG_ERROR_ABORTED
+} PngError;
+
+// PNG图片信息
+typedef struct {
+    uint16_t width;
+    uint16_t height;
+    uint8_t bit_depth;          // 1/2/4/8/16
+    uint8_t color_type;         // 0=灰度 2=RGB 3=调色板 4=灰度+Alpha 6=RGBA
+    uint8_t interlace;          // 0=无隔行（仅支持此种）
+} PngInfo;
+
+/**
+ * @brief 行输出回调函数
+ * @param user 用户数据
+ * @param y 行号（从上到下）
+ * @param pixels 一行本机字节序的RGB565像素（可直接以16位帧发送到LCD），仅在回调期间有效
+ * @param width 像素个数
+ * @return 继续解码返回true，返回false时解码提前结束并返回PNG_ERROR_ABORTED
+ */
+typedef bool (*PngRowFunc)(void* user, uint16_t y, const uint16_t* pixels, uint16_t width);
+
+/**
+ * @brief 读取PNG文件头信息
+ * @param file 已打开的文件，读取位置任意
+ * @param info 返回的图片信息
+ * @return 成功返回PNG_SUCCESS，失败返回错误码
+ */
+PngError PNG_ReadInfo(FIL* file, PngInfo* info);
+
+/**
+ * @brief 流式解码PNG，逐行调用回调函数
+ * @param file 已打开的文件，读取位置任意
+ * @param row_func 行输出回调
+ * @param user 传给回调的用户数据
+ * @return 成功返回PNG_SUCCESS，失败返回错误码
+ * @note 不支持隔行扫描（Adam7）图片；带Alpha通道的像素与黑色背景混合
+ *       内存占用见PNG_GetMemoryUsage，与图片高度无关
+ */
+PngError PNG_Decode(FIL* file, PngRowFunc row_func, void* user);
+
+/**
+ * @brief 计算解码指定图片需要的堆内存
+ * @param info 图片信息
+ * @param window_size 滑动窗口大小（由zlib头决定，最大32KB；传0按32KB计算）
+ * @return 字节数：窗口 + 两行扫描线 + 一行RGB565 + 输入缓冲区 + 霍夫曼表（约6KB）
+ */
+size_t PNG_GetMemoryUsage(const PngInfo* info, uint32_t window_size);
+
+/**
+ * @brief 获取错误信息字符串
+ * @param error 错误码
+ * @return 错误信息字符串
+ */
+const char* PNG_GetErrorString(PngError error);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SD_AND_LCD2_PNG_DECODER_H
@@ -0,0 +1,504 @@
+//
+// 幻灯片播放器实现
+// 帧缓冲区保存解码好的全屏图片（本机字节序的RGB565），显示时按行带直接DMA发送，过渡动画不需要额外的整帧缓冲区
+//
+
+#include "slideshow.h"
+#include "st7735.h"
+#include "fatfs.h"
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+
+extern SPI_HandleTypeDef ST7735_SPI_PORT;
+
+#define SLIDE_NO_IMAGE (-1)
+
+typedef struct SlideDeck {
+    char dir_path[SLIDE_PATH_MAX];
+    char* names[SLIDE_MAX_IMAGES];      // 图片文件名（GBK）
+    uint16_t count;
+    uint16_t index;                     // 当前图片
+    SlideConfig config;
+    uint16_t* frames[SLIDE_MAX_FRAMES];
+    bool frame_owned[SLIDE_MAX_FRAMES]; // 由内部分配，关闭时释放
+    int32_t frame_image[SLIDE_MAX_FRAMES]; // 帧缓冲区中保存的图片序号
+    bool frame_valid[SLIDE_MAX_FRAMES]; // 解码失败时为false，避免空闲时反复重试
+    uint8_t frame_turns[SLIDE_MAX_FRAMES]; // EXIF方向要求的顺时针旋转次数，显示时改写LCD扫描方向
+    uint8_t frame_count;                // 为0时直接流式显示
+    int8_t current_slot;                // 正在显示的帧缓冲区，-1表示当前图片是直接流式显示的，
+                                        // 或只有一个帧缓冲区（屏幕保存当前图片，帧缓冲区可以预加载下一张）
+    uint32_t shown_tick;                // 当前图片开始显示的时间
+    bool paused;
+} SlideDeck;
+
+static SlideError g_last_error = SLIDE_SUCCESS;
+
+static const char* error_strings[] = {
+    "成功",
+    "无效的参数",
+    "目录打开失败",
+    "没有可播放的图片",
+    "内存分配失败",
+    "解码失败"
+};
+
+extern uint32_t HAL_GetTick(void);
+
+static void join_path(char* buf, size_t size, const char* dir, const char* name);
+static SlideError scan_directory(SlideDeck* deck, const char* start_name);
+static void alloc_frames(SlideDeck* deck);
+static int find_slot(const SlideDeck* deck, uint16_t image);
+static int pick_slot(const SlideDeck* deck, int32_t keep_image);
+static void decode_into(SlideDeck* deck, int slot, uint16_t image);
+static SlideError show_image(SlideDeck* deck, uint16_t image, bool forward, bool animate);
+static void lcd_wait_dma(void);
+static void lcd_send_rows(uint16_t y, uint16_t rows, const uint16_t* pixels);
+static void lcd_send_frame(const uint16_t* pixels, uint8_t turns);
+static void wait_step(uint32_t start, const SlideConfig* config, uint8_t step);
+static void transition_wipe(const SlideConfig* config, const uint16_t* to, bool forward);
+static void transition_slide(const SlideConfig* config, const uint16_t* from, const uint16_t* to, bool forward);
+static bool transition_fade(const SlideConfig* config, const uint16_t* from, const uint16_t* to);
+
+void SLIDE_GetDefaultConfig(SlideConfig* config) {
+    if (!config) return;
+    memset(config, 0, sizeof(SlideConfig));
+    config->transition = SLIDE_TRANSITION_SLIDE;
+    config->transition_ms = 300;
+    config->transition_steps = 16;
+    config->dwell_ms = 5000;
+    config->scale_mode = PIC_SCALE_NEAREST;
+    config->preload_previous = false;
+}
+
+SlideError SLIDE_Open(const char* file_path, const SlideConfig* config, SlideDeck_t* handle) {
+    if (!file_path || !handle) {
+        g_last_error = SLIDE_ERROR_INVALID_PARAM;
+        return g_last_error;
+    }
+
+    const char* slash = strrchr(file_path, '/');
+    size_t dir_len = slash ? (size_t)(slash - file_path) : 0;
+    if (dir_len >= SLIDE_PATH_MAX) {
+        g_last_error = SLIDE_ERROR_INVALID_PARAM;
+        return g_last_error;
+    }
+
+    SlideDeck* deck = (SlideDeck*)malloc(sizeof(SlideDeck));
+    if (!deck) {
+        g_last_error = SLIDE_ERROR_MEMORY_ALLOC;
+        return g_last_error;
+    }
+    memset(deck, 0, sizeof(SlideDeck));
+
+    if (config) {
+        deck->config = *config;
+    }
+    else {
+        SLIDE_GetDefaultConfig(&deck->config);
+    }
+    if (deck->config.transition_steps == 0) deck->config.transition_steps = 1;
+
+    // 根目录下的文件路径形如"/a.jpg"，目录部分为"/"
+    if (dir_len == 0) {
+        strcpy(deck->dir_path, slash ? "/" : "");
+    }
+    else {
+        memcpy(deck->dir_path, file_path, dir_len);
+        deck->dir_path[dir_len] = '\0';
+    }
+
+    SlideError error = scan_directory(deck, slash ? slash + 1 : file_path);
+    if (error != SLIDE_SUCCESS) {
+        SLIDE_Close(deck);
+        g_last_error = error;
+        return error;
+    }
+
+    alloc_frames(deck);
+    deck->current_slot = SLIDE_NO_IMAGE;
+    deck->shown_tick = HAL_GetTick();
+
+    *handle = deck;
+    g_last_error = SLIDE_SUCCESS;
+    return SLIDE_SUCCESS;
+}
+
+void SLIDE_Close(SlideDeck_t handle) {
+    if (!handle) return;
+
+    for (uint16_t i = 0; i < handle->count; i++) {
+        free(handle->names[i]);
+    }
+    for (uint8_t i = 0; i < SLIDE_MAX_FRAMES; i++) {
+        if (handle->frame_owned[i]) free(handle->frames[i]);
+    }
+    free(handle);
+}
+
+SlideError SLIDE_Show(SlideDeck_t handle) {
+    if (!handle) {
+        g_last_error = SLIDE_ERROR_INVALID_PARAM;
+        return g_last_error;
+    }
+    g_last_error = show_image(handle, handle->index, true, false);
+    return g_last_error;
+}
+
+SlideError SLIDE_Next(SlideDeck_t handle) {
+    if (!handle) {
+        g_last_error = SLIDE_ERROR_INVALID_PARAM;
+        return g_last_error;
+    }
+    g_last_error = show_image(handle, (handle->index + 1) % handle->count, true, true);
+    return g_last_error;
+}
+
+SlideError SLIDE_Prev(SlideDeck_t handle) {
+    if (!handle) {
+        g_last_error = SLIDE_ERROR_INVALID_PARAM;
+        return g_last_error;
+    }
+    g_last_error = show_image(handle, (handle->index + handle->count - 1) % handle->count, false, true);
+    return g_last_error;
+}
+
+bool SLIDE_Poll(SlideDeck_t handle) {
+    if (!handle) return false;
+
+    if (handle->count > 1 && handle->config.dwell_ms > 0 && !handle->paused &&
+        HAL_GetTick() - handle->shown_tick >= handle->config.dwell_ms) {
+        SLIDE_Next(handle);
+        return true;
+    }
+
+    // 预加载：先下一张，再上一张；都已在帧缓冲区中时什么也不做
+    if (handle->frame_count == 0 || handle->count < 2) return false;
+
+    uint16_t next = (handle->index + 1) % handle->count;
+    uint16_t prev = (handle->index + handle->count - 1) % handle->count;
+    if (find_slot(handle, next) < 0) {
+        decode_into(handle, pick_slot(handle, handle->frame_count > 2 ? prev : SLIDE_NO_IMAGE), next);
+    }
+    else if (handle->config.preload_previous && handle->frame_count > 2 && find_slot(handle, prev) < 0) {
+        decode_into(handle, pick_slot(handle, next), prev);
+    }
+    return false;
+}
+
+void SLIDE_SetPaused(SlideDeck_t handle, bool paused) {
+    if (!handle) return;
+    handle->paused = paused;
+    if (!paused) handle->shown_tick = HAL_GetTick();
+}
+
+uint16_t SLIDE_GetIndex(SlideDeck_t handle) {
+    return handle ? handle->index : 0;
+}
+
+uint16_t SLIDE_GetCount(SlideDeck_t handle) {
+    return handle ? handle->count : 0;
+}
+
+uint8_t SLIDE_GetFrameCount(SlideDeck_t handle) {
+    return handle ? handle->frame_count : 0;
+}
+
+const char* SLIDE_GetName(SlideDeck_t handle, uint16_t index) {
+    if (!handle || index >= handle->count) return nullptr;
+    return handle->names[index];
+}
+
+const char* SLIDE_GetErrorString(SlideError error) {
+    if (error < 0 || error >= sizeof(error_strings) / sizeof(error_strings[0])) {
+        return "未知错误";
+    }
+    return error_strings[error];
+}
+
+SlideError SLIDE_GetLastError(void) {
+    return g_last_error;
+}
+
+static void join_path(char* buf, size_t size, const char* dir, const char* name) {
+    size_t len = strlen(dir);
+    if (len == 0) {
+        snprintf(buf, size, "%s", name);
+    }
+    else if (dir[len - 1] == '/') {
+        snprintf(buf, size, "%s%s", dir, name);
+    }
+    else {
+        snprintf(buf, size, "%s/%s", dir, name);
+    }
+}
+
+// 按目录顺序收集支持的图片，起始图片总是包含在列表中
+static SlideError scan_directory(SlideDeck* deck, const char* start_name) {
+    DIR dir;
+    FILINFO info;
+    if (f_opendir(&dir, deck->dir_path) != FR_OK) return SLIDE_ERROR_DIR_OPEN;
+
+    bool found = false;
+    while (f_readdir(&dir, &info) == FR_OK && info.fname[0] != '\0') {
+        if (info.fattrib & AM_DIR) continue;
+        if (!PIC_IsSupportedFormat(info.fname)) continue;
+
+        bool is_start = strcmp(info.fname, start_name) == 0;
+        if (deck->count >= SLIDE_MAX_IMAGES) {
+            if (found || !is_start) continue;
+            // 列表已满但还没遇到起始图片，用它替换最后一项
+            free(deck->names[--deck->count]);
+        }
+
+        char* name = strdup(info.fname);
+        if (!name) {
+            f_closedir(&dir);
+            return SLIDE_ERROR_MEMORY_ALLOC;
+        }
+        if (is_start) {
+            deck->index = deck->count;
+            found = true;
+        }
+        deck->names[deck->count++] = name;
+    }
+    f_closedir(&dir);
+
+    return deck->count > 0 ? SLIDE_SUCCESS : SLIDE_ERROR_NO_IMAGES;
+}
+
+// 分配帧缓冲区：外部提供的直接使用，其余按需malloc，每个都要在堆中留出SLIDE_DECODE_RESERVE字节给解码器，
+// 留不出来时放弃这个帧缓冲区；一个都没有时退化为直接流式显示
+static void alloc_frames(SlideDeck* deck) {
+    uint8_t wanted = deck->config.preload_previous ? 3 : 2;
+    if (deck->count < 2) wanted = 1;
+
+    for (uint8_t i = 0; i < wanted; i++) {
+        uint16_t* frame = deck->config.frame_buffers[i];
+        if (!frame) {
+            frame = (uint16_t*)malloc(SLIDE_FRAME_PIXELS * sizeof(uint16_t));
+            if (!frame) break;
+            void* reserve = malloc(SLIDE_DECODE_RESERVE);
+            if (!reserve) {
+                free(frame);
+                break;
+            }
+            free(reserve);
+            deck->frame_owned[i] = true;
+        }
+        deck->frames[i] = frame;
+        deck->frame_image[i] = SLIDE_NO_IMAGE;
+        deck->frame_count++;
+    }
+}
+
+static int find_slot(const SlideDeck* deck, uint16_t image) {
+    for (uint8_t i = 0; i < deck->frame_count; i++) {
+        if (deck->frame_image[i] == image) return i;
+    }
+    return -1;
+}
+
+// 选择用于解码的帧缓冲区：不覆盖正在显示的帧，优先使用空闲的，其次不保留keep_image的
+static int pick_slot(const SlideDeck* deck, int32_t keep_image) {
+    int fallback = -1;
+    for (uint8_t i = 0; i < deck->frame_count; i++) {
+        if (i == deck->current_slot) continue;
+        if (deck->frame_image[i] == SLIDE_NO_IMAGE) return i;
+        if (deck->frame_image[i] != keep_image) return i;
+        if (fallback < 0) fallback = i;
+    }
+    return fallback;
+}
+
+static void decode_into(SlideDeck* deck, int slot, uint16_t image) {
+    if (slot < 0) return;
+
+    char path[SLIDE_PATH_MAX];
+    join_path(path, sizeof(path), deck->dir_path, deck->names[image]);
+
+    // 需要旋转90/270度的图片按交换后的宽高解码，像素数相同，显示时由LCD完成旋转
+    uint8_t turns = PIC_GetExifRotation(path);
+    uint16_t width = (turns & 1) ? ST7735_GetHeight() : ST7735_GetWidth();
+    uint16_t height = (turns & 1) ? ST7735_GetWidth() : ST7735_GetHeight();
+
+    deck->frame_image[slot] = image;
+    deck->frame_turns[slot] = turns;
+    deck->frame_valid[slot] = PIC_DecodeToBuffer(path, deck->frames[slot], width, height,
+                                                 deck->config.scale_mode) == PIC_SUCCESS;
+}
+
+static SlideError show_image(SlideDeck* deck, uint16_t image, bool forward, bool animate) {
+    int slot = find_slot(deck, image);
+    if (slot < 0 && deck->frame_count > 0) {
+        // 没有预加载（快速连续切换或刚打开），同步解码
+        slot = pick_slot(deck, SLIDE_NO_IMAGE);
+        decode_into(deck, slot, image);
+    }
+
+    SlideError error = SLIDE_SUCCESS;
+    if (slot >= 0 && deck->frame_valid[slot]) {
+        const uint16_t* to = deck->frames[slot];
+        const uint16_t* from = deck->current_slot >= 0 ? deck->frames[deck->current_slot] : nullptr;
+        // 擦除只发送新图片，只有一个帧缓冲区（没有旧图片）时也可以使用
+        SlideTransition transition = deck->config.transition;
+        if (!animate || (!from && transition != SLIDE_TRANSITION_WIPE)) transition = SLIDE_TRANSITION_NONE;
+        // 过渡动画要求两帧的行布局相同，任意一帧需要旋转时直接切换
+        if (deck->frame_turns[slot] || (from && deck->frame_turns[deck->current_slot])) {
+            transition = SLIDE_TRANSITION_NONE;
+        }
+
+        switch (transition) {
+            case SLIDE_TRANSITION_WIPE:
+                transition_wipe(&deck->config, to, forward);
+                break;
+            case SLIDE_TRANSITION_SLIDE:
+                transition_slide(&deck->config, from, to, forward);
+                break;
+            case SLIDE_TRANSITION_FADE:
+                if (transition_fade(&deck->config, from, to)) break;
+                // 条带缓冲区分配失败时直接显示
+            default:
+                lcd_send_frame(to, deck->frame_turns[slot]);
+                break;
+        }
+        // 只有一个帧缓冲区时屏幕已经保存了这张图片，帧缓冲区空出来预加载下一张
+        deck->current_slot = deck->frame_count > 1 ? (int8_t)slot : SLIDE_NO_IMAGE;
+    }
+    else {
+        // 帧缓冲区不可用或解码失败（如内存不足），按原始尺寸直接流式显示
+        ST7735_FillScreenFast(ST7735_BLACK);
+        char path[SLIDE_PATH_MAX];
+        join_path(path, sizeof(path), deck->dir_path, deck->names[image]);
+        if (PIC_DisplayStreamingDMA(path, 0, 0, 0, 0, 0, 0) != PIC_SUCCESS) {
+            error = SLIDE_ERROR_DECODE_FAILED;
+        }
+        deck->current_slot = SLIDE_NO_IMAGE;
+    }
+
+    deck->index = image;
+    deck->shown_tick = HAL_GetTick();
+    return error;
+}
+
+static void lcd_wait_dma(void) {
+    while (HAL_SPI_GetState(&ST7735_SPI_PORT) != HAL_SPI_STATE_READY);
+    while (__HAL_SPI_GET_FLAG(&ST7735_SPI_PORT, SPI_FLAG_BSY));
+}
+
+// 发送帧缓冲区中连续的若干整行（整帧20480个像素，一次16位DMA即可完成）
+static void lcd_send_rows(uint16_t y, uint16_t rows, const uint16_t* pixels) {
+    const uint16_t width = ST7735_GetWidth();
+    if (rows == 0) return;
+    ST7735_Select();
+    ST7735_SetAddressWindow(0, y, width - 1, y + rows - 1);
+    ST7735_WritePixelsDMA(pixels, (uint32_t)rows * width);
+    lcd_wait_dma();
+    ST7735_Unselect();
+}
+
+// 按帧的旋转临时改写扫描方向后整帧发送，发送完恢复原方向，GRAM中的内容保持旋转后的样子
+static void lcd_send_frame(const uint16_t* pixels, uint8_t turns) {
+    ST7735_Rotation previous = ST7735_GetRotation();
+    if (turns) ST7735_SetRotation((ST7735_Rotation)((previous + turns) & 3));
+    lcd_send_rows(0, ST7735_GetHeight(), pixels);
+    if (turns) ST7735_SetRotation(previous);
+}
+
+// 等待到第step步的时间点，使过渡总时长与SPI速度无关
+static void wait_step(uint32_t start, const SlideConfig* config, uint8_t step) {
+    uint32_t target = start + (uint32_t)config->transition_ms * step / config->transition_steps;
+    while ((int32_t)(HAL_GetTick() - target) < 0);
+}
+
+// 擦除：每一步只发送新图片中新露出的行带，直接从帧缓冲区DMA
+static void transition_wipe(const SlideConfig* config, const uint16_t* to, bool forward) {
+    const uint16_t width = ST7735_GetWidth(), height = ST7735_GetHeight();
+    uint32_t start = HAL_GetTick();
+    uint16_t done = 0;
+    for (uint8_t step = 1; step <= config->transition_steps; step++) {
+        uint16_t edge = (uint16_t)((uint32_t)height * step / config->transition_steps);
+        uint16_t y = forward ? done : height - edge;
+        lcd_send_rows(y, edge - done, to + (uint32_t)y * width);
+        done = edge;
+        wait_step(start, config, step);
+    }
+}
+
+// 滑动：下一张从底部推入（上一张从顶部推入），每一步两个窗口各一次DMA，不需要拼接缓冲区
+static void transition_slide(const SlideConfig* config, const uint16_t* from, const uint16_t* to, bool forward) {
+    const uint16_t width = ST7735_GetWidth(), height = ST7735_GetHeight();
+    uint32_t start = HAL_GetTick();
+    for (uint8_t step = 1; step <= config->transition_steps; step++) {
+        uint16_t offset = (uint16_t)((uint32_t)height * step / config->transition_steps);
+        uint16_t rest = height - offset;
+        if (forward) {
+            lcd_send_rows(0, rest, from + (uint32_t)offset * width);
+            lcd_send_rows(rest, offset, to);
+        }
+        else {
+            lcd_send_rows(0, offset, to + (uint32_t)rest * width);
+            lcd_send_rows(offset, rest, from);
+        }
+        wait_step(start, config, step);
+    }
+}
+
+// 把RGB565展开为 00000GGG GGG00000 RRRRR000 000BBBBB，各分量之间留出乘5位权重的空间
+static inline uint32_t fade_expand(uint16_t p) {
+    return (p | ((uint32_t)p << 16)) & 0x07E0F81F;
+}
+
+static inline uint16_t fade_pack(uint32_t v) {
+    return (uint16_t)((v | (v >> 16)) & 0xFFFF);
+}
+
+// 淡入淡出：逐条带混合两帧，混合下一条带时上一条带正在DMA发送
+static bool transition_fade(const SlideConfig* config, const uint16_t* from, const uint16_t* to) {
+    const uint16_t width = ST7735_GetWidth(), height = ST7735_GetHeight();
+    const uint32_t strip_pixels = (uint32_t)width * SLIDE_FADE_STRIP_ROWS;
+    uint16_t* strips[2];
+    strips[0] = (uint16_t*)malloc(strip_pixels * sizeof(uint16_t));
+    strips[1] = (uint16_t*)malloc(strip_pixels * sizeof(uint16_t));
+    if (!strips[0] || !strips[1]) {
+        free(strips[0]);
+        free(strips[1]);
+        return false;
+    }
+
+    uint32_t start = HAL_GetTick();
+    for (uint8_t step = 1; step < config->transition_steps; step++) {
+        uint32_t alpha = 32 * step / config->transition_steps;
+        uint8_t index = 0;
+
+        ST7735_Select();
+        ST7735_SetAddressWindow(0, 0, width - 1, height - 1);
+
+        for (uint16_t y = 0; y < height; y += SLIDE_FADE_STRIP_ROWS) {
+            uint16_t rows = height - y < SLIDE_FADE_STRIP_ROWS ? height - y : SLIDE_FADE_STRIP_ROWS;
+            uint32_t count = (uint32_t)rows * width;
+            const uint16_t* a = from + (uint32_t)y * width;
+            const uint16_t* b = to + (uint32_t)y * width;
+            uint16_t* out = strips[index];
+
+            for (uint32_t i = 0; i < count; i++) {
+                uint32_t va = fade_expand(a[i]);
+                uint32_t vb = fade_expand(b[i]);
+                out[i] = fade_pack(((va * (32 - alpha) + vb * alpha) >> 5) & 0x07E0F81F);
+            }
+
+            lcd_wait_dma();
+            ST7735_WritePixelsDMA(out, count);
+            index ^= 1;
+        }
+
+        lcd_wait_dma();
+        ST7735_Unselect();
+        wait_step(start, config, step);
+    }
+
+    free(strips[0]);
+    free(strips[1]);
+    lcd_send_rows(0, height, to);
+    return true;
+}
@@ -0,0 +1,278 @@
+//
+// 幻灯片播放器类型定义和接口
+// 在显示当前图片的空闲时间把下一张（可选上一张）解码到全屏帧缓冲区，切换时只需一次DMA或一段过渡动画
+//
+
+#ifndef SD_AND_LCD2_SLIDESHOW_H
+#define SD_AND_LCD2_SLIDESHOW_H
+
+#include "pic_types.h"
+#include "st7735.h"
+
+#ifdef __cplusplus
+extern "C" {
+#else
+#include <stdint.h>
+#include <stdbool.h>
+#endif
+
+#define SLIDE_MAX_IMAGES 128
+// 单个目录最多播放的图片数量
+
+#define SLIDE_MAX_FRAMES 3
+// 帧缓冲区数量上限（当前、下一张、上一张）
+
+#define SLIDE_FRAME_PIXELS ((uint32_t)ST7735_WIDTH * ST7735_HEIGHT)
+// 每个帧缓冲区的像素数（按屏幕的逻辑尺寸，可能比画布大，如161x129的屏幕）
+
+#define SLIDE_DECODE_RESERVE (32768 + 4096)
+// 分配帧缓冲区后至少留给解码器的连续堆内存（PNG最大32KB的解压窗口加行缓冲区），留不出来时少分配一个帧缓冲区
+
+#define SLIDE_FADE_STRIP_ROWS 8
+// 淡入淡出时每个混合条带的行数，两个条带轮流进行DMA发送
+
+#define SLIDE_PATH_MAX 256
+// 目录路径和文件路径的最大长度
+
+// 错误码定义
+typedef enum {
+    SLIDE_SUCCESS = 0,
+    SLIDE_ERROR_INVALID_PARAM,
+    SLIDE_ERROR_DIR_OPEN,
+    SLIDE_ERROR_NO_IMAGES,
+    SLIDE_ERROR_MEMORY_ALLOC,
+    SLIDE_ERROR_DECODE_FAILED
+} SlideError;
+
+// 切换过渡效果
+typedef enum {
+    SLIDE_TRANSITION_NONE = 0,  // 直接整帧DMA
+    SLIDE_TRANSITION_WIPE,      // 新图片按行带逐步覆盖旧图片
+    SLIDE_TRANSITION_SLIDE,     // 新图片把旧图片沿垂直方向推出屏幕
+    SLIDE_TRANSITION_FADE       // 交叉淡入淡出（RGB565 SWAR混合）
+} SlideTransition;
+
+// 播放配置
+typedef struct {
+    SlideTransition transition;
+    uint16_t transition_ms;     // 过渡动画总时长（毫秒）
+    uint8_t transition_steps;   // 过渡动画步数
+    uint32_t dwell_ms;          // 每张图片的停留时间，0表示不自动切换
+    PicScaleMode scale_mode;    // 解码到帧缓冲区时的插值方式
+    bool preload_previous;      // 同时预加载上一张（需要第三个帧缓冲区）
+    uint16_t* frame_buffers[SLIDE_MAX_FRAMES];
+    // 外部提供的帧缓冲区（如画布借出的内存，见Canvas::LendMemory），每个至少SLIDE_FRAME_PIXELS个像素，
+    // 为NULL的由内部分配；内容会被覆盖
+} SlideConfig;
+
+// 幻灯片句柄
+typedef struct SlideDeck* SlideDeck_t;
+
+/**
+ * @brief 获取默认配置（滑动过渡，5秒停留，最近邻插值，不预加载上一张）
+ * @param config 返回的配置
+ */
+void SLIDE_GetDefaultConfig(SlideConfig* config);
+
+/**
+ * @brief 打开图片所在目录，按目录顺序播放其中所有支持的图片
+ * @param file_path 起始图片的完整路径（GBK编码）
+ * @param config 播放配置，为NULL时使用默认配置
+ * @param handle 返回的幻灯片句柄
+ * @return 成功返回SLIDE_SUCCESS，失败返回错误码
+ * @note 内部分配帧缓冲区时保留SLIDE_DECODE_RESERVE字节给解码器。只有一个帧缓冲区时屏幕保存当前图片，
+ *       帧缓冲区用于预加载下一张，过渡效果只有擦除（不需要旧图片），其余直接切换；
+ *       没有帧缓冲区时退化为直接流式显示，没有预加载和过渡效果
+ */
+SlideError SLIDE_Open(const char* file_path, const SlideConfig* config, SlideDeck_t* handle);
+
+/**
+ * @brief 关闭幻灯片并释放内部分配的缓冲区
+ * @param handle 幻灯片句柄
+ */
+void SLIDE_Close(SlideDeck_t handle);
+
+/**
+ * @brief 显示当前图片（不使用过渡效果），通常在打开后调用一次
+ * @param handle 幻灯片句柄
+ * @return 成功返回SLIDE_SUCCESS，失败返回错误码
+ */
+SlideError SLIDE_Show(SlideDeck_t handle);
+
+/**
+ * @brief 切换到下一张图片（末尾回到第一张）
+ * @param handle 幻灯片句柄
+ * @return 成功返回SLIDE_SUCCESS，失败返回错误码
+ * @note 已预加载时只需过渡动画的DMA传输；未预加载时先同步解码
+ */
+SlideError SLIDE_Next(SlideDeck_t handle);
+
+/**
+ * @brief 切换到上一张图片（第一张回到末尾）
+ * @param handle 幻灯片句柄
+ * @return 成功返回SLIDE_SUCCESS，失败返回错误码
+ */
+SlideError SLIDE_Prev(SlideDeck_t handle);
+
+/**
+ * @brief 在空闲时调用：停留时间到达后自动切换，否则预加载一张相邻图片
+ * @param handle 幻灯片句柄
+ * @return 本次调用切换了图片返回true，否则返回false
+ * @note 每次调用最多解码一张图片，解码期间不占用SPI
+ */
+bool SLIDE_Poll(SlideDeck_t handle);
+
+/**
+ * @brief 暂停或恢复自动切换，恢复时重新开始计时
+ * @param handle 幻灯片句柄
+ * @param paused 是否暂停
+ */
+void SLIDE_SetPaused(SlideDeck_t handle, bool paused);
+
+/**
+ * @brief 获取当前图片的序号
+ * @param handle 幻灯片句柄
+ * @return 序号（从0开始）
+ */
+uint16_t SLIDE_GetIndex(SlideDeck_t handle);
+
+/**
+ * @brief 获取图片数量
+ * @param handle 幻灯片句柄
+ * @return 图片数量
+ */
+uint16_t SLIDE_GetCount(SlideDeck_t handle);
+
+/**
+ * @brief 获取帧缓冲区数量
+ * @param handle 幻灯片句柄
+ * @return 帧缓冲区数量，0表示直接流式显示
+ */
+uint8_t SLIDE_GetFrameCount(SlideDeck_t handle);
+
+/**
+ * @brief 获取图片文件名
+ * @param handle 幻灯片句柄
+ * @param index 序号
+ * @return 文件名（GBK编码，不含目录），序号无效时返回NULL
+ */
+const char* SLIDE_GetName(SlideDeck_t handle, uint16_t index);
+
+/**
+ * @brief 获取错误信息字符串
+ * @param error 错误码
+ * @return 错误信息字符串
+ */
+const char* SLIDE_GetErrorString(SlideError error);
+
+/**
+ * @brief 获取最后发生的错误
+ * @return 最后发生的错误码
+ */
+SlideError SLIDE_GetLastError(void);
+
+#ifdef __cplusplus
+
+class Slideshow {
+private:
+    SlideDeck_t handle;
+
+public:
+    Slideshow() : handle(nullptr) {}
+
+    explicit Slideshow(const char* file_path, const SlideConfig* config = nullptr) : handle(nullptr) {
+        Open(file_path, config);
+    }
+
+    ~Slideshow() {
+        Close();
+    }
+
+    bool Open(const char* file_path, const SlideConfig* config = nullptr) {
+        Close();
+        return SLIDE_Open(file_path, config, &handle) == SLIDE_SUCCESS;
+    }
+
+    void Close() {
+        if (handle) {
+            SLIDE_Close(handle);
+            handle = nullptr;
+        }
+    }
+
+    [[nodiscard]] bool IsOpen() const {
+        return handle != nullptr;
+    }
+
+    bool Show() const {
+        if (!handle) return false;
+        return SLIDE_Show(handle) == SLIDE_SUCCESS;
+    }
+
+    bool Next() const {
+        if (!handle) return false;
+        return SLIDE_Next(handle) == SLIDE_SUCCESS;
+    }
+
+    bool Prev() const {
+        if (!handle) return false;
+        return SLIDE_Prev(handle) == SLIDE_SUCCESS;
+    }
+
+    bool Poll() const {
+        if (!handle) return false;
+        return SLIDE_Poll(handle);
+    }
+
+    void SetPaused(bool paused) const {
+        if (handle) SLIDE_SetPaused(handle, paused);
+    }
+
+    [[nodiscard]] uint16_t GetIndex() const {
+        return handle ? SLIDE_GetIndex(handle) : 0;
+    }
+
+    [[nodiscard]] uint16_t GetCount() const {
+        return handle ? SLIDE_GetCount(handle) : 0;
+    }
+
+    [[nodiscard]] uint8_t GetFrameCount() const {
+        return handle ? SLIDE_GetFrameCount(handle) : 0;
+    }
+
+    [[nodiscard]] const char* GetName(uint16_t index) const {
+        return handle ? SLIDE_GetName(handle, index) : nullptr;
+    }
+
+    static SlideError GetLastError() {
+        return SLIDE_GetLastError();
+    }
+
+    static const char* GetErrorString() {
+        return SLIDE_GetErrorString(GetLastError());
+    }
+
+    Slideshow(const Slideshow&) = delete;
+    Slideshow& operator=(const Slideshow&) = delete;
+
+    Slideshow(Slideshow&& other) noexcept : handle(other.handle) {
+        other.handle = nullptr;
+    }
+
+    Slideshow& operator=(Slideshow&& other) noexcept {
+        if (this != &other) {
+            Close();
+            handle = other.handle;
+            other.handle = nullptr;
+        }
+        return *this;
+    }
+};
+
+#endif // __cplusplus
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SD_AND_LCD2_SLIDESHOW_H
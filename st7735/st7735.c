@@ -5,7 +5,88 @@
 
 #define DELAY 0x80
 
-uint8_t st7735_line_buffer[ST7735_LINE_BUFFER_SIZE];
+#define ST7735_MADCTL_DIRECTION (ST7735_MADCTL_MX | ST7735_MADCTL_MY | ST7735_MADCTL_MV)
+
+// 按顺时针顺序排列的四个扫描方向，默认方向在表中的位置由ST7735_ROTATION决定
+static const uint8_t rotation_madctl[4] = {
+    ST7735_MADCTL_MX | ST7735_MADCTL_MY,
+    ST7735_MADCTL_MY | ST7735_MADCTL_MV,
+    0,
+    ST7735_MADCTL_MX | ST7735_MADCTL_MV
+};
+
+// 队列中的事务：窗口坐标和命令字节都复制到这里，DMA直接从SRAM发送
+typedef struct {
+    uint8_t commands[3];        // CASET、RASET、命令
+    uint8_t caset[4];
+    uint8_t raset[4];
+    uint8_t args[ST7735_QUEUE_ARGS_MAX];
+    bool set_window;
+    bool has_command;
+    bool pixels;
+    bool fill;
+    bool packed;                // 提交时处于12位模式的像素数据，发送时打包为RGB444
+    uint16_t color;             // 纯色填充时data指向这里
+    const uint8_t* data;
+    uint32_t length;
+    uint16_t repeat;
+    uint32_t stride;            // 每次重复后data前进的字节数
+    ST7735_QueueCallback callback;
+    void* user;
+} ST7735_QueueSlot;
+
+// 每个事务依次经过的发送阶段，不需要的阶段直接跳过
+typedef enum {
+    QUEUE_STAGE_TAIL = 0,       // 12位模式下先发送上一段像素剩下的半组
+    QUEUE_STAGE_CASET,
+    QUEUE_STAGE_CASET_DATA,
+    QUEUE_STAGE_RASET,
+    QUEUE_STAGE_RASET_DATA,
+    QUEUE_STAGE_COMMAND,
+    QUEUE_STAGE_DATA
+} ST7735_QueueStage;
+
+#define ST7735_QUEUE_CHUNK 0xFFFF
+// 单次DMA的最大帧数（NDTR为16位），更长的数据分块发送；16位帧时一帧为两个字节
+
+static ST7735_QueueSlot queue_slots[ST7735_QUEUE_DEPTH];
+static volatile uint8_t queue_head = 0;     // 正在发送的事务，只由中断修改
+static volatile uint8_t queue_tail = 0;     // 下一个空位，只由提交者修改
+static volatile bool queue_running = false;
+static uint8_t queue_stage = QUEUE_STAGE_TAIL;
+static uint32_t queue_offset = 0;
+static uint16_t queue_sent = 0;
+
+static ST7735_Rotation st7735_rotation = ST7735_ROTATE_0;
+static uint16_t st7735_width = ST7735_WIDTH;
+static uint16_t st7735_height = ST7735_HEIGHT;
+static uint8_t st7735_xstart = ST7735_XSTART;
+static uint8_t st7735_ystart = ST7735_YSTART;
+static uint8_t st7735_madctl = ST7735_ROTATION;
+
+// 硬件滚动区域（滚动轴上的逻辑坐标，length为0表示没有定义）和区域起点对应的GRAM行号
+static uint16_t scroll_start = 0;
+static uint16_t scroll_length = 0;
+static uint16_t scroll_offset = 0;
+static uint16_t scroll_tfa = 0;
+
+// SPI当前是否为16位帧（CubeMX初始化为8位）
+static bool st7735_frame16 = false;
+
+static ST7735_ColorMode st7735_color_mode = ST7735_COLOR_16BIT;
+
+// 12位模式的乒乓打包缓冲区：DMA发送一块时在中断中打包下一块
+static uint8_t pack_buffers[2][ST7735_PACK_PIXELS * 3 / 2];
+static uint8_t pack_index = 0;
+static uint16_t pack_ready = 0;             // 已打包好、等待发送的字节数
+static bool pack_started = false;
+// 两个像素才凑成整数个字节，奇数个像素的最后一个暂存到下一段像素数据；遇到命令之前补齐单独发送
+static uint16_t pack_carry;
+static bool pack_has_carry = false;
+static uint8_t pack_tail[2];
+
+// 每次设置地址窗口或改变方向时递增，供画布判断屏幕内容是否被其他模块改写
+static volatile uint32_t st7735_write_serial = 0;
 
 // based on Adafruit ST7735 library for Arduino
 static const uint8_t
@@ -102,16 +183,154 @@ static void ST7735_Reset() {
     HAL_Delay(200);
 }
 
+static void ST7735_WaitSPI(void) {
+    while (HAL_SPI_GetState(&ST7735_SPI_PORT) != HAL_SPI_STATE_READY);
+    while (__HAL_SPI_GET_FLAG(&ST7735_SPI_PORT, SPI_FLAG_BSY));
+}
+
+// 切换SPI帧宽度和发送DMA的数据宽度。DFF只能在SPI关闭时修改；DMA流在两次传输之间是关闭的，
+// 而HAL_DMA_Start不会重写PSIZE/MSIZE，所以直接改寄存器并同步Init中的值
+static void ST7735_SetFrame16(bool enable) {
+    if (st7735_frame16 == enable) return;
+
+    SPI_HandleTypeDef* hspi = &ST7735_SPI_PORT;
+    DMA_HandleTypeDef* hdma = hspi->hdmatx;
+    ST7735_WaitSPI();
+
+    __HAL_SPI_DISABLE(hspi);
+    if (enable) {
+        SET_BIT(hspi->Instance->CR1, SPI_CR1_DFF);
+        hspi->Init.DataSize = SPI_DATASIZE_16BIT;
+        hdma->Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+        hdma->Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
+    }
+    else {
+        CLEAR_BIT(hspi->Instance->CR1, SPI_CR1_DFF);
+        hspi->Init.DataSize = SPI_DATASIZE_8BIT;
+        hdma->Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+        hdma->Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    }
+    MODIFY_REG(hdma->Instance->CR, DMA_SxCR_PSIZE | DMA_SxCR_MSIZE,
+               hdma->Init.PeriphDataAlignment | hdma->Init.MemDataAlignment);
+    __HAL_SPI_ENABLE(hspi);
+
+    st7735_frame16 = enable;
+}
+
+// 打开或关闭发送DMA的存储器地址递增，关闭时同一个字被重复发送；同样只能在DMA流关闭时调用
+static void ST7735_SetMemoryIncrement(bool enable) {
+    DMA_HandleTypeDef* hdma = ST7735_SPI_PORT.hdmatx;
+    uint32_t minc = enable ? DMA_MINC_ENABLE : DMA_MINC_DISABLE;
+    if (hdma->Init.MemInc == minc) return;
+
+    hdma->Init.MemInc = minc;
+    MODIFY_REG(hdma->Instance->CR, DMA_SxCR_MINC, minc);
+}
+
+// 两个RGB565像素（一个32位字）同时取各分量的高4位，低半字和高半字各得到一个12位的RGB444
+#define ST7735_RGB444_PAIR(w) ((((w) >> 4) & 0x0F000F00u) | (((w) >> 3) & 0x00F000F0u) | (((w) >> 1) & 0x000F000Fu))
+
+uint32_t ST7735_PackRGB444(const uint16_t* src, uint8_t* dst, uint32_t count) {
+    uint8_t* out = dst;
+    uint32_t words[4], packed[3];
+
+    // 每次读四个字（八个像素），拼成三个字写出；M4支持非对齐的字访问，memcpy会编译为LDR/STR
+    for (; count >= 8; count -= 8, src += 8, out += 12) {
+        memcpy(words, src, sizeof(words));
+        uint32_t t[4];
+        for (uint8_t i = 0; i < 4; i++) {
+            uint32_t v = ST7735_RGB444_PAIR(words[i]);
+            t[i] = ((v & 0xFFF) << 12) | (v >> 16);
+        }
+        packed[0] = __REV((t[0] << 8) | (t[1] >> 16));
+        packed[1] = __REV((t[1] << 16) | (t[2] >> 8));
+        packed[2] = __REV((t[2] << 24) | t[3]);
+        memcpy(out, packed, sizeof(packed));
+    }
+    for (; count >= 2; count -= 2, src += 2, out += 3) {
+        memcpy(words, src, sizeof(uint32_t));
+        uint32_t v = ST7735_RGB444_PAIR(words[0]);
+        out[0] = (uint8_t)(v >> 4);
+        out[1] = (uint8_t)((v << 4) | ((v >> 24) & 0x0F));
+        out[2] = (uint8_t)(v >> 16);
+    }
+    if (count) {
+        uint32_t v = ST7735_RGB444_PAIR((uint32_t)*src);
+        out[0] = (uint8_t)(v >> 4);
+        out[1] = (uint8_t)(v << 4);
+        out += 2;
+    }
+    return (uint32_t)(out - dst);
+}
+
+// 补4位0发送暂存的像素，只在队列空闲时调用
+static void ST7735_FlushCarry(void) {
+    if (!pack_has_carry) return;
+    pack_has_carry = false;
+    ST7735_PackRGB444(&pack_carry, pack_tail, 1);
+    ST7735_SetFrame16(false);
+    ST7735_DC_HIGH();
+    HAL_SPI_Transmit(&ST7735_SPI_PORT, pack_tail, sizeof(pack_tail), HAL_MAX_DELAY);
+}
+
 void ST7735_WriteCommand(uint8_t cmd) {
+    ST7735_QueueFlush();
+    ST7735_FlushCarry();
+    ST7735_SetFrame16(false);
     ST7735_DC_LOW();
     HAL_SPI_Transmit(&ST7735_SPI_PORT, &cmd, sizeof(cmd), HAL_MAX_DELAY);
 }
 
 void ST7735_WriteData(uint8_t* buff, size_t buff_size) {
+    ST7735_QueueFlush();
+    ST7735_FlushCarry();
+    ST7735_SetFrame16(false);
     ST7735_DC_HIGH();
     HAL_SPI_Transmit(&ST7735_SPI_PORT, buff, buff_size, HAL_MAX_DELAY);
 }
 
+// 12位模式下的像素写入：提交一个只有数据的事务，由中断打包发送，接在当前窗口的像素流之后
+static void ST7735_QueuePixels(const uint16_t* pixels, uint32_t count) {
+    ST7735_Transaction transaction = { 0 };
+    transaction.data = (const uint8_t*)pixels;
+    transaction.length = count * sizeof(uint16_t);
+    transaction.pixels = true;
+    ST7735_QueueSubmit(&transaction);
+}
+
+void ST7735_WritePixels(const uint16_t* pixels, size_t count) {
+    if (st7735_color_mode == ST7735_COLOR_12BIT) {
+        ST7735_QueuePixels(pixels, count);
+        ST7735_QueueFlush();
+        return;
+    }
+
+    ST7735_QueueFlush();
+    ST7735_SetFrame16(true);
+    ST7735_DC_HIGH();
+    // HAL_SPI_Transmit的长度为16位，按帧数分块
+    while (count) {
+        uint16_t chunk = count > 0xFFFF ? 0xFFFF : (uint16_t)count;
+        HAL_SPI_Transmit(&ST7735_SPI_PORT, (uint8_t*)pixels, chunk, HAL_MAX_DELAY);
+        pixels += chunk;
+        count -= chunk;
+    }
+}
+
+void ST7735_WritePixelsDMA(const uint16_t* pixels, uint16_t count) {
+    if (st7735_color_mode == ST7735_COLOR_12BIT) {
+        // 队列发送期间SPI一直处于忙状态，调用者仍然可以用HAL_SPI_GetState等待完成
+        ST7735_QueuePixels(pixels, count);
+        return;
+    }
+
+    ST7735_QueueFlush();
+    ST7735_SetFrame16(true);
+    ST7735_SetMemoryIncrement(true);
+    ST7735_DC_HIGH();
+    HAL_SPI_Transmit_DMA(&ST7735_SPI_PORT, (uint8_t*)pixels, count);
+}
+
 static void ST7735_ExecuteCommandList(const uint8_t *addr) {
     uint8_t numCommands, numArgs;
     uint16_t ms;
@@ -139,15 +358,18 @@ static void ST7735_ExecuteCommandList(const uint8_t *addr) {
 }
 
 void ST7735_SetAddressWindow(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1) {
+    st7735_write_serial++;
+    if (scroll_offset) ST7735_ResetScroll();
+
     // column address set
     ST7735_WriteCommand(ST7735_CASET);
-    uint8_t data[] = { 0x00, x0 + ST7735_XSTART, 0x00, x1 + ST7735_XSTART };
+    uint8_t data[] = { 0x00, x0 + st7735_xstart, 0x00, x1 + st7735_xstart };
     ST7735_WriteData(data, sizeof(data));
 
     // row address set
     ST7735_WriteCommand(ST7735_RASET);
-    data[1] = y0 + ST7735_YSTART;
-    data[3] = y1 + ST7735_YSTART;
+    data[1] = y0 + st7735_ystart;
+    data[3] = y1 + st7735_ystart;
     ST7735_WriteData(data, sizeof(data));
 
     // write to RAM
@@ -170,19 +392,29 @@ void ST7735_Init() {
     ST7735_ExecuteCommandList(init_cmds2);
     ST7735_ExecuteCommandList(init_cmds3);
     ST7735_Unselect();
+
+    // 初始化命令写入的是默认方向
+    st7735_rotation = ST7735_ROTATE_0;
+    st7735_width = ST7735_WIDTH;
+    st7735_height = ST7735_HEIGHT;
+    st7735_xstart = ST7735_XSTART;
+    st7735_ystart = ST7735_YSTART;
+    st7735_madctl = ST7735_ROTATION;
+    st7735_color_mode = ST7735_COLOR_16BIT;
+    pack_has_carry = false;
+    scroll_start = scroll_length = scroll_offset = 0;
     
     MODIFY_REG(ST7735_SPI_PORT.Instance->CR1, SPI_CR1_BR, SPI_BAUDRATEPRESCALER_2);
 }
 
 void ST7735_DrawPixel(uint16_t x, uint16_t y, uint16_t color) {
-    if((x >= ST7735_WIDTH) || (y >= ST7735_HEIGHT))
+    if((x >= st7735_width) || (y >= st7735_height))
         return;
 
     ST7735_Select();
 
     ST7735_SetAddressWindow(x, y, x+1, y+1);
-    uint8_t data[] = { color >> 8, color & 0xFF };
-    ST7735_WriteData(data, sizeof(data));
+    ST7735_WritePixels(&color, 1);
 
     ST7735_Unselect();
 }
@@ -196,11 +428,9 @@ static void ST7735_WriteChar(uint16_t x, uint16_t y, char ch, FontDef font, uint
         b = font.data[(ch - 32) * font.height + i];
         for(j = 0; j < font.width; j++) {
             if((b << j) & 0x8000)  {
-                uint8_t data[] = { color >> 8, color & 0xFF };
-                ST7735_WriteData(data, sizeof(data));
+                ST7735_WritePixels(&color, 1);
             } else {
-                uint8_t data[] = { bgcolor >> 8, bgcolor & 0xFF };
-                ST7735_WriteData(data, sizeof(data));
+                ST7735_WritePixels(&bgcolor, 1);
             }
         }
     }
@@ -241,10 +471,10 @@ void ST7735_WriteString(uint16_t x, uint16_t y, const char* str, FontDef font, u
     ST7735_Select();
 
     while(*str) {
-        if(x + font.width >= ST7735_WIDTH) {
+        if(x + font.width >= st7735_width) {
             x = 0;
             y += font.height;
-            if(y + font.height >= ST7735_HEIGHT) {
+            if(y + font.height >= st7735_height) {
                 break;
             }
 
@@ -267,10 +497,10 @@ void ST7735_WriteStringNoBg(uint16_t x, uint16_t y, const char* str, FontDef fon
     ST7735_Select();
 
     while(*str) {
-        if(x + font.width >= ST7735_WIDTH) {
+        if(x + font.width >= st7735_width) {
             x = 0;
             y += font.height;
-            if(y + font.height >= ST7735_HEIGHT) {
+            if(y + font.height >= st7735_height) {
                 break;
             }
 
@@ -291,66 +521,41 @@ void ST7735_WriteStringNoBg(uint16_t x, uint16_t y, const char* str, FontDef fon
 
 void ST7735_FillRectangle(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color) {
     // clipping
-    if((x >= ST7735_WIDTH) || (y >= ST7735_HEIGHT)) return;
-    if((x + w - 1) >= ST7735_WIDTH) w = ST7735_WIDTH - x;
-    if((y + h - 1) >= ST7735_HEIGHT) h = ST7735_HEIGHT - y;
+    if((x >= st7735_width) || (y >= st7735_height) || w == 0 || h == 0) return;
+    if((x + w - 1) >= st7735_width) w = st7735_width - x;
+    if((y + h - 1) >= st7735_height) h = st7735_height - y;
 
     ST7735_Select();
-    ST7735_SetAddressWindow(x, y, x+w-1, y+h-1);
-
-    uint8_t data[] = { color >> 8, color & 0xFF };
-    ST7735_DC_HIGH();
-    for(y = h; y > 0; y--) {
-        for(x = w; x > 0; x--) {
-            HAL_SPI_Transmit(&ST7735_SPI_PORT, data, sizeof(data), HAL_MAX_DELAY);
-        }
-    }
-
+    ST7735_QueueFill(x, y, x+w-1, y+h-1, color, NULL, NULL);
+    ST7735_QueueFlush();
     ST7735_Unselect();
 }
 
 void ST7735_FillRectangleFast(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color) {
-    if((x >= ST7735_WIDTH) || (y >= ST7735_HEIGHT)) return;
-    if((x + w - 1) >= ST7735_WIDTH) w = ST7735_WIDTH - x;
-    if((y + h - 1) >= ST7735_HEIGHT) h = ST7735_HEIGHT - y;
-
-    ST7735_Select();
-    ST7735_SetAddressWindow(x, y, x+w-1, y+h-1);
-
-    uint8_t pixel_hi = color >> 8;
-    uint8_t pixel_lo = color & 0xFF;
-    for (uint16_t i = 0; i < w; i++) {
-        st7735_line_buffer[i * 2] = pixel_hi;
-        st7735_line_buffer[i * 2 + 1] = pixel_lo;
-    }
-
-    ST7735_DC_HIGH();
-    uint16_t line_bytes = w * 2;
-    for(y = h; y > 0; y--) {
-        HAL_SPI_Transmit_DMA(&ST7735_SPI_PORT, st7735_line_buffer, line_bytes);
-        while (HAL_SPI_GetState(&ST7735_SPI_PORT) != HAL_SPI_STATE_READY);
-        while (__HAL_SPI_GET_FLAG(&ST7735_SPI_PORT, SPI_FLAG_BSY));
-    }
+    if((x >= st7735_width) || (y >= st7735_height) || w == 0 || h == 0) return;
+    if((x + w - 1) >= st7735_width) w = st7735_width - x;
+    if((y + h - 1) >= st7735_height) h = st7735_height - y;
 
-    ST7735_Unselect();
+    // 提交后立即返回，整个矩形由一次（超过65535个像素时几次）DMA发送
+    ST7735_QueueFill(x, y, x + w - 1, y + h - 1, color, NULL, NULL);
 }
 
 void ST7735_FillScreen(uint16_t color) {
-    ST7735_FillRectangle(0, 0, ST7735_WIDTH, ST7735_HEIGHT, color);
+    ST7735_FillRectangle(0, 0, st7735_width, st7735_height, color);
 }
 
 void ST7735_FillScreenFast(uint16_t color) {
-    ST7735_FillRectangleFast(0, 0, ST7735_WIDTH, ST7735_HEIGHT, color);
+    ST7735_FillRectangleFast(0, 0, st7735_width, st7735_height, color);
 }
 
 void ST7735_DrawImage(uint16_t x, uint16_t y, uint16_t w, uint16_t h, const uint16_t* data) {
-    if((x >= ST7735_WIDTH) || (y >= ST7735_HEIGHT)) return;
-    if((x + w - 1) >= ST7735_WIDTH) return;
-    if((y + h - 1) >= ST7735_HEIGHT) return;
+    if((x >= st7735_width) || (y >= st7735_height)) return;
+    if((x + w - 1) >= st7735_width) return;
+    if((y + h - 1) >= st7735_height) return;
 
     ST7735_Select();
     ST7735_SetAddressWindow(x, y, x+w-1, y+h-1);
-    ST7735_WriteData((uint8_t*)data, sizeof(uint16_t)*w*h);
+    ST7735_WritePixels(data, (size_t)w*h);
     ST7735_Unselect();
 }
 
@@ -367,3 +572,384 @@ void ST7735_SetGamma(GammaDef gamma)
 	ST7735_WriteData((uint8_t *) &gamma, sizeof(gamma));
 	ST7735_Unselect();
 }
+
+void ST7735_SetRotation(ST7735_Rotation rotation) {
+    rotation = (ST7735_Rotation)(rotation & 3);
+
+    uint8_t base = 0;
+    for (uint8_t i = 0; i < 4; i++) {
+        if (rotation_madctl[i] == (ST7735_ROTATION & ST7735_MADCTL_DIRECTION)) {
+            base = i;
+            break;
+        }
+    }
+    uint8_t madctl = rotation_madctl[(base + rotation) & 3] | (ST7735_ROTATION & ~ST7735_MADCTL_DIRECTION);
+
+    // 滚动轴可能随方向改变，先回到未滚动的状态
+    ST7735_ResetScroll();
+
+    // 命令使用阻塞传输，先等待之前的DMA完成
+    ST7735_WaitSPI();
+
+    ST7735_Select();
+    ST7735_WriteCommand(ST7735_MADCTL);
+    ST7735_WriteData(&madctl, sizeof(madctl));
+    ST7735_Unselect();
+
+    // 行列交换时偏移量也随之交换
+    bool swap = rotation & 1;
+    st7735_rotation = rotation;
+    st7735_madctl = madctl;
+    st7735_write_serial++;
+    st7735_width = swap ? ST7735_HEIGHT : ST7735_WIDTH;
+    st7735_height = swap ? ST7735_WIDTH : ST7735_HEIGHT;
+    st7735_xstart = swap ? ST7735_YSTART : ST7735_XSTART;
+    st7735_ystart = swap ? ST7735_XSTART : ST7735_YSTART;
+}
+
+ST7735_Rotation ST7735_GetRotation(void) {
+    return st7735_rotation;
+}
+
+uint16_t ST7735_GetWidth(void) {
+    return st7735_width;
+}
+
+uint16_t ST7735_GetHeight(void) {
+    return st7735_height;
+}
+
+uint32_t ST7735_GetWriteSerial(void) {
+    return st7735_write_serial;
+}
+
+ST7735_ScrollAxis ST7735_GetScrollAxis(void) {
+    return (st7735_madctl & ST7735_MADCTL_MV) ? ST7735_SCROLL_HORIZONTAL : ST7735_SCROLL_VERTICAL;
+}
+
+static void ST7735_QueueScrollStart(uint16_t ssa) {
+    uint8_t args[] = { ssa >> 8, ssa & 0xFF };
+    ST7735_QueueCommand(ST7735_VSCSAD, args, sizeof(args));
+}
+
+bool ST7735_SetScrollArea(uint16_t start, uint16_t length) {
+    // 滚动轴上的逻辑坐标加上该轴的地址偏移即为GRAM行号，MY置位时行序相反
+    bool horizontal = ST7735_GetScrollAxis() == ST7735_SCROLL_HORIZONTAL;
+    uint16_t base = horizontal ? st7735_xstart : st7735_ystart;
+    uint16_t size = horizontal ? st7735_width : st7735_height;
+    if (length == 0 || start + length > size || base + start + length > ST7735_GRAM_LINES) return false;
+    if (start == scroll_start && length == scroll_length) return true;
+
+    uint16_t tfa = (st7735_madctl & ST7735_MADCTL_MY) ? ST7735_GRAM_LINES - (base + start + length) : base + start;
+    uint16_t bfa = ST7735_GRAM_LINES - tfa - length;
+    uint8_t args[] = { tfa >> 8, tfa & 0xFF, length >> 8, length & 0xFF, bfa >> 8, bfa & 0xFF };
+    ST7735_QueueCommand(ST7735_VSCRDEF, args, sizeof(args));
+    ST7735_QueueScrollStart(tfa);
+
+    scroll_start = start;
+    scroll_length = length;
+    scroll_offset = 0;
+    scroll_tfa = tfa;
+    return true;
+}
+
+void ST7735_SetScrollOffset(uint16_t offset) {
+    if (!scroll_length) return;
+    offset %= scroll_length;
+    if (offset == scroll_offset) return;
+
+    // GRAM行序与逻辑坐标相反时，显示起点向相反的方向移动
+    uint16_t shift = (st7735_madctl & ST7735_MADCTL_MY) ? (scroll_length - offset) % scroll_length : offset;
+    ST7735_QueueScrollStart(scroll_tfa + shift);
+    scroll_offset = offset;
+}
+
+uint16_t ST7735_GetScrollOffset(void) {
+    return scroll_offset;
+}
+
+uint16_t ST7735_ScrollMap(uint16_t pos) {
+    if (!scroll_offset || pos < scroll_start || pos >= scroll_start + scroll_length) return pos;
+    return scroll_start + (pos - scroll_start + scroll_offset) % scroll_length;
+}
+
+void ST7735_ResetScroll(void) {
+    // 显示起点等于区域起点时GRAM按原样显示，区域定义可以保留
+    if (scroll_offset) ST7735_QueueScrollStart(scroll_tfa);
+    scroll_start = 0;
+    scroll_length = 0;
+    scroll_offset = 0;
+}
+
+void ST7735_SetColorMode(ST7735_ColorMode mode) {
+    if (mode == st7735_color_mode) return;
+
+    // 阻塞命令会先等待队列清空并发出暂存的像素，之前提交的像素仍按原来的格式发送
+    uint8_t colmod = mode == ST7735_COLOR_12BIT ? 0x03 : 0x05;
+    ST7735_Select();
+    ST7735_WriteCommand(ST7735_COLMOD);
+    ST7735_WriteData(&colmod, sizeof(colmod));
+    ST7735_Unselect();
+    st7735_color_mode = mode;
+}
+
+ST7735_ColorMode ST7735_GetColorMode(void) {
+    return st7735_color_mode;
+}
+
+// size为帧数，pixels为true时以16位帧发送，fill为true时重复发送buff处的同一个像素
+static void ST7735_QueueSend(bool data, bool pixels, bool fill, const uint8_t* buff, uint16_t size) {
+    ST7735_SetFrame16(pixels);
+    ST7735_SetMemoryIncrement(!fill);
+    if (data) ST7735_DC_HIGH();
+    else ST7735_DC_LOW();
+    HAL_SPI_Transmit_DMA(&ST7735_SPI_PORT, (uint8_t*)buff, size);
+}
+
+// 从队首事务的当前位置取最多ST7735_PACK_PIXELS个像素打包到dst，返回字节数
+// 跨越重复的行连续打包，只输出整数对像素，落单的像素留到下一段
+static uint16_t ST7735_QueuePack(const ST7735_QueueSlot* slot, uint8_t* dst) {
+    uint8_t* out = dst;
+    uint32_t budget = ST7735_PACK_PIXELS;
+    while (budget && queue_sent < slot->repeat) {
+        uint32_t count = (slot->length - queue_offset) / 2;
+        if (count > budget) count = budget;
+        const uint16_t* src = (const uint16_t*)(slot->data + queue_sent * slot->stride + queue_offset);
+        if (slot->fill) src = (const uint16_t*)slot->data;
+        queue_offset += count * 2;
+        if (queue_offset == slot->length) {
+            queue_offset = 0;
+            queue_sent++;
+        }
+        budget -= count;
+
+        if (pack_has_carry) {
+            uint16_t pair[2] = { pack_carry, *src };
+            out += ST7735_PackRGB444(pair, out, 2);
+            pack_has_carry = false;
+            if (!slot->fill) src++;
+            count--;
+        }
+        if (count & 1) {
+            pack_carry = slot->fill ? *src : src[count - 1];
+            pack_has_carry = true;
+            count--;
+        }
+
+        if (slot->fill) {
+            // 同色像素打包后是重复的三个字节
+            uint16_t pair[2] = { *src, *src };
+            uint8_t pattern[3];
+            ST7735_PackRGB444(pair, pattern, 2);
+            for (; count; count -= 2, out += 3) memcpy(out, pattern, sizeof(pattern));
+        }
+        else {
+            out += ST7735_PackRGB444(src, out, count);
+        }
+    }
+    return (uint16_t)(out - dst);
+}
+
+// 启动队首事务的下一次传输；队首事务完成时调用回调并继续下一个事务，队列为空时停止
+// 只在中断中或关中断时调用
+static void ST7735_QueueAdvance(void) {
+    while (queue_head != queue_tail) {
+        ST7735_QueueSlot* slot = &queue_slots[queue_head];
+        switch (queue_stage++) {
+            case QUEUE_STAGE_TAIL:
+                // 像素流在命令或非像素数据处结束，暂存的像素补齐后先发出
+                if (!pack_has_carry || (slot->packed && !slot->set_window && !slot->has_command)) continue;
+                pack_has_carry = false;
+                ST7735_PackRGB444(&pack_carry, pack_tail, 1);
+                ST7735_QueueSend(true, false, false, pack_tail, sizeof(pack_tail));
+                return;
+            case QUEUE_STAGE_CASET:
+                if (!slot->set_window) {
+                    queue_stage = QUEUE_STAGE_COMMAND;
+                    continue;
+                }
+                ST7735_QueueSend(false, false, false, &slot->commands[0], 1);
+                return;
+            case QUEUE_STAGE_CASET_DATA:
+                ST7735_QueueSend(true, false, false, slot->caset, sizeof(slot->caset));
+                return;
+            case QUEUE_STAGE_RASET:
+                ST7735_QueueSend(false, false, false, &slot->commands[1], 1);
+                return;
+            case QUEUE_STAGE_RASET_DATA:
+                ST7735_QueueSend(true, false, false, slot->raset, sizeof(slot->raset));
+                return;
+            case QUEUE_STAGE_COMMAND:
+                if (!slot->has_command) continue;
+                ST7735_QueueSend(false, false, false, &slot->commands[2], 1);
+                return;
+            default:
+                if (slot->packed) {
+                    if (!pack_started) {
+                        pack_started = true;
+                        pack_ready = ST7735_QueuePack(slot, pack_buffers[pack_index]);
+                    }
+                    if (pack_ready) {
+                        ST7735_QueueSend(true, false, false, pack_buffers[pack_index], pack_ready);
+                        // DMA发送这一块的同时打包下一块，打包不到数据时这一块就是最后一块
+                        pack_index ^= 1;
+                        pack_ready = ST7735_QueuePack(slot, pack_buffers[pack_index]);
+                        queue_stage = QUEUE_STAGE_DATA;
+                        return;
+                    }
+                    pack_started = false;
+                    break;
+                }
+                if (slot->length && queue_sent < slot->repeat) {
+                    uint8_t frame = slot->pixels ? 2 : 1;
+                    uint32_t left = (slot->length - queue_offset) / frame;
+                    uint16_t size = left > ST7735_QUEUE_CHUNK ? ST7735_QUEUE_CHUNK : (uint16_t)left;
+                    const uint8_t* buff = slot->fill ? slot->data
+                                                     : slot->data + queue_sent * slot->stride + queue_offset;
+                    ST7735_QueueSend(true, slot->pixels, slot->fill, buff, size);
+                    queue_offset += (uint32_t)size * frame;
+                    if (queue_offset == slot->length) {
+                        queue_offset = 0;
+                        queue_sent++;
+                    }
+                    queue_stage = QUEUE_STAGE_DATA;
+                    return;
+                }
+                break;
+        }
+
+        // 当前事务完成
+        ST7735_QueueCallback callback = slot->callback;
+        void* user = slot->user;
+        queue_stage = QUEUE_STAGE_TAIL;
+        queue_offset = 0;
+        queue_sent = 0;
+        queue_head = (queue_head + 1) % ST7735_QUEUE_DEPTH;
+        if (callback) callback(user);
+    }
+    queue_running = false;
+}
+
+bool ST7735_QueueSubmit(const ST7735_Transaction* transaction) {
+    if (!transaction) return false;
+
+    // 不感知滚动的窗口按未滚动的地址写入
+    if (transaction->set_window && !transaction->keep_scroll && scroll_offset) ST7735_ResetScroll();
+
+    // 队列满时等待中断腾出一个描述符
+    uint8_t next = (queue_tail + 1) % ST7735_QUEUE_DEPTH;
+    while (next == queue_head);
+
+    ST7735_QueueSlot* slot = &queue_slots[queue_tail];
+    slot->set_window = transaction->set_window;
+    if (transaction->set_window) st7735_write_serial++;
+    slot->has_command = transaction->has_command || transaction->set_window;
+    slot->commands[0] = ST7735_CASET;
+    slot->commands[1] = ST7735_RASET;
+    slot->commands[2] = transaction->has_command ? transaction->command : ST7735_RAMWR;
+    if (transaction->set_window) {
+        slot->caset[0] = 0x00;
+        slot->caset[1] = transaction->x0 + st7735_xstart;
+        slot->caset[2] = 0x00;
+        slot->caset[3] = transaction->x1 + st7735_xstart;
+        slot->raset[0] = 0x00;
+        slot->raset[1] = transaction->y0 + st7735_ystart;
+        slot->raset[2] = 0x00;
+        slot->raset[3] = transaction->y1 + st7735_ystart;
+    }
+    slot->fill = transaction->fill;
+    slot->color = transaction->color;
+    slot->data = transaction->fill ? (const uint8_t*)&slot->color : transaction->data;
+    slot->pixels = transaction->pixels || transaction->fill;
+    slot->length = slot->data ? transaction->length : 0;
+    // 16位帧只能发送整数个像素
+    if (slot->pixels) slot->length &= ~1u;
+    slot->packed = slot->pixels && st7735_color_mode == ST7735_COLOR_12BIT;
+    slot->repeat = transaction->repeat ? transaction->repeat : 1;
+    // 不足一个像素时只发送窗口和命令：打包会把空的一段当作有像素，读出并写出缓冲区之外的数据
+    if (slot->pixels && !slot->length) slot->repeat = 0;
+    slot->stride = transaction->stride;
+    slot->callback = transaction->callback;
+    slot->user = transaction->user;
+
+    // 队列空闲时SPI可能还在进行队列之外的DMA传输
+    if (!queue_running) ST7735_WaitSPI();
+
+    // 与中断中的队列推进互斥：中断刚好发送完最后一个事务时由这里重新启动
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    queue_tail = next;
+    if (!queue_running) {
+        queue_running = true;
+        ST7735_QueueAdvance();
+    }
+    if (!primask) __enable_irq();
+    return true;
+}
+
+bool ST7735_QueueWindow(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1, const void* pixels, uint32_t size,
+                        ST7735_QueueCallback callback, void* user) {
+    ST7735_Transaction transaction = { 0 };
+    transaction.set_window = true;
+    transaction.x0 = x0;
+    transaction.y0 = y0;
+    transaction.x1 = x1;
+    transaction.y1 = y1;
+    transaction.data = (const uint8_t*)pixels;
+    transaction.length = size;
+    transaction.pixels = true;
+    transaction.callback = callback;
+    transaction.user = user;
+    return ST7735_QueueSubmit(&transaction);
+}
+
+bool ST7735_QueueCommand(uint8_t cmd, const uint8_t* args, uint8_t count) {
+    if (count > ST7735_QUEUE_ARGS_MAX || (count && !args)) return false;
+
+    // 参数先复制到即将使用的描述符中，提交时data指向这份副本
+    uint8_t next = (queue_tail + 1) % ST7735_QUEUE_DEPTH;
+    while (next == queue_head);
+    ST7735_QueueSlot* slot = &queue_slots[queue_tail];
+    if (count) memcpy(slot->args, args, count);
+
+    ST7735_Transaction transaction = { 0 };
+    transaction.has_command = true;
+    transaction.command = cmd;
+    transaction.data = count ? slot->args : NULL;
+    transaction.length = count;
+    return ST7735_QueueSubmit(&transaction);
+}
+
+bool ST7735_QueueFill(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1, uint16_t color,
+                      ST7735_QueueCallback callback, void* user) {
+    ST7735_Transaction transaction = { 0 };
+    transaction.set_window = true;
+    transaction.x0 = x0;
+    transaction.y0 = y0;
+    transaction.x1 = x1;
+    transaction.y1 = y1;
+    transaction.fill = true;
+    transaction.color = color;
+    transaction.length = (uint32_t)(x1 - x0 + 1) * (y1 - y0 + 1) * sizeof(uint16_t);
+    transaction.callback = callback;
+    transaction.user = user;
+    return ST7735_QueueSubmit(&transaction);
+}
+
+bool ST7735_QueueIsIdle(void) {
+    return !queue_running;
+}
+
+void ST7735_QueueFlush(void) {
+    while (queue_running);
+    ST7735_WaitSPI();
+}
+
+void ST7735_QueueTxComplete(void) {
+    // 队列之外的DMA传输也会进入这里，此时队列不在运行
+    if (queue_running) ST7735_QueueAdvance();
+}
+
+void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef* hspi) {
+    if (hspi == &ST7735_SPI_PORT) ST7735_QueueTxComplete();
+}
@@ -175,8 +175,12 @@ extern SPI_HandleTypeDef ST7735_SPI_PORT;
 #define ST7735_ROTATION (ST7735_MADCTL_MY | ST7735_MADCTL_MV | ST7735_MADCTL_BGR)
 */
 
-#define ST7735_LINE_BUFFER_SIZE (ST7735_WIDTH * 2)
-extern uint8_t st7735_line_buffer[ST7735_LINE_BUFFER_SIZE];
+#define ST7735_MAX_SIDE (ST7735_WIDTH > ST7735_HEIGHT ? ST7735_WIDTH : ST7735_HEIGHT)
+// 任意方向下屏幕宽度的上限（旋转后宽高可能互换），平移浏览按它分配整屏宽的条带缓冲区
+
+#define ST7735_GRAM_LINES 162
+// GRAM沿扫描方向的行数（ST7735S为162，ST7735R为160），硬件滚动的三个区域之和必须等于它
+
 
 /****************************/
 
@@ -201,6 +205,8 @@ extern uint8_t st7735_line_buffer[ST7735_LINE_BUFFER_SIZE];
 #define ST7735_RAMRD   0x2E
 
 #define ST7735_PTLAR   0x30
+#define ST7735_VSCRDEF 0x33
+#define ST7735_VSCSAD  0x37
 #define ST7735_COLMOD  0x3A
 #define ST7735_MADCTL  0x36
 
@@ -238,6 +244,60 @@ extern uint8_t st7735_line_buffer[ST7735_LINE_BUFFER_SIZE];
 #define ST7735_WHITE   0xFFFF
 #define ST7735_COLOR565(r, g, b) (((r & 0xF8) << 8) | ((g & 0xFC) << 3) | ((b & 0xF8) >> 3))
 
+// 运行时显示方向：相对ST7735_ROTATION定义的默认方向顺时针旋转
+// 只改写MADCTL，控制器按新的扫描方向写入GRAM，像素数据不需要任何软件转置
+typedef enum {
+    ST7735_ROTATE_0 = 0,
+    ST7735_ROTATE_90,
+    ST7735_ROTATE_180,
+    ST7735_ROTATE_270
+} ST7735_Rotation;
+
+// 像素传输格式：16位为RGB565（COLMOD 0x05），12位为RGB444（COLMOD 0x03）
+typedef enum {
+    ST7735_COLOR_16BIT = 0,
+    ST7735_COLOR_12BIT
+} ST7735_ColorMode;
+
+#define ST7735_PACK_PIXELS 256
+// 12位模式下每次打包的像素数（必须为偶数），驱动内有两个ST7735_PACK_PIXELS*3/2字节的乒乓缓冲区
+
+// 硬件滚动的方向：控制器只能沿GRAM的行方向循环滚动，行列交换（MV）的扫描方向下对应逻辑x方向
+typedef enum {
+    ST7735_SCROLL_VERTICAL = 0,
+    ST7735_SCROLL_HORIZONTAL
+} ST7735_ScrollAxis;
+
+#define ST7735_QUEUE_DEPTH 16
+// 事务队列的描述符数量，队列满时提交会等待最早的事务完成
+
+#define ST7735_QUEUE_ARGS_MAX 16
+// ST7735_QueueCommand可以携带的参数字节数（复制到队列中，调用后即可释放）
+
+// 事务完成回调，在SPI发送完成中断中调用：只能做置标志之类的简单工作，不要阻塞或提交新的事务
+typedef void (*ST7735_QueueCallback)(void* user);
+
+// 事务描述符：可选的地址窗口、可选的命令字节、数据（DC为高）重复发送repeat次，最后调用回调
+// 地址窗口按提交时的方向和偏移量换算，之后改变方向不影响已提交的事务
+typedef struct {
+    bool set_window;
+    uint8_t x0, y0, x1, y1;
+    bool has_command;           // set_window为true时命令默认为RAMWR
+    uint8_t command;
+    const uint8_t* data;        // 在回调之前必须保持有效且不能修改
+    uint32_t length;            // 字节数；像素事务不足一个像素（0或1字节）时只发送窗口和命令
+    bool pixels;                // data为本机字节序的RGB565像素，以16位帧发送（地址须按2字节对齐）；
+                                // 12位模式下由中断打包为RGB444后以8位帧发送
+    bool fill;                  // 纯色填充：忽略data，关闭DMA存储器地址递增，把color重复发送length/2次
+    uint16_t color;
+    uint16_t repeat;            // 0按1处理，用于重复发送同一段数据的场景
+    uint32_t stride;            // 每次重复后data前进的字节数，0表示重复同一段数据；
+                                // 取帧缓冲区的行跨度时可以用一个窗口发送其中的矩形区域（每行一次DMA）
+    bool keep_scroll;           // 窗口已按当前滚动偏移换算为写入地址；为false时滚动偏移不为0则先复位滚动
+    ST7735_QueueCallback callback;
+    void* user;
+} ST7735_Transaction;
+
 typedef enum {
     GAMMA_10 = 0x01,
     GAMMA_25 = 0x02,
@@ -258,6 +318,8 @@ void ST7735_Init(void);
 void ST7735_DrawPixel(uint16_t x, uint16_t y, uint16_t color);
 void ST7735_WriteString(uint16_t x, uint16_t y, const char* str, FontDef font, uint16_t color, uint16_t bgcolor);
 void ST7735_WriteStringNoBg(uint16_t x, uint16_t y, const char* str, FontDef font, uint16_t color);
+// 纯色填充由DMA从单个颜色字重复发送（存储器地址不递增），不需要行缓冲区；
+// Fast版本提交到事务队列后立即返回，普通版本等待填充完成
 void ST7735_FillRectangle(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color);
 void ST7735_FillRectangleFast(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color);
 void ST7735_FillScreen(uint16_t color);
@@ -266,6 +328,60 @@ void ST7735_DrawImage(uint16_t x, uint16_t y, uint16_t w, uint16_t h, const uint
 void ST7735_InvertColors(bool invert);
 void ST7735_SetGamma(GammaDef gamma);
 
+// 设置显示方向，90/270度时逻辑宽高互换；已显示的内容不受影响，只影响之后的写入
+void ST7735_SetRotation(ST7735_Rotation rotation);
+ST7735_Rotation ST7735_GetRotation(void);
+// 当前方向下的逻辑宽高，绘制和裁剪都应使用这两个值而不是ST7735_WIDTH/ST7735_HEIGHT
+uint16_t ST7735_GetWidth(void);
+uint16_t ST7735_GetHeight(void);
+// 写入序号：每次设置地址窗口（包括队列中的窗口事务）或改变方向时递增，
+// 序号没有变化说明期间没有任何模块写过屏幕
+uint32_t ST7735_GetWriteSerial(void);
+
+// 硬件滚动。坐标都是当前方向下沿滚动轴的逻辑坐标，驱动按MADCTL和地址偏移换算为GRAM的行号。
+// 滚动区域之外的行保持固定；区域内显示位置pos显示的是写入地址ST7735_ScrollMap(pos)的内容，
+// 所以滚动后只需要把新露出的行写到换算后的地址。命令进入事务队列，与之前提交的窗口保持顺序
+ST7735_ScrollAxis ST7735_GetScrollAxis(void);
+// 定义滚动区域并把偏移量复位为0，区域没有变化时什么也不做；超出屏幕或GRAM时返回false
+bool ST7735_SetScrollArea(uint16_t start, uint16_t length);
+// 区域内的内容向前（坐标减小的方向）移动offset行，从另一端绕回
+void ST7735_SetScrollOffset(uint16_t offset);
+uint16_t ST7735_GetScrollOffset(void);
+uint16_t ST7735_ScrollMap(uint16_t pos);
+// 回到未滚动的状态。设置地址窗口时若没有声明keep_scroll会自动调用，不感知滚动的模块不受影响
+void ST7735_ResetScroll(void);
+
+// 切换像素传输格式。12位模式每两个像素只发送三个字节，SPI数据量减少25%，每个分量只保留高4位；
+// 调用者仍然提供RGB565，驱动在发送完成中断中边打包边发送，所有像素接口（包括事务队列和纯色填充）都适用。
+// 切换前等待已提交的事务完成；打包占用中断时间（约每像素两个周期），不需要时应切回16位模式
+void ST7735_SetColorMode(ST7735_ColorMode mode);
+ST7735_ColorMode ST7735_GetColorMode(void);
+// RGB565转RGB444：两个像素打包为三个字节（高位先出），count为奇数时最后一个像素占两个字节（低4位补0）
+// 返回写入的字节数，src和dst都不需要对齐
+uint32_t ST7735_PackRGB444(const uint16_t* src, uint8_t* dst, uint32_t count);
+
+// 中断驱动的异步事务队列：提交后立即返回，SPI发送完成中断按顺序发送命令、参数和数据并切换DC，
+// CPU在面板传输期间可以继续解码或渲染；阻塞式的ST7735_WriteCommand/ST7735_WriteData会先等待队列清空
+// ST7735_QueueWindow的pixels为本机字节序的RGB565，size为字节数
+bool ST7735_QueueSubmit(const ST7735_Transaction* transaction);
+bool ST7735_QueueWindow(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1, const void* pixels, uint32_t size,
+                        ST7735_QueueCallback callback, void* user);
+bool ST7735_QueueCommand(uint8_t cmd, const uint8_t* args, uint8_t count);
+// 用纯色填充窗口，颜色保存在队列描述符中
+bool ST7735_QueueFill(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1, uint16_t color,
+                      ST7735_QueueCallback callback, void* user);
+bool ST7735_QueueIsIdle(void);
+void ST7735_QueueFlush(void);
+// 由HAL_SPI_TxCpltCallback调用（驱动已提供该回调，若工程中另有定义需要在其中转发）
+void ST7735_QueueTxComplete(void);
+
+// 像素数据（包括ST7735_DrawImage）都是本机字节序的RGB565：发送像素时SPI和DMA切换为16位帧，
+// 每个半字高位先出，正好是面板需要的顺序；命令和参数仍使用8位帧，切换由驱动自动完成
+// 在ST7735_SetAddressWindow之后调用，count为像素数
+void ST7735_WritePixels(const uint16_t* pixels, size_t count);
+// 同上，DMA发送后立即返回（不经过事务队列），完成前不能修改缓冲区
+void ST7735_WritePixelsDMA(const uint16_t* pixels, uint16_t count);
+
 void ST7735_SetAddressWindow(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1);
 void ST7735_WriteData(uint8_t* buff, size_t buff_size);
 void ST7735_Select();
@@ -0,0 +1,657 @@
+//
+// 缩略图缓存实现
+// 数据库文件布局：文件头（16字节） + 键表（THUMB_DB_MAX_ENTRIES个ThumbKey） + N个固定大小的像素槽位（THUMB_WIDTH*THUMB_HEIGHT个RGB565像素）
+// 键表集中存放，打开时一次f_read即可读入所有键
+//
+
+#include "thumb_cache.h"
+#include "pic_types.h"
+#include "tjpgd.h"
+#include "png_decoder.h"
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <cstddef>
+#include <strings.h>
+
+#define THUMB_DB_MAGIC 0x42444854   // "THDB"
+#define THUMB_DB_VERSION 3   // 2：像素改为本机字节序；3：键表与像素分开存放
+#define THUMB_PIXEL_BYTES (THUMB_WIDTH * THUMB_HEIGHT * sizeof(uint16_t))
+#define THUMB_KEYS_OFFSET sizeof(ThumbDBHeader)
+#define THUMB_PIXELS_OFFSET (THUMB_KEYS_OFFSET + THUMB_DB_MAX_ENTRIES * sizeof(ThumbKey))
+#define THUMB_PATH_MAX 256
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t thumb_width;
+    uint16_t thumb_height;
+    uint16_t key_capacity;  // 键表容量，即创建时的THUMB_DB_MAX_ENTRIES
+    uint32_t slot_count;
+} ThumbDBHeader;
+
+typedef struct ThumbDB {
+    FIL file;
+    char dir_path[THUMB_PATH_MAX];
+    ThumbKey* keys;                     // 所有槽位的键，打开时一次性读入
+    uint32_t count;
+    uint8_t verified[(THUMB_DB_MAX_ENTRIES + 7) / 8];  // 本次打开后已与源文件核对过的槽位
+    char* queue[THUMB_QUEUE_SIZE];      // 待生成的文件名（GBK）
+    uint8_t queue_head;
+    uint8_t queue_count;
+} ThumbDB;
+
+// BMP文件头结构（与pic_types.cpp中一致）
+typedef struct __attribute__((packed)) {
+    uint16_t signature;
+    uint32_t file_size;
+    uint16_t reserved1;
+    uint16_t reserved2;
+    uint32_t data_offset;
+    uint32_t header_size;
+    int32_t width;
+    int32_t height;
+    uint16_t planes;
+    uint16_t bits_per_pixel;
+    uint32_t compression;
+    uint32_t image_size;
+    int32_t x_pixels_per_meter;
+    int32_t y_pixels_per_meter;
+    uint32_t colors_used;
+    uint32_t colors_important;
+} ThumbBMPHeader;
+
+// JPEG缩略图解码上下文
+typedef struct {
+    FIL* file;
+    uint16_t* pixels;       // 目标缩略图缓冲区
+    uint16_t src_width;     // 缩放后的源图尺寸
+    uint16_t src_height;
+    uint16_t thumb_width;   // 缩略图有效尺寸
+    uint16_t thumb_height;
+    uint16_t offset_x;      // 缩略图在槽位中的居中偏移
+    uint16_t offset_y;
+} ThumbJpegContext;
+
+// PNG缩略图采样上下文（逐行解码，只保留命中采样行的像素）
+typedef struct {
+    uint16_t* pixels;
+    uint16_t src_width;
+    uint16_t src_height;
+    uint16_t thumb_width;
+    uint16_t thumb_height;
+    uint16_t offset_x;
+    uint16_t offset_y;
+    uint16_t next_row;      // 下一个待填充的缩略图行
+} ThumbPngContext;
+
+static ThumbError g_last_error = THUMB_SUCCESS;
+
+static const char* error_strings[] = {
+    "成功",
+    "文件打开失败",
+    "文件读取失败",
+    "文件写入失败",
+    "内存分配失败",
+    "无效的参数",
+    "不支持的格式",
+    "解码失败",
+    "没有缓存",
+    "队列已满",
+    "数据库已满"
+};
+
+static uint32_t hash_name(const char* name);
+static void join_path(char* buf, size_t size, const char* dir, const char* name);
+static int find_slot(const ThumbDB* db, uint32_t hash);
+static bool key_matches(const ThumbKey* cached, const ThumbKey* current);
+static bool is_verified(const ThumbDB* db, int slot);
+static void set_verified(ThumbDB* db, int slot);
+static ThumbError stat_source(const ThumbDB* db, const char* name, ThumbKey* key);
+static ThumbError init_db_file(ThumbDB* db);
+static ThumbError generate_thumbnail(ThumbDB* db, const char* name);
+static ThumbError render_jpeg(FIL* file, uint16_t* pixels, ThumbKey* key);
+static ThumbError render_bmp(FIL* file, uint16_t* pixels, ThumbKey* key);
+static ThumbError render_png(FIL* file, uint16_t* pixels, ThumbKey* key);
+static void fit_size(uint16_t src_w, uint16_t src_h, uint16_t* dst_w, uint16_t* dst_h);
+static size_t thumb_jpeg_input(JDEC* jd, uint8_t* buf, size_t nbyte);
+static int thumb_jpeg_output(JDEC* jd, void* bitmap, JRECT* rect);
+
+static inline uint16_t rgb888_to_565(uint8_t r, uint8_t g, uint8_t b) {
+    return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+}
+
+ThumbError THUMB_Open(const char* dir_path, ThumbDB_t* handle) {
+    if (!dir_path || !handle) {
+        g_last_error = THUMB_ERROR_INVALID_PARAM;
+        return g_last_error;
+    }
+
+    ThumbDB* db = (ThumbDB*)malloc(sizeof(ThumbDB));
+    if (!db) {
+        g_last_error = THUMB_ERROR_MEMORY_ALLOC;
+        return g_last_error;
+    }
+    memset(db, 0, sizeof(ThumbDB));
+    strncpy(db->dir_path, dir_path, sizeof(db->dir_path) - 1);
+
+    char db_path[THUMB_PATH_MAX];
+    join_path(db_path, sizeof(db_path), dir_path, THUMB_DB_FILENAME);
+    if (f_open(&db->file, db_path, FA_READ | FA_WRITE | FA_OPEN_ALWAYS) != FR_OK) {
+        free(db);
+        g_last_error = THUMB_ERROR_FILE_OPEN;
+        return g_last_error;
+    }
+
+    db->keys = (ThumbKey*)malloc(THUMB_DB_MAX_ENTRIES * sizeof(ThumbKey));
+    if (!db->keys) {
+        f_close(&db->file);
+        free(db);
+        g_last_error = THUMB_ERROR_MEMORY_ALLOC;
+        return g_last_error;
+    }
+
+    ThumbDBHeader header;
+    UINT bytes_read = 0;
+    FRESULT res = f_read(&db->file, &header, sizeof(header), &bytes_read);
+    bool valid = res == FR_OK && bytes_read == sizeof(header) &&
+        header.magic == THUMB_DB_MAGIC && header.version == THUMB_DB_VERSION &&
+        header.thumb_width == THUMB_WIDTH && header.thumb_height == THUMB_HEIGHT &&
+        header.key_capacity == THUMB_DB_MAX_ENTRIES && header.slot_count <= THUMB_DB_MAX_ENTRIES &&
+        f_size(&db->file) >= THUMB_PIXELS_OFFSET + header.slot_count * THUMB_PIXEL_BYTES;
+
+    ThumbError error = THUMB_SUCCESS;
+    if (valid) {
+        // 键表紧跟在文件头之后，一次读入所有槽位的键
+        db->count = header.slot_count;
+        UINT keys_size = db->count * sizeof(ThumbKey);
+        res = f_read(&db->file, db->keys, keys_size, &bytes_read);
+        if (res != FR_OK || bytes_read != keys_size) {
+            error = THUMB_ERROR_FILE_READ;
+        }
+    }
+    else {
+        // 新文件或者格式不匹配（例如缩略图尺寸改变），重新初始化
+        error = init_db_file(db);
+    }
+
+    if (error != THUMB_SUCCESS) {
+        THUMB_Close(db);
+        g_last_error = error;
+        return error;
+    }
+
+    *handle = db;
+    g_last_error = THUMB_SUCCESS;
+    return THUMB_SUCCESS;
+}
+
+void THUMB_Close(ThumbDB_t handle) {
+    if (!handle) return;
+
+    for (uint8_t i = 0; i < handle->queue_count; i++) {
+        free(handle->queue[(handle->queue_head + i) % THUMB_QUEUE_SIZE]);
+    }
+    f_close(&handle->file);
+    free(handle->keys);
+    free(handle);
+}
+
+ThumbError THUMB_Get(ThumbDB_t handle, const char* name, uint16_t* pixels) {
+    if (!handle || !name || !pixels) {
+        g_last_error = THUMB_ERROR_INVALID_PARAM;
+        return g_last_error;
+    }
+
+    int slot = find_slot(handle, hash_name(name));
+    if (slot < 0) {
+        g_last_error = THUMB_ERROR_NOT_CACHED;
+        return g_last_error;
+    }
+
+    // 源文件大小或修改时间变化时认为缓存失效；每个槽位在本次打开后只核对一次
+    // （THUMB_Request登记时通常已经核对过），之后的读取不再访问源文件
+    if (!is_verified(handle, slot)) {
+        ThumbKey current;
+        ThumbError error = stat_source(handle, name, &current);
+        if (error != THUMB_SUCCESS) {
+            g_last_error = error;
+            return error;
+        }
+        if (!key_matches(&handle->keys[slot], &current)) {
+            g_last_error = THUMB_ERROR_NOT_CACHED;
+            return g_last_error;
+        }
+        set_verified(handle, slot);
+    }
+
+    UINT bytes_read = 0;
+    FRESULT res = f_lseek(&handle->file, THUMB_PIXELS_OFFSET + slot * THUMB_PIXEL_BYTES);
+    if (res == FR_OK) res = f_read(&handle->file, pixels, THUMB_PIXEL_BYTES, &bytes_read);
+    if (res != FR_OK || bytes_read != THUMB_PIXEL_BYTES) {
+        g_last_error = THUMB_ERROR_FILE_READ;
+        return g_last_error;
+    }
+
+    g_last_error = THUMB_SUCCESS;
+    return THUMB_SUCCESS;
+}
+
+ThumbError THUMB_Request(ThumbDB_t handle, const char* name) {
+    if (!handle || !name || !THUMB_IsSupportedFormat(name)) {
+        g_last_error = THUMB_ERROR_INVALID_PARAM;
+        return g_last_error;
+    }
+
+    // 已有有效缓存则不需要生成
+    int slot = find_slot(handle, hash_name(name));
+    if (slot >= 0) {
+        if (is_verified(handle, slot)) {
+            g_last_error = THUMB_SUCCESS;
+            return THUMB_SUCCESS;
+        }
+        ThumbKey current;
+        if (stat_source(handle, name, &current) == THUMB_SUCCESS && key_matches(&handle->keys[slot], &current)) {
+            set_verified(handle, slot);
+            g_last_error = THUMB_SUCCESS;
+            return THUMB_SUCCESS;
+        }
+    }
+
+    for (uint8_t i = 0; i < handle->queue_count; i++) {
+        if (strcmp(handle->queue[(handle->queue_head + i) % THUMB_QUEUE_SIZE], name) == 0) {
+            g_last_error = THUMB_SUCCESS;
+            return THUMB_SUCCESS;
+        }
+    }
+
+    if (handle->queue_count >= THUMB_QUEUE_SIZE) {
+        g_last_error = THUMB_ERROR_QUEUE_FULL;
+        return g_last_error;
+    }
+
+    char* copy = strdup(name);
+    if (!copy) {
+        g_last_error = THUMB_ERROR_MEMORY_ALLOC;
+        return g_last_error;
+    }
+    handle->queue[(handle->queue_head + handle->queue_count) % THUMB_QUEUE_SIZE] = copy;
+    handle->queue_count++;
+
+    g_last_error = THUMB_SUCCESS;
+    return THUMB_SUCCESS;
+}
+
+bool THUMB_ProcessIdle(ThumbDB_t handle) {
+    return THUMB_ProcessIdleName(handle, nullptr, 0);
+}
+
+bool THUMB_ProcessIdleName(ThumbDB_t handle, char* done_name, uint32_t size) {
+    if (done_name && size) done_name[0] = '\0';
+    if (!handle || handle->queue_count == 0) return false;
+
+    char* name = handle->queue[handle->queue_head];
+    handle->queue_head = (handle->queue_head + 1) % THUMB_QUEUE_SIZE;
+    handle->queue_count--;
+
+    g_last_error = generate_thumbnail(handle, name);
+    if (g_last_error == THUMB_SUCCESS && done_name && size) snprintf(done_name, size, "%s", name);
+    free(name);
+
+    return handle->queue_count > 0;
+}
+
+bool THUMB_IsSupportedFormat(const char* filename) {
+    if (!filename) return false;
+
+    const char* ext = strrchr(filename, '.');
+    if (!ext) return false;
+
+    return strcasecmp(ext, ".jpg") == 0 || strcasecmp(ext, ".jpeg") == 0 || strcasecmp(ext, ".bmp") == 0 ||
+           strcasecmp(ext, ".png") == 0;
+}
+
+const char* THUMB_GetErrorString(ThumbError error) {
+    if (error < 0 || error >= sizeof(error_strings) / sizeof(error_strings[0])) {
+        return "未知错误";
+    }
+    return error_strings[error];
+}
+
+ThumbError THUMB_GetLastError(void) {
+    return g_last_error;
+}
+
+// 内部函数实现
+
+static uint32_t hash_name(const char* name) {
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    while (*name) {
+        hash ^= (uint8_t)*name++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static void join_path(char* buf, size_t size, const char* dir, const char* name) {
+    size_t len = strlen(dir);
+    if (len > 0 && dir[len - 1] == '/') {
+        snprintf(buf, size, "%s%s", dir, name);
+    }
+    else {
+        snprintf(buf, size, "%s/%s", dir, name);
+    }
+}
+
+static int find_slot(const ThumbDB* db, uint32_t hash) {
+    for (uint32_t i = 0; i < db->count; i++) {
+        if (db->keys[i].name_hash == hash) return (int)i;
+    }
+    return -1;
+}
+
+static bool key_matches(const ThumbKey* cached, const ThumbKey* current) {
+    return cached->file_size == current->file_size && cached->fdate == current->fdate &&
+           cached->ftime == current->ftime;
+}
+
+static bool is_verified(const ThumbDB* db, int slot) {
+    return (db->verified[slot >> 3] >> (slot & 7)) & 1;
+}
+
+static void set_verified(ThumbDB* db, int slot) {
+    db->verified[slot >> 3] |= (uint8_t)(1 << (slot & 7));
+}
+
+static ThumbError stat_source(const ThumbDB* db, const char* name, ThumbKey* key) {
+    char path[THUMB_PATH_MAX];
+    join_path(path, sizeof(path), db->dir_path, name);
+
+    FILINFO fno;
+    if (f_stat(path, &fno) != FR_OK) {
+        return THUMB_ERROR_FILE_OPEN;
+    }
+
+    memset(key, 0, sizeof(ThumbKey));
+    key->name_hash = hash_name(name);
+    key->file_size = fno.fsize;
+    key->fdate = fno.fdate;
+    key->ftime = fno.ftime;
+    return THUMB_SUCCESS;
+}
+
+static ThumbError init_db_file(ThumbDB* db) {
+    ThumbDBHeader header = {THUMB_DB_MAGIC, THUMB_DB_VERSION, THUMB_WIDTH, THUMB_HEIGHT, THUMB_DB_MAX_ENTRIES, 0};
+    UINT bytes_written = 0;
+
+    FRESULT res = f_lseek(&db->file, 0);
+    if (res == FR_OK) res = f_truncate(&db->file);
+    if (res == FR_OK) res = f_write(&db->file, &header, sizeof(header), &bytes_written);
+    if (res == FR_OK) res = f_sync(&db->file);
+    if (res != FR_OK || bytes_written != sizeof(header)) {
+        return THUMB_ERROR_FILE_WRITE;
+    }
+
+    db->count = 0;
+    memset(db->verified, 0, sizeof(db->verified));
+    return THUMB_SUCCESS;
+}
+
+static ThumbError generate_thumbnail(ThumbDB* db, const char* name) {
+    ThumbKey key;
+    ThumbError error = stat_source(db, name, &key);
+    if (error != THUMB_SUCCESS) return error;
+
+    // 同名文件的旧槽位直接覆盖，否则追加
+    int slot = find_slot(db, key.name_hash);
+    if (slot < 0) {
+        if (db->count >= THUMB_DB_MAX_ENTRIES) return THUMB_ERROR_DB_FULL;
+        slot = (int)db->count;
+    }
+
+    uint16_t* pixels = (uint16_t*)malloc(THUMB_PIXEL_BYTES);
+    if (!pixels) return THUMB_ERROR_MEMORY_ALLOC;
+    memset(pixels, 0, THUMB_PIXEL_BYTES);
+
+    char path[THUMB_PATH_MAX];
+    join_path(path, sizeof(path), db->dir_path, name);
+    FIL file;
+    if (f_open(&file, path, FA_READ) != FR_OK) {
+        free(pixels);
+        return THUMB_ERROR_FILE_OPEN;
+    }
+
+    const char* ext = strrchr(name, '.');
+    if (ext && strcasecmp(ext, ".bmp") == 0) {
+        error = render_bmp(&file, pixels, &key);
+    }
+    else if (ext && strcasecmp(ext, ".png") == 0) {
+        error = render_png(&file, pixels, &key);
+    }
+    else {
+        error = render_jpeg(&file, pixels, &key);
+    }
+    f_close(&file);
+
+    if (error == THUMB_SUCCESS) {
+        // 先写像素（追加第一个槽位时顺带把文件扩展到键表之后），再写键，最后更新槽位数
+        UINT bytes_written = 0;
+        FRESULT res = f_lseek(&db->file, THUMB_PIXELS_OFFSET + slot * THUMB_PIXEL_BYTES);
+        if (res == FR_OK) res = f_write(&db->file, pixels, THUMB_PIXEL_BYTES, &bytes_written);
+        bool written = res == FR_OK && bytes_written == THUMB_PIXEL_BYTES;
+        if (written) {
+            res = f_lseek(&db->file, THUMB_KEYS_OFFSET + slot * sizeof(ThumbKey));
+            if (res == FR_OK) res = f_write(&db->file, &key, sizeof(ThumbKey), &bytes_written);
+            written = res == FR_OK && bytes_written == sizeof(ThumbKey);
+        }
+        if (written && (uint32_t)slot == db->count) {
+            uint32_t new_count = db->count + 1;
+            res = f_lseek(&db->file, offsetof(ThumbDBHeader, slot_count));
+            if (res == FR_OK) res = f_write(&db->file, &new_count, sizeof(new_count), &bytes_written);
+            written = res == FR_OK && bytes_written == sizeof(new_count);
+            if (written) db->count = new_count;
+        }
+        if (written) written = f_sync(&db->file) == FR_OK;
+        if (!written) {
+            error = THUMB_ERROR_FILE_WRITE;
+        }
+        else {
+            db->keys[slot] = key;
+            set_verified(db, slot);
+        }
+    }
+
+    free(pixels);
+    return error;
+}
+
+static void fit_size(uint16_t src_w, uint16_t src_h, uint16_t* dst_w, uint16_t* dst_h) {
+    // 保持宽高比缩小到缩略图框内，不放大
+    if ((uint32_t)src_w * THUMB_HEIGHT > (uint32_t)src_h * THUMB_WIDTH) {
+        *dst_w = src_w < THUMB_WIDTH ? src_w : THUMB_WIDTH;
+        *dst_h = (uint16_t)((uint32_t)src_h * *dst_w / src_w);
+    }
+    else {
+        *dst_h = src_h < THUMB_HEIGHT ? src_h : THUMB_HEIGHT;
+        *dst_w = (uint16_t)((uint32_t)src_w * *dst_h / src_h);
+    }
+    if (*dst_w == 0) *dst_w = 1;
+    if (*dst_h == 0) *dst_h = 1;
+}
+
+static ThumbError render_jpeg(FIL* file, uint16_t* pixels, ThumbKey* key) {
+    uint8_t* workbuf = (uint8_t*)malloc(PIC_TJPGDEC_WORKSPACE);
+    if (!workbuf) return THUMB_ERROR_MEMORY_ALLOC;
+
+    JDEC jdec;
+    ThumbJpegContext ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.file = file;
+    ctx.pixels = pixels;
+
+    JRESULT jres = jd_prepare(&jdec, thumb_jpeg_input, workbuf, PIC_TJPGDEC_WORKSPACE, &ctx);
+    if (jres != JDR_OK) {
+        free(workbuf);
+        return THUMB_ERROR_DECODE_FAILED;
+    }
+
+    // 优先使用1/8缩放（TJpgDec在该比例下跳过IDCT，只用DC分量），
+    // 只有原图太小时才退回到更大的比例
+    uint8_t scale = 3;
+    while (scale > 0 && (jdec.width >> scale) < THUMB_WIDTH && (jdec.height >> scale) < THUMB_HEIGHT) {
+        scale--;
+    }
+    ctx.src_width = (jdec.width + (1 << scale) - 1) >> scale;
+    ctx.src_height = (jdec.height + (1 << scale) - 1) >> scale;
+    fit_size(ctx.src_width, ctx.src_height, &ctx.thumb_width, &ctx.thumb_height);
+    ctx.offset_x = (THUMB_WIDTH - ctx.thumb_width) / 2;
+    ctx.offset_y = (THUMB_HEIGHT - ctx.thumb_height) / 2;
+
+    jres = jd_decomp(&jdec, thumb_jpeg_output, scale);
+    free(workbuf);
+
+    if (jres != JDR_OK) return THUMB_ERROR_DECODE_FAILED;
+
+    key->width = ctx.thumb_width;
+    key->height = ctx.thumb_height;
+    return THUMB_SUCCESS;
+}
+
+static size_t thumb_jpeg_input(JDEC* jd, uint8_t* buf, size_t nbyte) {
+    ThumbJpegContext* ctx = (ThumbJpegContext*)jd->device;
+    UINT bytes_read;
+    if (!buf) {
+        // TJpgDec用空缓冲区表示跳过数据
+        return f_lseek(ctx->file, f_tell(ctx->file) + nbyte) == FR_OK ? nbyte : 0;
+    }
+    FRESULT res = f_read(ctx->file, buf, nbyte, &bytes_read);
+    if (res != FR_OK) {
+        return 0;
+    }
+    return bytes_read;
+}
+
+static int thumb_jpeg_output(JDEC* jd, void* bitmap, JRECT* rect) {
+    ThumbJpegContext* ctx = (ThumbJpegContext*)jd->device;
+
+    const uint16_t* src = (const uint16_t*)bitmap;
+    uint16_t w = rect->right - rect->left + 1;
+
+    // 最近邻采样：遍历采样点落在本块内的目标像素，目标像素t的采样点是t * src / thumb，
+    // 所以本块的第一个目标行（列）是ceil(top * thumb / src)
+    uint16_t ty = ((uint32_t)rect->top * ctx->thumb_height + ctx->src_height - 1) / ctx->src_height;
+    uint16_t tx_first = ((uint32_t)rect->left * ctx->thumb_width + ctx->src_width - 1) / ctx->src_width;
+    for (; ty < ctx->thumb_height; ty++) {
+        uint16_t sy = (uint32_t)ty * ctx->src_height / ctx->thumb_height;
+        if (sy > rect->bottom) break;
+
+        uint16_t* dst_row = ctx->pixels + (ctx->offset_y + ty) * THUMB_WIDTH + ctx->offset_x;
+        const uint16_t* src_row = src + (sy - rect->top) * w;
+        for (uint16_t tx = tx_first; tx < ctx->thumb_width; tx++) {
+            uint16_t sx = (uint32_t)tx * ctx->src_width / ctx->thumb_width;
+            if (sx > rect->right) break;
+
+            dst_row[tx] = src_row[sx - rect->left];
+        }
+    }
+
+    return 1;
+}
+
+static ThumbError render_bmp(FIL* file, uint16_t* pixels, ThumbKey* key) {
+    ThumbBMPHeader header;
+    UINT bytes_read;
+
+    FRESULT res = f_read(file, &header, sizeof(header), &bytes_read);
+    if (res != FR_OK || bytes_read != sizeof(header)) return THUMB_ERROR_FILE_READ;
+    if (header.signature != 0x4D42) return THUMB_ERROR_DECODE_FAILED;
+    if (header.bits_per_pixel != 24 && header.bits_per_pixel != 32) return THUMB_ERROR_UNSUPPORTED_FORMAT;
+
+    uint16_t img_width = (uint16_t)abs(header.width);
+    uint16_t img_height = (uint16_t)abs(header.height);
+    if (img_width == 0 || img_height == 0) return THUMB_ERROR_DECODE_FAILED;
+    bool bottom_up = header.height > 0;
+
+    uint16_t thumb_w, thumb_h;
+    fit_size(img_width, img_height, &thumb_w, &thumb_h);
+    uint16_t offset_x = (THUMB_WIDTH - thumb_w) / 2;
+    uint16_t offset_y = (THUMB_HEIGHT - thumb_h) / 2;
+
+    uint32_t row_size = ((img_width * header.bits_per_pixel + 31) / 32) * 4;
+    uint8_t bytes_per_pixel = header.bits_per_pixel / 8;
+
+    // 只需要读取到最右侧采样点所在的位置
+    uint32_t read_size = ((uint32_t)(thumb_w - 1) * img_width / thumb_w + 1) * bytes_per_pixel;
+    uint8_t* row_buffer = (uint8_t*)malloc(read_size);
+    if (!row_buffer) return THUMB_ERROR_MEMORY_ALLOC;
+
+    // 按文件中的顺序访问采样行，避免倒序寻址
+    for (uint16_t i = 0; i < thumb_h; i++) {
+        uint16_t ty = bottom_up ? thumb_h - 1 - i : i;
+        uint16_t sy = (uint32_t)ty * img_height / thumb_h;
+        uint16_t file_row = bottom_up ? img_height - 1 - sy : sy;
+
+        res = f_lseek(file, header.data_offset + file_row * row_size);
+        if (res == FR_OK) res = f_read(file, row_buffer, read_size, &bytes_read);
+        if (res != FR_OK || bytes_read != read_size) {
+            free(row_buffer);
+            return THUMB_ERROR_FILE_READ;
+        }
+
+        uint16_t* dst_row = pixels + (offset_y + ty) * THUMB_WIDTH + offset_x;
+        for (uint16_t tx = 0; tx < thumb_w; tx++) {
+            const uint8_t* pixel = row_buffer + ((uint32_t)tx * img_width / thumb_w) * bytes_per_pixel;
+            dst_row[tx] = rgb888_to_565(pixel[2], pixel[1], pixel[0]);
+        }
+    }
+
+    free(row_buffer);
+
+    key->width = thumb_w;
+    key->height = thumb_h;
+    return THUMB_SUCCESS;
+}
+
+static bool thumb_png_row(void* user, uint16_t y, const uint16_t* row, uint16_t width) {
+    ThumbPngContext* ctx = (ThumbPngContext*)user;
+
+    while (ctx->next_row < ctx->thumb_height &&
+           (uint32_t)ctx->next_row * ctx->src_height / ctx->thumb_height == y) {
+        uint16_t* dst_row = ctx->pixels + (ctx->offset_y + ctx->next_row) * THUMB_WIDTH + ctx->offset_x;
+        for (uint16_t tx = 0; tx < ctx->thumb_width; tx++) {
+            dst_row[tx] = row[(uint32_t)tx * width / ctx->thumb_width];
+        }
+        ctx->next_row++;
+    }
+
+    // 最后一个采样行之后的数据不需要再解压
+    return ctx->next_row < ctx->thumb_height;
+}
+
+static ThumbError render_png(FIL* file, uint16_t* pixels, ThumbKey* key) {
+    PngInfo info;
+    PngError png_error = PNG_ReadInfo(file, &info);
+    if (png_error == PNG_ERROR_FILE_READ) return THUMB_ERROR_FILE_READ;
+    if (png_error != PNG_SUCCESS) return THUMB_ERROR_DECODE_FAILED;
+
+    ThumbPngContext ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.pixels = pixels;
+    ctx.src_width = info.width;
+    ctx.src_height = info.height;
+    fit_size(info.width, info.height, &ctx.thumb_width, &ctx.thumb_height);
+    ctx.offset_x = (THUMB_WIDTH - ctx.thumb_width) / 2;
+    ctx.offset_y = (THUMB_HEIGHT - ctx.thumb_height) / 2;
+
+    png_error = PNG_Decode(file, thumb_png_row, &ctx);
+    if (png_error != PNG_SUCCESS && png_error != PNG_ERROR_ABORTED) {
+        if (png_error == PNG_ERROR_MEMORY_ALLOC) return THUMB_ERROR_MEMORY_ALLOC;
+        if (png_error == PNG_ERROR_UNSUPPORTED_FORMAT) return THUMB_ERROR_UNSUPPORTED_FORMAT;
+        return THUMB_ERROR_DECODE_FAILED;
+    }
+
+    key->width = ctx.thumb_width;
+    key->height = ctx.thumb_height;
+    return THUMB_SUCCESS;
+}
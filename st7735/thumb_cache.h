@@ -0,0 +1,221 @@
+//
+// 缩略图缓存类型定义和接口
+// 为文件浏览器生成小尺寸RGB565缩略图，并以每个目录一个打包数据库文件的形式保存在SD卡上
+//
+
+#ifndef SD_AND_LCD2_THUMB_CACHE_H
+#define SD_AND_LCD2_THUMB_CACHE_H
+
+#include "ff.h"
+
+#ifdef __cplusplus
+extern "C" {
+#else
+#include <stdint.h>
+#include <stdbool.h>
+#endif
+
+#define THUMB_WIDTH 40
+#define THUMB_HEIGHT 30
+// 缩略图尺寸（像素），不足部分以黑色填充并居中
+
+#define THUMB_DB_FILENAME ".thumbs.db"
+// 每个目录下的缩略图数据库文件名
+
+#define THUMB_DB_MAX_ENTRIES 512
+// 单个数据库最多保存的缩略图数量
+
+#define THUMB_QUEUE_SIZE 24
+// 等待空闲时生成的缩略图队列长度
+
+// 错误码定义
+typedef enum {
+    THUMB_SUCCESS = 0,
+    THUMB_ERROR_FILE_OPEN,
+    THUMB_ERROR_FILE_READ,
+    THUMB_ERROR_FILE_WRITE,
+    THUMB_ERROR_MEMORY_ALLOC,
+    THUMB_ERROR_INVALID_PARAM,
+    THUMB_ERROR_UNSUPPORTED_FORMAT,
+    THUMB_ERROR_DECODE_FAILED,
+    THUMB_ERROR_NOT_CACHED,
+    THUMB_ERROR_QUEUE_FULL,
+    THUMB_ERROR_DB_FULL
+} ThumbError;
+
+// 数据库中每个缩略图槽位的键（集中存放在文件头之后的键表中，16字节）
+typedef struct __attribute__((packed)) {
+    uint32_t name_hash;     // 文件名（GBK）的FNV-1a哈希
+    uint32_t file_size;     // 源文件大小
+    uint16_t fdate;         // 源文件修改日期
+    uint16_t ftime;         // 源文件修改时间
+    uint16_t width;         // 缩略图有效宽度
+    uint16_t height;        // 缩略图有效高度
+} ThumbKey;
+
+// 缩略图数据库句柄（对应一个目录）
+typedef struct ThumbDB* ThumbDB_t;
+
+/**
+ * @brief 打开目录的缩略图数据库（不存在时自动创建）
+ * @param dir_path 目录路径（GBK编码）
+ * @param handle 返回的数据库句柄
+ * @return 成功返回THUMB_SUCCESS，失败返回错误码
+ * @note 打开时一次f_read读入整个键表，之后查询不再扫描文件
+ */
+ThumbError THUMB_Open(const char* dir_path, ThumbDB_t* handle);
+
+/**
+ * @brief 关闭缩略图数据库并释放资源
+ * @param handle 数据库句柄
+ */
+void THUMB_Close(ThumbDB_t handle);
+
+/**
+ * @brief 读取缩略图
+ * @param handle 数据库句柄
+ * @param name 文件名（GBK编码，不含目录）
+ * @param pixels 输出缓冲区，大小为THUMB_WIDTH * THUMB_HEIGHT个像素（本机字节序的RGB565，可直接绘制到画布）
+ * @return 成功返回THUMB_SUCCESS；没有缓存或源文件已修改返回THUMB_ERROR_NOT_CACHED
+ * @note 命中时只需要一次f_lseek和一次f_read；源文件的f_stat在每个槽位本次打开后的第一次Get或Request时做一次
+ */
+ThumbError THUMB_Get(ThumbDB_t handle, const char* name, uint16_t* pixels);
+
+/**
+ * @brief 请求在空闲时为文件生成缩略图
+ * @param handle 数据库句柄
+ * @param name 文件名（GBK编码，不含目录）
+ * @return 已缓存或成功加入队列返回THUMB_SUCCESS，失败返回错误码
+ */
+ThumbError THUMB_Request(ThumbDB_t handle, const char* name);
+
+/**
+ * @brief 在空闲时调用，为队列中的一个文件生成缩略图并写入数据库
+ * @param handle 数据库句柄
+ * @return 队列中仍有待处理的文件返回true，否则返回false
+ * @note 每次调用最多解码一张图片，JPEG使用1/8缩放（仅DC分量），BMP只读取需要的行，PNG解码到最后一个采样行即停止
+ */
+bool THUMB_ProcessIdle(ThumbDB_t handle);
+
+/**
+ * @brief 与THUMB_ProcessIdle相同，并返回本次生成了缩略图的文件名
+ * @param handle 数据库句柄
+ * @param done_name 成功生成时写入文件名（GBK编码），没有处理文件或生成失败时写入空字符串；可以为NULL
+ * @param size done_name的字节数
+ * @return 队列中仍有待处理的文件返回true，否则返回false
+ * @note 调用者据此只在当前显示的文件有了缩略图时重新读取，不必每次都查询数据库
+ */
+bool THUMB_ProcessIdleName(ThumbDB_t handle, char* done_name, uint32_t size);
+
+/**
+ * @brief 检查文件是否可以生成缩略图（按扩展名判断）
+ * @param filename 文件名
+ * @return 可以生成返回true，否则返回false
+ */
+bool THUMB_IsSupportedFormat(const char* filename);
+
+/**
+ * @brief 获取错误信息字符串
+ * @param error 错误码
+ * @return 错误信息字符串
+ */
+const char* THUMB_GetErrorString(ThumbError error);
+
+/**
+ * @brief 获取最后发生的错误
+ * @return 最后发生的错误码
+ */
+ThumbError THUMB_GetLastError(void);
+
+#ifdef __cplusplus
+
+class ThumbnailCache {
+private:
+    ThumbDB_t handle;
+
+public:
+    ThumbnailCache() : handle(nullptr) {}
+
+    explicit ThumbnailCache(const char* dir_path) : handle(nullptr) {
+        Open(dir_path);
+    }
+
+    ~ThumbnailCache() {
+        Close();
+    }
+
+    bool Open(const char* dir_path) {
+        Close();
+        return THUMB_Open(dir_path, &handle) == THUMB_SUCCESS;
+    }
+
+    void Close() {
+        if (handle) {
+            THUMB_Close(handle);
+            handle = nullptr;
+        }
+    }
+
+    [[nodiscard]] bool IsOpen() const {
+        return handle != nullptr;
+    }
+
+    bool Get(const char* name, uint16_t* pixels) const {
+        if (!handle) return false;
+        return THUMB_Get(handle, name, pixels) == THUMB_SUCCESS;
+    }
+
+    bool Request(const char* name) const {
+        if (!handle) return false;
+        return THUMB_Request(handle, name) == THUMB_SUCCESS;
+    }
+
+    bool ProcessIdle() const {
+        if (!handle) return false;
+        return THUMB_ProcessIdle(handle);
+    }
+
+    bool ProcessIdle(char* done_name, uint32_t size) const {
+        if (!handle) {
+            if (done_name && size) done_name[0] = '\0';
+            return false;
+        }
+        return THUMB_ProcessIdleName(handle, done_name, size);
+    }
+
+    static bool IsSupportedFormat(const char* filename) {
+        return THUMB_IsSupportedFormat(filename);
+    }
+
+    static ThumbError GetLastError() {
+        return THUMB_GetLastError();
+    }
+
+    static const char* GetErrorString() {
+        return THUMB_GetErrorString(GetLastError());
+    }
+
+    ThumbnailCache(const ThumbnailCache&) = delete;
+    ThumbnailCache& operator=(const ThumbnailCache&) = delete;
+
+    ThumbnailCache(ThumbnailCache&& other) noexcept : handle(other.handle) {
+        other.handle = nullptr;
+    }
+
+    ThumbnailCache& operator=(ThumbnailCache&& other) noexcept {
+        if (this != &other) {
+            Close();
+            handle = other.handle;
+            other.handle = nullptr;
+        }
+        return *this;
+    }
+};
+
+#endif // __cplusplus
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SD_AND_LCD2_THUMB_CACHE_H
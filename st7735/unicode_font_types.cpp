@@ -1,20 +1,24 @@
 #include "unicode_font_types.h"
 #include "ff.h"
 #include <cstdio>
+#include <algorithm>
 
+// 索引项在第一次插入时才分配：字符多的字体使用稀疏索引，不占用这块内存
 SimpleCharIndex::SimpleCharIndex(int max_entries) : entries(nullptr), entry_count(0), max_entries(max_entries) {
-    entries = new UnicodeCharEntry[max_entries];
 }
 
 SimpleCharIndex::~SimpleCharIndex() {
     Clear();
-    delete[] entries;
 }
 
 bool SimpleCharIndex::Insert(uint32_t unicode, const UnicodeCharInfo& info) {
     if (entry_count >= max_entries) {
         return false;
     }
+    if (!entries) {
+        entries = new UnicodeCharEntry[max_entries];
+        if (!entries) return false;
+    }
 
     if (entry_count == 0 || unicode > entries[entry_count - 1].unicode) {
         entries[entry_count] = UnicodeCharEntry(unicode, info);
@@ -76,92 +80,167 @@ bool SimpleCharIndex::Search(uint32_t unicode, UnicodeCharInfo& info) const {
 }
 
 void SimpleCharIndex::Clear() {
+    delete[] entries;
+    entries = nullptr;
     entry_count = 0;
 }
 
-LRUCache::LRUCache(int capacity) : capacity(capacity), size(0), head(nullptr), tail(nullptr) {
+GlyphCache::~GlyphCache() {
+    Release();
 }
 
-LRUCache::~LRUCache() {
-    Clear();
-}
+bool GlyphCache::Allocate(uint16_t capacity, uint32_t slot_bytes) {
+    Release();
+    if (capacity == 0 || capacity >= EMPTY || slot_bytes == 0) return false;
 
-void LRUCache::MoveToFront(CacheEntry* entry) {
-    if (entry == head) return;
+    // 散列表至少是槽位数的两倍，线性探测的链保持很短
+    table_bits = 1;
+    while ((1u << table_bits) < 2u * capacity) table_bits++;
+    table_mask = (1u << table_bits) - 1;
 
-    if (entry->prev) entry->prev->next = entry->next;
-    if (entry->next) entry->next->prev = entry->prev;
-    if (entry == tail) tail = entry->prev;
+    slots = new Slot[capacity];
+    table = new uint16_t[table_mask + 1];
+    slab = new uint8_t[capacity * slot_bytes];
+    if (!slots || !table || !slab) {
+        Release();
+        return false;
+    }
 
-    entry->prev = nullptr;
-    entry->next = head;
-    if (head) head->prev = entry;
-    head = entry;
-    if (!tail) tail = head;
+    this->capacity = capacity;
+    this->slot_bytes = slot_bytes;
+    Clear();
+    return true;
 }
 
-void LRUCache::RemoveTail() {
-    if (!tail) return;
+void GlyphCache::Release() {
+    delete[] slots;
+    delete[] table;
+    delete[] slab;
+    slots = nullptr;
+    table = nullptr;
+    slab = nullptr;
+    capacity = 0;
+    slot_bytes = 0;
+    count = 0;
+}
+
+uint16_t GlyphCache::Hash(uint32_t unicode) const {
+    // 斐波那契散列，相邻码点分散到不同位置
+    return (unicode * 2654435769u) >> (32 - table_bits);
+}
 
-    CacheEntry* toRemove = tail;
-    tail = tail->prev;
-    if (tail) tail->next = nullptr;
-    else head = nullptr;
+int32_t GlyphCache::Find(uint32_t unicode) const {
+    if (!capacity) return -1;
 
-    delete toRemove;
-    size--;
+    for (uint16_t position = Hash(unicode);; position = (position + 1) & table_mask) {
+        uint16_t index = table[position];
+        if (index == EMPTY) return -1;
+        if (slots[index].unicode == unicode) return position;
+    }
 }
 
-bool LRUCache::Get(uint32_t unicode, std::shared_ptr<uint8_t[]>& bitmap) {
-    CacheEntry* current = head;
-    while (current) {
-        if (current->unicode == unicode) {
-            bitmap = current->bitmap;
-            MoveToFront(current);
-            return true;
+void GlyphCache::EraseAt(uint16_t position) {
+    // 向后移位删除：同一探测链上后面的表项前移填补空位，不需要墓碑
+    uint16_t hole = position;
+    for (uint16_t next = (position + 1) & table_mask; table[next] != EMPTY; next = (next + 1) & table_mask) {
+        uint16_t home = Hash(slots[table[next]].unicode);
+        if (((next - home) & table_mask) >= ((next - hole) & table_mask)) {
+            table[hole] = table[next];
+            hole = next;
         }
-        current = current->next;
     }
-    return false;
+    table[hole] = EMPTY;
 }
 
-bool LRUCache::Put(uint32_t unicode, const std::shared_ptr<uint8_t[]>& bitmap) {
-    CacheEntry* current = head;
-    while (current) {
-        if (current->unicode == unicode) {
-            current->bitmap = bitmap;
-            MoveToFront(current);
-            return true;
-        }
-        current = current->next;
+const uint8_t* GlyphCache::Get(uint32_t unicode, uint16_t* width, uint16_t* height) {
+    int32_t position = Find(unicode);
+    if (position < 0) {
+        stats.misses++;
+        return nullptr;
     }
 
-    if (size >= capacity) {
-        RemoveTail();
+    uint16_t index = table[position];
+    Slot& slot = slots[index];
+    slot.referenced = true;
+    stats.hits++;
+    *width = slot.width;
+    *height = slot.height;
+    return slab + index * slot_bytes;
+}
+
+uint8_t* GlyphCache::Insert(uint32_t unicode, uint16_t width, uint16_t height, uint32_t size) {
+    if (!capacity || size > slot_bytes) return nullptr;
+
+    int32_t position = Find(unicode);
+    uint16_t index;
+    if (position >= 0) {
+        index = table[position];
+    }
+    else {
+        // CLOCK：跳过并清除最近访问过的槽位，淘汰第一个未被访问的
+        while (true) {
+            Slot& slot = slots[hand];
+            index = hand;
+            hand = (hand + 1) % capacity;
+            if (!slot.used) break;
+            if (!slot.referenced) {
+                EraseAt(Find(slot.unicode));
+                slot.used = false;
+                count--;
+                stats.evictions++;
+                break;
+            }
+            slot.referenced = false;
+        }
+
+        position = Hash(unicode);
+        while (table[position] != EMPTY) position = (position + 1) & table_mask;
+        table[position] = index;
+        count++;
     }
 
-    auto* newEntry = new CacheEntry(unicode, bitmap);
-    newEntry->next = head;
-    if (head) head->prev = newEntry;
-    head = newEntry;
-    if (!tail) tail = head;
-    size++;
+    Slot& slot = slots[index];
+    slot.unicode = unicode;
+    slot.width = width;
+    slot.height = height;
+    slot.used = true;
+    slot.referenced = true;
+    return slab + index * slot_bytes;
+}
+
+void GlyphCache::Remove(uint32_t unicode) {
+    int32_t position = Find(unicode);
+    if (position < 0) return;
+
+    slots[table[position]].used = false;
+    EraseAt(position);
+    count--;
+}
 
+bool GlyphCache::Touch(uint32_t unicode) {
+    int32_t position = Find(unicode);
+    if (position < 0) return false;
+    slots[table[position]].referenced = true;
     return true;
 }
 
-void LRUCache::Clear() {
-    CacheEntry* current = head;
-    while (current) {
-        CacheEntry* next = current->next;
-        delete current;
-        current = next;
+void GlyphCache::ClearReferences() {
+    for (uint16_t i = 0; i < capacity; i++) slots[i].referenced = false;
+}
+
+void GlyphCache::Clear() {
+    if (!capacity) return;
+
+    for (uint16_t i = 0; i < capacity; i++) {
+        slots[i].used = false;
+        slots[i].referenced = false;
     }
-    head = tail = nullptr;
-    size = 0;
+    std::fill_n(table, table_mask + 1, EMPTY);
+    count = 0;
+    hand = 0;
 }
 
-UnicodeFont::UnicodeFont() : char_index(1000), cache(LRU_CACHE_SIZE), default_width(0), default_height(0),
+UnicodeFont::UnicodeFont() : char_index(1000), default_width(0), default_height(0),
                              font_file_size(0), initialized(false), use_index_cache(true), char_count(0) {
     font_path[0] = '\0';
 }
@@ -171,6 +250,7 @@ UnicodeFont::~UnicodeFont() {
         cache.Clear();
         char_index.Clear();
     }
+    if (file_opened) f_close(&font_file);
 }
 
 bool UnicodeFont::Load(const char* path, int cache_size) {
@@ -184,7 +264,6 @@ bool UnicodeFont::Load(const char* path, int cache_size) {
 
     printf("开始加载字体: %s\r\n", font_path);
 
-    FIL font_file;
     if (f_open(&font_file, font_path, FA_READ) != FR_OK) {
         printf("字体文件打开失败!\r\n");
         return false;
@@ -192,23 +271,104 @@ bool UnicodeFont::Load(const char* path, int cache_size) {
 
     font_file_size = f_size(&font_file);
 
-    if (!ParseFontHeader(&font_file)) {
+    // 解析v2索引时已经通过扇区缓存读取字形表
+    sector_data.reset(new uint8_t[FONT_SECTOR_CACHE_BLOCKS * FONT_SECTOR_SIZE]);
+    for (SectorBlock& entry : sector_blocks) entry = SectorBlock();
+
+    if (!ParseFontHeader(&font_file) || !ParseCharIndex(&font_file)) {
         f_close(&font_file);
         return false;
     }
 
-    if (!ParseCharIndex(&font_file)) {
+    // 内嵌字形与文件字形的位图要能交给同一个绘制路径
+    if (embedded && embedded->bits_per_pixel != bits_per_pixel) {
+        printf("内嵌字形为%u位，字体文件为%u位，不再使用内嵌字形\r\n", embedded->bits_per_pixel, bits_per_pixel);
+        embedded = nullptr;
+    }
+
+    // 文件保持打开，之后读取位图和索引块时直接定位
+    file_opened = true;
+
+    uint32_t slot_bytes = std::max(max_bitmap_size, GlyphBitmapSize(default_width, default_height));
+    if (!cache.Allocate(cache_size, slot_bytes)) {
+        printf("字形缓存分配失败!\r\n");
         f_close(&font_file);
+        file_opened = false;
         return false;
     }
 
-    f_close(&font_file);
-
     printf("字体加载完成!\r\n");
     initialized = true;
     return true;
 }
 
+bool IsUTF8ContinuationByte(uint8_t byte) {
+    return (byte & 0xC0) == 0x80;
+}
+
+uint32_t UTF8ToUnicode(const char** utf8_str) {
+    if (!utf8_str || !*utf8_str) return 0;
+    
+    const uint8_t* str = (const uint8_t*)*utf8_str;
+    uint32_t unicode = 0;
+    
+    if ((str[0] & 0x80) == 0x00) {
+        unicode = str[0];
+        (*utf8_str)++;
+    } else if ((str[0] & 0xE0) == 0xC0) {
+        if (IsUTF8ContinuationByte(str[1])) {
+            unicode = ((str[0] & 0x1F) << 6) | (str[1] & 0x3F);
+            (*utf8_str) += 2;
+        }
+    } else if ((str[0] & 0xF0) == 0xE0) {
+        if (IsUTF8ContinuationByte(str[1]) && IsUTF8ContinuationByte(str[2])) {
+            unicode = ((str[0] & 0x0F) << 12) | ((str[1] & 0x3F) << 6) | (str[2] & 0x3F);
+            (*utf8_str) += 3;
+        }
+    } else if ((str[0] & 0xF8) == 0xF0) {
+        if (IsUTF8ContinuationByte(str[1]) && IsUTF8ContinuationByte(str[2]) && IsUTF8ContinuationByte(str[3])) {
+            unicode = ((str[0] & 0x07) << 18) | ((str[1] & 0x3F) << 12) | ((str[2] & 0x3F) << 6) | (str[3] & 0x3F);
+            (*utf8_str) += 4;
+        }
+    } else {
+        (*utf8_str)++;
+    }
+    
+    return unicode;
+}
+
+static bool IsBlankCodepoint(uint32_t unicode) {
+    return unicode == 0x0020 || unicode == 0x00A0 || unicode == 0x2000 || unicode == 0x2001 ||
+        unicode == 0x2002 || unicode == 0x2003 || unicode == 0x2004 || unicode == 0x2005 ||
+        unicode == 0x2006 || unicode == 0x2007 || unicode == 0x2008 || unicode == 0x2009 ||
+        unicode == 0x200A || unicode == 0x202F || unicode == 0x205F || unicode == 0x3000;
+}
+
+static uint32_t ReadBE32(const uint8_t* bytes) {
+    return (bytes[0] << 24) | (bytes[1] << 16) | (bytes[2] << 8) | bytes[3];
+}
+
+// v1索引项：码点、宽、高、位图偏移、位图大小
+static void ParseCharEntry(const uint8_t* entry, UnicodeCharInfo* info) {
+    info->width = (entry[4] << 8) | entry[5];
+    info->height = (entry[6] << 8) | entry[7];
+    info->data_offset = ReadBE32(entry + 8);
+    info->data_size = ReadBE32(entry + 12);
+    info->encoding = FONT_GLYPH_RAW;
+}
+
+// v2区段：首码点、字符数、宽、高、位图偏移或字形表序号、单个压缩字符的存储大小
+static UnicodeCharRange ParseCharRange(const uint8_t* entry) {
+    UnicodeCharRange range;
+    range.start = ReadBE32(entry);
+    range.count = (entry[4] << 8) | entry[5];
+    range.width = entry[6];
+    range.height = entry[7];
+    range.data = ReadBE32(entry + 8);
+    range.packed = ReadBE32(entry + 12);
+    return range;
+}
+
 bool UnicodeFont::ParseFontHeader(FIL* file) {
     uint8_t header[8];
     UINT bytes_read;
@@ -218,71 +378,54 @@ bool UnicodeFont::ParseFontHeader(FIL* file) {
         return false;
     }
 
-    if (header[0] != 0x55 || header[1] != 0x46 || header[2] != 0x4E || header[3] != 0x54) {
+    // "UFNT"为v1格式，"UFN2"为v2格式，"UFN3"为带每像素位数的v2格式
+    if (header[0] != 0x55 || header[1] != 0x46 || header[2] != 0x4E ||
+        (header[3] != 0x54 && header[3] != 0x32 && header[3] != 0x33)) {
         printf("字体头签名错误!\r\n");
         return false;
     }
 
+    format_version = header[3] == 0x54 ? 1 : header[3] - 0x30;
     default_width = (header[4] << 8) | header[5];
     default_height = (header[6] << 8) | header[7];
     return true;
 }
 
 bool UnicodeFont::ParseCharIndex(FIL* file) {
-    uint8_t char_count_bytes[4];
+    // v1：字符数，之后每个字符一个索引项；v2：字符数、区段数、字形表偏移，之后每个区段一项；
+    // v3在字形表偏移之后还有每像素位数和3个保留字节
+    uint8_t counts[16];
+    uint32_t counts_size = format_version == 3 ? 16 : format_version == 2 ? 12 : 4;
     UINT bytes_read;
 
-    if (f_read(file, char_count_bytes, 4, &bytes_read) != FR_OK || bytes_read != 4) {
+    if (f_read(file, counts, counts_size, &bytes_read) != FR_OK || bytes_read != counts_size) {
         printf("读取字符数量失败，读取字节数: %u\r\n", bytes_read);
         return false;
     }
 
-    uint32_t char_count = (char_count_bytes[0] << 24) | (char_count_bytes[1] << 16) |
-        (char_count_bytes[2] << 8) | char_count_bytes[3];
-
-    if (char_count <= 1000) {
-        for (uint32_t i = 0; i < char_count; i++) {
-            uint8_t unicode_bytes[4];
-            UnicodeCharInfo info;
-
-            if (f_read(file, unicode_bytes, 4, &bytes_read) != FR_OK || bytes_read != 4) {
-                printf("读取字符 %lu 的Unicode码失败\r\n", i);
-                return false;
-            }
-
-            uint32_t unicode = (unicode_bytes[0] << 24) | (unicode_bytes[1] << 16) |
-                (unicode_bytes[2] << 8) | unicode_bytes[3];
-
-            uint8_t info_bytes[12];
-            if (f_read(file, info_bytes, sizeof(info_bytes), &bytes_read) != FR_OK ||
-                bytes_read != sizeof(info_bytes)) {
-                printf("读取字符 %lu 的索引信息失败，读取字节数: %u\r\n", i, bytes_read);
-                return false;
-            }
-
-            info.width = (info_bytes[0] << 8) | info_bytes[1];
-            info.height = (info_bytes[2] << 8) | info_bytes[3];
-            info.data_offset = (info_bytes[4] << 24) | (info_bytes[5] << 16) |
-                (info_bytes[6] << 8) | info_bytes[7];
-            info.data_size = (info_bytes[8] << 24) | (info_bytes[9] << 16) |
-                (info_bytes[10] << 8) | info_bytes[11];
-
-            if (i < char_count) {
-                if (!char_index.Insert(unicode, info)) {
-                    printf("插入字符 %lu (U+%04lX) 到索引失败\r\n", i, unicode);
-                    return false;
-                }
-            }
-        }
+    char_count = ReadBE32(counts);
+    index_offset = 8 + counts_size;
+    if (format_version >= 2) {
+        index_count = ReadBE32(counts + 4);
+        glyph_table_offset = ReadBE32(counts + 8);
+    }
+    else {
+        index_count = char_count;
     }
 
-    printf("字符索引解析完成，共 %lu 个字符\r\n", char_count);
+    bits_per_pixel = format_version == 3 ? counts[12] : 1;
+    if (bits_per_pixel != 1 && bits_per_pixel != 2 && bits_per_pixel != 4) {
+        printf("不支持的每像素位数: %u\r\n", bits_per_pixel);
+        return false;
+    }
 
-    this->char_count = char_count;
+    metric_range_count = 0;
+    metric_width_count = 0;
+    metrics_valid = true;
 
-    if (char_count > 1000) {
+    if (index_count > 1000) {
         use_index_cache = false;
-        printf("字符数超过1000，禁用索引缓存，使用直接文件读取模式\r\n");
+        printf("索引项超过1000，使用稀疏索引，索引项留在文件中\r\n");
         char_index.Clear();
     }
     else {
@@ -290,332 +433,579 @@ bool UnicodeFont::ParseCharIndex(FIL* file) {
         printf("使用索引缓存模式\r\n");
     }
 
+    if (!ScanIndex(file)) return false;
+
+    if (format_version >= 2) printf("字符索引解析完成，共 %lu 个字符，%lu 个区段\r\n", char_count, index_count);
+    else printf("字符索引解析完成，共 %lu 个字符\r\n", char_count);
+
+    CompactMetrics();
+    if (!metrics_valid) printf("字宽表不可用，测量时查找索引\r\n");
+    else if (metric_range_count == 0) printf("等宽字体，测量不查表\r\n");
+    else printf("字宽表: %u 段, %u 字节\r\n", metric_range_count, metric_width_count);
+
     return true;
 }
 
-bool UnicodeFont::LoadChar(uint32_t unicode, std::shared_ptr<uint8_t[]>& bitmap, uint16_t* width, uint16_t* height) {
-    if (!initialized) {
-        printf("LoadChar: 字体未初始化!\r\n");
-        return false;
+// 容量不足时按倍数扩大，保留已有内容
+template <typename T>
+static bool GrowArray(std::unique_ptr<T[]>& array, uint16_t& capacity, uint16_t used) {
+    if (used < capacity) return true;
+    if (capacity == UINT16_MAX) return false;
+
+    uint16_t new_capacity = std::min<uint32_t>(capacity ? capacity * 2 : 16, UINT16_MAX);
+    std::unique_ptr<T[]> grown(new T[new_capacity]);
+    if (used) std::copy_n(array.get(), used, grown.get());
+    array = std::move(grown);
+    capacity = new_capacity;
+    return true;
+}
+
+void UnicodeFont::AddMetric(uint32_t unicode, uint16_t width) {
+    if (!metrics_valid || width == default_width) return;
+    if (width > UINT8_MAX || !GrowArray(metric_widths, metric_width_capacity, metric_width_count)) {
+        metrics_valid = false;
+        return;
     }
 
-    if (use_index_cache) {
-        if (cache.Get(unicode, bitmap)) {
-            if constexpr (FONT_DEBUG_INFO) printf("LoadChar: 字符 U+%04lX 从缓存加载\r\n", unicode);
-            UnicodeCharInfo info;
-            if (char_index.Search(unicode, info)) {
-                *width = info.width;
-                *height = info.height;
-            }
-            else {
-                *width = default_width;
-                *height = default_height;
-            }
-            return true;
+    // 索引按码点升序，与上一段末尾相接的码点直接并入
+    MetricRange* range = metric_range_count ? &metric_ranges[metric_range_count - 1] : nullptr;
+    if (!range || range->first + range->count != unicode) {
+        if ((metric_range_count + 1u) * sizeof(MetricRange) + metric_width_count + 1u > FONT_METRICS_MAX_BYTES ||
+            !GrowArray(metric_ranges, metric_range_capacity, metric_range_count)) {
+            metrics_valid = false;
+            return;
         }
+        range = &metric_ranges[metric_range_count++];
+        range->first = unicode;
+        range->count = 0;
+        range->offset = metric_width_count;
+    }
 
-        UnicodeCharInfo info;
-        if (!char_index.Search(unicode, info)) {
-            printf("LoadChar: 字符 U+%04lX 不在索引中!\r\n", unicode);
-            return false;
-        }
+    metric_widths[metric_width_count++] = width;
+    range->count++;
+}
+
+void UnicodeFont::CompactMetrics() {
+    if (!metrics_valid) {
+        metric_ranges.reset();
+        metric_widths.reset();
+        metric_range_count = metric_range_capacity = 0;
+        metric_width_count = metric_width_capacity = 0;
+        return;
+    }
+
+    // 加载完成后按实际大小重新分配，去掉扩容留下的空位
+    if (metric_range_count < metric_range_capacity) {
+        std::unique_ptr<MetricRange[]> ranges(metric_range_count ? new MetricRange[metric_range_count] : nullptr);
+        std::copy_n(metric_ranges.get(), metric_range_count, ranges.get());
+        metric_ranges = std::move(ranges);
+        metric_range_capacity = metric_range_count;
+    }
+    if (metric_width_count < metric_width_capacity) {
+        std::unique_ptr<uint8_t[]> widths(metric_width_count ? new uint8_t[metric_width_count] : nullptr);
+        std::copy_n(metric_widths.get(), metric_width_count, widths.get());
+        metric_widths = std::move(widths);
+        metric_width_capacity = metric_width_count;
+    }
+}
 
-        if (strlen(font_path) == 0) {
-            printf("LoadChar: 字体路径为空!\r\n");
+bool UnicodeFont::ScanIndex(FIL* file) {
+    // 每次读入一整块索引（32项，512字节），不再逐项读取；同时得到最大的位图大小和字宽表
+    uint32_t block_count = (index_count + FONT_INDEX_SAMPLE_STRIDE - 1) / FONT_INDEX_SAMPLE_STRIDE;
+    if (!use_index_cache) {
+        sample_count = block_count;
+        index_samples.reset(new uint32_t[block_count]);
+    }
+    else if (format_version >= 2) {
+        ranges.reset(new UnicodeCharRange[index_count]);
+    }
+    max_bitmap_size = 0;
+
+    for (uint32_t block = 0; block < block_count; block++) {
+        uint32_t entries = std::min<uint32_t>(FONT_INDEX_SAMPLE_STRIDE, index_count - block * FONT_INDEX_SAMPLE_STRIDE);
+        uint32_t offset = index_offset + block * FONT_INDEX_SAMPLE_STRIDE * FONT_INDEX_ENTRY_SIZE;
+        UINT bytes_read;
+
+        // v2读字形表会移动文件位置，每块重新定位
+        if (f_lseek(file, offset) != FR_OK ||
+            f_read(file, index_block, entries * FONT_INDEX_ENTRY_SIZE, &bytes_read) != FR_OK ||
+            bytes_read != entries * FONT_INDEX_ENTRY_SIZE) {
+            printf("读取第 %lu 块索引失败\r\n", block);
+            sample_count = 0;
             return false;
         }
 
-        static FIL font_file;
-        static bool file_opened = false;
+        if (!use_index_cache) index_samples[block] = ReadBE32(index_block);
+        for (uint32_t i = 0; i < entries; i++) {
+            const uint8_t* entry = index_block + i * FONT_INDEX_ENTRY_SIZE;
+
+            if (format_version >= 2) {
+                UnicodeCharRange range = ParseCharRange(entry);
+                if (use_index_cache) ranges[block * FONT_INDEX_SAMPLE_STRIDE + i] = range;
+                if (!ScanRange(range)) return false;
+                continue;
+            }
+
+            uint32_t unicode = ReadBE32(entry);
+            UnicodeCharInfo info;
+            ParseCharEntry(entry, &info);
+            max_bitmap_size = std::max(max_bitmap_size, GlyphBitmapSize(info.width, info.height));
+            AddMetric(unicode, info.width);
 
-        if (!file_opened) {
-            FRESULT open_result = f_open(&font_file, font_path, FA_READ);
-            if (open_result != FR_OK) {
-                printf("LoadChar: 打开文件失败! 错误码: %d, 路径: %s\r\n", open_result, font_path);
+            if (use_index_cache && !char_index.Insert(unicode, info)) {
+                printf("插入字符 U+%04lX 到索引失败\r\n", unicode);
                 return false;
             }
-            file_opened = true;
         }
+    }
 
-        FRESULT seek_result = f_lseek(&font_file, info.data_offset);
-        if (seek_result != FR_OK) {
-            printf("LoadChar: 文件定位失败! 错误码: %d, 偏移量: %lu\r\n", seek_result, info.data_offset);
-            return false;
-        }
+    if (!use_index_cache) {
+        cached_block = static_cast<int32_t>(sample_count) - 1;
+        printf("稀疏索引建立完成，共 %lu 块\r\n", sample_count);
+    }
+    return true;
+}
 
-        uint32_t bitmap_size = ((info.width + 7) / 8) * info.height;
+bool UnicodeFont::ScanRange(const UnicodeCharRange& range) {
+    if (range.width) {
+        max_bitmap_size = std::max(max_bitmap_size, GlyphBitmapSize(range.width, range.height));
+        for (uint32_t i = 0; i < range.count; i++) AddMetric(range.start + i, range.width);
+        return true;
+    }
 
-        FSIZE_t file_size = f_size(&font_file);
-        if (info.data_offset + bitmap_size > file_size) {
-            printf("LoadChar: 位图数据超出文件范围! 偏移: %lu, 大小: %lu, 文件大小: %lu\r\n",
-                   info.data_offset, bitmap_size, file_size);
+    // 尺寸不一的区段要从字形表取得每个字符的宽高
+    for (uint32_t i = 0; i < range.count; i++) {
+        uint8_t glyph[FONT_GLYPH_ENTRY_SIZE];
+        if (!ReadFileBytes(glyph_table_offset + (range.data + i) * FONT_GLYPH_ENTRY_SIZE, glyph, sizeof(glyph))) {
+            printf("读取字形表失败，序号: %lu\r\n", range.data + i);
             return false;
         }
+        max_bitmap_size = std::max(max_bitmap_size, GlyphBitmapSize(glyph[4], glyph[5]));
+        AddMetric(range.start + i, glyph[4]);
+    }
+    return true;
+}
 
-        std::shared_ptr<uint8_t[]> char_bitmap(new uint8_t[bitmap_size]);
+void UnicodeFont::SetEmbedded(const EmbeddedFont* font) {
+    if (font && initialized && font->bits_per_pixel != bits_per_pixel) {
+        printf("内嵌字形为%u位，字体文件为%u位，不能一起使用\r\n", font->bits_per_pixel, bits_per_pixel);
+        return;
+    }
 
-        UINT bytes_read;
-        FRESULT read_result = f_read(&font_file, char_bitmap.get(), bitmap_size, &bytes_read);
-        if (read_result != FR_OK || bytes_read != bitmap_size) {
-            printf("LoadChar: 读取位图失败! 错误码: %d, 期望字节数: %lu, 实际读取: %u\r\n",
-                   read_result, bitmap_size, bytes_read);
-            return false;
-        }
+    embedded = font;
+    if (embedded && !initialized) {
+        default_width = embedded->default_width;
+        default_height = embedded->default_height;
+        bits_per_pixel = embedded->bits_per_pixel;
+    }
+}
 
-        if (!cache.Put(unicode, char_bitmap)) {
-            printf("LoadChar: 缓存插入失败!\r\n");
-            return false;
-        }
+const EmbeddedGlyph* UnicodeFont::FindEmbedded(uint32_t unicode) const {
+    if (!embedded) return nullptr;
 
-        bitmap = char_bitmap;
-        *width = info.width;
-        *height = info.height;
+    const EmbeddedGlyph* end = embedded->glyphs + embedded->glyph_count;
+    const EmbeddedGlyph* glyph = std::lower_bound(embedded->glyphs, end, unicode,
+                                                  [](const EmbeddedGlyph& g, uint32_t u) { return g.unicode < u; });
+    return glyph != end && glyph->unicode == unicode ? glyph : nullptr;
+}
 
-        if constexpr (FONT_DEBUG_INFO) printf("LoadChar: 字符 U+%04lX 加载成功!\r\n", unicode);
+bool UnicodeFont::LoadChar(uint32_t unicode, const uint8_t*& bitmap, uint16_t* width, uint16_t* height) {
+    // 闪存中的字形直接返回，不占用缓存
+    if (const EmbeddedGlyph* glyph = FindEmbedded(unicode)) {
+        bitmap = embedded->bitmaps + glyph->offset;
+        *width = glyph->width;
+        *height = glyph->height;
         return true;
     }
-    else {
-        return LoadCharFromFile(unicode, bitmap, width, height);
-    }
-}
 
-bool UnicodeFont::LoadCharFromFile(uint32_t unicode, std::shared_ptr<uint8_t[]>& bitmap, uint16_t* width,
-                                   uint16_t* height) {
     if (!initialized) {
-        printf("LoadCharFromFile: 字体未初始化!\r\n");
+        if (!embedded) printf("LoadChar: 字体未初始化!\r\n");
         return false;
     }
 
-    if constexpr (FONT_DEBUG_INFO) printf("LoadCharFromFile: 直接文件读取字符 U+%04lX\r\n", unicode);
-
-    if (strlen(font_path) == 0) {
-        printf("LoadCharFromFile: 字体路径为空!\r\n");
-        return false;
+    bitmap = cache.Get(unicode, width, height);
+    if (bitmap) {
+        if constexpr (FONT_DEBUG_INFO) printf("LoadChar: 字符 U+%04lX 从缓存加载\r\n", unicode);
+        return true;
     }
 
-    FIL font_file;
-    FRESULT open_result = f_open(&font_file, font_path, FA_READ);
-    if (open_result != FR_OK) {
-        printf("LoadCharFromFile: 打开文件失败! 错误码: %d, 路径: %s\r\n", open_result, font_path);
+    UnicodeCharInfo info;
+    if (!FindChar(unicode, &info)) {
+        printf("LoadChar: 字符 U+%04lX 不在字体中!\r\n", unicode);
         return false;
     }
 
-    uint8_t header[8];
-    UINT bytes_read;
-    if (f_read(&font_file, header, 8, &bytes_read) != FR_OK || bytes_read != 8) {
-        printf("LoadCharFromFile: 读取字体头失败\r\n");
-        f_close(&font_file);
-        return false;
+    uint32_t bitmap_size = GlyphBitmapSize(info.width, info.height);
+    uint8_t* dst = cache.Insert(unicode, info.width, info.height, bitmap_size);
+    if (!dst) {
+        if (bitmap_size > scratch_size) {
+            scratch.reset(new uint8_t[bitmap_size]);
+            scratch_size = bitmap_size;
+        }
+        dst = scratch.get();
     }
 
-    uint8_t char_count_bytes[4];
-    if (f_read(&font_file, char_count_bytes, 4, &bytes_read) != FR_OK || bytes_read != 4) {
-        printf("LoadCharFromFile: 读取字符数量失败\r\n");
-        f_close(&font_file);
+    if (!ReadBitmap(info, dst, bitmap_size)) {
+        if (dst != scratch.get()) cache.Remove(unicode);
         return false;
     }
 
-    uint32_t file_char_count = (char_count_bytes[0] << 24) | (char_count_bytes[1] << 16) |
-        (char_count_bytes[2] << 8) | char_count_bytes[3];
-
-    uint32_t data_offset = 0;
-    uint16_t char_width = default_width;
-    uint16_t char_height = default_height;
-    bool found = false;
-
-    uint32_t left = 0;
-    uint32_t right = file_char_count - 1;
+    bitmap = dst;
+    *width = info.width;
+    *height = info.height;
 
-    while (left <= right) {
-        uint32_t mid = left + (right - left) / 2;
+    if constexpr (FONT_DEBUG_INFO) printf("LoadChar: 字符 U+%04lX 加载成功!\r\n", unicode);
+    return true;
+}
 
-        uint32_t mid_offset = 8 + 4 + mid * 16;
+uint16_t UnicodeFont::Preload(const char* utf8_str) {
+    return Preload(&utf8_str, 1);
+}
 
-        FRESULT seek_result = f_lseek(&font_file, mid_offset);
-        if (seek_result != FR_OK) {
-            printf("LoadCharFromFile: 定位中间字符失败! 错误码: %d, 偏移量: %lu\r\n", seek_result, mid_offset);
-            f_close(&font_file);
-            return false;
+uint16_t UnicodeFont::Preload(const char* const* utf8_strings, uint16_t count) {
+    if (!initialized || !utf8_strings) return 0;
+
+    // 本页用到的不同字形都占用缓存容量：已缓存的置访问位保留下来，其余的预读；
+    // 字体中没有的字不占容量，查过索引后丢弃，再从字符串中补充。
+    // 缓存满且所有槽位都被访问过时，插入会清除全部访问位后淘汰，本页刚置位的字形也可能被淘汰；
+    // 先清除访问位，本页的字形（不超过容量）都置位，插入时只淘汰本页之外的字形
+    cache.ClearReferences();
+    const uint16_t capacity = cache.GetMaxCacheSize();
+    std::unique_ptr<PreloadEntry[]> entries(new PreloadEntry[capacity]);
+    uint16_t entry_count = 0;
+    uint16_t resolved = 0;          // 前resolved项已经查过索引
+    uint16_t string_index = 0;
+    const char* ptr = count ? utf8_strings[0] : nullptr;
+    for (;;) {
+        while (entry_count < capacity && string_index < count) {
+            uint32_t unicode = ptr && *ptr != '\0' ? UTF8ToUnicode(&ptr) : 0;
+            if (unicode == 0) {
+                ptr = ++string_index < count ? utf8_strings[string_index] : nullptr;
+                continue;
+            }
+            if (IsBlankCodepoint(unicode) || FindEmbedded(unicode)) continue;
+
+            bool duplicate = false;
+            for (uint16_t j = 0; j < entry_count && !duplicate; j++) duplicate = entries[j].unicode == unicode;
+            if (duplicate) continue;
+            entries[entry_count].unicode = unicode;
+            entries[entry_count].cached = cache.Touch(unicode);
+            entry_count++;
         }
 
-        uint8_t unicode_bytes[4];
-        if (f_read(&font_file, unicode_bytes, 4, &bytes_read) != FR_OK || bytes_read != 4) {
-            printf("LoadCharFromFile: 读取中间字符的Unicode码失败\r\n");
-            f_close(&font_file);
-            return false;
+        // 按码点顺序查索引，稀疏索引时相邻的码点在同一块中
+        std::sort(entries.get() + resolved, entries.get() + entry_count,
+                  [](const PreloadEntry& a, const PreloadEntry& b) { return a.unicode < b.unicode; });
+        uint16_t found = resolved;
+        for (uint16_t i = resolved; i < entry_count; i++) {
+            if (entries[i].cached || FindChar(entries[i].unicode, &entries[i].info)) entries[found++] = entries[i];
         }
+        bool dropped = found < entry_count;
+        entry_count = resolved = found;
+        if (!dropped || string_index >= count) break;
+    }
+
+    uint16_t touched = 0;
+    uint16_t found = 0;
+    for (uint16_t i = 0; i < entry_count; i++) {
+        if (entries[i].cached) touched++;
+        else entries[found++] = entries[i];
+    }
+
+    // 按位图偏移顺序读取，扇区缓存只向前移动，每个扇区只读一次
+    std::sort(entries.get(), entries.get() + found,
+              [](const PreloadEntry& a, const PreloadEntry& b) { return a.info.data_offset < b.info.data_offset; });
+    uint16_t loaded = 0;
+    for (uint16_t i = 0; i < found; i++) {
+        const UnicodeCharInfo& info = entries[i].info;
+        uint32_t bitmap_size = GlyphBitmapSize(info.width, info.height);
+        uint8_t* dst = cache.Insert(entries[i].unicode, info.width, info.height, bitmap_size);
+        if (!dst) continue;
+
+        if (!ReadBitmap(info, dst, bitmap_size)) {
+            cache.Remove(entries[i].unicode);
+            continue;
+        }
+        loaded++;
+    }
 
-        uint32_t current_unicode = (unicode_bytes[0] << 24) | (unicode_bytes[1] << 16) |
-            (unicode_bytes[2] << 8) | unicode_bytes[3];
+    if constexpr (FONT_DEBUG_INFO) printf("Preload: 新载入 %u 个字形，已缓存 %u 个\r\n", loaded, touched);
+    return loaded;
+}
 
-        if (current_unicode == unicode) {
-            uint8_t info_bytes[12];
-            if (f_read(&font_file, info_bytes, sizeof(info_bytes), &bytes_read) != FR_OK ||
-                bytes_read != sizeof(info_bytes)) {
-                printf("LoadCharFromFile: 读取字符信息失败\r\n");
-                f_close(&font_file);
-                return false;
-            }
+bool UnicodeFont::LoadChar(uint32_t unicode, std::shared_ptr<uint8_t[]>& bitmap, uint16_t* width, uint16_t* height) {
+    const uint8_t* cached;
+    if (!LoadChar(unicode, cached, width, height)) return false;
 
-            char_width = (info_bytes[0] << 8) | info_bytes[1];
-            char_height = (info_bytes[2] << 8) | info_bytes[3];
-            data_offset = (info_bytes[4] << 24) | (info_bytes[5] << 16) |
-                (info_bytes[6] << 8) | info_bytes[7];
-            found = true;
-            break;
-        }
-        else if (current_unicode < unicode) {
-            left = mid + 1;
-        }
-        else {
-            right = mid - 1;
+    uint32_t bitmap_size = GlyphBitmapSize(*width, *height);
+    bitmap.reset(new uint8_t[bitmap_size]);
+    memcpy(bitmap.get(), cached, bitmap_size);
+    return true;
+}
+
+const uint8_t* UnicodeFont::GetSector(uint32_t block, uint32_t* length) const {
+    SectorBlock* victim = &sector_blocks[0];
+    for (SectorBlock& entry : sector_blocks) {
+        if (entry.block == block) {
+            entry.stamp = ++sector_clock;
+            *length = entry.length;
+            return sector_data.get() + (&entry - sector_blocks) * FONT_SECTOR_SIZE;
         }
+        if (entry.stamp < victim->stamp) victim = &entry;
     }
 
-    if (!found) {
-        printf("LoadCharFromFile: 字符 U+%04lX 不在字体中!\r\n", unicode);
-        f_close(&font_file);
-        return false;
-    }
+    // 淘汰最久未使用的块；按扇区对齐整块读取，FatFs可以直接读到缓冲区
+    uint8_t* data = sector_data.get() + (victim - sector_blocks) * FONT_SECTOR_SIZE;
+    victim->block = UINT32_MAX;
 
-    FRESULT seek_result = f_lseek(&font_file, data_offset);
+    FRESULT seek_result = f_lseek(&font_file, block * FONT_SECTOR_SIZE);
     if (seek_result != FR_OK) {
-        printf("LoadCharFromFile: 文件定位失败! 错误码: %d, 偏移量: %lu\r\n", seek_result, data_offset);
-        f_close(&font_file);
-        return false;
+        printf("LoadChar: 文件定位失败! 错误码: %d, 块号: %lu\r\n", seek_result, block);
+        return nullptr;
     }
 
-    uint32_t bitmap_size = ((char_width + 7) / 8) * char_height;
+    UINT bytes_read;
+    FRESULT read_result = f_read(&font_file, data, FONT_SECTOR_SIZE, &bytes_read);
+    if (read_result != FR_OK) {
+        printf("LoadChar: 读取位图失败! 错误码: %d, 块号: %lu\r\n", read_result, block);
+        return nullptr;
+    }
+    sector_reads++;
+
+    victim->block = block;
+    victim->length = bytes_read;
+    victim->stamp = ++sector_clock;
+    *length = bytes_read;
+    return data;
+}
 
-    FSIZE_t file_size = f_size(&font_file);
-    if (data_offset + bitmap_size > file_size) {
-        printf("LoadCharFromFile: 位图数据超出文件范围!\r\n");
-        f_close(&font_file);
-        return false;
-    }
+const uint8_t* UnicodeFont::MapFile(uint32_t offset, uint32_t* available) const {
+    if (!sector_data) return nullptr;
 
-    std::shared_ptr<uint8_t[]> char_bitmap(new uint8_t[bitmap_size]);
+    uint32_t length;
+    const uint8_t* sector = GetSector(offset / FONT_SECTOR_SIZE, &length);
+    uint32_t start = offset % FONT_SECTOR_SIZE;
+    if (!sector || start >= length) return nullptr;
 
-    FRESULT read_result = f_read(&font_file, char_bitmap.get(), bitmap_size, &bytes_read);
-    if (read_result != FR_OK || bytes_read != bitmap_size) {
-        printf("LoadCharFromFile: 读取位图失败! 错误码: %d, 期望字节数: %lu, 实际读取: %u\r\n",
-               read_result, bitmap_size, bytes_read);
-        f_close(&font_file);
-        return false;
-    }
+    *available = length - start;
+    return sector + start;
+}
 
-    f_close(&font_file);
+bool UnicodeFont::ReadFileBytes(uint32_t offset, uint8_t* data, uint32_t size) const {
+    // 数据可能跨越块边界，分段从缓存的块中复制
+    while (size) {
+        uint32_t available;
+        const uint8_t* src = MapFile(offset, &available);
+        if (!src) return false;
 
-    bitmap = char_bitmap;
-    *width = char_width;
-    *height = char_height;
+        uint32_t count = std::min(size, available);
+        memcpy(data, src, count);
+        data += count;
+        offset += count;
+        size -= count;
+    }
+    return true;
+}
 
-    if constexpr (FONT_DEBUG_INFO) printf("LoadCharFromFile: 字符 U+%04lX 加载成功!\r\n", unicode);
+bool UnicodeFont::DecodeRLE(const UnicodeCharInfo& info, uint8_t* bitmap, uint32_t size) const {
+    // 行优先的像素游程，每个半字节是一段长度，从空白开始与笔画交替；15表示同色的游程还在继续。
+    // 最后一段空白省略，位图先清零
+    memset(bitmap, 0, size);
+    const uint32_t total = static_cast<uint32_t>(info.width) * info.height;
+    const uint16_t row_bytes = (info.width + 7) / 8;
+    uint32_t pixel = 0;
+    bool ink = false;
+
+    uint32_t offset = info.data_offset;
+    uint32_t remaining = info.data_size;
+    while (remaining) {
+        uint32_t available;
+        const uint8_t* src = MapFile(offset, &available);
+        if (!src) return false;
+
+        uint32_t count = std::min(remaining, available);
+        for (uint32_t i = 0; i < count; i++) {
+            for (uint8_t run : {static_cast<uint8_t>(src[i] >> 4), static_cast<uint8_t>(src[i] & 0x0F)}) {
+                if (pixel + run > total) {
+                    printf("LoadChar: 压缩位图数据错误! 偏移: %lu\r\n", info.data_offset);
+                    return false;
+                }
+                for (uint32_t end = pixel + run; ink && pixel < end; pixel++) {
+                    uint16_t row = pixel / info.width;
+                    uint16_t col = pixel % info.width;
+                    bitmap[row * row_bytes + col / 8] |= 0x80 >> (col % 8);
+                }
+                if (!ink) pixel += run;
+                if (run < 15) ink = !ink;
+            }
+        }
+        offset += count;
+        remaining -= count;
+    }
     return true;
 }
 
-bool UnicodeFont::GetCharWidth(uint32_t unicode, uint16_t* width) const {
-    if (!initialized) {
+bool UnicodeFont::ReadBitmap(const UnicodeCharInfo& info, uint8_t* bitmap, uint32_t size) {
+    if (!file_opened || !sector_data) {
+        printf("LoadChar: 字体文件未打开!\r\n");
         return false;
     }
 
-    if (unicode == 0x0020 || unicode == 0x00A0 || unicode == 0x2000 || unicode == 0x2001 || 
-        unicode == 0x2002 || unicode == 0x2003 || unicode == 0x2004 || unicode == 0x2005 ||
-        unicode == 0x2006 || unicode == 0x2007 || unicode == 0x2008 || unicode == 0x2009 ||
-        unicode == 0x200A || unicode == 0x202F || unicode == 0x205F || unicode == 0x3000) {
-        *width = default_width;
-        return true;
+    uint32_t stored_size = info.encoding == FONT_GLYPH_RLE ? info.data_size : size;
+    if (info.data_offset + stored_size > font_file_size) {
+        printf("LoadChar: 位图数据超出文件范围! 偏移: %lu, 大小: %lu, 文件大小: %lu\r\n",
+               info.data_offset, stored_size, font_file_size);
+        return false;
     }
 
-    if (use_index_cache) {
-        UnicodeCharInfo info;
-        if (char_index.Search(unicode, info)) {
-            *width = info.width;
-            return true;
+    if (info.encoding == FONT_GLYPH_RLE) {
+        // 游程只区分笔画和空白，多位的字形不压缩
+        if (bits_per_pixel != 1) {
+            printf("LoadChar: %u位字形不支持压缩! 偏移: %lu\r\n", bits_per_pixel, info.data_offset);
+            return false;
         }
-        *width = default_width;
+        return DecodeRLE(info, bitmap, size);
+    }
+    return ReadFileBytes(info.data_offset, bitmap, size);
+}
+
+bool UnicodeFont::ResolveRange(const UnicodeCharRange& range, uint32_t unicode, UnicodeCharInfo* info) const {
+    if (unicode < range.start || unicode - range.start >= range.count) return false;
+    uint32_t index = unicode - range.start;
+
+    // 尺寸相同的区段位图依次存放，直接算出偏移；压缩的区段只有一个字符
+    if (range.width) {
+        uint32_t size = GlyphBitmapSize(range.width, range.height);
+        info->width = range.width;
+        info->height = range.height;
+        info->data_offset = range.data + index * size;
+        info->data_size = range.packed ? range.packed & 0x7FFFFFFF : size;
+        info->encoding = (range.packed & 0x80000000) ? FONT_GLYPH_RLE : FONT_GLYPH_RAW;
+        return true;
+    }
+
+    // 字形表项：位图偏移（最高位表示压缩）、宽、高、存储大小
+    uint8_t glyph[FONT_GLYPH_ENTRY_SIZE];
+    if (!ReadFileBytes(glyph_table_offset + (range.data + index) * FONT_GLYPH_ENTRY_SIZE, glyph, sizeof(glyph))) {
+        printf("FindChar: 读取字形表失败! 序号: %lu\r\n", range.data + index);
         return false;
     }
-    else {
-        FIL font_file;
-        FRESULT open_result = f_open(&font_file, font_path, FA_READ);
-        if (open_result != FR_OK) {
-            *width = default_width;
-            return false;
-        }
 
-        uint8_t header[8];
-        UINT bytes_read;
-        if (f_read(&font_file, header, 8, &bytes_read) != FR_OK || bytes_read != 8) {
-            f_close(&font_file);
-            *width = default_width;
-            return false;
-        }
+    uint32_t offset = ReadBE32(glyph);
+    info->width = glyph[4];
+    info->height = glyph[5];
+    info->data_offset = offset & 0x7FFFFFFF;
+    info->data_size = (glyph[6] << 8) | glyph[7];
+    info->encoding = (offset & 0x80000000) ? FONT_GLYPH_RLE : FONT_GLYPH_RAW;
+    return true;
+}
 
-        uint8_t char_count_bytes[4];
-        if (f_read(&font_file, char_count_bytes, 4, &bytes_read) != FR_OK || bytes_read != 4) {
-            f_close(&font_file);
-            *width = default_width;
-            return false;
-        }
+bool UnicodeFont::FindChar(uint32_t unicode, UnicodeCharInfo* info) const {
+    if (!use_index_cache) return FindCharInFile(unicode, info);
+    if (format_version == 1) return char_index.Search(unicode, *info);
 
-        uint32_t file_char_count = (char_count_bytes[0] << 24) | (char_count_bytes[1] << 16) |
-            (char_count_bytes[2] << 8) | char_count_bytes[3];
+    // 最后一个首码点不大于unicode的区段
+    const UnicodeCharRange* begin = ranges.get();
+    const UnicodeCharRange* range = std::upper_bound(begin, begin + index_count, unicode,
+                                                     [](uint32_t u, const UnicodeCharRange& r) { return u < r.start; });
+    if (range == begin) return false;
+    return ResolveRange(*(range - 1), unicode, info);
+}
 
-        uint32_t left = 0;
-        uint32_t right = file_char_count - 1;
-        bool found = false;
+bool UnicodeFont::FindCharInFile(uint32_t unicode, UnicodeCharInfo* info) const {
+    if constexpr (FONT_DEBUG_INFO) printf("FindCharInFile: 在稀疏索引中查找字符 U+%04lX\r\n", unicode);
 
-        while (left <= right) {
-            uint32_t mid = left + (right - left) / 2;
+    if (!file_opened || !sample_count) return false;
 
-            uint32_t mid_offset = 8 + 4 + mid * 16;
+    // 内存中找到所在的块：最后一个首码点不大于unicode的块
+    const uint32_t* samples = index_samples.get();
+    const uint32_t* next = std::upper_bound(samples, samples + sample_count, unicode);
+    if (next == samples) return false;
+    auto block = static_cast<uint32_t>(next - samples - 1);
+    uint32_t entries = std::min<uint32_t>(FONT_INDEX_SAMPLE_STRIDE, index_count - block * FONT_INDEX_SAMPLE_STRIDE);
 
-            FRESULT seek_result = f_lseek(&font_file, mid_offset);
-            if (seek_result != FR_OK) {
-                f_close(&font_file);
-                *width = default_width;
-                return false;
-            }
+    // 相邻的字符通常在同一块中，不需要再读卡
+    if (static_cast<int32_t>(block) != cached_block) {
+        uint32_t offset = index_offset + block * FONT_INDEX_SAMPLE_STRIDE * FONT_INDEX_ENTRY_SIZE;
+        UINT bytes_read;
+        cached_block = -1;
+        FRESULT seek_result = f_lseek(&font_file, offset);
+        if (seek_result != FR_OK) {
+            printf("FindCharInFile: 定位索引块失败! 错误码: %d, 偏移量: %lu\r\n", seek_result, offset);
+            return false;
+        }
+        if (f_read(&font_file, index_block, entries * FONT_INDEX_ENTRY_SIZE, &bytes_read) != FR_OK ||
+            bytes_read != entries * FONT_INDEX_ENTRY_SIZE) {
+            printf("FindCharInFile: 读取索引块失败\r\n");
+            return false;
+        }
+        cached_block = static_cast<int32_t>(block);
+    }
 
-            uint8_t unicode_bytes[4];
-            if (f_read(&font_file, unicode_bytes, 4, &bytes_read) != FR_OK || bytes_read != 4) {
-                f_close(&font_file);
-                *width = default_width;
-                return false;
-            }
+    // 块内最后一个首码点不大于unicode的项：v1要求码点相等，v2检查是否落在区段内
+    uint32_t left = 0;
+    uint32_t right = entries;
+    while (left < right) {
+        uint32_t mid = left + (right - left) / 2;
+        if (ReadBE32(index_block + mid * FONT_INDEX_ENTRY_SIZE) <= unicode) left = mid + 1;
+        else right = mid;
+    }
+    if (left == 0) return false;
 
-            uint32_t current_unicode = (unicode_bytes[0] << 24) | (unicode_bytes[1] << 16) |
-                (unicode_bytes[2] << 8) | unicode_bytes[3];
+    const uint8_t* entry = index_block + (left - 1) * FONT_INDEX_ENTRY_SIZE;
+    if (format_version >= 2) return ResolveRange(ParseCharRange(entry), unicode, info);
+    if (ReadBE32(entry) != unicode) return false;
+    ParseCharEntry(entry, info);
+    return true;
+}
 
-            if (current_unicode == unicode) {
-                uint8_t info_bytes[12];
-                if (f_read(&font_file, info_bytes, sizeof(info_bytes), &bytes_read) != FR_OK ||
-                    bytes_read != sizeof(info_bytes)) {
-                    f_close(&font_file);
-                    *width = default_width;
-                    return false;
-                }
+bool UnicodeFont::GetCharWidth(uint32_t unicode, uint16_t* width) const {
+    if (!IsValid()) {
+        return false;
+    }
 
-                *width = (info_bytes[0] << 8) | info_bytes[1];
-                found = true;
-                break;
-            }
-            else if (current_unicode < unicode) {
-                left = mid + 1;
-            }
-            else {
-                right = mid - 1;
-            }
-        }
+    if (IsBlankCodepoint(unicode)) {
+        *width = default_width;
+        return true;
+    }
 
-        f_close(&font_file);
+    if (const EmbeddedGlyph* glyph = FindEmbedded(unicode)) {
+        *width = glyph->width;
+        return true;
+    }
 
-        if (!found) {
-            *width = default_width;
-            return false;
-        }
+    if (!initialized) {
+        *width = default_width;
+        return false;
+    }
 
+    UnicodeCharInfo info;
+    if (FindChar(unicode, &info)) {
+        *width = info.width;
         return true;
     }
+    *width = default_width;
+    return false;
+}
+
+uint16_t UnicodeFont::MeasureChar(uint32_t unicode) const {
+    if (!IsValid() || IsBlankCodepoint(unicode)) return default_width;
+    if (const EmbeddedGlyph* glyph = FindEmbedded(unicode)) return glyph->width;
+    if (!initialized) return default_width;
+
+    if (!metrics_valid) {
+        uint16_t width;
+        GetCharWidth(unicode, &width);
+        return width;
+    }
+    if (metric_range_count == 0) return default_width;
+
+    // 找到起始码点不大于unicode的最后一段
+    const MetricRange* ranges = metric_ranges.get();
+    const MetricRange* range = std::upper_bound(ranges, ranges + metric_range_count, unicode,
+                                                [](uint32_t u, const MetricRange& r) { return u < r.first; });
+    if (range == ranges) return default_width;
+    --range;
+    if (unicode - range->first >= range->count) return default_width;
+    return metric_widths[range->offset + (unicode - range->first)];
 }
@@ -11,11 +11,62 @@
 #define LRU_CACHE_SIZE 20
 #define FONT_DEBUG_INFO false
 
+#define FONT_INDEX_SAMPLE_STRIDE 32
+// 字符数超过1000的字体索引留在文件中，内存里每FONT_INDEX_SAMPLE_STRIDE项保存一个码点
+
+#define FONT_INDEX_ENTRY_SIZE 16
+// 索引每项16字节，FONT_INDEX_SAMPLE_STRIDE项正好512字节，查找一个字符最多读一次卡
+
+#define FONT_GLYPH_ENTRY_SIZE 8
+// 字形表（尺寸不一的区段使用）每项的字节数
+
+#define FONT_SECTOR_SIZE 512
+// 位图按512字节的文件块读入，相邻码点的位图连续存放，一次读卡可供许多字形使用
+
+#define FONT_SECTOR_CACHE_BLOCKS 4
+// 缓存的文件块数（LRU）
+
+#define FONT_METRICS_MAX_BYTES 8192
+// 字宽表的内存上限，非默认宽度的字符过于分散时放弃字宽表
+
+enum FontGlyphEncoding : uint8_t {
+    FONT_GLYPH_RAW = 0,     // 每行按字节对齐的位图，每像素1、2或4位，高位在前
+    FONT_GLYPH_RLE = 1,     // 半字节游程编码（仅v2格式的1位字形）
+};
+
+// 位图每行的字节数。多位的字形每个像素是笔画的覆盖度，0为背景，全1为前景
+inline uint32_t GlyphRowBytes(uint16_t width, uint8_t bits_per_pixel) {
+    return (static_cast<uint32_t>(width) * bits_per_pixel + 7) / 8;
+}
+
+// 位图一行中第col个像素的值，高位在前
+inline uint8_t GetGlyphLevel(const uint8_t* row, uint16_t col, uint8_t bits_per_pixel) {
+    uint32_t bit = static_cast<uint32_t>(col) * bits_per_pixel;
+    return (row[bit >> 3] >> (8 - bits_per_pixel - (bit & 7))) & ((1 << bits_per_pixel) - 1);
+}
+
+// 解码*utf8_str处的一个字符并前进，遇到非法的序列返回0
+uint32_t UTF8ToUnicode(const char** utf8_str);
+bool IsUTF8ContinuationByte(uint8_t byte);
+
 struct UnicodeCharInfo {
     uint16_t width = 0;
     uint16_t height = 0;
     uint32_t data_offset = 0;
-    uint32_t data_size = 0;
+    uint32_t data_size = 0;     // 文件中存储的字节数
+    FontGlyphEncoding encoding = FONT_GLYPH_RAW;
+};
+
+// v2格式的区段：码点连续的一组字符。width不为0时区段内字符尺寸相同，位图从data处依次存放，
+// 只有单个字符的区段可以压缩（packed最高位为压缩标志，其余为存储大小）；
+// width为0时data为字形表中第一个字符的序号，每个字符在字形表中有自己的尺寸、偏移和编码
+struct UnicodeCharRange {
+    uint32_t start = 0;
+    uint16_t count = 0;
+    uint8_t width = 0;
+    uint8_t height = 0;
+    uint32_t data = 0;
+    uint32_t packed = 0;
 };
 
 struct UnicodeCharEntry {
@@ -44,66 +95,212 @@ public:
     [[nodiscard]] bool IsEmpty() const { return entry_count == 0; }
 };
 
-class LRUCache {
+// 编译进闪存的字形子集，由font_converter.py --embed-header生成。字形按码点升序排列，位图与文件中的格式相同
+struct EmbeddedGlyph {
+    uint32_t unicode;
+    uint8_t width;
+    uint8_t height;
+    uint32_t offset;    // 在bitmaps中的位置
+};
+
+struct EmbeddedFont {
+    uint16_t default_width;
+    uint16_t default_height;
+    uint16_t glyph_count;
+    const EmbeddedGlyph* glyphs;
+    const uint8_t* bitmaps;
+    uint8_t bits_per_pixel = 1;     // 必须与一起使用的字体文件相同
+};
+
+// 生成的头文件用static_assert检查字形有序，查找时才能二分
+template <size_t N>
+constexpr bool IsEmbeddedGlyphsSorted(const EmbeddedGlyph (&glyphs)[N]) {
+    for (size_t i = 1; i < N; i++) {
+        if (glyphs[i - 1].unicode >= glyphs[i].unicode) return false;
+    }
+    return true;
+}
+
+struct GlyphCacheStats {
+    uint32_t hits = 0;
+    uint32_t misses = 0;
+    uint32_t evictions = 0;
+};
+
+// 定长字形缓存：码点经开放寻址散列表（线性探测）找到槽位，位图放在按槽位等分的预分配内存中，
+// 用CLOCK算法淘汰。查找、插入和淘汰都不分配堆内存
+class GlyphCache {
 private:
-    struct CacheEntry {
+    struct Slot {
         uint32_t unicode;
-        std::shared_ptr<uint8_t[]> bitmap;
-        CacheEntry* prev;
-        CacheEntry* next;
-        
-        CacheEntry(uint32_t u, std::shared_ptr<uint8_t[]> b) 
-            : unicode(u), bitmap(std::move(b)), prev(nullptr), next(nullptr) {}
+        uint16_t width;
+        uint16_t height;
+        bool used;
+        bool referenced;        // CLOCK的访问位，命中时置位，指针扫过时清除
     };
-    
-    int capacity;
-    int size;
-    CacheEntry* head;
-    CacheEntry* tail;
-    
-    void MoveToFront(CacheEntry* entry);
-    void RemoveTail();
-    
+
+    static constexpr uint16_t EMPTY = 0xFFFF;
+
+    Slot* slots = nullptr;
+    uint16_t* table = nullptr;  // 散列表，存放槽位下标
+    uint8_t* slab = nullptr;
+    uint16_t capacity = 0;
+    uint16_t table_mask = 0;
+    uint8_t table_bits = 0;
+    uint32_t slot_bytes = 0;
+    uint16_t count = 0;
+    uint16_t hand = 0;
+    GlyphCacheStats stats;
+
+    [[nodiscard]] uint16_t Hash(uint32_t unicode) const;
+    [[nodiscard]] int32_t Find(uint32_t unicode) const;
+    void EraseAt(uint16_t position);
+
 public:
-    explicit LRUCache(int capacity = LRU_CACHE_SIZE);
-    ~LRUCache();
-    
-    bool Get(uint32_t unicode, std::shared_ptr<uint8_t[]>& bitmap);
-    bool Put(uint32_t unicode, const std::shared_ptr<uint8_t[]>& bitmap);
+    GlyphCache() = default;
+    ~GlyphCache();
+    GlyphCache(const GlyphCache&) = delete;
+    GlyphCache& operator=(const GlyphCache&) = delete;
+
+    // 按最大的字形位图大小分配capacity个槽位
+    bool Allocate(uint16_t capacity, uint32_t slot_bytes);
+    void Release();
+
+    // 命中时返回位图，指针在该槽位被淘汰（之后的Insert）之前有效
+    const uint8_t* Get(uint32_t unicode, uint16_t* width, uint16_t* height);
+    // 为新字形取得一个槽位（必要时淘汰），返回位图的写入位置；size超过槽位大小时返回nullptr
+    uint8_t* Insert(uint32_t unicode, uint16_t width, uint16_t height, uint32_t size);
+    // 写入失败时撤销Insert
+    void Remove(uint32_t unicode);
+    // 已缓存时置访问位（不计入统计），避免随后的插入把它淘汰
+    bool Touch(uint32_t unicode);
+    // 清除所有槽位的访问位：之后Touch和Insert的字形在这些槽位被淘汰之前不会被淘汰
+    void ClearReferences();
     void Clear();
-    
-    [[nodiscard]] int GetCacheSize() const { return size; }
-    [[nodiscard]] int GetMaxCacheSize() const { return capacity; }
+
+    [[nodiscard]] uint16_t GetCacheSize() const { return count; }
+    [[nodiscard]] uint16_t GetMaxCacheSize() const { return capacity; }
+    [[nodiscard]] uint32_t GetSlotBytes() const { return slot_bytes; }
+    [[nodiscard]] const GlyphCacheStats& GetStats() const { return stats; }
 };
 
 class UnicodeFont {
 private:
     char font_path[256]{};
     SimpleCharIndex char_index;
-    LRUCache cache;
+    GlyphCache cache;
+    std::unique_ptr<uint8_t[]> scratch;     // 超过槽位大小的字形放在这里，下一次LoadChar前有效
+    uint32_t scratch_size = 0;
+    uint32_t max_bitmap_size = 0;
+
+    // v1每个字符一个索引项；v2每个区段一项，尺寸不一的区段另有字形表；v3与v2相同，另记录每像素位数
+    uint8_t format_version = 1;
+    uint8_t bits_per_pixel = 1;
+    uint32_t index_offset = 0;
+    uint32_t index_count = 0;
+    uint32_t glyph_table_offset = 0;
+    std::unique_ptr<UnicodeCharRange[]> ranges;     // v2区段不超过1000个时全部放在内存中
+
+    // 每个字体各自保持打开的文件，不再每个字符重新打开
+    mutable FIL font_file{};
+    mutable bool file_opened = false;
+
+    // 稀疏索引：每块索引项的第一个码点，以及最近读入的一块索引
+    std::unique_ptr<uint32_t[]> index_samples;
+    uint32_t sample_count = 0;
+    mutable uint8_t index_block[FONT_INDEX_SAMPLE_STRIDE * FONT_INDEX_ENTRY_SIZE]{};
+    mutable int32_t cached_block = -1;
+
+    // 位图的扇区缓存：block为文件中的块号，stamp越大表示越近使用
+    struct SectorBlock {
+        uint32_t block = UINT32_MAX;
+        uint32_t length = 0;
+        uint32_t stamp = 0;
+    };
+    mutable SectorBlock sector_blocks[FONT_SECTOR_CACHE_BLOCKS];
+    std::unique_ptr<uint8_t[]> sector_data;
+    mutable uint32_t sector_clock = 0;
+    mutable uint32_t sector_reads = 0;
+
+    // 字宽表：宽度等于默认宽度的字符与不在字体中的字符测量结果相同，不必记录；
+    // 其余字符按连续码点分段，每个字符一个字节。全部等宽的字体表为空
+    struct MetricRange {
+        uint32_t first;
+        uint16_t count;
+        uint16_t offset;    // 在metric_widths中的起始位置
+    };
+    std::unique_ptr<MetricRange[]> metric_ranges;
+    std::unique_ptr<uint8_t[]> metric_widths;
+    uint16_t metric_range_count = 0;
+    uint16_t metric_range_capacity = 0;
+    uint16_t metric_width_count = 0;
+    uint16_t metric_width_capacity = 0;
+    bool metrics_valid = false;     // 宽度超过255或表太大时为false，测量退回GetCharWidth
     uint16_t default_width;
     uint16_t default_height;
     uint32_t font_file_size;
     bool initialized;
+    const EmbeddedFont* embedded = nullptr;
     bool use_index_cache;
     uint32_t char_count;
     
     bool ParseFontHeader(FIL* file);
     bool ParseCharIndex(FIL* file);
-    bool LoadCharFromFile(uint32_t unicode, std::shared_ptr<uint8_t[]>& bitmap, uint16_t* width, uint16_t* height);
+    bool ScanIndex(FIL* file);
+    bool ScanRange(const UnicodeCharRange& range);
+    bool FindChar(uint32_t unicode, UnicodeCharInfo* info) const;
+    bool FindCharInFile(uint32_t unicode, UnicodeCharInfo* info) const;
+    bool ResolveRange(const UnicodeCharRange& range, uint32_t unicode, UnicodeCharInfo* info) const;
+    [[nodiscard]] uint32_t GlyphBitmapSize(uint16_t width, uint16_t height) const {
+        return GlyphRowBytes(width, bits_per_pixel) * height;
+    }
+    bool ReadBitmap(const UnicodeCharInfo& info, uint8_t* bitmap, uint32_t size);
+    bool DecodeRLE(const UnicodeCharInfo& info, uint8_t* bitmap, uint32_t size) const;
+    const uint8_t* GetSector(uint32_t block, uint32_t* length) const;
+    const uint8_t* MapFile(uint32_t offset, uint32_t* available) const;
+    bool ReadFileBytes(uint32_t offset, uint8_t* data, uint32_t size) const;
+    [[nodiscard]] const EmbeddedGlyph* FindEmbedded(uint32_t unicode) const;
+
+    struct PreloadEntry {
+        uint32_t unicode;
+        bool cached;            // 已在缓存中，只保留不读取
+        UnicodeCharInfo info;
+    };
+    void AddMetric(uint32_t unicode, uint16_t width);
+    void CompactMetrics();
     
 public:
     UnicodeFont();
     ~UnicodeFont();
     
     bool Load(const char* path, int cache_size = LRU_CACHE_SIZE);
-    [[nodiscard]] bool IsValid() const { return initialized; }
+    // 附加闪存中的字形子集，LoadChar先查这里再读卡；没有加载字体文件时也可以单独使用
+    void SetEmbedded(const EmbeddedFont* font);
+    [[nodiscard]] bool IsValid() const { return initialized || embedded; }
+    // 返回缓存中的位图，不复制也不分配内存；指针在下一次LoadChar之前一定有效，
+    // 缓存命中的字形在其槽位被淘汰之前都有效
+    bool LoadChar(uint32_t unicode, const uint8_t*& bitmap, uint16_t* width, uint16_t* height);
+    // 预读字符串中的字形到缓存：码点去重，按位图在文件中的位置排序后顺序读取，相邻字形共用一次读卡。
+    // 不同的字（包括已缓存的，不包括字体中没有的）超过缓存容量时后面的不预读，返回新载入的字形数。
+    // 缓存已满时只淘汰本页之外的字形，本页的字形之后都能命中
+    uint16_t Preload(const char* utf8_str);
+    uint16_t Preload(const char* const* utf8_strings, uint16_t count);
+    // 返回位图的副本，由调用者持有
     bool LoadChar(uint32_t unicode, std::shared_ptr<uint8_t[]>& bitmap, uint16_t* width, uint16_t* height);
     bool GetCharWidth(uint32_t unicode, uint16_t* width) const;
+    // 测量用的字宽，不在字体中的字符返回默认宽度；只查内存中的字宽表，不读卡
+    [[nodiscard]] uint16_t MeasureChar(uint32_t unicode) const;
+    [[nodiscard]] bool IsMonospace() const { return metrics_valid && metric_range_count == 0; }
     [[nodiscard]] uint16_t GetDefaultWidth() const { return default_width; }
     [[nodiscard]] uint16_t GetDefaultHeight() const { return default_height; }
     [[nodiscard]] bool UsesIndexCache() const { return use_index_cache; }
     [[nodiscard]] uint32_t GetCharCount() const { return char_count; }
+    [[nodiscard]] uint8_t GetFormatVersion() const { return format_version; }
+    // LoadChar返回的位图每像素的位数：1为单色，2或4为抗锯齿的覆盖度
+    [[nodiscard]] uint8_t GetBitsPerPixel() const { return bits_per_pixel; }
+    [[nodiscard]] const GlyphCacheStats& GetCacheStats() const { return cache.GetStats(); }
+    // 读取位图和字形表时实际读卡的次数
+    [[nodiscard]] uint32_t GetSectorReadCount() const { return sector_reads; }
 };
 
 #endif // UNICODE_FONT_TYPES_H
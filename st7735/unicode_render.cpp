@@ -1,325 +1,399 @@
 #include "unicode_render.h"
 #include "st7735.h"
 #include <cstdio>
+#include <cstring>
 #include <memory>
+#include <algorithm>
 
-static bool GetBitmapPixel(const uint8_t* bitmap, uint16_t width, uint16_t height, uint16_t x, uint16_t y) {
-    if (x >= width || y >= height) return false;
-    
-    uint32_t bytes_per_row = (width + 7) / 8;
-    uint32_t byte_index = y * bytes_per_row + (x / 8);
-    uint8_t bit_offset = 7 - (x % 8);
-    
-    uint32_t total_bytes = bytes_per_row * height;
-    if (byte_index >= total_bytes) return false;
-    
-    return (bitmap[byte_index] >> bit_offset) & 1;
+// 文字行条带：一行文字按列分块展开为像素，两块交替使用，一块由DMA发送时CPU展开下一块
+static uint16_t line_strips[2][UNICODE_LINE_STRIP_PIXELS];
+static volatile bool line_busy[2] = {false, false};
+
+// 位图的半字节对应的4个像素，颜色变化时重建
+static uint16_t expand_lut[16][4];
+static uint16_t lut_color, lut_bgcolor;
+static bool lut_valid = false;
+
+// 多位字形的颜色梯度，颜色变化或每像素位数变化时重建
+static uint16_t level_ramp[UNICODE_GLYPH_MAX_LEVELS];
+static uint8_t ramp_bits = 0;
+
+static void PrepareExpandLUT(uint16_t color, uint16_t bgcolor) {
+    if (lut_valid && lut_color == color && lut_bgcolor == bgcolor) return;
+
+    for (uint8_t nibble = 0; nibble < 16; nibble++) {
+        for (uint8_t i = 0; i < 4; i++) {
+            expand_lut[nibble][i] = (nibble & (0x08 >> i)) ? color : bgcolor;
+        }
+    }
+    lut_color = color;
+    lut_bgcolor = bgcolor;
+    lut_valid = true;
+    ramp_bits = 0;
 }
 
-void WriteUnicodeChar(uint16_t x, uint16_t y, uint32_t unicode, UnicodeFont* font, uint16_t color, uint16_t bgcolor) {
-    if (!font || !font->IsValid()) {
-        printf("WriteUnicodeChar: 字体无效!\r\n");
-        return;
+// 把位图一行的[from, to)列展开为像素，对齐的整字节查表一次得到8个像素
+static void ExpandBitmapRow(uint16_t* dst, const uint8_t* bits, uint16_t from, uint16_t to) {
+    uint16_t col = from;
+    for (; col < to && (col & 7); col++) {
+        *dst++ = (bits[col >> 3] & (0x80 >> (col & 7))) ? lut_color : lut_bgcolor;
     }
-    
-    std::shared_ptr<uint8_t[]> bitmap;
-    uint16_t width, height;
-    
-    if (!font->LoadChar(unicode, bitmap, &width, &height)) {
-        printf("WriteUnicodeChar: 字符 U+%04lX 不在字体中，绘制占位符方框!\r\n", unicode);
-        width = font->GetDefaultWidth();
-        height = font->GetDefaultHeight();
-        DrawPlaceholderBox(x, y, width, height, color);
-        return;
+    for (; col + 8 <= to; col += 8) {
+        uint8_t byte = bits[col >> 3];
+        memcpy(dst, expand_lut[byte >> 4], sizeof(expand_lut[0]));
+        memcpy(dst + 4, expand_lut[byte & 0x0F], sizeof(expand_lut[0]));
+        dst += 8;
     }
-    
-    uint16_t baseline_offset = (font->GetDefaultHeight() * 8) / 10;
-    uint16_t char_baseline = (height * 8) / 10;
-    
-    uint16_t render_y = y + baseline_offset - char_baseline;
-    
-    if (FONT_RENDER_DEBUG_INFO) printf("WriteUnicodeChar: 渲染字符 U+%04lX, 位置: (%d, %d), 尺寸: %dx%d, 基线Y: %d\r\n",
-           unicode, x, render_y, width, height, render_y);
-    
-    if (x + width > ST7735_WIDTH || render_y + height > ST7735_HEIGHT) {
-        printf("WriteUnicodeChar: 位置超出屏幕范围!\r\n");
-        return;
+    for (; col < to; col++) {
+        *dst++ = (bits[col >> 3] & (0x80 >> (col & 7))) ? lut_color : lut_bgcolor;
     }
-    
-    uint16_t pixel_count = 0;
-    uint16_t* row_buffer = (uint16_t*)malloc(width * sizeof(uint16_t));
-    if (!row_buffer) {
-        printf("WriteUnicodeChar: 内存分配失败!\r\n");
-        return;
+}
+
+// 多位字形一行的[from, to)列按覆盖度查颜色梯度展开
+static void ExpandLevelRow(uint16_t* dst, const uint8_t* bits, uint16_t from, uint16_t to, uint8_t bits_per_pixel) {
+    if (ramp_bits != bits_per_pixel) {
+        BuildGlyphRamp(level_ramp, bits_per_pixel, lut_color, lut_bgcolor);
+        ramp_bits = bits_per_pixel;
     }
-    
-    uint16_t bytes_per_row = (width + 7) / 8;
-    
-    for (uint16_t row = 0; row < height; row++) {
-        const uint8_t* bitmap_row = bitmap.get() + row * bytes_per_row;
-        
-        for (uint16_t col = 0; col < width; col++) {
-            uint8_t byte_index = col / 8;
-            uint8_t bit_mask = 1 << (7 - (col % 8));
-            
-            if (bitmap_row[byte_index] & bit_mask) {
-                row_buffer[col] = color;
-                pixel_count++;
-            } else {
-                row_buffer[col] = bgcolor;
-            }
-        }
-        
-        ST7735_Select();
-        ST7735_SetAddressWindow(x, render_y + row, x + width - 1, render_y + row);
-        ST7735_DC_HIGH();
-        
-        uint8_t* byte_buffer = (uint8_t*)row_buffer;
-        for (uint16_t i = 0; i < width; i++) {
-            uint8_t tmp = byte_buffer[i * 2];
-            byte_buffer[i * 2] = byte_buffer[i * 2 + 1];
-            byte_buffer[i * 2 + 1] = tmp;
-        }
-        
-        HAL_SPI_Transmit(&ST7735_SPI_PORT, byte_buffer, width * 2, HAL_MAX_DELAY);
-        ST7735_Unselect();
+    for (uint16_t col = from; col < to; col++) {
+        *dst++ = level_ramp[GetGlyphLevel(bits, col, bits_per_pixel)];
     }
-    
-    free(row_buffer);
-    
-    if (FONT_RENDER_DEBUG_INFO) printf("WriteUnicodeChar: 字符 U+%04lX 渲染完成，绘制了 %d 个像素\r\n", unicode, pixel_count);
 }
 
-void WriteUnicodeString(uint16_t x, uint16_t y, const uint32_t* unicode_str, UnicodeFont* font, uint16_t color, uint16_t bgcolor) {
-    if (!unicode_str || !font || !font->IsValid()) return;
-    
-    uint16_t total_width = 0;
-    uint16_t line_width = 0;
-    uint16_t line_count = 1;
-    
-    const uint32_t* temp_ptr = unicode_str;
-    while (*temp_ptr != 0) {
-        uint16_t width;
-        
-        if (!font->GetCharWidth(*temp_ptr, &width)) {
-            width = font->GetDefaultWidth();
-        }
-        
-        if (line_width + width > ST7735_WIDTH) {
-            if (line_width > total_width) {
-                total_width = line_width;
+static void LineStripDone(void* user) {
+    *static_cast<volatile bool*>(user) = false;
+}
+
+// 把一行文字连同背景展开到条带中，每块只设置一次地址窗口、用一次DMA发送。
+// 字形必须按从左到右的顺序放置；超出初始宽度的字形会把行加宽，直到屏幕右边缘
+class TextLineWriter {
+public:
+    TextLineWriter(uint16_t x, uint16_t y, uint16_t width, uint16_t height) : x(x), y(y), width(width) {
+        uint16_t screen_width = ST7735_GetWidth();
+        uint16_t screen_height = ST7735_GetHeight();
+        if (x >= screen_width || y >= screen_height) return;
+
+        this->height = std::min<uint16_t>(height, screen_height - y);
+        max_width = screen_width - x;
+        this->width = std::min(width, max_width);
+        if (this->height) chunk_columns = UNICODE_LINE_STRIP_PIXELS / this->height;
+    }
+
+    // gx为相对行首的列，gy为相对行顶的行，可以为负（超出行高的部分被裁掉）
+    void Glyph(uint16_t gx, int16_t gy, const uint8_t* bitmap, uint16_t w, uint16_t h, uint8_t bits_per_pixel) {
+        if (!chunk_columns) return;
+        if (gx + w > width) width = std::min<uint16_t>(gx + w, max_width);
+
+        uint16_t end = std::min<uint16_t>(gx + w, width);
+        uint16_t bytes_per_row = GlyphRowBytes(w, bits_per_pixel);
+        int16_t row0 = std::max<int16_t>(0, -gy);
+        int16_t row1 = std::min<int16_t>(h, height - gy);
+
+        uint16_t col = gx;
+        while (col < end) {
+            if (!open) Begin();
+            uint16_t chunk_end = chunk_x + chunk_w;
+            if (col >= chunk_end) {
+                Submit();
+                continue;
             }
-            line_width = width;
-            line_count++;
-        } else {
-            line_width += width;
+
+            // 跨越块边界的字形分两次展开
+            uint16_t stop = std::min(end, chunk_end);
+            uint16_t* dst = line_strips[index] + (col - chunk_x);
+            for (int16_t row = row0; row < row1; row++) {
+                if (bits_per_pixel == 1) {
+                    ExpandBitmapRow(dst + (row + gy) * chunk_w, bitmap + row * bytes_per_row, col - gx, stop - gx);
+                }
+                else {
+                    ExpandLevelRow(dst + (row + gy) * chunk_w, bitmap + row * bytes_per_row, col - gx, stop - gx,
+                                   bits_per_pixel);
+                }
+            }
+            col = stop;
         }
-        
-        temp_ptr++;
     }
-    
-    if (line_width > total_width) {
-        total_width = line_width;
-    }
-    
-    uint16_t total_height = line_count * font->GetDefaultHeight();
-    
-    ST7735_FillRectangle(x, y, total_width, total_height, bgcolor);
-    
-    uint16_t current_x = x;
-    uint16_t current_y = y;
-    
-    while (*unicode_str != 0) {
-        std::shared_ptr<uint8_t[]> bitmap;
-        uint16_t width, height;
-        
-        if (!font->LoadChar(*unicode_str, bitmap, &width, &height)) {
-            width = font->GetDefaultWidth();
-            height = font->GetDefaultHeight();
-        }
-        
-        if (current_x + width > ST7735_WIDTH) {
-            current_x = x;
-            current_y += font->GetDefaultHeight();
-            
-            if (current_y + font->GetDefaultHeight() > ST7735_HEIGHT) {
-                break;
-            }
+
+    // 发送剩余的列，之后不再引用条带以外的数据，不必等待DMA完成
+    void Finish() {
+        if (!chunk_columns) return;
+        while (chunk_x < width) {
+            if (!open) Begin();
+            Submit();
         }
-        
-        WriteUnicodeCharNoBg(current_x, current_y, *unicode_str, font, color);
-        
-        current_x += width;
-        unicode_str++;
     }
-}
 
-bool IsUTF8ContinuationByte(uint8_t byte) {
-    return (byte & 0xC0) == 0x80;
+private:
+    uint16_t x, y, width;
+    uint16_t height = 0, max_width = 0;
+    uint16_t chunk_columns = 0;
+    uint16_t chunk_x = 0, chunk_w = 0;
+    uint8_t index = 0;
+    bool open = false;
+
+    void Begin() {
+        // 等待这块条带上一次的DMA完成，此时另一块可能仍在发送
+        while (line_busy[index]);
+        chunk_w = std::min<uint16_t>(chunk_columns, width - chunk_x);
+        std::fill_n(line_strips[index], chunk_w * height, lut_bgcolor);
+        open = true;
+    }
+
+    void Submit() {
+        line_busy[index] = true;
+        ST7735_QueueWindow(x + chunk_x, y, x + chunk_x + chunk_w - 1, y + height - 1, line_strips[index],
+                           static_cast<uint32_t>(chunk_w) * height * sizeof(uint16_t), LineStripDone,
+                           const_cast<bool*>(&line_busy[index]));
+        index ^= 1;
+        chunk_x += chunk_w;
+        open = false;
+    }
+};
+
+// 与DrawPlaceholderBox相同的方框加对角线图案
+static std::shared_ptr<uint8_t[]> MakePlaceholderBitmap(uint16_t width, uint16_t height) {
+    uint16_t bytes_per_row = (width + 7) / 8;
+    std::shared_ptr<uint8_t[]> bitmap(new uint8_t[bytes_per_row * height]());
+    auto set = [&](uint16_t col, uint16_t row) {
+        bitmap[row * bytes_per_row + col / 8] |= 0x80 >> (col % 8);
+    };
+
+    for (uint16_t i = 0; i < width; i++) {
+        set(i, 0);
+        set(i, height - 1);
+    }
+    for (uint16_t i = 0; i < height; i++) {
+        set(0, i);
+        set(width - 1, i);
+    }
+    for (uint16_t i = 0; i < width && i < height; i++) {
+        set(i, i);
+        set(width - 1 - i, i);
+    }
+    return bitmap;
 }
 
-uint32_t UTF8ToUnicode(const char** utf8_str) {
-    if (!utf8_str || !*utf8_str) return 0;
-    
-    const uint8_t* str = (const uint8_t*)*utf8_str;
-    uint32_t unicode = 0;
-    
-    if ((str[0] & 0x80) == 0x00) {
-        unicode = str[0];
-        (*utf8_str)++;
-    } else if ((str[0] & 0xE0) == 0xC0) {
-        if (IsUTF8ContinuationByte(str[1])) {
-            unicode = ((str[0] & 0x1F) << 6) | (str[1] & 0x3F);
-            (*utf8_str) += 2;
-        }
-    } else if ((str[0] & 0xF0) == 0xE0) {
-        if (IsUTF8ContinuationByte(str[1]) && IsUTF8ContinuationByte(str[2])) {
-            unicode = ((str[0] & 0x0F) << 12) | ((str[1] & 0x3F) << 6) | (str[2] & 0x3F);
-            (*utf8_str) += 3;
+// 透明背景的字形：每行中连续的置位像素合并为一段，上下相邻且列范围相同的段再合并为矩形，
+// 每个矩形用一个窗口和一次纯色填充提交到队列，不再逐像素设置窗口并等待传输。
+// 屏幕上的像素无法读回混合，多位的字形按覆盖度过半取舍
+struct GlyphRun {
+    uint16_t x0, x1;
+    uint16_t y0, rows;
+};
+
+static void FillBitmapRuns(uint16_t x, uint16_t y, const uint8_t* bitmap, uint16_t width, uint16_t height,
+                           uint16_t color, uint8_t bits_per_pixel) {
+    auto emit = [&](const GlyphRun& run) {
+        ST7735_QueueFill(x + run.x0, y + run.y0, x + run.x1, y + run.y0 + run.rows - 1, color, nullptr, nullptr);
+    };
+
+    GlyphRun open[UNICODE_MAX_ROW_RUNS], next[UNICODE_MAX_ROW_RUNS];
+    uint8_t open_count = 0;
+    uint16_t bytes_per_row = GlyphRowBytes(width, bits_per_pixel);
+    const uint8_t max_level = (1 << bits_per_pixel) - 1;
+    auto inked = [&](const uint8_t* bits, uint16_t col) {
+        if (bits_per_pixel == 1) return (bits[col >> 3] & (0x80 >> (col & 7))) != 0;
+        return GetGlyphLevel(bits, col, bits_per_pixel) * 2 > max_level;
+    };
+
+    for (uint16_t row = 0; row <= height; row++) {
+        uint8_t next_count = 0;
+        uint8_t match = 0;
+        bool used[UNICODE_MAX_ROW_RUNS] = {};
+
+        const uint8_t* bits = bitmap + row * bytes_per_row;
+        uint16_t col = 0;
+        while (row < height && col < width) {
+            // 整字节为0时一次跳过这个字节中的所有列
+            uint32_t bit = static_cast<uint32_t>(col) * bits_per_pixel;
+            if (!(bit & 7) && !bits[bit >> 3]) {
+                col += 8 / bits_per_pixel;
+                continue;
+            }
+            if (!inked(bits, col)) {
+                col++;
+                continue;
+            }
+
+            uint16_t start = col;
+            while (col < width && inked(bits, col)) col++;
+            GlyphRun run = {start, static_cast<uint16_t>(col - 1), row, 1};
+
+            // 两行的段都按列排序，顺序查找上一行中列范围相同的段
+            while (match < open_count && open[match].x0 < start) match++;
+            if (match < open_count && open[match].x0 == start && open[match].x1 == run.x1) {
+                run = open[match];
+                run.rows++;
+                used[match++] = true;
+            }
+
+            if (next_count < UNICODE_MAX_ROW_RUNS) next[next_count++] = run;
+            else emit(run);
         }
-    } else if ((str[0] & 0xF8) == 0xF0) {
-        if (IsUTF8ContinuationByte(str[1]) && IsUTF8ContinuationByte(str[2]) && IsUTF8ContinuationByte(str[3])) {
-            unicode = ((str[0] & 0x07) << 18) | ((str[1] & 0x3F) << 12) | ((str[2] & 0x3F) << 6) | (str[3] & 0x3F);
-            (*utf8_str) += 4;
+
+        // 上一行中没有延续下去的段已经结束
+        for (uint8_t i = 0; i < open_count; i++) {
+            if (!used[i]) emit(open[i]);
         }
-    } else {
-        (*utf8_str)++;
+        std::copy_n(next, next_count, open);
+        open_count = next_count;
     }
-    
-    return unicode;
 }
 
-void WriteUnicodeStringUTF8(uint16_t x, uint16_t y, const char* utf8_str, UnicodeFont* font, uint16_t color, uint16_t bgcolor) {
-    if (!utf8_str || !font || !font->IsValid()) {
-        printf("WriteUnicodeStringUTF8: 参数无效!\r\n");
-        return;
-    }
-    
-    if (FONT_RENDER_DEBUG_INFO) printf("开始渲染字符串: %s\r\n", utf8_str);
-    
+static bool IsSpaceChar(uint32_t unicode) {
+    return unicode == 0x0020 || unicode == 0x00A0 || unicode == 0x2000 || unicode == 0x2001 ||
+           unicode == 0x2002 || unicode == 0x2003 || unicode == 0x2004 || unicode == 0x2005 ||
+           unicode == 0x2006 || unicode == 0x2007 || unicode == 0x2008 || unicode == 0x2009 ||
+           unicode == 0x200A || unicode == 0x202F || unicode == 0x205F || unicode == 0x3000;
+}
+
+// UTF-8字符串的字间距：字宽加1，标点和全角符号再加1
+static uint16_t GetUTF8CharSpacing(uint32_t unicode, uint16_t width) {
+    uint16_t char_spacing = width + 1;
+    if (unicode >= 0x2000 && unicode <= 0x206F) char_spacing += 1;
+    else if (unicode >= 0x3000 && unicode <= 0x303F) char_spacing += 1;
+    else if (unicode >= 0xFF00 && unicode <= 0xFFEF) char_spacing += 1;
+    else if (unicode == 0x002C || unicode == 0x002E || unicode == 0x003B ||
+             unicode == 0x003A || unicode == 0x0021 || unicode == 0x003F) char_spacing += 1;
+    return char_spacing;
+}
+
+// 带背景的字符串按行排版：背景宽度与原来整块填充的宽度相同，每行展开到条带后分块发送。
+// unicode_str和utf8_str只使用其中一个，UTF-8字符串使用标点加宽的字间距并跳过空白字符
+static void WriteTextLines(uint16_t x, uint16_t y, const uint32_t* unicode_str, const char* utf8_str,
+                           UnicodeFont* font, uint16_t color, uint16_t bgcolor) {
+    auto next_char = [&]() -> uint32_t {
+        if (utf8_str) return *utf8_str ? UTF8ToUnicode(&utf8_str) : 0;
+        return *unicode_str ? *unicode_str++ : 0;
+    };
+    auto advance = [&](uint32_t unicode, uint16_t width) -> uint16_t {
+        return utf8_str ? GetUTF8CharSpacing(unicode, width) : width;
+    };
+
+    uint16_t screen_width = ST7735_GetWidth();
+    uint16_t screen_height = ST7735_GetHeight();
+    uint16_t line_height = font->GetDefaultHeight();
+
+    // 先量出最宽的一行作为背景宽度
+    const uint32_t* unicode_start = unicode_str;
+    const char* utf8_start = utf8_str;
     uint16_t total_width = 0;
     uint16_t line_width = 0;
-    uint16_t line_count = 1;
-    
-    const char* temp_ptr = utf8_str;
-    while (*temp_ptr != '\0') {
-        uint32_t unicode = UTF8ToUnicode(&temp_ptr);
-        if (unicode == 0) break;
-        
-        uint16_t width;
-        
-        if (!font->GetCharWidth(unicode, &width)) {
-            width = font->GetDefaultWidth();
-        }
-        
-        uint16_t char_spacing = width + 1;
-        
-        if (unicode >= 0x2000 && unicode <= 0x206F) {
-            char_spacing += 1;
-        } else if (unicode >= 0x3000 && unicode <= 0x303F) {
-            char_spacing += 1;
-        } else if (unicode >= 0xFF00 && unicode <= 0xFFEF) {
-            char_spacing += 1;
-        } else if (unicode == 0x002C || unicode == 0x002E || unicode == 0x003B || 
-                   unicode == 0x003A || unicode == 0x0021 || unicode == 0x003F) {
-            char_spacing += 1;
-        }
-        
-        if (line_width + char_spacing > ST7735_WIDTH) {
-            if (line_width > total_width) {
-                total_width = line_width;
-            }
+    for (uint32_t unicode = next_char(); unicode != 0; unicode = next_char()) {
+        uint16_t char_spacing = advance(unicode, font->MeasureChar(unicode));
+        if (line_width + char_spacing > screen_width) {
+            total_width = std::max(total_width, line_width);
             line_width = char_spacing;
-            line_count++;
-        } else {
+        }
+        else {
             line_width += char_spacing;
         }
     }
-    
-    if (line_width > total_width) {
-        total_width = line_width;
-    }
-    
-    uint16_t total_height = line_count * font->GetDefaultHeight();
-    
-    ST7735_FillRectangle(x, y, total_width, total_height, bgcolor);
-    
+    total_width = std::max(total_width, line_width);
+    unicode_str = unicode_start;
+    utf8_str = utf8_start;
+
+    if (x >= screen_width || y + line_height > screen_height) return;
+    PrepareExpandLUT(color, bgcolor);
+
     uint16_t current_x = x;
     uint16_t current_y = y;
-    
-    const char* ptr = utf8_str;
-    while (*ptr != '\0') {
-        uint32_t unicode = UTF8ToUnicode(&ptr);
-        if (unicode == 0) {
-            printf("UTF8转换失败!\r\n");
-            break;
-        }
-        
+    TextLineWriter line(x, current_y, total_width, line_height);
+    for (uint32_t unicode = next_char(); unicode != 0; unicode = next_char()) {
         uint16_t width, height;
-        
-        if (unicode == 0x0020 || unicode == 0x00A0 || unicode == 0x2000 || unicode == 0x2001 || 
-            unicode == 0x2002 || unicode == 0x2003 || unicode == 0x2004 || unicode == 0x2005 ||
-            unicode == 0x2006 || unicode == 0x2007 || unicode == 0x2008 || unicode == 0x2009 ||
-            unicode == 0x200A || unicode == 0x202F || unicode == 0x205F || unicode == 0x3000) {
+
+        if (utf8_str && IsSpaceChar(unicode)) {
             width = font->GetDefaultWidth();
-        } else {
-            std::shared_ptr<uint8_t[]> bitmap;
-            
+        }
+        else {
+            const uint8_t* bitmap;
+            std::shared_ptr<uint8_t[]> placeholder;
+            uint8_t bits_per_pixel = font->GetBitsPerPixel();
             if (!font->LoadChar(unicode, bitmap, &width, &height)) {
-                printf("字符 U+%04lX 加载失败，使用默认尺寸\r\n", unicode);
                 width = font->GetDefaultWidth();
-                height = font->GetDefaultHeight();
+                height = line_height;
+                placeholder = MakePlaceholderBitmap(width, height);
+                bitmap = placeholder.get();
+                bits_per_pixel = 1;
             }
-            
-            if (current_x + width > ST7735_WIDTH) {
+
+            if (current_x + width > screen_width) {
+                line.Finish();
                 current_x = x;
-                current_y += font->GetDefaultHeight();
-                
-                if (current_y + font->GetDefaultHeight() > ST7735_HEIGHT) {
-                    printf("超出屏幕范围，停止渲染\r\n");
-                    break;
-                }
+                current_y += line_height;
+                if (current_y + line_height > screen_height) return;
+                line = TextLineWriter(x, current_y, total_width, line_height);
             }
-            
-            WriteUnicodeCharNoBg(current_x, current_y, unicode, font, color);
-        }
-        
-        uint16_t char_spacing = width + 1;
-        
-        if (unicode >= 0x2000 && unicode <= 0x206F) {
-            char_spacing += 1;
-        } else if (unicode >= 0x3000 && unicode <= 0x303F) {
-            char_spacing += 1;
-        } else if (unicode >= 0xFF00 && unicode <= 0xFFEF) {
-            char_spacing += 1;
-        } else if (unicode == 0x002C || unicode == 0x002E || unicode == 0x003B || 
-                   unicode == 0x003A || unicode == 0x0021 || unicode == 0x003F) {
-            char_spacing += 1;
+
+            // 与透明背景的版本一样按底边对齐
+            line.Glyph(current_x - x, line_height - height, bitmap, width, height, bits_per_pixel);
         }
-        
-        current_x += char_spacing;
+
+        current_x += advance(unicode, width);
     }
+    line.Finish();
 }
 
-void DrawPlaceholderBox(uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint16_t color) {
-    if (x + width > ST7735_WIDTH || y + height > ST7735_HEIGHT) {
+// 单个字符按80%高度处的基线对齐，背景只覆盖字形本身
+// 字体中没有这个字符时返回false，由调用者绘制占位符
+static bool WriteGlyphDMA(uint16_t x, uint16_t y, uint32_t unicode, UnicodeFont* font, uint16_t color,
+                          uint16_t bgcolor) {
+    const uint8_t* bitmap;
+    uint16_t width, height;
+    if (!font->LoadChar(unicode, bitmap, &width, &height)) return false;
+
+    uint16_t baseline_offset = (font->GetDefaultHeight() * 8) / 10;
+    uint16_t char_baseline = (height * 8) / 10;
+    uint16_t render_y = y + baseline_offset - char_baseline;
+    if (x + width > ST7735_GetWidth() || render_y + height > ST7735_GetHeight()) return true;
+
+    PrepareExpandLUT(color, bgcolor);
+    TextLineWriter line(x, render_y, width, height);
+    line.Glyph(0, 0, bitmap, width, height, font->GetBitsPerPixel());
+    line.Finish();
+    return true;
+}
+
+void WriteUnicodeChar(uint16_t x, uint16_t y, uint32_t unicode, UnicodeFont* font, uint16_t color, uint16_t bgcolor) {
+    if (!font || !font->IsValid()) {
+        printf("WriteUnicodeChar: 字体无效!\r\n");
         return;
     }
-    
-    for (uint16_t i = 0; i < width; i++) {
-        ST7735_DrawPixel(x + i, y, color);
-        ST7735_DrawPixel(x + i, y + height - 1, color);
+
+    if (!WriteGlyphDMA(x, y, unicode, font, color, bgcolor)) {
+        printf("WriteUnicodeChar: 字符 U+%04lX 不在字体中，绘制占位符方框!\r\n", unicode);
+        DrawPlaceholderBox(x, y, font->GetDefaultWidth(), font->GetDefaultHeight(), color);
+        return;
     }
-    
-    for (uint16_t i = 0; i < height; i++) {
-        ST7735_DrawPixel(x, y + i, color);
-        ST7735_DrawPixel(x + width - 1, y + i, color);
+    ST7735_QueueFlush();
+}
+
+void WriteUnicodeString(uint16_t x, uint16_t y, const uint32_t* unicode_str, UnicodeFont* font, uint16_t color, uint16_t bgcolor) {
+    if (!unicode_str || !font || !font->IsValid()) return;
+
+    WriteTextLines(x, y, unicode_str, nullptr, font, color, bgcolor);
+    ST7735_QueueFlush();
+}
+
+void WriteUnicodeStringUTF8(uint16_t x, uint16_t y, const char* utf8_str, UnicodeFont* font, uint16_t color, uint16_t bgcolor) {
+    if (!utf8_str || !font || !font->IsValid()) {
+        printf("WriteUnicodeStringUTF8: 参数无效!\r\n");
+        return;
     }
-    
-    for (uint16_t i = 0; i < width && i < height; i++) {
-        ST7735_DrawPixel(x + i, y + i, color);
-        ST7735_DrawPixel(x + width - 1 - i, y + i, color);
+
+    if (FONT_RENDER_DEBUG_INFO) printf("开始渲染字符串: %s\r\n", utf8_str);
+
+    WriteTextLines(x, y, nullptr, utf8_str, font, color, bgcolor);
+    ST7735_QueueFlush();
+}
+
+void DrawPlaceholderBox(uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint16_t color) {
+    if (x + width > ST7735_GetWidth() || y + height > ST7735_GetHeight()) {
+        return;
     }
+
+    FillBitmapRuns(x, y, MakePlaceholderBitmap(width, height).get(), width, height, color, 1);
+    ST7735_QueueFlush();
 }
 
 void WriteUnicodeCharNoBg(uint16_t x, uint16_t y, uint32_t unicode, UnicodeFont* font, uint16_t color) {
@@ -332,7 +406,7 @@ void WriteUnicodeCharNoBg(uint16_t x, uint16_t y, uint32_t unicode, UnicodeFont*
         return;
     }
     
-    std::shared_ptr<uint8_t[]> bitmap;
+    const uint8_t* bitmap;
     uint16_t width, height;
     
     if (!font->LoadChar(unicode, bitmap, &width, &height)) {
@@ -345,37 +419,15 @@ void WriteUnicodeCharNoBg(uint16_t x, uint16_t y, uint32_t unicode, UnicodeFont*
     uint16_t char_baseline = height - 1;
     uint16_t render_y = y + baseline_offset - char_baseline;
     
-    if (x + width > ST7735_WIDTH || render_y + height > ST7735_HEIGHT) {
+    if (x + width > ST7735_GetWidth() || render_y + height > ST7735_GetHeight()) {
         printf("WriteUnicodeCharNoBg: 位置超出屏幕范围!\r\n");
         return;
     }
     
-    uint16_t pixel_count = 0;
-    uint16_t bytes_per_row = (width + 7) / 8;
-    
-    for (uint16_t row = 0; row < height; row++) {
-        const uint8_t* bitmap_row = bitmap.get() + row * bytes_per_row;
-        
-        for (uint16_t col = 0; col < width; col++) {
-            uint8_t byte_index = col / 8;
-            uint8_t bit_mask = 1 << (7 - (col % 8));
-            
-            if (bitmap_row[byte_index] & bit_mask) {
-                ST7735_Select();
-                ST7735_SetAddressWindow(x + col, render_y + row, x + col, render_y + row);
-                ST7735_DC_HIGH();
-                
-                uint8_t data[2];
-                data[0] = (color >> 8) & 0xFF;
-                data[1] = color & 0xFF;
-                HAL_SPI_Transmit(&ST7735_SPI_PORT, data, 2, HAL_MAX_DELAY);
-                ST7735_Unselect();
-                pixel_count++;
-            }
-        }
-    }
-    
-    if (FONT_RENDER_DEBUG_INFO) printf("WriteUnicodeCharNoBg: 字符 U+%04lX 渲染完成，绘制了 %d 个像素\r\n", unicode, pixel_count);
+    FillBitmapRuns(x, render_y, bitmap, width, height, color, font->GetBitsPerPixel());
+    ST7735_QueueFlush();
+
+    if (FONT_RENDER_DEBUG_INFO) printf("WriteUnicodeCharNoBg: 字符 U+%04lX 渲染完成\r\n", unicode);
 }
 
 void WriteUnicodeStringNoBg(uint16_t x, uint16_t y, const uint32_t* unicode_str, UnicodeFont* font, uint16_t color) {
@@ -385,7 +437,7 @@ void WriteUnicodeStringNoBg(uint16_t x, uint16_t y, const uint32_t* unicode_str,
     uint16_t current_y = y;
     
     while (*unicode_str != 0) {
-        std::shared_ptr<uint8_t[]> bitmap;
+        const uint8_t* bitmap;
         uint16_t width, height;
         
         if (!font->LoadChar(*unicode_str, bitmap, &width, &height)) {
@@ -393,11 +445,11 @@ void WriteUnicodeStringNoBg(uint16_t x, uint16_t y, const uint32_t* unicode_str,
             height = font->GetDefaultHeight();
         }
         
-        if (current_x + width > ST7735_WIDTH) {
+        if (current_x + width > ST7735_GetWidth()) {
             current_x = 0;
             current_y += font->GetDefaultHeight();
             
-            if (current_y + font->GetDefaultHeight() > ST7735_HEIGHT) {
+            if (current_y + font->GetDefaultHeight() > ST7735_GetHeight()) {
                 break;
             }
         }
@@ -421,7 +473,7 @@ void WriteUnicodeStringUTF8NoBg(uint16_t x, uint16_t y, const char* utf8_str, Un
         uint32_t unicode = UTF8ToUnicode(&ptr);
         if (unicode == 0) break;
         
-        std::shared_ptr<uint8_t[]> bitmap;
+        const uint8_t* bitmap;
         uint16_t width, height;
         
         if (!font->LoadChar(unicode, bitmap, &width, &height)) {
@@ -429,11 +481,11 @@ void WriteUnicodeStringUTF8NoBg(uint16_t x, uint16_t y, const char* utf8_str, Un
             height = font->GetDefaultHeight();
         }
         
-        if (current_x + width > ST7735_WIDTH) {
+        if (current_x + width > ST7735_GetWidth()) {
             current_x = 0;
             current_y += font->GetDefaultHeight();
             
-            if (current_y + font->GetDefaultHeight() > ST7735_HEIGHT) {
+            if (current_y + font->GetDefaultHeight() > ST7735_GetHeight()) {
                 break;
             }
         }
@@ -450,13 +502,7 @@ uint16_t UnicodeStringLength(const uint32_t* unicode_str, UnicodeFont* font) {
     uint16_t total_width = 0;
 
     while (*unicode_str != 0) {
-        uint16_t width;
-
-        if (!font->GetCharWidth(*unicode_str, &width)) {
-            width = font->GetDefaultWidth();
-        }
-
-        total_width += width + 1;
+        total_width += font->MeasureChar(*unicode_str) + 1;
         unicode_str++;
     }
 
@@ -473,13 +519,7 @@ uint16_t UnicodeStringUTF8Length(const char* utf8_str, UnicodeFont* font) {
         uint32_t unicode = UTF8ToUnicode(&ptr);
         if (unicode == 0) break;
 
-        uint16_t width;
-
-        if (!font->GetCharWidth(unicode, &width)) {
-            width = font->GetDefaultWidth();
-        }
-
-        uint16_t char_spacing = width + 1;
+        uint16_t char_spacing = font->MeasureChar(unicode) + 1;
 
         if (unicode >= 0x2000 && unicode <= 0x206F) {
             char_spacing += 1;
@@ -497,121 +537,18 @@ uint16_t UnicodeStringUTF8Length(const char* utf8_str, UnicodeFont* font) {
     return total_width > 0 ? total_width - 1 : 0;
 }
 
-static void DrawPixelDMA(uint16_t x, uint16_t y, uint16_t color) {
-    ST7735_Select();
-    ST7735_SetAddressWindow(x, y, x, y);
-    ST7735_DC_HIGH();
-    
-    uint8_t data[2];
-    data[0] = (color >> 8) & 0xFF;
-    data[1] = color & 0xFF;
-    
-    HAL_SPI_Transmit_DMA(&ST7735_SPI_PORT, data, 2);
-    while (HAL_SPI_GetState(&ST7735_SPI_PORT) != HAL_SPI_STATE_READY);
-    while (__HAL_SPI_GET_FLAG(&ST7735_SPI_PORT, SPI_FLAG_BSY));
-    
-    ST7735_Unselect();
-}
-
-static void FillRectDMA(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color) {
-    if (x + w > ST7735_WIDTH) w = ST7735_WIDTH - x;
-    if (y + h > ST7735_HEIGHT) h = ST7735_HEIGHT - y;
-    if (w == 0 || h == 0) return;
-    
-    ST7735_Select();
-    ST7735_SetAddressWindow(x, y, x + w - 1, y + h - 1);
-    ST7735_DC_HIGH();
-    
-    uint16_t* buffer = (uint16_t*)malloc(w * sizeof(uint16_t));
-    if (!buffer) {
-        ST7735_Unselect();
-        return;
-    }
-    
-    for (uint16_t i = 0; i < w; i++) {
-        buffer[i] = color;
-    }
-    
-    uint8_t* byte_buffer = (uint8_t*)buffer;
-    for (uint16_t i = 0; i < w; i++) {
-        uint8_t tmp = byte_buffer[i * 2];
-        byte_buffer[i * 2] = byte_buffer[i * 2 + 1];
-        byte_buffer[i * 2 + 1] = tmp;
-    }
-    
-    for (uint16_t row = 0; row < h; row++) {
-        HAL_SPI_Transmit_DMA(&ST7735_SPI_PORT, byte_buffer, w * 2);
-        while (HAL_SPI_GetState(&ST7735_SPI_PORT) != HAL_SPI_STATE_READY);
-        while (__HAL_SPI_GET_FLAG(&ST7735_SPI_PORT, SPI_FLAG_BSY));
-    }
-    
-    free(buffer);
-    ST7735_Unselect();
-}
-
 static void DrawPlaceholderBoxDMA(uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint16_t color) {
-    if (x + width > ST7735_WIDTH || y + height > ST7735_HEIGHT) return;
-    
-    for (uint16_t i = 0; i < width; i++) {
-        DrawPixelDMA(x + i, y, color);
-        DrawPixelDMA(x + i, y + height - 1, color);
-    }
-    
-    for (uint16_t i = 0; i < height; i++) {
-        DrawPixelDMA(x, y + i, color);
-        DrawPixelDMA(x + width - 1, y + i, color);
-    }
-    
-    for (uint16_t i = 0; i < width && i < height; i++) {
-        DrawPixelDMA(x + i, y + i, color);
-        DrawPixelDMA(x + width - 1 - i, y + i, color);
-    }
+    if (x + width > ST7735_GetWidth() || y + height > ST7735_GetHeight()) return;
+
+    FillBitmapRuns(x, y, MakePlaceholderBitmap(width, height).get(), width, height, color, 1);
 }
 
 void WriteUnicodeCharDMA(uint16_t x, uint16_t y, uint32_t unicode, UnicodeFont* font, uint16_t color, uint16_t bgcolor) {
     if (!font || !font->IsValid()) return;
-    
-    std::shared_ptr<uint8_t[]> bitmap;
-    uint16_t width, height;
-    
-    if (!font->LoadChar(unicode, bitmap, &width, &height)) {
+
+    if (!WriteGlyphDMA(x, y, unicode, font, color, bgcolor)) {
         DrawPlaceholderBoxDMA(x, y, font->GetDefaultWidth(), font->GetDefaultHeight(), color);
-        return;
-    }
-    
-    uint16_t baseline_offset = (font->GetDefaultHeight() * 8) / 10;
-    uint16_t char_baseline = (height * 8) / 10;
-    uint16_t render_y = y + baseline_offset - char_baseline;
-    
-    if (x + width > ST7735_WIDTH || render_y + height > ST7735_HEIGHT) return;
-    
-    uint16_t* row_buffer = (uint16_t*)malloc(width * sizeof(uint16_t));
-    if (!row_buffer) return;
-    
-    for (uint16_t row = 0; row < height; row++) {
-        for (uint16_t col = 0; col < width; col++) {
-            row_buffer[col] = GetBitmapPixel(bitmap.get(), width, height, col, row) ? color : bgcolor;
-        }
-        
-        ST7735_Select();
-        ST7735_SetAddressWindow(x, render_y + row, x + width - 1, render_y + row);
-        ST7735_DC_HIGH();
-        
-        uint8_t* byte_buffer = (uint8_t*)row_buffer;
-        for (uint16_t i = 0; i < width; i++) {
-            uint8_t tmp = byte_buffer[i * 2];
-            byte_buffer[i * 2] = byte_buffer[i * 2 + 1];
-            byte_buffer[i * 2 + 1] = tmp;
-        }
-        
-        HAL_SPI_Transmit_DMA(&ST7735_SPI_PORT, byte_buffer, width * 2);
-        while (HAL_SPI_GetState(&ST7735_SPI_PORT) != HAL_SPI_STATE_READY);
-        while (__HAL_SPI_GET_FLAG(&ST7735_SPI_PORT, SPI_FLAG_BSY));
-        
-        ST7735_Unselect();
     }
-    
-    free(row_buffer);
 }
 
 void WriteUnicodeCharNoBgDMA(uint16_t x, uint16_t y, uint32_t unicode, UnicodeFont* font, uint16_t color) {
@@ -624,7 +561,7 @@ void WriteUnicodeCharNoBgDMA(uint16_t x, uint16_t y, uint32_t unicode, UnicodeFo
         return;
     }
     
-    std::shared_ptr<uint8_t[]> bitmap;
+    const uint8_t* bitmap;
     uint16_t width, height;
     
     if (!font->LoadChar(unicode, bitmap, &width, &height)) {
@@ -636,69 +573,15 @@ void WriteUnicodeCharNoBgDMA(uint16_t x, uint16_t y, uint32_t unicode, UnicodeFo
     uint16_t char_baseline = height - 1;
     uint16_t render_y = y + baseline_offset - char_baseline;
     
-    if (x + width > ST7735_WIDTH || render_y + height > ST7735_HEIGHT) return;
-    
-    for (uint16_t row = 0; row < height; row++) {
-        for (uint16_t col = 0; col < width; col++) {
-            if (GetBitmapPixel(bitmap.get(), width, height, col, row)) {
-                DrawPixelDMA(x + col, render_y + row, color);
-            }
-        }
-    }
+    if (x + width > ST7735_GetWidth() || render_y + height > ST7735_GetHeight()) return;
+
+    FillBitmapRuns(x, render_y, bitmap, width, height, color, font->GetBitsPerPixel());
 }
 
 void WriteUnicodeStringDMA(uint16_t x, uint16_t y, const uint32_t* unicode_str, UnicodeFont* font, uint16_t color, uint16_t bgcolor) {
     if (!unicode_str || !font || !font->IsValid()) return;
-    
-    uint16_t total_width = 0;
-    uint16_t line_width = 0;
-    uint16_t line_count = 1;
-    
-    const uint32_t* temp_ptr = unicode_str;
-    while (*temp_ptr != 0) {
-        std::shared_ptr<uint8_t[]> bitmap;
-        uint16_t width, height;
-        
-        if (!font->LoadChar(*temp_ptr, bitmap, &width, &height)) {
-            width = font->GetDefaultWidth();
-        }
-        
-        if (line_width + width > ST7735_WIDTH) {
-            if (line_width > total_width) total_width = line_width;
-            line_width = width;
-            line_count++;
-        } else {
-            line_width += width;
-        }
-        temp_ptr++;
-    }
-    
-    if (line_width > total_width) total_width = line_width;
-    uint16_t total_height = line_count * font->GetDefaultHeight();
-    
-    FillRectDMA(x, y, total_width, total_height, bgcolor);
-    
-    uint16_t current_x = x;
-    uint16_t current_y = y;
-    
-    while (*unicode_str != 0) {
-        std::shared_ptr<uint8_t[]> bitmap;
-        uint16_t width, height;
-        
-        if (!font->LoadChar(*unicode_str, bitmap, &width, &height)) {
-            width = font->GetDefaultWidth();
-        }
-        
-        if (current_x + width > ST7735_WIDTH) {
-            current_x = x;
-            current_y += font->GetDefaultHeight();
-            if (current_y + font->GetDefaultHeight() > ST7735_HEIGHT) break;
-        }
-        
-        WriteUnicodeCharNoBgDMA(current_x, current_y, *unicode_str, font, color);
-        current_x += width;
-        unicode_str++;
-    }
+
+    WriteTextLines(x, y, unicode_str, nullptr, font, color, bgcolor);
 }
 
 void WriteUnicodeStringNoBgDMA(uint16_t x, uint16_t y, const uint32_t* unicode_str, UnicodeFont* font, uint16_t color) {
@@ -708,17 +591,17 @@ void WriteUnicodeStringNoBgDMA(uint16_t x, uint16_t y, const uint32_t* unicode_s
     uint16_t current_y = y;
     
     while (*unicode_str != 0) {
-        std::shared_ptr<uint8_t[]> bitmap;
+        const uint8_t* bitmap;
         uint16_t width, height;
         
         if (!font->LoadChar(*unicode_str, bitmap, &width, &height)) {
             width = font->GetDefaultWidth();
         }
         
-        if (current_x + width > ST7735_WIDTH) {
+        if (current_x + width > ST7735_GetWidth()) {
             current_x = 0;
             current_y += font->GetDefaultHeight();
-            if (current_y + font->GetDefaultHeight() > ST7735_HEIGHT) break;
+            if (current_y + font->GetDefaultHeight() > ST7735_GetHeight()) break;
         }
         
         WriteUnicodeCharNoBgDMA(current_x, current_y, *unicode_str, font, color);
@@ -729,83 +612,8 @@ void WriteUnicodeStringNoBgDMA(uint16_t x, uint16_t y, const uint32_t* unicode_s
 
 void WriteUnicodeStringUTF8DMA(uint16_t x, uint16_t y, const char* utf8_str, UnicodeFont* font, uint16_t color, uint16_t bgcolor) {
     if (!utf8_str || !font || !font->IsValid()) return;
-    
-    uint16_t total_width = 0;
-    uint16_t line_width = 0;
-    uint16_t line_count = 1;
-    
-    const char* temp_ptr = utf8_str;
-    while (*temp_ptr != '\0') {
-        uint32_t unicode = UTF8ToUnicode(&temp_ptr);
-        if (unicode == 0) break;
-        
-        uint16_t width, height;
-        std::shared_ptr<uint8_t[]> bitmap;
-        
-        if (!font->LoadChar(unicode, bitmap, &width, &height)) {
-            width = font->GetDefaultWidth();
-        }
-        
-        uint16_t char_spacing = width + 1;
-        if (unicode >= 0x2000 && unicode <= 0x206F) char_spacing += 1;
-        else if (unicode >= 0x3000 && unicode <= 0x303F) char_spacing += 1;
-        else if (unicode >= 0xFF00 && unicode <= 0xFFEF) char_spacing += 1;
-        else if (unicode == 0x002C || unicode == 0x002E || unicode == 0x003B ||
-                 unicode == 0x003A || unicode == 0x0021 || unicode == 0x003F) char_spacing += 1;
-        
-        if (line_width + char_spacing > ST7735_WIDTH) {
-            if (line_width > total_width) total_width = line_width;
-            line_width = char_spacing;
-            line_count++;
-        } else {
-            line_width += char_spacing;
-        }
-    }
-    
-    if (line_width > total_width) total_width = line_width;
-    uint16_t total_height = line_count * font->GetDefaultHeight();
-    
-    FillRectDMA(x, y, total_width, total_height, bgcolor);
-    
-    uint16_t current_x = x;
-    uint16_t current_y = y;
-    
-    const char* ptr = utf8_str;
-    while (*ptr != '\0') {
-        uint32_t unicode = UTF8ToUnicode(&ptr);
-        if (unicode == 0) break;
-        
-        uint16_t width, height;
-        std::shared_ptr<uint8_t[]> bitmap;
-        
-        if (unicode == 0x0020 || unicode == 0x00A0 || unicode == 0x2000 || unicode == 0x2001 ||
-            unicode == 0x2002 || unicode == 0x2003 || unicode == 0x2004 || unicode == 0x2005 ||
-            unicode == 0x2006 || unicode == 0x2007 || unicode == 0x2008 || unicode == 0x2009 ||
-            unicode == 0x200A || unicode == 0x202F || unicode == 0x205F || unicode == 0x3000) {
-            width = font->GetDefaultWidth();
-        } else {
-            if (!font->LoadChar(unicode, bitmap, &width, &height)) {
-                width = font->GetDefaultWidth();
-            }
-            
-            if (current_x + width > ST7735_WIDTH) {
-                current_x = x;
-                current_y += font->GetDefaultHeight();
-                if (current_y + font->GetDefaultHeight() > ST7735_HEIGHT) break;
-            }
-            
-            WriteUnicodeCharNoBgDMA(current_x, current_y, unicode, font, color);
-        }
-        
-        uint16_t char_spacing = width + 1;
-        if (unicode >= 0x2000 && unicode <= 0x206F) char_spacing += 1;
-        else if (unicode >= 0x3000 && unicode <= 0x303F) char_spacing += 1;
-        else if (unicode >= 0xFF00 && unicode <= 0xFFEF) char_spacing += 1;
-        else if (unicode == 0x002C || unicode == 0x002E || unicode == 0x003B ||
-                 unicode == 0x003A || unicode == 0x0021 || unicode == 0x003F) char_spacing += 1;
-        
-        current_x += char_spacing;
-    }
+
+    WriteTextLines(x, y, nullptr, utf8_str, font, color, bgcolor);
 }
 
 void WriteUnicodeStringUTF8NoBgDMA(uint16_t x, uint16_t y, const char* utf8_str, UnicodeFont* font, uint16_t color) {
@@ -820,17 +628,17 @@ void WriteUnicodeStringUTF8NoBgDMA(uint16_t x, uint16_t y, const char* utf8_str,
         uint32_t unicode = UTF8ToUnicode(&ptr);
         if (unicode == 0) break;
         
-        std::shared_ptr<uint8_t[]> bitmap;
+        const uint8_t* bitmap;
         uint16_t width, height;
         
         if (!font->LoadChar(unicode, bitmap, &width, &height)) {
             width = font->GetDefaultWidth();
         }
         
-        if (current_x + width > ST7735_WIDTH) {
+        if (current_x + width > ST7735_GetWidth()) {
             current_x = 0;
             current_y += font->GetDefaultHeight();
-            if (current_y + font->GetDefaultHeight() > ST7735_HEIGHT) break;
+            if (current_y + font->GetDefaultHeight() > ST7735_GetHeight()) break;
         }
         
         WriteUnicodeCharNoBgDMA(current_x, current_y, unicode, font, color);
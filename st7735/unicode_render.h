@@ -7,6 +7,36 @@
 
 #define FONT_RENDER_DEBUG_INFO false
 
+#define UNICODE_LINE_STRIP_PIXELS 1024
+// 带背景文字的行条带像素数（共两块），一行文字按 像素数/字高 列分块发送
+
+#define UNICODE_MAX_ROW_RUNS 32
+// 透明背景文字逐行合并像素段时，每行最多跟踪的段数，超出的段单独发送
+
+#define UNICODE_GLYPH_MAX_LEVELS 16
+// 多位字形覆盖度的级数上限（4位），覆盖度查找表按此分配
+
+// RGB565按alpha（0~32）混合：R、B留在低16位，G移到高16位，各通道之间空出的位容纳乘积，一次乘法算完三个通道
+inline uint16_t BlendRGB565(uint16_t fg, uint16_t bg, uint8_t alpha) {
+    uint32_t f = (fg | (static_cast<uint32_t>(fg) << 16)) & 0x07E0F81F;
+    uint32_t b = (bg | (static_cast<uint32_t>(bg) << 16)) & 0x07E0F81F;
+    uint32_t result = ((((f - b) * alpha) >> 5) + b) & 0x07E0F81F;
+    return static_cast<uint16_t>(result | (result >> 16));
+}
+
+// 覆盖度级别对应的alpha（0~32），四舍五入
+inline uint8_t GlyphLevelAlpha(uint8_t level, uint8_t max_level) {
+    return (level * 32 + max_level / 2) / max_level;
+}
+
+// 前景色和背景色之间的颜色梯度，覆盖度直接查表得到像素，每个像素不再混合
+inline void BuildGlyphRamp(uint16_t* ramp, uint8_t bits_per_pixel, uint16_t color, uint16_t bgcolor) {
+    uint8_t max_level = (1 << bits_per_pixel) - 1;
+    for (uint8_t level = 0; level <= max_level; level++) {
+        ramp[level] = BlendRGB565(color, bgcolor, GlyphLevelAlpha(level, max_level));
+    }
+}
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -19,6 +49,8 @@ void WriteUnicodeStringUTF8(uint16_t x, uint16_t y, const char* utf8_str, Unicod
 void WriteUnicodeStringUTF8NoBg(uint16_t x, uint16_t y, const char* utf8_str, UnicodeFont* font, uint16_t color);
 void DrawPlaceholderBox(uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint16_t color);
 
+// DMA版本都经事务队列提交，返回时传输可能仍在进行。
+// 背景色已知时使用带背景的版本：文字在条带中合成后整块发送，比透明背景按像素段发送更快
 void WriteUnicodeCharDMA(uint16_t x, uint16_t y, uint32_t unicode, UnicodeFont* font, uint16_t color, uint16_t bgcolor);
 void WriteUnicodeCharNoBgDMA(uint16_t x, uint16_t y, uint32_t unicode, UnicodeFont* font, uint16_t color);
 void WriteUnicodeStringDMA(uint16_t x, uint16_t y, const uint32_t* unicode_str, UnicodeFont* font, uint16_t color, uint16_t bgcolor);
@@ -26,9 +58,6 @@ void WriteUnicodeStringNoBgDMA(uint16_t x, uint16_t y, const uint32_t* unicode_s
 void WriteUnicodeStringUTF8DMA(uint16_t x, uint16_t y, const char* utf8_str, UnicodeFont* font, uint16_t color, uint16_t bgcolor);
 void WriteUnicodeStringUTF8NoBgDMA(uint16_t x, uint16_t y, const char* utf8_str, UnicodeFont* font, uint16_t color);
 
-uint32_t UTF8ToUnicode(const char** utf8_str);
-bool IsUTF8ContinuationByte(uint8_t byte);
-
 uint16_t UnicodeStringLength(const uint32_t* unicode_str, UnicodeFont* font);
 uint16_t UnicodeStringUTF8Length(const char* utf8_str, UnicodeFont* font);
 
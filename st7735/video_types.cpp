@@ -132,7 +132,7 @@ typedef struct VideoHandle {
     VideoPlayCallback callback;
     void* callback_user_data;
     
-    bool needs_byte_swap;
+    bool little_endian;         // RAW帧低字节在前，与内存中的RGB565一致
 } VideoHandle;
 
 typedef struct {
@@ -144,6 +144,9 @@ typedef struct {
     uint16_t display_height;
     uint8_t scale;
     uint32_t frame_end_offset;
+    uint16_t* stage[2];         // 两个MCU暂存缓冲区，一个在ST7735事务队列中发送时填充另一个
+    volatile bool stage_busy[2];
+    uint8_t stage_index;
 } VideoJpegContext;
 
 static VideoError g_last_error = VIDEO_SUCCESS;
@@ -245,7 +248,7 @@ VideoError VIDEO_Open(const char* filename, VideoHandle_t* handle) {
     vh->frames_skipped = 0;
     vh->frames_rendered = 0;
     
-    vh->needs_byte_swap = detect_rgb565_endianness(vh);
+    vh->little_endian = detect_rgb565_endianness(vh);
     
     *handle = vh;
     g_last_error = VIDEO_SUCCESS;
@@ -310,7 +313,7 @@ VideoError VIDEO_Play(VideoHandle_t handle, uint16_t x, uint16_t y, VideoPlayMod
         return g_last_error;
     }
     
-    if (x + handle->info.width > ST7735_WIDTH || y + handle->info.height > ST7735_HEIGHT) {
+    if (x + handle->info.width > ST7735_GetWidth() || y + handle->info.height > ST7735_GetHeight()) {
         g_last_error = VIDEO_ERROR_INVALID_PARAM;
         return g_last_error;
     }
@@ -1016,7 +1019,7 @@ static VideoError decode_mjpeg_frame(VideoHandle_t handle, uint32_t offset, uint
     
     uint16_t scale_factor = 1;
     uint8_t scale = 0;
-    while (jdec.width / scale_factor > ST7735_WIDTH || jdec.height / scale_factor > ST7735_HEIGHT) {
+    while (jdec.width / scale_factor > ST7735_GetWidth() || jdec.height / scale_factor > ST7735_GetHeight()) {
         scale++;
         scale_factor <<= 1;
         if (scale > 3) break;
@@ -1025,7 +1028,22 @@ static VideoError decode_mjpeg_frame(VideoHandle_t handle, uint32_t offset, uint
     ctx.display_width = (jdec.width + scale_factor - 1) / scale_factor;
     ctx.display_height = (jdec.height + scale_factor - 1) / scale_factor;
     
+    uint32_t mcu_pixels = (uint32_t)jdec.msx * 8 * jdec.msy * 8;
+    ctx.stage[0] = (uint16_t*)malloc(mcu_pixels * sizeof(uint16_t));
+    ctx.stage[1] = (uint16_t*)malloc(mcu_pixels * sizeof(uint16_t));
+    ctx.stage_busy[0] = false;
+    ctx.stage_busy[1] = false;
+    ctx.stage_index = 0;
+    if (!ctx.stage[0] || !ctx.stage[1]) {
+        free(ctx.stage[0]);
+        free(ctx.stage[1]);
+        return VIDEO_ERROR_MEMORY_ALLOC;
+    }
+    
     jres = jd_decomp(&jdec, video_jpeg_output_func, scale);
+    ST7735_QueueFlush();
+    free(ctx.stage[0]);
+    free(ctx.stage[1]);
     if (jres != JDR_OK) {
         return VIDEO_ERROR_DECODE_FAILED;
     }
@@ -1045,16 +1063,16 @@ static VideoError decode_raw_frame(VideoHandle_t handle, uint32_t offset, uint32
     uint16_t height = handle->info.height;
     uint16_t display_x = handle->display_x;
     uint16_t display_y = handle->display_y;
-    bool need_swap = handle->needs_byte_swap;
+    // 以16位帧发送，低字节在前的帧原样发送，高字节在前的帧才需要交换
+    bool need_swap = !handle->little_endian;
     
     ST7735_Select();
     ST7735_SetAddressWindow(display_x, display_y, display_x + width - 1, display_y + height - 1);
-    ST7735_DC_HIGH();
     
     uint16_t row_buffer_size = width * 2;
     
-    uint8_t* buffer_a = (uint8_t*)malloc(row_buffer_size);
-    uint8_t* buffer_b = (uint8_t*)malloc(row_buffer_size);
+    uint16_t* buffer_a = (uint16_t*)malloc(row_buffer_size);
+    uint16_t* buffer_b = (uint16_t*)malloc(row_buffer_size);
     if (!buffer_a || !buffer_b) {
         if (buffer_a) free(buffer_a);
         if (buffer_b) free(buffer_b);
@@ -1073,26 +1091,22 @@ static VideoError decode_raw_frame(VideoHandle_t handle, uint32_t offset, uint32
     
     if (need_swap) {
         for (uint16_t x = 0; x < width; x++) {
-            uint8_t tmp = buffer_a[x * 2];
-            buffer_a[x * 2] = buffer_a[x * 2 + 1];
-            buffer_a[x * 2 + 1] = tmp;
+            buffer_a[x] = (buffer_a[x] >> 8) | (buffer_a[x] << 8);
         }
     }
     
     for (uint16_t y = 0; y < height; y++) {
-        uint8_t* current_buf = (y % 2 == 0) ? buffer_a : buffer_b;
-        uint8_t* next_buf = (y % 2 == 0) ? buffer_b : buffer_a;
+        uint16_t* current_buf = (y % 2 == 0) ? buffer_a : buffer_b;
+        uint16_t* next_buf = (y % 2 == 0) ? buffer_b : buffer_a;
         
-        HAL_SPI_Transmit_DMA(&ST7735_SPI_PORT, current_buf, row_buffer_size);
+        ST7735_WritePixelsDMA(current_buf, width);
         
         if (y < height - 1) {
             res = f_read(file, next_buf, row_buffer_size, &br);
             if (res == FR_OK && br == row_buffer_size) {
                 if (need_swap) {
                     for (uint16_t x = 0; x < width; x++) {
-                        uint8_t tmp = next_buf[x * 2];
-                        next_buf[x * 2] = next_buf[x * 2 + 1];
-                        next_buf[x * 2 + 1] = tmp;
+                        next_buf[x] = (next_buf[x] >> 8) | (next_buf[x] << 8);
                     }
                 }
             }
@@ -1128,6 +1142,10 @@ static size_t video_jpeg_input_func(JDEC* jd, uint8_t* buf, size_t nbyte) {
     return bytes_read;
 }
 
+static void video_stage_done(void* user) {
+    *(volatile bool*)user = false;
+}
+
 static int video_jpeg_output_func(JDEC* jd, void* bitmap, JRECT* rect) {
     VideoJpegContext* ctx = (VideoJpegContext*)jd->device;
     
@@ -1136,31 +1154,22 @@ static int video_jpeg_output_func(JDEC* jd, void* bitmap, JRECT* rect) {
     uint16_t w = rect->right - rect->left + 1;
     uint16_t h = rect->bottom - rect->top + 1;
     
-    ST7735_Select();
-    ST7735_SetAddressWindow(x, y, x + w - 1, y + h - 1);
-    ST7735_DC_HIGH();
-    
     uint16_t* src = (uint16_t*)bitmap;
     uint32_t pixel_count = w * h;
     
-    uint16_t* temp_buffer = (uint16_t*)malloc(pixel_count * sizeof(uint16_t));
-    if (!temp_buffer) {
-        ST7735_Unselect();
-        return 0;
-    }
+    // 等待这个暂存缓冲区上一次的传输完成，此时另一个缓冲区可能仍在发送
+    uint8_t index = ctx->stage_index;
+    while (ctx->stage_busy[index]);
     
-    for (uint32_t i = 0; i < pixel_count; i++) {
-        uint16_t pixel = src[i];
-        temp_buffer[i] = ((pixel & 0xFF00) >> 8) | ((pixel & 0xFF) << 8);
-    }
-    
-    // 使用DMA传输
-    HAL_SPI_Transmit_DMA(&ST7735_SPI_PORT, (uint8_t*)temp_buffer, pixel_count * sizeof(uint16_t));
-    while (HAL_SPI_GetState(&ST7735_SPI_PORT) != HAL_SPI_STATE_READY);
-    while (__HAL_SPI_GET_FLAG(&ST7735_SPI_PORT, SPI_FLAG_BSY));
+    // 解码下一个MCU时TJpgDec会覆盖输出缓冲区，先复制出来
+    uint16_t* dst = ctx->stage[index];
+    memcpy(dst, src, pixel_count * sizeof(uint16_t));
     
-    free(temp_buffer);
-    ST7735_Unselect();
+    // 提交后立即返回，解码下一个MCU与这一个MCU的传输重叠
+    ctx->stage_busy[index] = true;
+    ST7735_QueueWindow(x, y, x + w - 1, y + h - 1, dst, pixel_count * sizeof(uint16_t),
+                       video_stage_done, (void*)&ctx->stage_busy[index]);
+    ctx->stage_index = index ^ 1;
     
     return 1;
 }
@@ -0,0 +1,375 @@
+//
+// 画布条带模式测试：同样的绘制调用分别画到帧缓冲区模式和条带模式的画布上，条带模式经真实的驱动和SPI/DMA替身
+// 发送到面板模型，检查
+//   1. 每次DrawCanvasDMA之后屏幕与帧缓冲区逐像素相同（只发送脏条带，屏幕上保留的部分也必须正确）
+//   2. 显示列表写满时先发送已记录的内容再重新记录，单个命令比列表还大时直接光栅化发送，屏幕仍然正确；
+//      溢出后Copy返回false，FillCanvas之后恢复
+//   3. 硬件滚动（两个滚动轴、两种模式）之后屏幕显示的内容与帧缓冲区相同，且只发送新露出的部分
+//   4. IsDirty只对上次显示后绘制过的区域返回true
+// 字形来自内嵌字体（1位和4位），位图和图形参数由固定种子的随机数生成
+//
+
+#include "canvas.h"
+#include "hal_host.h"
+#include "panel_host.h"
+#include "st7735.h"
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const char* what) {
+    if (!ok) {
+        printf("FAIL %s\n", what);
+        failures++;
+    }
+}
+
+// 可打印ASCII字符的内嵌字体，字形宽度不一，位图为随机的覆盖度
+struct TestFont {
+    std::vector<EmbeddedGlyph> glyphs;
+    std::vector<uint8_t> bitmaps;
+    EmbeddedFont embedded{};
+    UnicodeFont font;
+
+    TestFont(uint8_t bits_per_pixel, uint32_t seed) {
+        std::mt19937 rng(seed);
+        const uint8_t height = 12;
+        for (uint32_t c = 0x21; c < 0x7F; c++) {
+            uint8_t w = (uint8_t)(3 + rng() % 7);
+            glyphs.push_back({ c, w, height, (uint32_t)bitmaps.size() });
+            uint32_t size = GlyphRowBytes(w, bits_per_pixel) * height;
+            for (uint32_t i = 0; i < size; i++) bitmaps.push_back((uint8_t)rng());
+        }
+        embedded = { 6, height, (uint16_t)glyphs.size(), glyphs.data(), bitmaps.data(), bits_per_pixel };
+        font.SetEmbedded(&embedded);
+    }
+};
+
+std::string random_text(std::mt19937& rng) {
+    std::string text;
+    size_t length = 1 + rng() % 24;
+    for (size_t i = 0; i < length; i++) text.push_back((char)(0x20 + rng() % 0x5F));
+    return text;
+}
+
+struct Scene {
+    Canvas& frame;
+    Canvas& strip;
+    TestFont& mono;
+    TestFont& gray;
+    std::mt19937 rng;
+    bool allow_blend;           // 透明的抗锯齿文字（溢出后与只在屏幕上的像素不混合，逐像素比较时不使用）
+    uint32_t copies = 0, refused_copies = 0;
+
+    int coord(int range) { return (int)(rng() % (uint32_t)range); }
+    uint16_t color() { return (uint16_t)rng(); }
+
+    // 同一个绘制调用画到两个画布上
+    template <typename F>
+    void both(F draw) {
+        draw(frame);
+        draw(strip);
+    }
+
+    void random_op(std::vector<uint16_t>& pixels) {
+        int x = coord(170) - 5, y = coord(140) - 5;
+        uint16_t c = color(), bg = color();
+        auto ux = (uint16_t)std::max(x, 0), uy = (uint16_t)std::max(y, 0);
+        switch (rng() % 12) {
+            case 0:
+            case 1: {
+                uint16_t w = (uint16_t)(1 + coord(60)), h = (uint16_t)(1 + coord(40));
+                both([&](Canvas& cv) { cv.FillRectangle(ux, uy, w, h, c); });
+                break;
+            }
+            case 2: {
+                uint16_t w = (uint16_t)(1 + coord(40)), h = (uint16_t)(1 + coord(30));
+                pixels.resize((size_t)w * h);
+                for (uint16_t& p : pixels) p = color();
+                both([&](Canvas& cv) { cv.DrawBitmap(ux, uy, w, h, pixels.data()); });
+                break;
+            }
+            case 3: {
+                uint16_t x1 = (uint16_t)coord(160), y1 = (uint16_t)coord(128);
+                both([&](Canvas& cv) { cv.Line(ux, uy, x1, y1, c); });
+                break;
+            }
+            case 4: {
+                uint16_t r = (uint16_t)(1 + coord(20));
+                bool fill = rng() & 1;
+                both([&](Canvas& cv) { fill ? cv.FillCircle(ux, uy, r, c) : cv.HollowCircle(ux, uy, r, c); });
+                break;
+            }
+            case 5: {
+                uint16_t rx = (uint16_t)(1 + coord(20)), ry = (uint16_t)(1 + coord(15));
+                bool fill = rng() & 1;
+                both([&](Canvas& cv) {
+                    fill ? cv.FillEllipse(ux, uy, rx, ry, c) : cv.HollowEllipse(ux, uy, rx, ry, c);
+                });
+                break;
+            }
+            case 6: {
+                uint16_t x2 = (uint16_t)coord(160), y2 = (uint16_t)coord(128);
+                uint16_t x3 = (uint16_t)coord(160), y3 = (uint16_t)coord(128);
+                both([&](Canvas& cv) { cv.FillTriangle(ux, uy, x2, y2, x3, y3, c); });
+                break;
+            }
+            case 7: {
+                uint16_t w = (uint16_t)(2 + coord(50)), h = (uint16_t)(2 + coord(30));
+                both([&](Canvas& cv) { cv.HollowRectangle(ux, uy, w, h, c); });
+                break;
+            }
+            case 8: {
+                std::string text = random_text(rng);
+                bool with_bg = rng() & 1;
+                both([&](Canvas& cv) {
+                    if (with_bg) cv.WriteUnicodeString(ux, uy, text.c_str(), &mono.font, c, bg);
+                    else cv.WriteUnicodeString(ux, uy, text.c_str(), &mono.font, c);
+                });
+                break;
+            }
+            case 9: {
+                std::string text = random_text(rng);
+                bool with_bg = !allow_blend || (rng() & 1);
+                both([&](Canvas& cv) {
+                    if (with_bg) cv.WriteUnicodeString(ux, uy, text.c_str(), &gray.font, c, bg);
+                    else cv.WriteUnicodeString(ux, uy, text.c_str(), &gray.font, c);
+                });
+                break;
+            }
+            case 10: {
+                uint16_t w = (uint16_t)(1 + coord(80)), h = (uint16_t)(1 + coord(60));
+                uint16_t x0 = (uint16_t)coord(160), y0 = (uint16_t)coord(128);
+                // 条带模式可能无法复制，此时两边都不复制
+                if (strip.Copy(ux, uy, w, h, x0, y0)) {
+                    frame.Copy(ux, uy, w, h, x0, y0);
+                    copies++;
+                }
+                else {
+                    refused_copies++;
+                }
+                break;
+            }
+            default:
+                if (coord(8) == 0) both([&](Canvas& cv) { cv.FillCanvas(c); });
+                break;
+        }
+    }
+};
+
+uint32_t compare(const HostPanel& panel, Canvas& frame) {
+    uint32_t mismatches = 0;
+    const uint16_t* expected = frame.GetBuffer();
+    for (uint16_t y = 0; y < 128; y++) {
+        for (uint16_t x = 0; x < 160; x++) {
+            if (panel.Pixel(x, y) != expected[y * 160 + x]) mismatches++;
+        }
+    }
+    return mismatches;
+}
+
+// 随机绘制若干帧，每帧之后比较屏幕与帧缓冲区
+void run_scene(const char* name, uint32_t seed, uint32_t list_size, bool allow_blend, uint32_t frames,
+               TestFont& mono, TestFont& gray, bool expect_overflow) {
+    Canvas frame(160, 128);
+    Canvas strip(160, 128, CANVAS_STRIP_ROWS, list_size);
+    HostPanel panel(ST7735_GetWidth(), ST7735_GetHeight(), 0xDEAD);
+    HostSPI_Reset();
+
+    Scene scene{ frame, strip, mono, gray, std::mt19937(seed), allow_blend };
+    std::vector<uint16_t> pixels;
+    frame.FillCanvas(0);
+    strip.FillCanvas(0);
+
+    uint32_t bad_frames = 0, overflowed_frames = 0, worst = 0;
+    for (uint32_t f = 0; f < frames; f++) {
+        uint32_t ops = 1 + scene.rng() % 30;
+        for (uint32_t i = 0; i < ops; i++) scene.random_op(pixels);
+        if (strip.isDisplayListOverflowed()) overflowed_frames++;
+
+        strip.DrawCanvasDMA(0, 0, true);
+        panel.Apply(HostSPI_TakeLog());
+        uint32_t mismatches = compare(panel, frame);
+        if (mismatches) {
+            bad_frames++;
+            worst = std::max(worst, mismatches);
+        }
+    }
+
+    printf("%s: %u帧，%u帧溢出过，复制%u次（%u次被拒绝），%u帧不一致（最多%u像素）\n", name, frames,
+           overflowed_frames, scene.copies, scene.refused_copies, bad_frames, worst);
+    check(bad_frames == 0, "屏幕与帧缓冲区逐像素相同");
+    check(panel.GetOverruns() == 0, "像素数与地址窗口一致");
+    check(HostSPI_GetOverlaps() == 0, "不应在传输进行中启动新的传输");
+    if (expect_overflow) check(overflowed_frames > 0, "小显示列表应当写满过");
+    else check(overflowed_frames == 0, "大显示列表不应写满");
+}
+
+// 显示列表写满后的行为：Copy被拒绝，比列表还大的位图直接发送，FillCanvas后恢复
+void test_overflow_recovery(TestFont& mono) {
+    Canvas frame(160, 128);
+    Canvas strip(160, 128, CANVAS_STRIP_ROWS, 1024);
+    HostPanel panel(ST7735_GetWidth(), ST7735_GetHeight(), 0xDEAD);
+    HostSPI_Reset();
+
+    frame.FillCanvas(0x1234);
+    strip.FillCanvas(0x1234);
+    strip.DrawCanvasDMA();
+
+    // 一行文字约需几百字节，几行就会写满1KB的列表
+    const char* line = "Overflow! The list is full.";
+    for (uint16_t y = 0; y < 120; y += 12) {
+        frame.WriteUnicodeString(0, y, line, &mono.font, 0xFFFF, 0x0000);
+        strip.WriteUnicodeString(0, y, line, &mono.font, 0xFFFF, 0x0000);
+    }
+    check(strip.isDisplayListOverflowed(), "写满后isDisplayListOverflowed为true");
+    check(!strip.Copy(0, 0, 40, 20, 80, 60), "溢出后Copy返回false");
+
+    // 单个位图比整个显示列表还大
+    std::vector<uint16_t> big(60 * 30);
+    for (size_t i = 0; i < big.size(); i++) big[i] = (uint16_t)(i * 2654435761u >> 16);
+    frame.DrawBitmap(50, 40, 60, 30, big.data());
+    strip.DrawBitmap(50, 40, 60, 30, big.data());
+    frame.FillCircle(80, 55, 10, 0xF800);
+    strip.FillCircle(80, 55, 10, 0xF800);
+
+    strip.DrawCanvasDMA();
+    panel.Apply(HostSPI_TakeLog());
+    check(compare(panel, frame) == 0, "溢出和直接发送之后屏幕与帧缓冲区相同");
+
+    frame.FillCanvas(0x0F0F);
+    strip.FillCanvas(0x0F0F);
+    check(!strip.isDisplayListOverflowed(), "FillCanvas之后溢出标志清除");
+    check(strip.Copy(0, 0, 40, 20, 80, 60), "恢复后Copy成功");
+    frame.Copy(0, 0, 40, 20, 80, 60);
+    strip.DrawCanvasDMA();
+    panel.Apply(HostSPI_TakeLog());
+    check(compare(panel, frame) == 0, "恢复后屏幕与帧缓冲区相同");
+    check(panel.GetOverruns() == 0, "像素数与地址窗口一致");
+}
+
+// 硬件滚动：屏幕上显示的是按滚动偏移换算后的GRAM内容，帧缓冲区画布用Copy得到同样的结果
+void test_hardware_scroll(ST7735_Rotation rotation, bool strip_mode, TestFont& mono) {
+    HostSPI_Reset();
+    ST7735_SetRotation(rotation);
+    const uint16_t w = ST7735_GetWidth(), h = ST7735_GetHeight();
+    HostPanel panel(w, h, 0xDEAD);
+    panel.Apply(HostSPI_TakeLog());
+
+    const bool columns = ST7735_GetScrollAxis() == ST7735_SCROLL_HORIZONTAL;
+    const uint16_t size = columns ? w : h;
+    Canvas frame(w, h);
+    auto screen = strip_mode ? std::make_unique<Canvas>(w, h, CANVAS_STRIP_ROWS, 1 << 16) : std::make_unique<Canvas>(w, h);
+    std::mt19937 rng(rotation * 2 + strip_mode);
+    auto both = [&](auto draw) {
+        draw(frame);
+        draw(*screen);
+    };
+    both([&](Canvas& cv) { cv.FillCanvas(0x2104); });
+    for (uint16_t i = 0; i < 12; i++) {
+        uint16_t color = (uint16_t)rng();
+        both([&](Canvas& cv) { cv.WriteUnicodeString(0, i * 12, "Scroll test 0123456789 abcdefghijklmnop", &mono.font, color); });
+    }
+    screen->DrawCanvasDMA(0, 0, true);
+    panel.Apply(HostSPI_TakeLog());
+
+    check(columns ? !screen->Scroll(0, h, 1) : !screen->ScrollColumns(0, w, 1), "不是当前滚动轴的方向不能硬件滚动");
+
+    const uint32_t steps = 30;
+    uint32_t bad_steps = 0, scrolled_steps = 0, scroll_bytes = 0;
+    for (uint32_t step = 0; step < steps; step++) {
+        // 尚未发送的内容随滚动移动
+        uint16_t rx = (uint16_t)(rng() % (w - 10)), ry = (uint16_t)(rng() % (h - 10)), rc = (uint16_t)rng();
+        both([&](Canvas& cv) { cv.FillRectangle(rx, ry, 8, 6, rc); });
+
+        // 每几步换一次滚动区域
+        uint16_t start = step / 8 % 2 ? 10 : 0;
+        uint16_t length = (uint16_t)(size - start - (step / 8 % 2 ? 20 : 0));
+        uint16_t distance = (uint16_t)(1 + rng() % (length / 5));
+        auto delta = (int16_t)(rng() & 1 ? distance : -distance);
+        bool scrolled = columns ? screen->ScrollColumns(start, length, delta) : screen->Scroll(start, length, delta);
+        check(scrolled, "当前滚动轴方向的硬件滚动成功");
+        uint16_t from = delta > 0 ? start : start + distance, to = delta > 0 ? start + distance : start;
+        if (columns) frame.Copy(from, 0, length - distance, h, to, 0);
+        else frame.Copy(0, from, w, length - distance, 0, to);
+
+        // 重绘新露出的部分
+        uint16_t exposed = delta > 0 ? start : start + length - distance;
+        uint16_t color = (uint16_t)rng();
+        both([&](Canvas& cv) {
+            if (columns) cv.FillRectangle(exposed, 0, distance, h, color);
+            else cv.FillRectangle(0, exposed, w, distance, color);
+            cv.WriteUnicodeString(columns ? exposed : 2, columns ? 30 : exposed, "Hi", &mono.font, ~color);
+        });
+
+        screen->DrawCanvasDMA(0, 0, true);
+        uint32_t bytes = panel.Apply(HostSPI_TakeLog());
+        if (ST7735_GetScrollOffset()) {
+            scrolled_steps++;
+            scroll_bytes += bytes;
+        }
+        const uint16_t* expected = frame.GetBuffer();
+        uint32_t mismatches = 0;
+        for (uint16_t y = 0; y < h; y++) {
+            for (uint16_t x = 0; x < w; x++) mismatches += panel.Shown(x, y) != expected[y * w + x];
+        }
+        if (mismatches) bad_steps++;
+    }
+
+    printf("硬件滚动(%s, %s): %u步中%u步保持滚动，平均%u字节/步，%u步不一致\n", columns ? "列" : "行",
+           strip_mode ? "条带" : "帧缓冲区", steps, scrolled_steps, scrolled_steps ? scroll_bytes / scrolled_steps : 0,
+           bad_steps);
+    check(bad_steps == 0, "滚动后屏幕显示的内容与帧缓冲区相同");
+    check(scrolled_steps > 0, "滚动偏移在发送后保持");
+    check(!scrolled_steps || scroll_bytes / scrolled_steps < (uint32_t)w * h, "滚动后只发送新露出和改动的部分");
+    check(panel.GetOverruns() == 0, "像素数与地址窗口一致");
+
+    HostSPI_Reset();
+    ST7735_SetRotation(ST7735_ROTATE_0);
+    HostSPI_TakeLog();
+}
+
+// 显示后区域不再是脏的；之后的绘制只使相交的区域变脏，两种模式相同
+void test_is_dirty(bool strip_mode) {
+    auto canvas = strip_mode ? std::make_unique<Canvas>(160, 128, CANVAS_STRIP_ROWS) : std::make_unique<Canvas>(160, 128);
+    check(canvas->IsDirty(100, 90, 40, 30), "新画布需要整帧发送");
+    canvas->FillCanvas(0x0000);
+    canvas->DrawCanvasDMA(0, 0, true);
+    check(!canvas->IsDirty(0, 0, 160, 128), "显示之后没有脏区域");
+
+    canvas->FillRectangle(0, 12, 150, 12, 0xFFFF);
+    check(!canvas->IsDirty(100, 90, 40, 30), "不相交的区域不是脏的");
+    check(canvas->IsDirty(140, 20, 10, 10), "与绘制相交的区域是脏的");
+    canvas->DrawCanvasDMA(0, 0, true);
+    check(!canvas->IsDirty(0, 0, 160, 128), "再次显示之后没有脏区域");
+}
+
+} // namespace
+
+int main() {
+    ST7735_Init();
+    check(ST7735_GetWidth() >= 160 && ST7735_GetHeight() >= 128, "默认方向的屏幕放得下160x128的画布");
+
+    TestFont mono(1, 7);
+    TestFont gray(4, 11);
+    for (uint32_t seed = 1; seed <= 3; seed++) {
+        run_scene("大显示列表", seed, 1 << 20, true, 40, mono, gray, false);
+        run_scene("小显示列表", seed + 100, 2048, false, 40, mono, gray, true);
+    }
+    test_overflow_recovery(mono);
+    test_is_dirty(false);
+    test_is_dirty(true);
+    for (ST7735_Rotation rotation : { ST7735_ROTATE_0, ST7735_ROTATE_90 }) {
+        test_hardware_scroll(rotation, false, mono);
+        test_hardware_scroll(rotation, true, mono);
+    }
+
+    printf(failures ? "FAILED %d\n" : "ok\n", failures);
+    return failures ? 1 : 0;
+}
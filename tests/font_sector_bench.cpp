@@ -0,0 +1,266 @@
+//
+// 字体位图读取基准：在内存中生成一个3000字的v1字体（稀疏索引），经FatFs替身按几种访问模式加载字形，
+// 比较经字体的扇区块缓存读取与加入缓存之前的读法（索引块和每个位图各自f_lseek/f_read）所需的读卡次数，
+// 并逐字节核对位图。字形缓存只留1个位置，两种读法的位图读取次数相同，差别只在读卡路径上。
+// 另外检查Preload按不同的字计算缓存容量，字体中没有的字不占容量，缓存已满时不淘汰本页的字
+//
+
+#include "unicode_font_types.h"
+#include "ff_host.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const char* what) {
+    if (!ok) {
+        printf("FAIL %s\n", what);
+        failures++;
+    }
+}
+
+const char* const FONT_PATH = "bench.ufnt";
+const uint32_t FIRST_CHAR = 0x4E00;
+const uint32_t CHAR_COUNT = 3000;
+const uint16_t CHAR_HEIGHT = 16;
+
+struct GlyphLayout {
+    uint16_t width;
+    uint32_t offset;
+    uint32_t size;
+};
+
+struct TestFontFile {
+    std::vector<uint8_t> data;
+    std::vector<GlyphLayout> glyphs;
+};
+
+void put_be(std::vector<uint8_t>& out, uint32_t v, int bytes) {
+    for (int shift = (bytes - 1) * 8; shift >= 0; shift -= 8) out.push_back((uint8_t)(v >> shift));
+}
+
+// v1格式：头、字符数、每字16字节的索引项（码点、宽、高、位图偏移、大小），之后是按码点顺序存放的位图
+TestFontFile make_font() {
+    TestFontFile font;
+    std::mt19937 rng(45);
+    const uint32_t index_offset = 12;
+    uint32_t offset = index_offset + CHAR_COUNT * FONT_INDEX_ENTRY_SIZE;
+    for (uint32_t i = 0; i < CHAR_COUNT; i++) {
+        auto width = (uint16_t)(8 + rng() % 9);
+        uint32_t size = GlyphRowBytes(width, 1) * CHAR_HEIGHT;
+        font.glyphs.push_back({ width, offset, size });
+        offset += size;
+    }
+
+    font.data = { 'U', 'F', 'N', 'T' };
+    put_be(font.data, 16, 2);
+    put_be(font.data, CHAR_HEIGHT, 2);
+    put_be(font.data, CHAR_COUNT, 4);
+    for (uint32_t i = 0; i < CHAR_COUNT; i++) {
+        put_be(font.data, FIRST_CHAR + i, 4);
+        put_be(font.data, font.glyphs[i].width, 2);
+        put_be(font.data, CHAR_HEIGHT, 2);
+        put_be(font.data, font.glyphs[i].offset, 4);
+        put_be(font.data, font.glyphs[i].size, 4);
+    }
+    for (const GlyphLayout& glyph : font.glyphs) {
+        for (uint32_t i = 0; i < glyph.size; i++) font.data.push_back((uint8_t)rng());
+    }
+    return font;
+}
+
+// 加入扇区缓存之前的读法：稀疏索引按块读入（换块时读一次），位图直接从文件位置读取
+class DirectReader {
+public:
+    explicit DirectReader(const TestFontFile& font) : font(font) { f_open(&file, FONT_PATH, FA_READ); }
+    ~DirectReader() { f_close(&file); }
+
+    bool Read(uint32_t unicode, uint8_t* bitmap) {
+        uint32_t index = unicode - FIRST_CHAR;
+        auto block = (int32_t)(index / FONT_INDEX_SAMPLE_STRIDE);
+        UINT bytes_read;
+        if (block != cached_block) {
+            uint32_t entries = std::min<uint32_t>(FONT_INDEX_SAMPLE_STRIDE, CHAR_COUNT - block * FONT_INDEX_SAMPLE_STRIDE);
+            f_lseek(&file, 12 + block * FONT_INDEX_SAMPLE_STRIDE * FONT_INDEX_ENTRY_SIZE);
+            if (f_read(&file, index_block, entries * FONT_INDEX_ENTRY_SIZE, &bytes_read) != FR_OK) return false;
+            cached_block = block;
+        }
+        const GlyphLayout& glyph = font.glyphs[index];
+        f_lseek(&file, glyph.offset);
+        return f_read(&file, bitmap, glyph.size, &bytes_read) == FR_OK && bytes_read == glyph.size;
+    }
+
+private:
+    const TestFontFile& font;
+    FIL file{};
+    int32_t cached_block = -1;
+    uint8_t index_block[FONT_INDEX_SAMPLE_STRIDE * FONT_INDEX_ENTRY_SIZE];
+};
+
+struct Workload {
+    const char* name;
+    std::vector<uint32_t> chars;
+    bool expect_fewer;      // 有局部性的访问，缓存应当减少读卡
+};
+
+// 一页40字，取自一段window个相邻码点：窗口小时接近同一目录下相似的文件名，大时接近一般的文字
+std::vector<uint32_t> text_pages(std::mt19937& rng, uint32_t window) {
+    std::vector<uint32_t> chars;
+    for (int page = 0; page < 250; page++) {
+        uint32_t base = rng() % (CHAR_COUNT - window);
+        for (int i = 0; i < 40; i++) chars.push_back(FIRST_CHAR + base + rng() % window);
+    }
+    return chars;
+}
+
+std::vector<uint32_t> sequential() {
+    std::vector<uint32_t> chars;
+    for (uint32_t i = 0; i < CHAR_COUNT; i++) chars.push_back(FIRST_CHAR + i);
+    return chars;
+}
+
+std::vector<uint32_t> random_chars(std::mt19937& rng) {
+    std::vector<uint32_t> chars;
+    for (int i = 0; i < 10000; i++) chars.push_back(FIRST_CHAR + rng() % CHAR_COUNT);
+    return chars;
+}
+
+void run(const Workload& workload, const TestFontFile& file) {
+    // 经扇区块缓存
+    UnicodeFont font;
+    check(font.Load(FONT_PATH, 1), "加载测试字体");
+    HostFS_ResetStats();
+    uint32_t mismatches = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t unicode : workload.chars) {
+        const uint8_t* bitmap;
+        uint16_t width, height;
+        if (!font.LoadChar(unicode, bitmap, &width, &height)) {
+            mismatches++;
+            continue;
+        }
+        const GlyphLayout& glyph = file.glyphs[unicode - FIRST_CHAR];
+        mismatches += width != glyph.width || height != CHAR_HEIGHT ||
+                      !std::equal(bitmap, bitmap + glyph.size, file.data.begin() + glyph.offset);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    HostFsStats cached = HostFS_GetStats();
+    uint32_t block_reads = font.GetSectorReadCount();
+
+    // 加入缓存之前的读法
+    HostFsStats direct;
+    {
+        DirectReader reader(file);
+        HostFS_ResetStats();
+        std::vector<uint8_t> bitmap(64);
+        uint32_t previous = 0;
+        for (uint32_t unicode : workload.chars) {
+            // 与只有1个位置的字形缓存一致：连续的同一个字不再读取
+            if (unicode != previous) reader.Read(unicode, bitmap.data());
+            previous = unicode;
+        }
+        direct = HostFS_GetStats();
+    }
+
+    printf("%s: %zu字, 读卡%u次(其中位图块%u次)/直接读%u次, f_read %u/%u次, %.0f字/s, %u字不一致\n", workload.name,
+           workload.chars.size(), cached.sector_reads, block_reads, direct.sector_reads, cached.read_calls,
+           direct.read_calls, workload.chars.size() / seconds, mismatches);
+    check(mismatches == 0, "经扇区缓存读出的位图与字体文件相同");
+    if (workload.expect_fewer) check(cached.sector_reads < direct.sector_reads, "有局部性的访问读卡次数减少");
+}
+
+std::string utf8(uint32_t unicode) {
+    std::string out;
+    if (unicode < 0x80) {
+        out.push_back((char)unicode);
+    }
+    else {
+        out.push_back((char)(0xE0 | unicode >> 12));
+        out.push_back((char)(0x80 | ((unicode >> 6) & 0x3F)));
+        out.push_back((char)(0x80 | (unicode & 0x3F)));
+    }
+    return out;
+}
+
+// 缓存8个位置：先预读4个字，再预读一页重复这4个字、夹杂字体中没有的字和4个新字，新字都应当读入
+void test_preload() {
+    UnicodeFont font;
+    check(font.Load(FONT_PATH, 8), "加载测试字体");
+
+    std::string first, page;
+    for (int repeat = 0; repeat < 5; repeat++) {
+        for (uint32_t i = 0; i < 4; i++) first += utf8(FIRST_CHAR + 100 + i);
+    }
+    check(font.Preload(first.c_str()) == 4, "重复的字只预读一次");
+
+    page = first + "ABCDEFGHIJKLMNOP";
+    for (uint32_t i = 0; i < 4; i++) page += utf8(FIRST_CHAR + 2000 + i);
+    const char* strings[] = { page.c_str(), "QRSTUVWXYZ" };
+    uint16_t loaded = font.Preload(strings, 2);
+    printf("Preload: 一页8个不同的字（4个已缓存，夹杂26个字体中没有的字），新载入%u个\n", loaded);
+    check(loaded == 4, "已缓存的字按不同的字计算，字体中没有的字不占缓存容量");
+
+    HostFS_ResetStats();
+    for (uint32_t unicode : { FIRST_CHAR + 100, FIRST_CHAR + 103, FIRST_CHAR + 2000, FIRST_CHAR + 2003 }) {
+        const uint8_t* bitmap;
+        uint16_t width, height;
+        font.LoadChar(unicode, bitmap, &width, &height);
+    }
+    check(HostFS_GetStats().sector_reads == 0, "预读之后本页的字不再读卡");
+}
+
+// 缓存8个位置且已满、每个槽位都被访问过（浏览过几页之后的常态）：预读一页4个已缓存的字和4个新字，
+// 淘汰只能发生在本页之外的4个字上
+void test_preload_full_cache() {
+    UnicodeFont font;
+    check(font.Load(FONT_PATH, 8), "加载测试字体");
+    for (uint32_t i = 0; i < 8; i++) {
+        const uint8_t* bitmap;
+        uint16_t width, height;
+        font.LoadChar(FIRST_CHAR + 300 + i, bitmap, &width, &height);
+    }
+
+    std::string page;
+    for (uint32_t i = 0; i < 4; i++) page += utf8(FIRST_CHAR + 300 + i * 2);
+    for (uint32_t i = 0; i < 4; i++) page += utf8(FIRST_CHAR + 2500 + i);
+    uint16_t loaded = font.Preload(page.c_str());
+    printf("Preload: 缓存已满时一页8个不同的字（4个已缓存），新载入%u个\n", loaded);
+    check(loaded == 4, "缓存已满时新字都预读");
+
+    HostFS_ResetStats();
+    for (uint32_t i = 0; i < 4; i++) {
+        const uint8_t* bitmap;
+        uint16_t width, height;
+        font.LoadChar(FIRST_CHAR + 300 + i * 2, bitmap, &width, &height);
+        font.LoadChar(FIRST_CHAR + 2500 + i, bitmap, &width, &height);
+    }
+    check(HostFS_GetStats().sector_reads == 0, "缓存已满时预读不淘汰本页已缓存的字");
+}
+
+} // namespace
+
+int main() {
+    TestFontFile file = make_font();
+    HostFS_Reset();
+    HostFS_AddImage(FONT_PATH, file.data.data(), file.data.size());
+
+    std::mt19937 rng(450);
+    const Workload workloads[] = {
+        { "相近的文字页", text_pages(rng, 64), true },
+        { "分散的文字页", text_pages(rng, 400), false },
+        { "顺序", sequential(), true },
+        { "随机", random_chars(rng), false },
+    };
+    for (const Workload& workload : workloads) run(workload, file);
+    test_preload();
+    test_preload_full_cache();
+
+    printf(failures ? "FAILED %d\n" : "ok\n", failures);
+    return failures ? 1 : 0;
+}
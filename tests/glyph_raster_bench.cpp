@@ -0,0 +1,177 @@
+//
+// 字形光栅化基准：测量BlendRGB565和画布字形光栅化每秒处理的字数（1、2、4位，有无背景色，帧缓冲区与条带模式），
+// 并检查
+//   1. BlendRGB565与浮点计算的混合结果每个分量相差不超过1，alpha为0和32时分别等于背景色和前景色
+//   2. 条带模式下每个字形在显示列表中占用的字节数；一页12x12的4位文字菜单用默认的显示列表大小不会溢出
+// 字形来自12x12的内嵌字体（与中文字库相同的宽高），位图为随机的覆盖度
+//
+
+#include "canvas.h"
+#include "st7735.h"
+#include "unicode_render.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const char* what) {
+    if (!ok) {
+        printf("FAIL %s\n", what);
+        failures++;
+    }
+}
+
+const uint8_t GLYPH_SIZE = 12;
+
+// 可打印ASCII字符的内嵌字体，每个字形都是12x12
+struct SquareFont {
+    std::vector<EmbeddedGlyph> glyphs;
+    std::vector<uint8_t> bitmaps;
+    EmbeddedFont embedded{};
+    UnicodeFont font;
+
+    SquareFont(uint8_t bits_per_pixel, uint32_t seed) {
+        std::mt19937 rng(seed);
+        for (uint32_t c = 0x21; c < 0x7F; c++) {
+            glyphs.push_back({ c, GLYPH_SIZE, GLYPH_SIZE, (uint32_t)bitmaps.size() });
+            uint32_t size = GlyphRowBytes(GLYPH_SIZE, bits_per_pixel) * GLYPH_SIZE;
+            for (uint32_t i = 0; i < size; i++) bitmaps.push_back((uint8_t)rng());
+        }
+        embedded = { GLYPH_SIZE, GLYPH_SIZE, (uint16_t)glyphs.size(), glyphs.data(), bitmaps.data(), bits_per_pixel };
+        font.SetEmbedded(&embedded);
+    }
+};
+
+// 浮点计算的混合结果与BlendRGB565比较，统计各分量的最大误差
+void test_blend_accuracy() {
+    std::mt19937 rng(50);
+    int max_error = 0;
+    bool exact_ends = true;
+    for (int i = 0; i < 20000; i++) {
+        auto fg = (uint16_t)rng(), bg = (uint16_t)rng();
+        for (uint8_t alpha = 0; alpha <= 32; alpha++) {
+            uint16_t result = BlendRGB565(fg, bg, alpha);
+            const int shifts[3] = { 11, 5, 0 }, masks[3] = { 0x1F, 0x3F, 0x1F };
+            for (int c = 0; c < 3; c++) {
+                int f = (fg >> shifts[c]) & masks[c], b = (bg >> shifts[c]) & masks[c];
+                int r = (result >> shifts[c]) & masks[c];
+                double expected = b + (f - b) * alpha / 32.0;
+                max_error = std::max(max_error, (int)std::ceil(std::fabs(r - expected) - 1e-9));
+            }
+        }
+        exact_ends = exact_ends && BlendRGB565(fg, bg, 0) == bg && BlendRGB565(fg, bg, 32) == fg;
+    }
+    printf("BlendRGB565: 各分量与浮点计算最大相差%d\n", max_error);
+    check(max_error <= 1, "BlendRGB565每个分量与浮点计算相差不超过1");
+    check(exact_ends, "alpha为0和32时分别等于背景色和前景色");
+}
+
+// 每个12x12的4位字形需要混合144个像素，按此换算成每秒的字数
+void bench_blend() {
+    std::mt19937 rng(51);
+    std::vector<uint16_t> fg(4096), bg(4096);
+    std::vector<uint8_t> alpha(4096);
+    for (size_t i = 0; i < fg.size(); i++) {
+        fg[i] = (uint16_t)rng();
+        bg[i] = (uint16_t)rng();
+        alpha[i] = (uint8_t)(rng() % 33);
+    }
+    const int rounds = 2000;
+    uint32_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; round++) {
+        for (size_t i = 0; i < fg.size(); i++) sink += BlendRGB565(fg[i], bg[i] ^ (uint16_t)round, alpha[i]);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double blends = (double)rounds * fg.size() / seconds;
+    printf("BlendRGB565: %.1f M次/s, 相当于%.0f个12x12字形/s (校验%08X)\n", blends / 1e6,
+           blends / (GLYPH_SIZE * GLYPH_SIZE), sink);
+}
+
+// 一页菜单：10行、每行13个字，选中的一行反色，右侧是滚动条
+const int PAGE_LINES = 10, PAGE_COLUMNS = 13;
+
+std::string page_line(int line) {
+    std::string text;
+    for (int i = 0; i < PAGE_COLUMNS; i++) text.push_back((char)(0x21 + (line * PAGE_COLUMNS + i) % 0x5E));
+    return text;
+}
+
+// 返回绘制的字数
+uint32_t draw_page(Canvas& canvas, SquareFont& font, bool with_bg, int selected) {
+    canvas.FillCanvas(ST7735_BLACK);
+    canvas.FillRectangle(0, (uint16_t)(selected * GLYPH_SIZE), PAGE_COLUMNS * GLYPH_SIZE, GLYPH_SIZE, ST7735_WHITE);
+    canvas.FillRectangle(157, (uint16_t)(selected * GLYPH_SIZE), 3, 16, ST7735_WHITE);
+    for (int line = 0; line < PAGE_LINES; line++) {
+        bool inverted = line == selected;
+        uint16_t color = inverted ? ST7735_BLACK : ST7735_WHITE;
+        std::string text = page_line(line);
+        auto y = (uint16_t)(line * GLYPH_SIZE);
+        if (with_bg) canvas.WriteUnicodeString(0, y, text.c_str(), &font.font, color, inverted ? ST7735_WHITE : ST7735_BLACK);
+        else canvas.WriteUnicodeString(0, y, text.c_str(), &font.font, color);
+    }
+    return PAGE_LINES * PAGE_COLUMNS;
+}
+
+// 帧缓冲区模式只计光栅化；条带模式包括记录显示列表、逐条带光栅化和经替身发送
+void bench_raster(SquareFont& font, bool strip_mode, bool with_bg) {
+    auto canvas = strip_mode ? std::make_unique<Canvas>(160, 128, CANVAS_STRIP_ROWS) : std::make_unique<Canvas>(160, 128);
+    const int rounds = strip_mode ? 100 : 1000;
+    uint32_t glyphs = 0;
+    bool overflowed = false;
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; round++) {
+        glyphs += draw_page(*canvas, font, with_bg, round % PAGE_LINES);
+        overflowed = overflowed || canvas->isDisplayListOverflowed();
+        if (strip_mode) canvas->DrawCanvasDMA(0, 0, true);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%u位%s, %s: %8.0f字/s\n", font.embedded.bits_per_pixel, with_bg ? "有背景" : "透明  ",
+           strip_mode ? "条带模式  " : "帧缓冲区模式", glyphs / seconds);
+    if (strip_mode) check(!overflowed, "一页菜单不应使默认大小的显示列表溢出");
+}
+
+// 二分查找一页菜单不溢出所需的最小显示列表，换算成每个字形的字节数
+void test_list_size(SquareFont& font, bool with_bg) {
+    uint32_t low = 1024, high = 1 << 16;
+    while (low < high) {
+        uint32_t mid = (low + high) / 2;
+        Canvas canvas(160, 128, CANVAS_STRIP_ROWS, mid);
+        draw_page(canvas, font, with_bg, 3);
+        if (canvas.isDisplayListOverflowed()) low = mid + 1;
+        else high = mid;
+    }
+    uint32_t glyphs = PAGE_LINES * PAGE_COLUMNS;
+    printf("%u位%s: 一页%u字需要%u字节的显示列表（每字约%u字节，默认%u字节）\n", font.embedded.bits_per_pixel,
+           with_bg ? "有背景" : "透明  ", glyphs, low, low / glyphs, (uint32_t)CANVAS_DISPLAY_LIST_SIZE);
+    check(low <= CANVAS_DISPLAY_LIST_SIZE, "一页12x12文字的菜单放得下默认大小的显示列表");
+}
+
+} // namespace
+
+int main() {
+    ST7735_Init();
+
+    test_blend_accuracy();
+    bench_blend();
+
+    SquareFont mono(1, 1), gray2(2, 2), gray4(4, 4);
+    for (SquareFont* font : { &mono, &gray2, &gray4 }) {
+        for (bool with_bg : { true, false }) {
+            bench_raster(*font, false, with_bg);
+            bench_raster(*font, true, with_bg);
+            test_list_size(*font, with_bg);
+        }
+    }
+
+    printf(failures ? "FAILED %d\n" : "ok\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,159 @@
+//
+// FatFs的主机端替身实现
+//
+
+#include "ff_host.h"
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct HostFile {
+    std::shared_ptr<const std::vector<uint8_t>> image;
+    int64_t cached_sector = -1;     // 对应FatFs文件对象中的扇区缓冲区
+};
+
+std::map<std::string, std::shared_ptr<const std::vector<uint8_t>>> images;
+std::map<const FIL*, HostFile> open_files;
+std::map<const DIR*, std::pair<std::string, std::string>> open_dirs;     // 目录前缀，上一次列出的路径
+HostFsStats stats;
+
+std::shared_ptr<const std::vector<uint8_t>> load_image(const char* path) {
+    auto it = images.find(path);
+    if (it != images.end()) return it->second;
+
+    FILE* f = fopen(path, "rb");
+    if (!f) return nullptr;
+    auto data = std::make_shared<std::vector<uint8_t>>();
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) data->insert(data->end(), buf, buf + n);
+    fclose(f);
+    return data;
+}
+
+} // namespace
+
+void HostFS_AddImage(const char* path, const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    images[path] = std::make_shared<const std::vector<uint8_t>>(bytes, bytes + size);
+}
+
+void HostFS_Reset(void) {
+    images.clear();
+    open_files.clear();
+    open_dirs.clear();
+    HostFS_ResetStats();
+}
+
+HostFsStats HostFS_GetStats(void) {
+    return stats;
+}
+
+void HostFS_ResetStats(void) {
+    memset(&stats, 0, sizeof(stats));
+}
+
+extern "C" {
+
+FRESULT f_open(FIL* fp, const TCHAR* path, BYTE mode) {
+    (void)mode;
+    stats.open_calls++;
+    auto image = load_image(path);
+    if (!image) return FR_NO_FILE;
+
+    memset(fp, 0, sizeof(*fp));
+    fp->obj.objsize = (FSIZE_t)image->size();
+    open_files[fp] = HostFile{ image };
+    return FR_OK;
+}
+
+FRESULT f_close(FIL* fp) {
+    open_files.erase(fp);
+    return FR_OK;
+}
+
+FRESULT f_read(FIL* fp, void* buff, UINT btr, UINT* br) {
+    auto it = open_files.find(fp);
+    if (it == open_files.end()) return FR_INVALID_OBJECT;
+    HostFile& file = it->second;
+    stats.read_calls++;
+
+    const std::vector<uint8_t>& data = *file.image;
+    uint32_t pos = fp->fptr;
+    UINT n = pos >= data.size() ? 0 : (UINT)std::min<size_t>(btr, data.size() - pos);
+    if (n) {
+        memcpy(buff, data.data() + pos, n);
+
+        // 整扇区直接读到用户缓冲区，首尾不完整的扇区经过扇区缓冲区，与上一次读取同一扇区时不再读卡
+        int64_t first = pos / HOST_FS_SECTOR_SIZE;
+        int64_t last = (pos + n - 1) / HOST_FS_SECTOR_SIZE;
+        for (int64_t sector = first; sector <= last; sector++) {
+            uint32_t start = (uint32_t)sector * HOST_FS_SECTOR_SIZE;
+            bool whole = start >= pos && start + HOST_FS_SECTOR_SIZE <= pos + n;
+            if (whole) {
+                stats.sector_reads++;
+            }
+            else if (sector != file.cached_sector) {
+                stats.sector_reads++;
+                file.cached_sector = sector;
+            }
+        }
+    }
+    fp->fptr = pos + n;
+    stats.bytes_read += n;
+    *br = n;
+    return FR_OK;
+}
+
+FRESULT f_lseek(FIL* fp, FSIZE_t ofs) {
+    if (!open_files.count(fp)) return FR_INVALID_OBJECT;
+    stats.seek_calls++;
+    fp->fptr = ofs > fp->obj.objsize ? fp->obj.objsize : ofs;
+    return FR_OK;
+}
+
+FRESULT f_stat(const TCHAR* path, FILINFO* fno) {
+    auto image = load_image(path);
+    if (!image) return FR_NO_FILE;
+    memset(fno, 0, sizeof(*fno));
+    fno->fsize = (FSIZE_t)image->size();
+    return FR_OK;
+}
+
+FRESULT f_opendir(DIR* dp, const TCHAR* path) {
+    memset(dp, 0, sizeof(*dp));
+    open_dirs[dp] = { std::string(path) + "/", std::string() };
+    return FR_OK;
+}
+
+FRESULT f_closedir(DIR* dp) {
+    open_dirs.erase(dp);
+    return FR_OK;
+}
+
+FRESULT f_readdir(DIR* dp, FILINFO* fno) {
+    auto it = open_dirs.find(dp);
+    if (it == open_dirs.end()) return FR_INVALID_OBJECT;
+    const std::string& prefix = it->second.first;
+    std::string& last = it->second.second;
+
+    memset(fno, 0, sizeof(*fno));
+    for (auto image = images.upper_bound(last.empty() ? prefix : last); image != images.end(); ++image) {
+        const std::string& path = image->first;
+        if (path.compare(0, prefix.size(), prefix) != 0) break;
+        std::string name = path.substr(prefix.size());
+        if (name.empty() || name.find('/') != std::string::npos || name.size() >= sizeof(fno->fname)) continue;
+        strcpy(fno->fname, name.c_str());
+        fno->fsize = (FSIZE_t)image->second->size();
+        last = path;
+        return FR_OK;
+    }
+    return FR_OK;
+}
+
+} // extern "C"
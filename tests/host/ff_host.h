@@ -0,0 +1,34 @@
+//
+// FatFs的主机端替身
+// 文件以内存中的磁盘镜像代替：可以直接登记一块内存，也可以打开主机上的文件（打开时整体读入）
+// 目录只列出登记过的镜像：路径为“目录/文件名”的镜像按路径顺序列出
+// 读取按SD卡扇区统计：与FatFs一样，整扇区直接读，不足一个扇区的部分经过每个文件的扇区缓冲区
+//
+
+#ifndef HOST_FF_HOST_H
+#define HOST_FF_HOST_H
+
+#include "ff.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#define HOST_FS_SECTOR_SIZE 512
+
+typedef struct {
+    uint32_t open_calls;
+    uint32_t read_calls;
+    uint32_t seek_calls;
+    uint32_t sector_reads;     // 实际从“卡”上读取的扇区数
+    uint64_t bytes_read;
+} HostFsStats;
+
+// 登记一个内存中的文件镜像，f_open按路径打开时优先使用；数据会被复制
+void HostFS_AddImage(const char* path, const void* data, size_t size);
+
+// 删除所有登记的镜像并清零统计
+void HostFS_Reset(void);
+
+HostFsStats HostFS_GetStats(void);
+void HostFS_ResetStats(void);
+
+#endif // HOST_FF_HOST_H
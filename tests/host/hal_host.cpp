@@ -0,0 +1,234 @@
+//
+// SPI/DMA的主机端替身实现
+//
+
+#include "hal_host.h"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+GPIO_TypeDef host_gpio[3];
+
+namespace {
+
+SPI_TypeDef spi_regs;
+DMA_Stream_TypeDef dma_regs = { DMA_SxCR_MINC, 0, 0, 0 };
+DMA_HandleTypeDef dma_handle = { &dma_regs, { 0, 0, DMA_MINC_ENABLE, 0, 0, 0, 0 }, nullptr };
+
+struct DmaRequest {
+    SPI_HandleTypeDef* hspi;
+    const uint8_t* data;
+    uint16_t size;
+    bool increment;
+    size_t log_index;
+};
+
+std::mutex irq_mutex;                   // 持有即“关中断”
+thread_local bool irq_disabled = false;
+thread_local bool in_isr = false;
+
+std::mutex state_mutex;                 // 保护以下状态
+std::condition_variable state_changed;
+std::vector<HostSpiTransfer> transfer_log;
+DmaRequest request;
+bool request_pending = false;
+bool dma_hold = false;
+bool recording = true;
+uint32_t overlaps = 0;
+
+// DC引脚的电平：驱动直接写BSRR，在每次发送时结算
+bool dc_high(void) {
+    GPIO_TypeDef* port = GPIOB;
+    uint32_t bsrr = port->BSRR;
+    port->ODR = (port->ODR | (bsrr & 0xFFFF)) & ~(bsrr >> 16);
+    port->BSRR = 0;
+    return port->ODR & GPIO_PIN_14;
+}
+
+bool frame16(SPI_HandleTypeDef* hspi) {
+    return hspi->Instance->CR1 & SPI_CR1_DFF;
+}
+
+std::vector<uint8_t> wire_bytes(const uint8_t* data, uint16_t size, bool wide, bool increment) {
+    std::vector<uint8_t> bytes;
+    uint8_t frame = wide ? 2 : 1;
+    bytes.reserve((size_t)size * frame);
+    for (uint32_t i = 0; i < size; i++) {
+        const uint8_t* p = increment ? data + i * frame : data;
+        if (wide) {
+            uint16_t v = (uint16_t)(p[0] | (p[1] << 8));
+            bytes.push_back((uint8_t)(v >> 8));
+            bytes.push_back((uint8_t)v);
+        }
+        else {
+            bytes.push_back(p[0]);
+        }
+    }
+    return bytes;
+}
+
+// 模拟DMA控制器：传输结束时进入“中断”
+class DmaEngine {
+public:
+    DmaEngine() : worker([this] { Run(); }) {}
+
+    ~DmaEngine() {
+        {
+            std::lock_guard<std::mutex> lock(state_mutex);
+            stop = true;
+        }
+        state_changed.notify_all();
+        worker.join();
+    }
+
+private:
+    bool stop = false;
+    std::thread worker;
+
+    void Run() {
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(state_mutex);
+                state_changed.wait(lock, [this] { return (request_pending && !dma_hold) || stop; });
+                if (stop) return;
+            }
+
+            // 只有这个线程会结束传输，request在等待中断锁期间不会被替换（日志位置可能被HostSPI_TakeLog调整）
+            std::lock_guard<std::mutex> irq(irq_mutex);
+            in_isr = true;
+            SPI_HandleTypeDef* hspi;
+            {
+                std::lock_guard<std::mutex> lock(state_mutex);
+                if (request.log_index < transfer_log.size()) {
+                    HostSpiTransfer& transfer = transfer_log[request.log_index];
+                    transfer.bytes = wire_bytes(request.data, request.size, transfer.frame16, request.increment);
+                }
+                request_pending = false;
+                hspi = request.hspi;
+                hspi->State = HAL_SPI_STATE_READY;
+            }
+            state_changed.notify_all();
+            HAL_SPI_TxCpltCallback(hspi);
+            in_isr = false;
+        }
+    }
+};
+
+DmaEngine& engine(void) {
+    static DmaEngine instance;
+    return instance;
+}
+
+} // namespace
+
+SPI_HandleTypeDef hspi2 = { &spi_regs, {}, &dma_handle, HAL_SPI_STATE_READY };
+
+void HostSPI_Reset(void) {
+    HostSPI_TakeLog();
+    std::lock_guard<std::mutex> lock(state_mutex);
+    overlaps = 0;
+}
+
+std::vector<HostSpiTransfer> HostSPI_TakeLog(void) {
+    std::lock_guard<std::mutex> lock(state_mutex);
+    std::vector<HostSpiTransfer> log;
+    log.swap(transfer_log);
+    // 尚未结束的DMA仍然引用日志中的位置，保留一个占位
+    if (request_pending && request.log_index < log.size()) {
+        transfer_log.push_back(log[request.log_index]);
+        log.erase(log.begin() + (ptrdiff_t)request.log_index);
+        request.log_index = 0;
+    }
+    return log;
+}
+
+void HostSPI_HoldDMA(bool hold) {
+    engine();
+    {
+        std::lock_guard<std::mutex> lock(state_mutex);
+        dma_hold = hold;
+    }
+    state_changed.notify_all();
+}
+
+bool HostSPI_IsDMABusy(void) {
+    std::lock_guard<std::mutex> lock(state_mutex);
+    return request_pending;
+}
+
+uint32_t HostSPI_GetOverlaps(void) {
+    std::lock_guard<std::mutex> lock(state_mutex);
+    return overlaps;
+}
+
+void HostSPI_SetRecording(bool record) {
+    std::lock_guard<std::mutex> lock(state_mutex);
+    recording = record;
+}
+
+extern "C" {
+
+void HostIRQ_Disable(void) {
+    if (in_isr || irq_disabled) return;
+    irq_mutex.lock();
+    irq_disabled = true;
+}
+
+void HostIRQ_Enable(void) {
+    if (in_isr || !irq_disabled) return;
+    irq_disabled = false;
+    irq_mutex.unlock();
+}
+
+uint32_t HostIRQ_GetPrimask(void) {
+    return in_isr || irq_disabled;
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef* port, uint16_t pin, GPIO_PinState state) {
+    if (state == GPIO_PIN_SET) port->ODR |= pin;
+    else port->ODR &= ~(uint32_t)pin;
+}
+
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef* port, uint16_t pin) {
+    return (port->ODR & pin) ? GPIO_PIN_SET : GPIO_PIN_RESET;
+}
+
+void HAL_Delay(uint32_t) {}
+
+uint32_t HAL_GetTick(void) {
+    return 0;
+}
+
+HAL_StatusTypeDef HAL_SPI_Transmit(SPI_HandleTypeDef* hspi, uint8_t* data, uint16_t size, uint32_t) {
+    std::lock_guard<std::mutex> lock(state_mutex);
+    if (request_pending) overlaps++;
+    bool wide = frame16(hspi);
+    bool data_high = dc_high();
+    if (recording) transfer_log.push_back({ data_high, wide, false, in_isr, wire_bytes(data, size, wide, true) });
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_Transmit_DMA(SPI_HandleTypeDef* hspi, uint8_t* data, uint16_t size) {
+    engine();
+    {
+        std::lock_guard<std::mutex> lock(state_mutex);
+        if (request_pending) {
+            overlaps++;
+            return HAL_BUSY;
+        }
+        bool increment = hspi->hdmatx->Instance->CR & DMA_SxCR_MINC;
+        bool data_high = dc_high();
+        if (recording) transfer_log.push_back({ data_high, frame16(hspi), true, in_isr, {} });
+        request = { hspi, data, size, increment, recording ? transfer_log.size() - 1 : SIZE_MAX };
+        request_pending = true;
+        hspi->State = HAL_SPI_STATE_BUSY_TX;
+    }
+    state_changed.notify_all();
+    return HAL_OK;
+}
+
+HAL_SPI_StateTypeDef HAL_SPI_GetState(SPI_HandleTypeDef* hspi) {
+    return hspi->State;
+}
+
+} // extern "C"
@@ -0,0 +1,36 @@
+//
+// SPI/DMA的主机端替身
+// 阻塞发送立即记录；DMA发送由一个后台线程模拟：传输结束时（可以暂停）持有中断锁调用HAL_SPI_TxCpltCallback，
+// 与驱动中__disable_irq保护的临界区互斥。DMA读取的数据在传输结束时才复制，提前改写缓冲区会在记录中体现出来
+//
+
+#ifndef HOST_HAL_HOST_H
+#define HOST_HAL_HOST_H
+
+#include "stm32f4xx_hal.h"
+#include <cstdint>
+#include <vector>
+
+extern SPI_HandleTypeDef hspi2;
+
+struct HostSpiTransfer {
+    bool data;                  // DC引脚为高（数据），否则为命令
+    bool frame16;               // 以16位帧发送
+    bool dma;
+    bool from_isr;              // 在模拟的完成中断中启动，即由HAL_SPI_TxCpltCallback接力
+    std::vector<uint8_t> bytes; // 线上的字节顺序（16位帧高位先出）
+};
+
+// 清空记录和计数
+void HostSPI_Reset(void);
+// 取出到目前为止的所有传输记录
+std::vector<HostSpiTransfer> HostSPI_TakeLog(void);
+// hold为true时DMA传输不会结束（也不会产生完成中断），直到再次以false调用
+void HostSPI_HoldDMA(bool hold);
+bool HostSPI_IsDMABusy(void);
+// 一次传输尚未结束就启动下一次传输的次数，驱动正确时应为0
+uint32_t HostSPI_GetOverlaps(void);
+// record为false时不再记录传输内容（默认记录），只模拟时序，替身本身不再分配内存
+void HostSPI_SetRecording(bool record);
+
+#endif // HOST_HAL_HOST_H
@@ -0,0 +1,10 @@
+//
+// 主机端替身：代替Core/Inc/main.h，只提供被库代码间接包含到的HAL声明
+//
+
+#ifndef HOST_MAIN_H
+#define HOST_MAIN_H
+
+#include "stm32f4xx_hal.h"
+
+#endif // HOST_MAIN_H
@@ -0,0 +1,116 @@
+//
+// ST7735面板的主机端模型实现
+//
+
+#include "panel_host.h"
+#include "st7735.h"
+#include <algorithm>
+
+HostPanel::HostPanel(uint16_t width, uint16_t height, uint16_t fill)
+    : width(width), height(height), pixels((size_t)width * height, fill) {
+}
+
+void HostPanel::Fill(uint16_t color) {
+    std::fill(pixels.begin(), pixels.end(), color);
+}
+
+uint32_t HostPanel::Apply(const std::vector<HostSpiTransfer>& log) {
+    uint32_t pixel_bytes = 0;
+    for (const HostSpiTransfer& t : log) {
+        for (uint8_t byte : t.bytes) {
+            if (!t.data) {
+                Command(byte);
+            }
+            else {
+                if (command == ST7735_RAMWR) pixel_bytes++;
+                Data(byte);
+            }
+        }
+    }
+    return pixel_bytes;
+}
+
+void HostPanel::Command(uint8_t cmd) {
+    // 窗口未写满就开始新命令：驱动按窗口计算的数据量与实际发送的不一致
+    if (command == ST7735_RAMWR && cursor != 0 &&
+        cursor != (uint32_t)(x1 - x0 + 1) * (y1 - y0 + 1)) {
+        overruns++;
+    }
+    command = cmd;
+    args.clear();
+    cursor = 0;
+    pending_count = 0;
+}
+
+void HostPanel::Data(uint8_t byte) {
+    if (command != ST7735_RAMWR) {
+        args.push_back(byte);
+        if (command == ST7735_CASET && args.size() == 4) {
+            x0 = (uint16_t)(args[0] << 8 | args[1]);
+            x1 = (uint16_t)(args[2] << 8 | args[3]);
+        }
+        else if (command == ST7735_RASET && args.size() == 4) {
+            y0 = (uint16_t)(args[0] << 8 | args[1]);
+            y1 = (uint16_t)(args[2] << 8 | args[3]);
+        }
+        else if (command == ST7735_COLMOD && args.size() == 1) {
+            twelve_bit = (args[0] & 0x07) == 0x03;
+        }
+        else if (command == ST7735_MADCTL && args.size() == 1) {
+            madctl = args[0];
+        }
+        else if (command == ST7735_VSCRDEF && args.size() == 6) {
+            scroll_tfa = (uint16_t)(args[0] << 8 | args[1]);
+            scroll_vsa = (uint16_t)(args[2] << 8 | args[3]);
+        }
+        else if (command == ST7735_VSCSAD && args.size() == 2) {
+            scroll_ssa = (uint16_t)(args[0] << 8 | args[1]);
+        }
+        return;
+    }
+
+    pending[pending_count++] = byte;
+    if (!twelve_bit && pending_count == 2) {
+        Write((uint16_t)(pending[0] << 8 | pending[1]));
+        pending_count = 0;
+    }
+    else if (twelve_bit && pending_count >= 2) {
+        // 两个像素占3字节：R1G1 B1R2 G2B2，收到12位就写入一个像素（奇数个像素的窗口以2字节结尾）
+        auto expand = [](uint8_t r, uint8_t g, uint8_t b) {
+            return (uint16_t)(((r << 1 | r >> 3) << 11) | ((g << 2 | g >> 2) << 5) | (b << 1 | b >> 3));
+        };
+        if (pending_count == 2) {
+            Write(expand(pending[0] >> 4, pending[0] & 0x0F, pending[1] >> 4));
+        }
+        else {
+            Write(expand(pending[1] & 0x0F, pending[2] >> 4, pending[2] & 0x0F));
+            pending_count = 0;
+        }
+    }
+}
+
+uint16_t HostPanel::Shown(uint16_t x, uint16_t y) const {
+    // 滚动沿GRAM行进行：行列交换时对应逻辑x，MY置位时GRAM行序与逻辑坐标相反
+    bool columns = madctl & ST7735_MADCTL_MV;
+    bool reversed = madctl & ST7735_MADCTL_MY;
+    uint16_t pos = columns ? x : y;
+    uint16_t line = reversed ? ST7735_GRAM_LINES - 1 - pos : pos;
+    if (scroll_vsa && line >= scroll_tfa && line < scroll_tfa + scroll_vsa) {
+        // 区域内第一条显示行是显示起点ssa处的GRAM行
+        line = scroll_tfa + (line - scroll_tfa + scroll_ssa - scroll_tfa) % scroll_vsa;
+        pos = reversed ? ST7735_GRAM_LINES - 1 - line : line;
+    }
+    return columns ? Pixel(pos, y) : Pixel(x, pos);
+}
+
+void HostPanel::Write(uint16_t color) {
+    uint32_t columns = x1 - x0 + 1;
+    uint32_t x = x0 + cursor % columns;
+    uint32_t y = y0 + cursor / columns;
+    cursor++;
+    if (x1 < x0 || y1 < y0 || y > y1 || x >= width || y >= height) {
+        overruns++;
+        return;
+    }
+    pixels[y * width + x] = color;
+}
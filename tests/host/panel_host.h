@@ -0,0 +1,47 @@
+//
+// ST7735面板的主机端模型：按SPI替身记录的命令和数据更新显存，供测试比较屏幕内容
+// 只解释CASET/RASET/RAMWR、COLMOD和滚动相关的MADCTL/VSCRDEF/VSCSAD，坐标按逻辑方向（驱动默认的XSTART/YSTART为0）；
+// 12位像素展开为RGB565（高位复制到低位），与原图比较时需要按RGB444量化
+//
+
+#ifndef HOST_PANEL_HOST_H
+#define HOST_PANEL_HOST_H
+
+#include "hal_host.h"
+#include <cstdint>
+#include <vector>
+
+class HostPanel {
+public:
+    HostPanel(uint16_t width, uint16_t height, uint16_t fill = 0);
+
+    // 依次执行一段传输记录，返回其中RAMWR之后的像素字节数
+    uint32_t Apply(const std::vector<HostSpiTransfer>& log);
+
+    [[nodiscard]] uint16_t Pixel(uint16_t x, uint16_t y) const { return pixels[y * width + x]; }
+    // 屏幕上(x, y)处显示的像素：硬件滚动时显示的是另一个写入地址的内容
+    [[nodiscard]] uint16_t Shown(uint16_t x, uint16_t y) const;
+    void Fill(uint16_t color);
+    // 写出了窗口之外（或窗口未满就换了命令）的像素数，驱动正确时为0
+    [[nodiscard]] uint32_t GetOverruns() const { return overruns; }
+
+private:
+    uint16_t width, height;
+    std::vector<uint16_t> pixels;
+    uint8_t command = 0;
+    std::vector<uint8_t> args;
+    bool twelve_bit = false;
+    uint8_t madctl = 0;
+    uint16_t scroll_tfa = 0, scroll_vsa = 0, scroll_ssa = 0;   // GRAM行号，vsa为0表示没有定义滚动区域
+    uint16_t x0 = 0, x1 = 0, y0 = 0, y1 = 0;
+    uint32_t cursor = 0;
+    uint8_t pending[3] = {};
+    uint8_t pending_count = 0;
+    uint32_t overruns = 0;
+
+    void Command(uint8_t cmd);
+    void Data(uint8_t byte);
+    void Write(uint16_t color);
+};
+
+#endif // HOST_PANEL_HOST_H
@@ -0,0 +1,177 @@
+//
+// 主机端替身：代替STM32F4 HAL，只声明主机测试用到的类型和函数
+// SPI发送和DMA的行为见hal_host.h
+//
+
+#ifndef HOST_STM32F4XX_HAL_H
+#define HOST_STM32F4XX_HAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    HAL_OK = 0,
+    HAL_ERROR,
+    HAL_BUSY,
+    HAL_TIMEOUT
+} HAL_StatusTypeDef;
+
+#define HAL_MAX_DELAY 0xFFFFFFFFU
+
+// GPIO：只保留BSRR等寄存器，驱动直接写BSRR切换DC引脚
+typedef struct {
+    volatile uint32_t BSRR;
+    volatile uint32_t ODR;
+    volatile uint32_t IDR;
+} GPIO_TypeDef;
+
+extern GPIO_TypeDef host_gpio[3];
+#define GPIOA (&host_gpio[0])
+#define GPIOB (&host_gpio[1])
+#define GPIOC (&host_gpio[2])
+
+#define GPIO_PIN_0  0x0001U
+#define GPIO_PIN_1  0x0002U
+#define GPIO_PIN_2  0x0004U
+#define GPIO_PIN_4  0x0010U
+#define GPIO_PIN_5  0x0020U
+#define GPIO_PIN_7  0x0080U
+#define GPIO_PIN_10 0x0400U
+#define GPIO_PIN_13 0x2000U
+#define GPIO_PIN_14 0x4000U
+
+typedef enum {
+    GPIO_PIN_RESET = 0,
+    GPIO_PIN_SET
+} GPIO_PinState;
+
+void HAL_GPIO_WritePin(GPIO_TypeDef* port, uint16_t pin, GPIO_PinState state);
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef* port, uint16_t pin);
+void HAL_Delay(uint32_t ms);
+uint32_t HAL_GetTick(void);
+
+// SPI和DMA流的寄存器只保留驱动会读写的几个
+typedef struct {
+    volatile uint32_t CR1;
+    volatile uint32_t CR2;
+    volatile uint32_t SR;
+    volatile uint32_t DR;
+} SPI_TypeDef;
+
+typedef struct {
+    volatile uint32_t CR;
+    volatile uint32_t NDTR;
+    volatile uint32_t PAR;
+    volatile uint32_t M0AR;
+} DMA_Stream_TypeDef;
+
+typedef struct {
+    uint32_t Direction;
+    uint32_t PeriphInc;
+    uint32_t MemInc;
+    uint32_t PeriphDataAlignment;
+    uint32_t MemDataAlignment;
+    uint32_t Mode;
+    uint32_t Priority;
+} DMA_InitTypeDef;
+
+typedef struct __DMA_HandleTypeDef {
+    DMA_Stream_TypeDef* Instance;
+    DMA_InitTypeDef Init;
+    void* Parent;
+} DMA_HandleTypeDef;
+
+typedef enum {
+    HAL_SPI_STATE_RESET = 0,
+    HAL_SPI_STATE_READY,
+    HAL_SPI_STATE_BUSY,
+    HAL_SPI_STATE_BUSY_TX
+} HAL_SPI_StateTypeDef;
+
+typedef struct {
+    uint32_t Mode;
+    uint32_t Direction;
+    uint32_t DataSize;
+    uint32_t CLKPolarity;
+    uint32_t CLKPhase;
+    uint32_t NSS;
+    uint32_t BaudRatePrescaler;
+    uint32_t FirstBit;
+} SPI_InitTypeDef;
+
+typedef struct __SPI_HandleTypeDef {
+    SPI_TypeDef* Instance;
+    SPI_InitTypeDef Init;
+    DMA_HandleTypeDef* hdmatx;
+    volatile HAL_SPI_StateTypeDef State;
+} SPI_HandleTypeDef;
+
+#define SPI_FLAG_TXE 0x0002U
+#define SPI_FLAG_BSY 0x0080U
+#define SPI_CR1_BR   0x0038U
+#define SPI_CR1_SPE  0x0040U
+#define SPI_CR1_DFF  0x0800U
+#define SPI_DATASIZE_8BIT  0x0000U
+#define SPI_DATASIZE_16BIT 0x0800U
+#define SPI_BAUDRATEPRESCALER_2 0x0000U
+
+#define DMA_SxCR_EN     0x0001U
+#define DMA_SxCR_MINC   0x0400U
+#define DMA_SxCR_PSIZE  0x1800U
+#define DMA_SxCR_MSIZE  0x6000U
+#define DMA_MINC_ENABLE  0x0400U
+#define DMA_MINC_DISABLE 0x0000U
+#define DMA_PDATAALIGN_BYTE     0x0000U
+#define DMA_PDATAALIGN_HALFWORD 0x0800U
+#define DMA_MDATAALIGN_BYTE     0x0000U
+#define DMA_MDATAALIGN_HALFWORD 0x2000U
+
+#define __HAL_SPI_GET_FLAG(h, f) ((((h)->Instance->SR) & (f)) == (f))
+#define __HAL_SPI_ENABLE(h) ((h)->Instance->CR1 |= SPI_CR1_SPE)
+#define __HAL_SPI_DISABLE(h) ((h)->Instance->CR1 &= ~SPI_CR1_SPE)
+
+#define SET_BIT(REG, BIT) ((REG) |= (BIT))
+#define CLEAR_BIT(REG, BIT) ((REG) &= ~(BIT))
+#define READ_BIT(REG, BIT) ((REG) & (BIT))
+#define MODIFY_REG(REG, CLEARMASK, SETMASK) ((REG) = (((REG) & (~(CLEARMASK))) | (SETMASK)))
+
+// size为帧数（8位或16位，由CR1的DFF决定）
+HAL_StatusTypeDef HAL_SPI_Transmit(SPI_HandleTypeDef* hspi, uint8_t* data, uint16_t size, uint32_t timeout);
+HAL_StatusTypeDef HAL_SPI_Transmit_DMA(SPI_HandleTypeDef* hspi, uint8_t* data, uint16_t size);
+HAL_SPI_StateTypeDef HAL_SPI_GetState(SPI_HandleTypeDef* hspi);
+void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef* hspi);
+
+// 中断屏蔽：模拟的DMA完成中断在另一个线程中运行，关中断即持有同一把锁
+void HostIRQ_Disable(void);
+void HostIRQ_Enable(void);
+uint32_t HostIRQ_GetPrimask(void);
+#define __disable_irq() HostIRQ_Disable()
+#define __enable_irq() HostIRQ_Enable()
+#define __get_PRIMASK() HostIRQ_GetPrimask()
+
+static inline uint32_t __REV(uint32_t value) {
+    return __builtin_bswap32(value);
+}
+
+// FATFS/Target/bsp_driver_sd.h用到的SD卡信息
+typedef struct {
+    uint32_t CardType;
+    uint32_t CardVersion;
+    uint32_t Class;
+    uint32_t RelCardAdd;
+    uint32_t BlockNbr;
+    uint32_t BlockSize;
+    uint32_t LogBlockNbr;
+    uint32_t LogBlockSize;
+} HAL_SD_CardInfoTypeDef;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOST_STM32F4XX_HAL_H
@@ -0,0 +1,190 @@
+//
+// PNG解码基准：在内存中生成测试图片（各种滤波类型轮换，zlib默认压缩级别），
+// 经FatFs替身反复解码，逐像素核对RGB565结果，并统计速度和读卡次数
+//
+
+#include "png_decoder.h"
+#include "ff_host.h"
+#include <zlib.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+struct TestImage {
+    const char* name;
+    uint16_t width;
+    uint16_t height;
+    uint8_t color_type;     // 0=灰度 2=RGB 6=RGBA，位深均为8
+    std::vector<uint8_t> png;
+    std::vector<uint16_t> expected;
+};
+
+uint8_t channels_of(uint8_t color_type) {
+    return color_type == 6 ? 4 : color_type == 2 ? 3 : 1;
+}
+
+uint16_t rgb565(uint8_t r, uint8_t g, uint8_t b) {
+    return (uint16_t)(((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3));
+}
+
+// 与解码器相同的Alpha混合（与黑色背景）
+uint8_t blend(uint8_t v, uint8_t a) {
+    uint32_t t = (uint32_t)v * a + 128;
+    return (uint8_t)((t + (t >> 8)) >> 8);
+}
+
+uint8_t paeth(int a, int b, int c) {
+    int p = a + b - c;
+    int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+    return (uint8_t)(pa <= pb && pa <= pc ? a : pb <= pc ? b : c);
+}
+
+void put_u32(std::vector<uint8_t>& out, uint32_t v) {
+    for (int shift = 24; shift >= 0; shift -= 8) out.push_back((uint8_t)(v >> shift));
+}
+
+void put_chunk(std::vector<uint8_t>& out, const char* type, const std::vector<uint8_t>& data) {
+    put_u32(out, (uint32_t)data.size());
+    size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+    put_u32(out, (uint32_t)crc32(0, out.data() + start, (uInt)(out.size() - start)));
+}
+
+// 平滑渐变叠加少量噪声，接近照片的压缩率；每行轮换使用五种滤波
+TestImage make_image(const char* name, uint16_t width, uint16_t height, uint8_t color_type) {
+    TestImage image{ name, width, height, color_type, {}, {} };
+    uint8_t ch = channels_of(color_type);
+    size_t row_bytes = (size_t)width * ch;
+    std::vector<uint8_t> prev(row_bytes, 0), row(row_bytes), raw;
+    srand(width * 31 + color_type);
+
+    for (uint16_t y = 0; y < height; y++) {
+        for (uint16_t x = 0; x < width; x++) {
+            uint8_t* p = &row[(size_t)x * ch];
+            for (uint8_t c = 0; c < ch; c++) {
+                int v = (x * (c + 1) + y * (3 - c % 3)) / 2 + rand() % 8;
+                p[c] = (uint8_t)(c == 3 ? 128 + (x ^ y) % 128 : v);
+            }
+            uint16_t pixel;
+            if (color_type == 0) pixel = rgb565(p[0], p[0], p[0]);
+            else if (color_type == 2) pixel = rgb565(p[0], p[1], p[2]);
+            else pixel = rgb565(blend(p[0], p[3]), blend(p[1], p[3]), blend(p[2], p[3]));
+            image.expected.push_back(pixel);
+        }
+
+        uint8_t filter = y % 5;
+        raw.push_back(filter);
+        for (size_t i = 0; i < row_bytes; i++) {
+            int a = i >= ch ? row[i - ch] : 0;
+            int b = prev[i];
+            int c = i >= ch ? prev[i - ch] : 0;
+            int pred = filter == 0 ? 0 : filter == 1 ? a : filter == 2 ? b : filter == 3 ? (a + b) / 2 : paeth(a, b, c);
+            raw.push_back((uint8_t)(row[i] - pred));
+        }
+        prev = row;
+    }
+
+    uLongf z_size = compressBound((uLong)raw.size());
+    std::vector<uint8_t> z(z_size);
+    compress2(z.data(), &z_size, raw.data(), (uLong)raw.size(), Z_DEFAULT_COMPRESSION);
+    z.resize(z_size);
+
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    image.png.assign(signature, signature + 8);
+    std::vector<uint8_t> ihdr;
+    put_u32(ihdr, width);
+    put_u32(ihdr, height);
+    ihdr.insert(ihdr.end(), { 8, color_type, 0, 0, 0 });
+    put_chunk(image.png, "IHDR", ihdr);
+    // IDAT按8KB分块，与常见编码器一致，覆盖跨块读取
+    for (size_t i = 0; i < z.size(); i += 8192) {
+        put_chunk(image.png, "IDAT", std::vector<uint8_t>(z.begin() + i, z.begin() + std::min(z.size(), i + 8192)));
+    }
+    put_chunk(image.png, "IEND", {});
+    return image;
+}
+
+struct CheckContext {
+    const TestImage* image;
+    uint32_t mismatches;
+    uint32_t rows;
+};
+
+bool check_row(void* user, uint16_t y, const uint16_t* pixels, uint16_t width) {
+    CheckContext* ctx = static_cast<CheckContext*>(user);
+    const uint16_t* expected = &ctx->image->expected[(size_t)y * ctx->image->width];
+    for (uint16_t x = 0; x < width; x++) ctx->mismatches += pixels[x] != expected[x];
+    ctx->rows++;
+    return true;
+}
+
+volatile uint32_t sink;
+
+bool count_row(void*, uint16_t, const uint16_t* pixels, uint16_t) {
+    // 读一个像素，避免整行的转换被当成无用代码
+    sink += pixels[0];
+    return true;
+}
+
+} // namespace
+
+int main() {
+    TestImage images[] = {
+        make_image("gray 320x240", 320, 240, 0),
+        make_image("rgb  320x240", 320, 240, 2),
+        make_image("rgba 320x240", 320, 240, 6),
+        make_image("rgb  1024x768", 1024, 768, 2),
+    };
+
+    int failures = 0;
+    for (TestImage& image : images) {
+        HostFS_Reset();
+        HostFS_AddImage("0:/bench.png", image.png.data(), image.png.size());
+
+        FIL file;
+        PngInfo info;
+        if (f_open(&file, "0:/bench.png", FA_READ) != FR_OK || PNG_ReadInfo(&file, &info) != PNG_SUCCESS) {
+            printf("FAIL %s: 读取文件头失败\n", image.name);
+            return 1;
+        }
+
+        // 正确性
+        CheckContext ctx{ &image, 0, 0 };
+        HostFS_ResetStats();
+        PngError error = PNG_Decode(&file, check_row, &ctx);
+        HostFsStats io = HostFS_GetStats();
+        if (error != PNG_SUCCESS || ctx.rows != image.height || ctx.mismatches) {
+            printf("FAIL %s: %s, %u行, %u个像素不一致\n", image.name, PNG_GetErrorString(error), ctx.rows,
+                   ctx.mismatches);
+            failures++;
+            f_close(&file);
+            continue;
+        }
+
+        // 速度：至少解码0.3秒
+        uint32_t frames = 0;
+        auto start = std::chrono::steady_clock::now();
+        double seconds = 0;
+        do {
+            PNG_Decode(&file, count_row, nullptr);
+            frames++;
+            seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        } while (seconds < 0.3);
+        f_close(&file);
+
+        double pixels = (double)image.width * image.height * frames;
+        printf("%s: 文件%6zu字节, %.2f ms/帧, %6.1f M像素/s, %5.1f MB/s压缩数据, "
+               "f_read %u次, 读卡%u扇区, 堆%zu字节\n",
+               image.name, image.png.size(), seconds * 1000 / frames, pixels / seconds / 1e6,
+               (double)image.png.size() * frames / seconds / 1e6, io.read_calls, io.sector_reads,
+               PNG_GetMemoryUsage(&info, 0));
+    }
+
+    printf(failures ? "FAILED %d\n" : "ok\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,428 @@
+//
+// 幻灯片的堆预算：在与固件相同大小的堆（链接脚本的_Min_Heap_Size，首次适配、每块8字节头）中
+// 按固件的顺序分配常驻内存（条带模式的画布、128个字形缓存位置的12x12字体、文件管理器），
+// 把画布的内存借给幻灯片作第一个帧缓冲区，打印各部分占用的字节数并检查
+//   1. 画布借出的整块内存放得下幻灯片的一帧，幻灯片至少有一个帧缓冲区，自行分配的帧缓冲区之外仍留有SLIDE_DECODE_RESERVE字节
+//   2. 解码器放得下的图片预加载后切换不读卡（预加载的解码成功）；放不下的（32KB解压窗口的PNG）只检查不破坏堆
+//   3. 关闭幻灯片、收回内存后画布照常绘制，堆恢复到打开幻灯片之前
+// malloc/free/calloc/strdup经链接器--wrap、new/delete经全局替换进入模拟的堆；
+// SPI替身不记录传输内容，不占用模拟的堆；FatFs替身自身的少量分配计入其中，大致相当于固件中FatFs长文件名的工作缓冲区
+//
+
+#include "canvas.h"
+#include "slideshow.h"
+#include "thumb_cache.h"
+#include "unicode_font_types.h"
+#include "png_decoder.h"
+#include "ff_host.h"
+#include "hal_host.h"
+#include "st7735.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+extern "C" {
+void* __real_malloc(size_t size);
+void __real_free(void* ptr);
+void* __real_calloc(size_t count, size_t size);
+char* __real_strdup(const char* str);
+}
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const char* what) {
+    if (!ok) {
+        printf("FAIL %s\n", what);
+        failures++;
+    }
+}
+
+// 模拟的堆：块头记录整块大小（含头）和是否占用，释放时与相邻的空闲块合并
+namespace heap {
+
+const uint32_t SIZE = 0x16000;
+const uint32_t HEADER = 8;
+
+struct Block {
+    uint32_t size;
+    uint32_t used;
+};
+
+alignas(8) uint8_t memory[SIZE];
+bool active = false;
+uint32_t in_use = 0;
+uint32_t peak = 0;
+std::recursive_mutex lock;
+
+Block* at(uint32_t offset) { return reinterpret_cast<Block*>(memory + offset); }
+
+void start() {
+    *at(0) = { SIZE, 0 };
+    in_use = peak = 0;
+    active = true;
+}
+
+bool owns(const void* ptr) {
+    return ptr >= memory && ptr < memory + SIZE;
+}
+
+void* allocate(size_t size) {
+    std::lock_guard<std::recursive_mutex> guard(lock);
+    uint32_t need = (uint32_t)((size + 7) & ~(size_t)7) + HEADER;
+    for (uint32_t offset = 0; offset < SIZE; offset += at(offset)->size) {
+        Block* block = at(offset);
+        if (block->used || block->size < need) continue;
+        if (block->size - need >= 2 * HEADER) {
+            *at(offset + need) = { block->size - need, 0 };
+            block->size = need;
+        }
+        block->used = 1;
+        in_use += block->size;
+        peak = std::max(peak, in_use);
+        return memory + offset + HEADER;
+    }
+    return nullptr;
+}
+
+void release(void* ptr) {
+    std::lock_guard<std::recursive_mutex> guard(lock);
+    Block* block = reinterpret_cast<Block*>(static_cast<uint8_t*>(ptr) - HEADER);
+    block->used = 0;
+    in_use -= block->size;
+    for (uint32_t offset = 0; offset < SIZE; offset += at(offset)->size) {
+        Block* current = at(offset);
+        while (!current->used && offset + current->size < SIZE && !at(offset + current->size)->used) {
+            current->size += at(offset + current->size)->size;
+        }
+    }
+}
+
+uint32_t largest_free() {
+    std::lock_guard<std::recursive_mutex> guard(lock);
+    uint32_t largest = 0;
+    for (uint32_t offset = 0; offset < SIZE; offset += at(offset)->size) {
+        if (!at(offset)->used) largest = std::max(largest, at(offset)->size - HEADER);
+    }
+    return largest;
+}
+
+void* any_allocate(size_t size) {
+    return active ? allocate(size) : __real_malloc(size);
+}
+
+void any_release(void* ptr) {
+    if (owns(ptr)) release(ptr);
+    else __real_free(ptr);
+}
+
+} // namespace heap
+
+} // namespace
+
+extern "C" {
+
+void* __wrap_malloc(size_t size) {
+    return heap::any_allocate(size);
+}
+
+void __wrap_free(void* ptr) {
+    heap::any_release(ptr);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+    if (!heap::active) return __real_calloc(count, size);
+    void* ptr = heap::allocate(count * size);
+    if (ptr) memset(ptr, 0, count * size);
+    return ptr;
+}
+
+char* __wrap_strdup(const char* str) {
+    if (!heap::active) return __real_strdup(str);
+    auto* copy = static_cast<char*>(heap::allocate(strlen(str) + 1));
+    if (copy) strcpy(copy, str);
+    return copy;
+}
+
+} // extern "C"
+
+void* operator new(size_t size) {
+    void* ptr = heap::any_allocate(size ? size : 1);
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    if (ptr) heap::any_release(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    operator delete(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    operator delete(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+    operator delete(ptr);
+}
+
+namespace {
+
+// 与main.cpp相同的画布和字体配置
+const uint32_t CANVAS_MEMORY_BYTES = SLIDE_FRAME_PIXELS * sizeof(uint16_t);
+const uint16_t MENU_GLYPH_CACHE_SIZE = 128;
+
+const char* const FONT_PATH = "/font/12x12.ufnt";
+const uint32_t FIRST_CHAR = 0x4E00;
+const uint32_t CHAR_COUNT = 7000;
+const uint16_t CHAR_SIZE = 12;
+
+void put_be(std::vector<uint8_t>& out, uint32_t v, int bytes) {
+    for (int shift = (bytes - 1) * 8; shift >= 0; shift -= 8) out.push_back((uint8_t)(v >> shift));
+}
+
+void put_le(std::vector<uint8_t>& out, uint32_t v, int bytes) {
+    for (int i = 0; i < bytes; i++) out.push_back((uint8_t)(v >> (i * 8)));
+}
+
+// v1格式的12x12字体，字数与GB2312相当
+std::vector<uint8_t> make_font() {
+    std::mt19937 rng(31);
+    uint32_t glyph_size = GlyphRowBytes(CHAR_SIZE, 1) * CHAR_SIZE;
+    uint32_t offset = 12 + CHAR_COUNT * FONT_INDEX_ENTRY_SIZE;
+    std::vector<uint8_t> data = { 'U', 'F', 'N', 'T' };
+    put_be(data, CHAR_SIZE, 2);
+    put_be(data, CHAR_SIZE, 2);
+    put_be(data, CHAR_COUNT, 4);
+    for (uint32_t i = 0; i < CHAR_COUNT; i++) {
+        put_be(data, FIRST_CHAR + i, 4);
+        put_be(data, CHAR_SIZE, 2);
+        put_be(data, CHAR_SIZE, 2);
+        put_be(data, offset + i * glyph_size, 4);
+        put_be(data, glyph_size, 4);
+    }
+    for (uint32_t i = 0; i < CHAR_COUNT * glyph_size; i++) data.push_back((uint8_t)rng());
+    return data;
+}
+
+// 24位BMP，自下而上存放
+std::vector<uint8_t> make_bmp(uint16_t width, uint16_t height, uint32_t seed) {
+    uint32_t row_size = (width * 3u + 3) & ~3u;
+    std::vector<uint8_t> data = { 'B', 'M' };
+    put_le(data, 54 + row_size * height, 4);
+    put_le(data, 0, 4);
+    put_le(data, 54, 4);
+    put_le(data, 40, 4);
+    put_le(data, width, 4);
+    put_le(data, height, 4);
+    put_le(data, 1, 2);
+    put_le(data, 24, 2);
+    put_le(data, 0, 4);
+    put_le(data, row_size * height, 4);
+    put_le(data, 2835, 4);
+    put_le(data, 2835, 4);
+    put_le(data, 0, 4);
+    put_le(data, 0, 4);
+    for (uint16_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < row_size; x++) data.push_back((uint8_t)(x * seed + y));
+    }
+    return data;
+}
+
+#ifdef HAVE_ZLIB
+void put_chunk(std::vector<uint8_t>& out, const char* type, const std::vector<uint8_t>& data) {
+    put_be(out, (uint32_t)data.size(), 4);
+    size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+    put_be(out, (uint32_t)crc32(0, out.data() + start, (uInt)(out.size() - start)), 4);
+}
+
+// RGB的PNG，解压窗口为1 << window_bits字节（zlib默认15，即32KB；小图片常用更小的窗口）
+std::vector<uint8_t> make_png(uint16_t width, uint16_t height, int window_bits) {
+    std::vector<uint8_t> raw;
+    srand(width);
+    for (uint16_t y = 0; y < height; y++) {
+        raw.push_back(0);
+        for (uint32_t i = 0; i < width * 3u; i++) raw.push_back((uint8_t)((i + y) / 2 + rand() % 8));
+    }
+    z_stream stream{};
+    deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY);
+    std::vector<uint8_t> z(deflateBound(&stream, (uLong)raw.size()));
+    stream.next_in = raw.data();
+    stream.avail_in = (uInt)raw.size();
+    stream.next_out = z.data();
+    stream.avail_out = (uInt)z.size();
+    deflate(&stream, Z_FINISH);
+    z.resize(stream.total_out);
+    deflateEnd(&stream);
+
+    std::vector<uint8_t> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    std::vector<uint8_t> ihdr;
+    put_be(ihdr, width, 4);
+    put_be(ihdr, height, 4);
+    ihdr.insert(ihdr.end(), { 8, 2, 0, 0, 0 });
+    put_chunk(png, "IHDR", ihdr);
+    put_chunk(png, "IDAT", z);
+    put_chunk(png, "IEND", {});
+    return png;
+}
+#endif
+
+// 文件管理器显示一个目录时常驻的内存：缩略图数据库（句柄与键表）、预览像素、一页菜单（20项）和待生成的文件名，
+// 以及各级上层目录的路径（进入子目录前上层的菜单和缩略图数据库已经释放，只保留256字节的路径）；
+// 句柄的大小按thumb_cache.cpp中的ThumbDB估计，菜单项按每项64字节估计
+struct FileManager {
+    std::vector<void*> blocks;
+
+    size_t depth;
+
+    explicit FileManager(size_t depth) : depth(depth) {
+        for (size_t i = 0; i < depth; i++) blocks.push_back(new char[256]);
+        blocks.push_back(malloc(sizeof(FIL) + 256 + sizeof(void*) + 4 + (THUMB_DB_MAX_ENTRIES + 7) / 8 +
+                                THUMB_QUEUE_SIZE * sizeof(char*) + 2));
+        blocks.push_back(malloc(THUMB_DB_MAX_ENTRIES * sizeof(ThumbKey)));
+        blocks.push_back(malloc(THUMB_WIDTH * THUMB_HEIGHT * sizeof(uint16_t)));
+        for (int i = 0; i < 20; i++) {
+            blocks.push_back(malloc(64));
+            blocks.push_back(malloc(16));
+            blocks.push_back(strdup("IMG_0000.JPG"));
+        }
+    }
+
+    ~FileManager() {
+        for (size_t i = 0; i < blocks.size(); i++) {
+            if (i < depth) delete[] static_cast<char*>(blocks[i]);
+            else free(blocks[i]);
+        }
+    }
+};
+
+// 一页12x12的菜单文字
+void draw_menu(Canvas& canvas, UnicodeFont& font, uint32_t seed) {
+    canvas.FillCanvas(ST7735_BLACK);
+    for (uint16_t line = 0; line < 10; line++) {
+        char text[64];
+        size_t len = 0;
+        for (uint32_t i = 0; i < 13; i++) {
+            uint32_t unicode = FIRST_CHAR + (seed * 131 + line * 13 + i) % CHAR_COUNT;
+            text[len++] = (char)(0xE0 | (unicode >> 12));
+            text[len++] = (char)(0x80 | ((unicode >> 6) & 0x3F));
+            text[len++] = (char)(0x80 | (unicode & 0x3F));
+        }
+        text[len] = '\0';
+        canvas.WriteUnicodeString(0, (uint16_t)(line * CHAR_SIZE), text, &font, ST7735_WHITE);
+    }
+    canvas.DrawCanvasDMA(0, 0, true);
+}
+
+struct TestPicture {
+    std::string name;
+    std::vector<uint8_t> data;
+    uint32_t decoder_bytes;     // 解码器需要的连续内存，超过剩余的堆时预加载失败，只检查不会破坏堆
+};
+
+} // namespace
+
+int main() {
+    HostSPI_SetRecording(false);
+    HostSPI_HoldDMA(false);
+    ST7735_Init();
+
+    std::vector<uint8_t> font_file = make_font();
+    HostFS_AddImage(FONT_PATH, font_file.data(), font_file.size());
+    std::vector<TestPicture> pictures;
+    pictures.push_back({ "/pics/a.bmp", make_bmp(320, 240, 3), 0 });
+    pictures.push_back({ "/pics/b.bmp", make_bmp(ST7735_WIDTH, ST7735_HEIGHT, 5), 0 });
+#ifdef HAVE_ZLIB
+    PngInfo large = { 640, 480, 8, 2, 0 }, small = { 200, 150, 8, 2, 0 };
+    pictures.push_back({ "/pics/c.png", make_png(640, 480, 15), (uint32_t)PNG_GetMemoryUsage(&large, 1u << 15) });
+    pictures.push_back({ "/pics/d.png", make_png(200, 150, 13), (uint32_t)PNG_GetMemoryUsage(&small, 1u << 13) });
+#endif
+    pictures.push_back({ "/pics/e.bmp", make_bmp(90, 400, 7), 0 });
+    for (const TestPicture& picture : pictures) HostFS_AddImage(picture.name.c_str(), picture.data.data(), picture.data.size());
+
+    heap::start();
+    {
+        Canvas canvas(160, 128, CANVAS_STRIP_ROWS, CANVAS_MEMORY_BYTES - Canvas::StripMemorySize(160, CANVAS_STRIP_ROWS, 0));
+        uint32_t canvas_bytes = heap::in_use;
+        UnicodeFont font;
+        check(font.Load(FONT_PATH, MENU_GLYPH_CACHE_SIZE), "加载字体");
+        draw_menu(canvas, font, 0);
+        uint32_t font_bytes = heap::in_use - canvas_bytes;
+        FileManager manager(2);
+        uint32_t manager_bytes = heap::in_use - canvas_bytes - font_bytes;
+        uint32_t before_open = heap::in_use;
+        printf("堆%u字节：画布%u，字体%u，文件管理器（第二层目录）%u，空闲%u（最大连续%u）\n", heap::SIZE, canvas_bytes,
+               font_bytes, manager_bytes, heap::SIZE - heap::in_use, heap::largest_free());
+
+        uint32_t lent_size = 0;
+        void* lent = canvas.LendMemory(&lent_size);
+        check(lent && lent_size >= CANVAS_MEMORY_BYTES, "画布借出的内存放得下幻灯片的一帧");
+        draw_menu(canvas, font, 1);
+        check(heap::in_use == before_open, "借出期间绘制不分配内存");
+
+        SlideConfig config;
+        SLIDE_GetDefaultConfig(&config);
+        config.dwell_ms = 0;
+        config.transition = SLIDE_TRANSITION_WIPE;
+        config.transition_ms = 0;      // 替身的HAL_GetTick不走时
+        config.frame_buffers[0] = static_cast<uint16_t*>(lent);
+        {
+            Slideshow slideshow("/pics/a.bmp", &config);
+            check(slideshow.IsOpen(), "打开幻灯片");
+            uint32_t opened = heap::in_use;
+            uint32_t free_bytes = heap::largest_free();
+            printf("幻灯片：%u张图片，%u个帧缓冲区，句柄和文件名%u字节，之后最大连续空闲%u字节\n",
+                   slideshow.GetCount(), slideshow.GetFrameCount(), opened - before_open, free_bytes);
+            check(slideshow.GetFrameCount() >= 1, "至少有一个帧缓冲区");
+            check(slideshow.GetFrameCount() == 1 || free_bytes >= SLIDE_DECODE_RESERVE,
+                  "自行分配的帧缓冲区之外留有SLIDE_DECODE_RESERVE字节");
+
+            heap::peak = heap::in_use;
+            for (size_t i = 0; i < pictures.size(); i++) {
+                slideshow.Poll();
+                HostFS_ResetStats();
+                slideshow.Next();
+                const TestPicture& picture = pictures[(i + 1) % pictures.size()];
+                bool fits = picture.decoder_bytes <= free_bytes;
+                if (picture.decoder_bytes) {
+                    printf("  %s：解码器需要%u字节，%s\n", picture.name.c_str(), picture.decoder_bytes,
+                           fits ? "预加载" : "放不下，不能解码");
+                }
+                // 说明文字用栈上的缓冲区，不在模拟的堆中分配
+                char what[96];
+                snprintf(what, sizeof(what), "%s预加载后切换时不读卡", picture.name.c_str());
+                if (fits) check(HostFS_GetStats().sector_reads == 0, what);
+                snprintf(what, sizeof(what), "%s切换后堆没有泄漏", picture.name.c_str());
+                check(heap::in_use == opened, what);
+            }
+            printf("幻灯片：播放时堆峰值%u字节，最少空闲%u字节\n", heap::peak, heap::SIZE - heap::peak);
+        }
+        canvas.ReturnMemory();
+        check(heap::in_use == before_open, "关闭幻灯片后堆恢复");
+
+        draw_menu(canvas, font, 2);
+        check(canvas.isBufferValid() && !canvas.isDisplayListOverflowed(), "收回内存后画布照常绘制");
+    }
+    check(heap::in_use == 0, "全部释放");
+    heap::active = false;
+
+    printf(failures ? "FAILED %d\n" : "ok\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,214 @@
+//
+// ST7735事务队列测试：在SPI/DMA替身上运行真实的驱动，检查
+//   1. 事务按提交顺序发送，命令/参数/像素的DC和帧宽正确，回调按顺序调用
+//   2. 第一次传输之后的每一段都由HAL_SPI_TxCpltCallback在中断中接力启动，回调也在中断中调用
+//   3. 队列满时提交会等待，直到中断腾出描述符
+//
+
+#include "hal_host.h"
+#include "st7735.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const char* what) {
+    if (!ok) {
+        printf("FAIL %s\n", what);
+        failures++;
+    }
+}
+
+// 一条命令和紧随其后的参数或像素（DC为高的所有字节）
+struct Packet {
+    uint8_t command;
+    std::vector<uint8_t> data;
+    bool frame16;               // 数据中是否出现过16位帧
+};
+
+std::vector<Packet> split_packets(const std::vector<HostSpiTransfer>& log) {
+    std::vector<Packet> packets;
+    for (const HostSpiTransfer& t : log) {
+        if (!t.data) {
+            for (uint8_t cmd : t.bytes) packets.push_back({ cmd, {}, false });
+        }
+        else if (!packets.empty()) {
+            packets.back().data.insert(packets.back().data.end(), t.bytes.begin(), t.bytes.end());
+            packets.back().frame16 |= t.frame16;
+        }
+    }
+    return packets;
+}
+
+std::vector<uint8_t> window_args(uint8_t a, uint8_t b) {
+    return { 0, a, 0, b };
+}
+
+std::vector<uint8_t> pixel_bytes(const std::vector<uint16_t>& pixels) {
+    std::vector<uint8_t> bytes;
+    for (uint16_t p : pixels) {
+        bytes.push_back((uint8_t)(p >> 8));
+        bytes.push_back((uint8_t)p);
+    }
+    return bytes;
+}
+
+// 回调记录：在模拟的中断线程中调用
+std::mutex callback_mutex;
+std::vector<int> callback_order;
+bool callback_outside_isr = false;
+
+void record_callback(void* user) {
+    std::lock_guard<std::mutex> lock(callback_mutex);
+    callback_order.push_back((int)(intptr_t)user);
+    if (!__get_PRIMASK()) callback_outside_isr = true;
+}
+
+std::vector<int> take_callbacks() {
+    std::lock_guard<std::mutex> lock(callback_mutex);
+    std::vector<int> order;
+    order.swap(callback_order);
+    return order;
+}
+
+void expect_packet(const std::vector<Packet>& packets, size_t index, uint8_t command,
+                   const std::vector<uint8_t>& data, const char* what) {
+    bool ok = index < packets.size() && packets[index].command == command && packets[index].data == data;
+    if (!ok) {
+        printf("  packet %zu: ", index);
+        if (index < packets.size()) printf("cmd %02X, %zu bytes", packets[index].command, packets[index].data.size());
+        printf(" (want cmd %02X, %zu bytes)\n", command, data.size());
+    }
+    check(ok, what);
+}
+
+void test_order_and_chaining() {
+    HostSPI_Reset();
+    take_callbacks();
+
+    std::vector<uint16_t> window = { 0x1234, 0xF800, 0x07E0, 0x001F, 0xFFFF, 0x0000, 0xA5A5, 0x5A5A };
+    std::vector<uint16_t> frame(16 * 4);
+    for (size_t i = 0; i < frame.size(); i++) frame[i] = (uint16_t)(0x1000 + i);
+    uint8_t gamma = GAMMA_22;
+
+    // 传输被扣住时提交所有事务，只有第一个命令字节能发出
+    HostSPI_HoldDMA(true);
+    ST7735_QueueWindow(0, 0, 3, 1, window.data(), window.size() * 2, record_callback, (void*)0);
+    ST7735_QueueCommand(ST7735_GAMSET, &gamma, 1);
+    ST7735_QueueFill(4, 4, 5, 5, 0xBEEF, record_callback, (void*)1);
+    ST7735_Transaction strided = {};
+    strided.set_window = true;
+    strided.x0 = 10;
+    strided.y0 = 20;
+    strided.x1 = 12;
+    strided.y1 = 21;
+    strided.data = (const uint8_t*)(frame.data() + 2);
+    strided.length = 3 * 2;
+    strided.pixels = true;
+    strided.repeat = 2;
+    strided.stride = 16 * 2;
+    strided.callback = record_callback;
+    strided.user = (void*)2;
+    ST7735_QueueSubmit(&strided);
+
+    check(!ST7735_QueueIsIdle(), "扣住DMA时队列应处于运行状态");
+    check(take_callbacks().empty(), "扣住DMA时不应调用回调");
+
+    // 放开后不显式等待，阻塞式命令自己会等队列清空
+    HostSPI_HoldDMA(false);
+    ST7735_WriteCommand(ST7735_NOP);
+    check(ST7735_QueueIsIdle(), "阻塞命令返回时队列应为空");
+
+    std::vector<int> order = take_callbacks();
+    check(order == std::vector<int>({ 0, 1, 2 }), "回调按提交顺序调用");
+    check(!callback_outside_isr, "回调应在完成中断中调用");
+    check(HostSPI_GetOverlaps() == 0, "不应在传输进行中启动新的传输");
+
+    std::vector<HostSpiTransfer> log = HostSPI_TakeLog();
+    std::vector<Packet> packets = split_packets(log);
+    check(packets.size() == 11, "命令个数");
+    expect_packet(packets, 0, ST7735_CASET, window_args(0, 3), "窗口1 CASET");
+    expect_packet(packets, 1, ST7735_RASET, window_args(0, 1), "窗口1 RASET");
+    expect_packet(packets, 2, ST7735_RAMWR, pixel_bytes(window), "窗口1像素");
+    expect_packet(packets, 3, ST7735_GAMSET, { GAMMA_22 }, "命令参数");
+    expect_packet(packets, 4, ST7735_CASET, window_args(4, 5), "填充 CASET");
+    expect_packet(packets, 5, ST7735_RASET, window_args(4, 5), "填充 RASET");
+    expect_packet(packets, 6, ST7735_RAMWR, pixel_bytes(std::vector<uint16_t>(4, 0xBEEF)), "填充像素");
+    expect_packet(packets, 7, ST7735_CASET, window_args(10, 12), "跨行 CASET");
+    expect_packet(packets, 8, ST7735_RASET, window_args(20, 21), "跨行 RASET");
+    expect_packet(packets, 9, ST7735_RAMWR,
+                  pixel_bytes({ frame[2], frame[3], frame[4], frame[18], frame[19], frame[20] }), "跨行像素");
+    expect_packet(packets, 10, ST7735_NOP, {}, "阻塞命令排在队列之后");
+    for (size_t i = 0; i + 1 < packets.size(); i++) {
+        bool pixels = packets[i].command == ST7735_RAMWR;
+        if (packets[i].frame16 != pixels) check(false, "只有像素以16位帧发送");
+    }
+
+    // 第一段由提交者启动，之后每一段都由完成中断接力
+    size_t dma = 0, chained = 0;
+    for (const HostSpiTransfer& t : log) {
+        if (!t.dma) continue;
+        if (dma++ > 0) chained += t.from_isr;
+        else check(!t.from_isr, "第一段传输由提交者启动");
+    }
+    check(dma > 1 && chained == dma - 1, "后续传输都由HAL_SPI_TxCpltCallback接力");
+    printf("order/chaining: %zu次DMA传输，%zu次由完成中断接力\n", dma, chained);
+}
+
+void test_queue_full_wait() {
+    HostSPI_Reset();
+    take_callbacks();
+
+    // 环形队列最多容纳ST7735_QUEUE_DEPTH - 1个事务
+    const int capacity = ST7735_QUEUE_DEPTH - 1;
+    static uint16_t colors[ST7735_QUEUE_DEPTH];
+    HostSPI_HoldDMA(true);
+    for (int i = 0; i < capacity; i++) {
+        colors[i] = (uint16_t)(0x0100 + i);
+        ST7735_QueueWindow(i, 0, i, 0, &colors[i], 2, record_callback, (void*)(intptr_t)i);
+    }
+
+    std::atomic<bool> submitted{ false };
+    colors[capacity] = 0xCAFE;
+    std::thread late([&] {
+        ST7735_QueueWindow(capacity, 0, capacity, 0, &colors[capacity], 2, record_callback,
+                           (void*)(intptr_t)capacity);
+        submitted = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    check(!submitted, "队列满时提交应等待");
+    check(take_callbacks().empty(), "等待期间没有事务完成");
+
+    HostSPI_HoldDMA(false);
+    late.join();
+    check(submitted, "腾出描述符后提交应返回");
+    ST7735_QueueFlush();
+
+    std::vector<int> order = take_callbacks();
+    bool in_order = order.size() == (size_t)capacity + 1;
+    for (size_t i = 0; in_order && i < order.size(); i++) in_order = order[i] == (int)i;
+    check(in_order, "等待后提交的事务排在最后");
+
+    std::vector<Packet> packets = split_packets(HostSPI_TakeLog());
+    check(!packets.empty() && packets.back().command == ST7735_RAMWR &&
+          packets.back().data == pixel_bytes({ 0xCAFE }), "最后发送的是等待后提交的像素");
+    check(HostSPI_GetOverlaps() == 0, "不应在传输进行中启动新的传输");
+    printf("queue full: %d个事务排队，第%d个等待后提交\n", capacity, capacity + 1);
+}
+
+} // namespace
+
+int main() {
+    ST7735_Init();
+    test_order_and_chaining();
+    test_queue_full_wait();
+
+    printf(failures ? "FAILED %d\n" : "ok\n", failures);
+    return failures ? 1 : 0;
+}
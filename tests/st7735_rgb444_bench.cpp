@@ -0,0 +1,247 @@
+//
+// 12位（RGB444）模式基准：同一帧分别以16位和12位模式经真实的驱动和SPI/DMA替身发送到面板模型，
+// 统计RAMWR之后的像素字节数（SPI传输时间与之成正比），并检查
+//   1. 12位模式的字节数为16位模式的3/4，屏幕内容为原图按RGB444量化的结果
+//   2. 奇数宽度的窗口、跨行的暂存像素和纯色填充不会多写或少写像素
+//   3. 不足一个像素的像素事务只发送窗口和命令，回调仍按顺序调用，不读写缓冲区之外的数据
+//
+
+#include "hal_host.h"
+#include "panel_host.h"
+#include "st7735.h"
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <random>
+#include <vector>
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const char* what) {
+    if (!ok) {
+        printf("FAIL %s\n", what);
+        failures++;
+    }
+}
+
+// 与面板模型相同的RGB444量化：各分量取高4位，再把高位复制到低位
+uint16_t quantize(uint16_t c) {
+    uint8_t r = (uint8_t)(c >> 12), g = (uint8_t)((c >> 7) & 0x0F), b = (uint8_t)((c >> 1) & 0x0F);
+    return (uint16_t)(((r << 1 | r >> 3) << 11) | ((g << 2 | g >> 2) << 5) | (b << 1 | b >> 3));
+}
+
+uint16_t expected_pixel(uint16_t c, ST7735_ColorMode mode) {
+    return mode == ST7735_COLOR_12BIT ? quantize(c) : c;
+}
+
+std::mutex callback_mutex;
+std::vector<int> callback_order;
+
+void record_callback(void* user) {
+    std::lock_guard<std::mutex> lock(callback_mutex);
+    callback_order.push_back((int)(intptr_t)user);
+}
+
+std::vector<int> take_callbacks() {
+    std::lock_guard<std::mutex> lock(callback_mutex);
+    std::vector<int> order;
+    order.swap(callback_order);
+    return order;
+}
+
+// 按画布条带模式的方式发送一帧：每FRAME_STRIP行一个窗口
+const uint16_t FRAME_WIDTH = 160, FRAME_HEIGHT = 128, FRAME_STRIP = 16;
+
+void send_frame(const std::vector<uint16_t>& frame) {
+    for (uint16_t y = 0; y < FRAME_HEIGHT; y += FRAME_STRIP) {
+        ST7735_QueueWindow(0, (uint8_t)y, FRAME_WIDTH - 1, (uint8_t)(y + FRAME_STRIP - 1),
+                           &frame[(size_t)y * FRAME_WIDTH], (uint32_t)FRAME_WIDTH * FRAME_STRIP * 2, nullptr,
+                           nullptr);
+    }
+    ST7735_QueueFlush();
+}
+
+struct FrameResult {
+    uint32_t bytes;
+    uint32_t mismatches;
+    double ms;
+};
+
+FrameResult bench_frame(ST7735_ColorMode mode, const std::vector<uint16_t>& frame) {
+    // 面板模型从COLMOD命令得知像素格式
+    HostPanel panel(ST7735_GetWidth(), ST7735_GetHeight());
+    HostSPI_Reset();
+    ST7735_SetColorMode(mode);
+    panel.Apply(HostSPI_TakeLog());
+
+    send_frame(frame);
+    FrameResult result{ panel.Apply(HostSPI_TakeLog()), 0, 0 };
+    for (uint16_t y = 0; y < FRAME_HEIGHT; y++) {
+        for (uint16_t x = 0; x < FRAME_WIDTH; x++) {
+            result.mismatches += panel.Pixel(x, y) != expected_pixel(frame[(size_t)y * FRAME_WIDTH + x], mode);
+        }
+    }
+    check(panel.GetOverruns() == 0, "整帧的像素数与地址窗口一致");
+
+    // 驱动在中断中打包（主机上为替身线程），这里的时间包含替身的开销，只用于比较两种模式
+    const int rounds = 20;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        send_frame(frame);
+        HostSPI_TakeLog();
+    }
+    result.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / rounds;
+    return result;
+}
+
+void test_frame_bytes() {
+    std::mt19937 rng(39);
+    std::vector<uint16_t> frame((size_t)FRAME_WIDTH * FRAME_HEIGHT);
+    for (uint16_t& p : frame) p = (uint16_t)rng();
+
+    FrameResult full = bench_frame(ST7735_COLOR_16BIT, frame);
+    FrameResult reduced = bench_frame(ST7735_COLOR_12BIT, frame);
+    ST7735_SetColorMode(ST7735_COLOR_16BIT);
+
+    // 帧率与SPI时钟成正比，按每MHz换算
+    printf("16位: %6u字节/帧, 每MHz SPI时钟%5.2f帧/s, 主机%.2f ms/帧\n", full.bytes, 1e6 / 8 / full.bytes, full.ms);
+    printf("12位: %6u字节/帧, 每MHz SPI时钟%5.2f帧/s, 主机%.2f ms/帧 (字节数%.1f%%)\n", reduced.bytes,
+           1e6 / 8 / reduced.bytes, reduced.ms, 100.0 * reduced.bytes / full.bytes);
+    check(full.bytes == (uint32_t)FRAME_WIDTH * FRAME_HEIGHT * 2, "16位模式每像素2字节");
+    check(reduced.bytes * 4 == full.bytes * 3, "12位模式的字节数为16位模式的3/4");
+    check(full.mismatches == 0, "16位模式的屏幕内容与原图相同");
+    check(reduced.mismatches == 0, "12位模式的屏幕内容为原图按RGB444量化");
+}
+
+// 奇数宽度的窗口、用stride发送的矩形和纯色填充：暂存的像素在窗口之间补齐，不跨窗口
+void test_odd_windows() {
+    HostPanel panel(ST7735_GetWidth(), ST7735_GetHeight(), 0x0000);
+    HostSPI_Reset();
+    ST7735_SetColorMode(ST7735_COLOR_12BIT);
+    panel.Apply(HostSPI_TakeLog());
+    std::vector<uint16_t> expected((size_t)FRAME_WIDTH * FRAME_HEIGHT, 0x0000);
+
+    std::mt19937 rng(40);
+    std::vector<uint16_t> source((size_t)FRAME_WIDTH * FRAME_HEIGHT);
+    for (uint16_t& p : source) p = (uint16_t)rng();
+
+    for (int i = 0; i < 60; i++) {
+        uint8_t x0 = (uint8_t)(rng() % 150), y0 = (uint8_t)(rng() % 120);
+        uint8_t w = (uint8_t)(1 + rng() % (FRAME_WIDTH - x0)), h = (uint8_t)(1 + rng() % (FRAME_HEIGHT - y0));
+        ST7735_Transaction transaction = {};
+        transaction.set_window = true;
+        transaction.x0 = x0;
+        transaction.y0 = y0;
+        transaction.x1 = (uint8_t)(x0 + w - 1);
+        transaction.y1 = (uint8_t)(y0 + h - 1);
+        if (i % 3 == 0) {
+            uint16_t color = (uint16_t)rng();
+            transaction.fill = true;
+            transaction.color = color;
+            transaction.length = (uint32_t)w * h * 2;
+            for (uint8_t y = 0; y < h; y++) {
+                for (uint8_t x = 0; x < w; x++) expected[(size_t)(y0 + y) * FRAME_WIDTH + x0 + x] = quantize(color);
+            }
+        }
+        else {
+            // 源矩形取帧缓冲区中相同的位置，每行一次重复
+            transaction.data = (const uint8_t*)&source[(size_t)y0 * FRAME_WIDTH + x0];
+            transaction.length = (uint32_t)w * 2;
+            transaction.pixels = true;
+            transaction.repeat = h;
+            transaction.stride = FRAME_WIDTH * 2;
+            for (uint8_t y = 0; y < h; y++) {
+                for (uint8_t x = 0; x < w; x++) {
+                    size_t index = (size_t)(y0 + y) * FRAME_WIDTH + x0 + x;
+                    expected[index] = quantize(source[index]);
+                }
+            }
+        }
+        ST7735_QueueSubmit(&transaction);
+    }
+    ST7735_QueueFlush();
+    panel.Apply(HostSPI_TakeLog());
+    ST7735_SetColorMode(ST7735_COLOR_16BIT);
+
+    uint32_t mismatches = 0;
+    for (uint16_t y = 0; y < FRAME_HEIGHT; y++) {
+        for (uint16_t x = 0; x < FRAME_WIDTH; x++) mismatches += panel.Pixel(x, y) != expected[(size_t)y * FRAME_WIDTH + x];
+    }
+    check(mismatches == 0, "奇数宽度的窗口按RGB444量化后与预期相同");
+    check(panel.GetOverruns() == 0, "奇数宽度的窗口不多写也不少写像素");
+    check(HostSPI_GetOverlaps() == 0, "不应在传输进行中启动新的传输");
+}
+
+// 一个窗口的像素分三个事务提交，中间的事务不足一个像素：暂存的像素留到最后一个事务，
+// 中间的事务只调用回调，不打包缓冲区之外的数据
+void test_short_transactions() {
+    HostPanel panel(ST7735_GetWidth(), ST7735_GetHeight(), 0x0000);
+    HostSPI_Reset();
+    ST7735_SetColorMode(ST7735_COLOR_12BIT);
+    panel.Apply(HostSPI_TakeLog());
+    take_callbacks();
+
+    // 三个像素后紧跟一个不应读取的哨兵值
+    const uint16_t head[4] = { 0xF800, 0x07E0, 0x001F, 0xFFFF };
+    const uint16_t tail[1] = { 0x8410 };
+    ST7735_Transaction first = {};
+    first.set_window = true;
+    first.x0 = 10;
+    first.y0 = 20;
+    first.x1 = 13;
+    first.y1 = 20;
+    first.data = (const uint8_t*)head;
+    first.length = 3 * 2;
+    first.pixels = true;
+    first.callback = record_callback;
+    first.user = (void*)1;
+    ST7735_QueueSubmit(&first);
+
+    // 1字节按整数个像素截为0，无数据的像素事务长度也为0
+    ST7735_Transaction empty = {};
+    empty.data = (const uint8_t*)&head[3];
+    empty.length = 1;
+    empty.pixels = true;
+    empty.callback = record_callback;
+    empty.user = (void*)2;
+    ST7735_QueueSubmit(&empty);
+    empty.data = nullptr;
+    empty.length = 0;
+    empty.user = (void*)3;
+    ST7735_QueueSubmit(&empty);
+
+    ST7735_Transaction last = {};
+    last.data = (const uint8_t*)tail;
+    last.length = 2;
+    last.pixels = true;
+    last.callback = record_callback;
+    last.user = (void*)4;
+    ST7735_QueueSubmit(&last);
+
+    ST7735_QueueFlush();
+    uint32_t bytes = panel.Apply(HostSPI_TakeLog());
+    ST7735_SetColorMode(ST7735_COLOR_16BIT);
+
+    check(take_callbacks() == std::vector<int>({ 1, 2, 3, 4 }), "不足一个像素的事务也按顺序调用回调");
+    check(bytes == 6, "四个像素打包为6字节");
+    bool ok = panel.Pixel(10, 20) == quantize(head[0]) && panel.Pixel(11, 20) == quantize(head[1]) &&
+              panel.Pixel(12, 20) == quantize(head[2]) && panel.Pixel(13, 20) == quantize(tail[0]);
+    check(ok, "暂存的像素跨过空事务与下一个事务配对");
+    check(panel.GetOverruns() == 0, "空事务不写出窗口之外的像素");
+}
+
+} // namespace
+
+int main() {
+    ST7735_Init();
+    check(ST7735_GetWidth() >= FRAME_WIDTH && ST7735_GetHeight() >= FRAME_HEIGHT, "默认方向的屏幕放得下160x128的帧");
+
+    test_frame_bytes();
+    test_odd_windows();
+    test_short_transactions();
+
+    printf(failures ? "FAILED %d\n" : "ok\n", failures);
+    return failures ? 1 : 0;
+}